@@ -0,0 +1,164 @@
+#ifndef BENCHHARNESS_H
+#define BENCHHARNESS_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <utility>
+#include <cstdlib>
+#include <cstdint>
+#include "../tools/SyntheticCards.h"
+
+// Shared helpers for the programs in bench/: a multi-threaded timing loop
+// with per-operation latency percentiles, and a reporter that prints a table
+// and appends one JSON object per result to $ATM_BENCH_JSON so runs from
+// different commits can be compared. Synthetic card numbers come from
+// tools/SyntheticCards.h.
+namespace bench {
+
+typedef std::vector<std::pair<std::string, std::string>> Params;
+
+// Throughput and latency of one benchmark run.
+struct Stats {
+    std::uint64_t ops;
+    double seconds;
+    double ops_per_sec;
+    double p50_ns;
+    double p99_ns;
+    double p999_ns;
+};
+
+inline std::uint64_t now_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Returns the q-quantile of the samples (reorders them).
+inline double percentile(std::vector<std::uint32_t>& samples, double q) {
+    if (samples.empty()) {
+        return 0;
+    }
+    std::size_t index = static_cast<std::size_t>(q * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+// Builds Stats from merged latency samples and the wall-clock duration.
+inline Stats summarize(std::vector<std::uint32_t>& samples, double seconds) {
+    Stats stats;
+    stats.ops = samples.size();
+    stats.seconds = seconds;
+    stats.ops_per_sec = seconds > 0 ? stats.ops / seconds : 0;
+    stats.p50_ns = percentile(samples, 0.50);
+    stats.p99_ns = percentile(samples, 0.99);
+    stats.p999_ns = percentile(samples, 0.999);
+    return stats;
+}
+
+// Runs op(thread_index, iteration) ops_per_thread times on each of threads
+// threads, started together, timing every call.
+template <typename Op>
+Stats run(int threads, std::size_t ops_per_thread, Op op) {
+    std::vector<std::vector<std::uint32_t>> samples(threads);
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::vector<std::uint32_t>& local = samples[t];
+            local.reserve(ops_per_thread);
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (std::size_t i = 0; i < ops_per_thread; ++i) {
+                std::uint64_t start = now_ns();
+                op(t, i);
+                std::uint64_t elapsed = now_ns() - start;
+                local.push_back(elapsed > 0xFFFFFFFFu ? 0xFFFFFFFFu : static_cast<std::uint32_t>(elapsed));
+            }
+        });
+    }
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+    std::uint64_t start = now_ns();
+    go.store(true, std::memory_order_release);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    double seconds = (now_ns() - start) / 1e9;
+
+    std::vector<std::uint32_t> merged;
+    merged.reserve(threads * ops_per_thread);
+    for (const std::vector<std::uint32_t>& local : samples) {
+        merged.insert(merged.end(), local.begin(), local.end());
+    }
+    return summarize(merged, seconds);
+}
+
+// Multiplies iteration counts by $ATM_BENCH_SCALE (default 1) for quick or long runs.
+inline std::size_t scaled(std::size_t count) {
+    const char* scale = std::getenv("ATM_BENCH_SCALE");
+    double factor = scale != nullptr ? std::atof(scale) : 1.0;
+    std::size_t result = static_cast<std::size_t>(count * (factor > 0 ? factor : 1.0));
+    return result > 0 ? result : 1;
+}
+
+// Prints results as a table and appends them as JSON lines to $ATM_BENCH_JSON.
+class Report {
+public:
+    explicit Report(const std::string& suite) : suite(suite), header_printed(false) {
+        const char* path = std::getenv("ATM_BENCH_JSON");
+        if (path != nullptr && *path != '\0') {
+            json.open(path, std::ios::app);
+        }
+        const char* commit_env = std::getenv("ATM_BENCH_COMMIT");
+        commit = commit_env != nullptr ? commit_env : "unknown";
+    }
+
+    // Records one result with its parameters (e.g. {"threads", "4"}).
+    void add(const std::string& name, const Params& params, const Stats& stats) {
+        if (!header_printed) {
+            std::cout << "== " << suite << " ==" << std::endl;
+            std::cout << std::left << std::setw(56) << "benchmark" << std::right << std::setw(14) << "ops/sec"
+                      << std::setw(10) << "p50_ns" << std::setw(10) << "p99_ns" << std::setw(11) << "p999_ns"
+                      << std::endl;
+            header_printed = true;
+        }
+        std::string label = name;
+        for (const auto& param : params) {
+            label += " " + param.first + "=" + param.second;
+        }
+        std::cout << std::left << std::setw(56) << label << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(14) << stats.ops_per_sec << std::setw(10) << stats.p50_ns
+                  << std::setw(10) << stats.p99_ns << std::setw(11) << stats.p999_ns << std::endl;
+
+        if (json.is_open()) {
+            json << "{\"suite\":\"" << suite << "\",\"benchmark\":\"" << name << "\",\"commit\":\"" << commit << "\"";
+            for (const auto& param : params) {
+                json << ",\"" << param.first << "\":\"" << param.second << "\"";
+            }
+            json << std::fixed << std::setprecision(6) << ",\"ops\":" << stats.ops << ",\"seconds\":" << stats.seconds
+                 << std::setprecision(1) << ",\"ops_per_sec\":" << stats.ops_per_sec << ",\"p50_ns\":" << stats.p50_ns
+                 << ",\"p99_ns\":" << stats.p99_ns << ",\"p999_ns\":" << stats.p999_ns << "}\n";
+            json.flush();
+        }
+    }
+
+private:
+    std::string suite;
+    std::string commit;
+    std::ofstream json;
+    bool header_printed;
+};
+
+} // namespace bench
+
+#endif // BENCHHARNESS_H
@@ -0,0 +1,529 @@
+#ifndef POLICYBANK_H
+#define POLICYBANK_H
+
+#include <atomic>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "../include/FlatAccountTable.h"
+#include "../include/Logger.h"
+#include "../include/Metrics.h"
+#include "../include/Result.h"
+
+// Benchmark model of the account core for bench_policies.cpp: a balance
+// table like the one BankSystem and Account hard-wire, templated on how
+// accounts are stored, how concurrent callers are kept apart, where
+// transactions are logged and where metrics go, so the strategies can be
+// compared in isolation. A policy that does nothing compiles to nothing.
+//
+// DefaultBank picks the strategies BankSystem uses on its balance path: a
+// flat card-key table split into 16 locked shards, balances updated under a
+// lock striped by account and read without one, asynchronous Info logging
+// and operation metrics. It only models that path: it has no PINs,
+// journal, ledger, limits or snapshots, and nothing outside bench/ uses it.
+//
+// Every policy is a plain struct; see the requirements above each group.
+namespace bank_policy {
+
+// ---------------------------------------------------------------------------
+// Storage: maps packed card keys to balance cells.
+// A storage policy has a nested template Map<Balance> with
+//   Balance* find(std::uint64_t key);
+//   Balance* insert(std::uint64_t key, int initial_balance); // Null if present.
+//   std::size_t size() const;
+// Cell addresses stay valid for the map's lifetime. Maps are not thread-safe;
+// the concurrency policy guards them.
+// ---------------------------------------------------------------------------
+
+// std::unordered_map: one heap node per account.
+struct NodeMapStorage {
+    template <typename Balance>
+    class Map {
+    public:
+        Balance* find(std::uint64_t key) {
+            typename std::unordered_map<std::uint64_t, Balance>::iterator found = cells.find(key);
+            return found == cells.end() ? nullptr : &found->second;
+        }
+
+        Balance* insert(std::uint64_t key, int initial_balance) {
+            std::pair<typename std::unordered_map<std::uint64_t, Balance>::iterator, bool> added =
+                cells.emplace(std::piecewise_construct, std::forward_as_tuple(key),
+                              std::forward_as_tuple(initial_balance));
+            return added.second ? &added.first->second : nullptr;
+        }
+
+        std::size_t size() const { return cells.size(); }
+
+    private:
+        std::unordered_map<std::uint64_t, Balance> cells;
+    };
+};
+
+namespace detail {
+
+// Open-addressing table from card keys to balance cells, laid out and
+// probed like BankSystem's FlatAccountTable: the same hash, linear probing
+// and growth once 70% full, with 16-byte slots.
+template <typename Balance>
+class CellTable {
+public:
+    CellTable() : count(0) {}
+
+    // Returns the cell for key, or null if absent.
+    Balance* find(std::uint64_t key) const {
+        if (slots.empty()) {
+            return nullptr;
+        }
+        std::size_t mask = slots.size() - 1;
+        for (std::size_t i = FlatAccountTable::hash(key) & mask;; i = (i + 1) & mask) {
+            if (slots[i].cell == nullptr || slots[i].key == key) {
+                return slots[i].cell;
+            }
+        }
+    }
+
+    // Adds key; returns false if it is already present.
+    bool insert(std::uint64_t key, Balance* cell) {
+        if ((count + 1) * 10 > slots.size() * 7) {
+            rehash(slots.empty() ? 16 : slots.size() * 2);
+        }
+        Slot* slot = probe(key);
+        if (slot->cell != nullptr) {
+            return false;
+        }
+        slot->key = key;
+        slot->cell = cell;
+        ++count;
+        return true;
+    }
+
+    std::size_t size() const { return count; }
+
+private:
+    struct Slot {
+        std::uint64_t key;
+        Balance* cell; // Null marks an empty slot.
+    };
+
+    std::vector<Slot> slots; // Size is zero or a power of two.
+    std::size_t count;
+
+    // Returns the slot holding key, or the empty slot where it belongs.
+    Slot* probe(std::uint64_t key) {
+        std::size_t mask = slots.size() - 1;
+        for (std::size_t i = FlatAccountTable::hash(key) & mask;; i = (i + 1) & mask) {
+            if (slots[i].cell == nullptr || slots[i].key == key) {
+                return &slots[i];
+            }
+        }
+    }
+
+    // Rebuilds the table with the given number of slots.
+    void rehash(std::size_t slot_count) {
+        std::vector<Slot> old(slot_count, Slot());
+        old.swap(slots);
+        for (const Slot& slot : old) {
+            if (slot.cell != nullptr) {
+                *probe(slot.key) = slot;
+            }
+        }
+    }
+};
+
+} // namespace detail
+
+// A FlatAccountTable-style table pointing at cells in a deque, like
+// BankSystem's account storage.
+struct FlatMapStorage {
+    template <typename Balance>
+    class Map {
+    public:
+        Balance* find(std::uint64_t key) { return table.find(key); }
+
+        Balance* insert(std::uint64_t key, int initial_balance) {
+            if (key == 0 || table.find(key) != nullptr) {
+                return nullptr;
+            }
+            cells.emplace_back(initial_balance);
+            table.insert(key, &cells.back());
+            return &cells.back();
+        }
+
+        std::size_t size() const { return table.size(); }
+
+    private:
+        detail::CellTable<Balance> table;
+        std::deque<Balance> cells;
+    };
+};
+
+// Struct of arrays: balances sit contiguously in fixed-size chunks, so a
+// chunk of balances shares cache lines with nothing else, and the table
+// points into them.
+struct SoAStorage {
+    template <typename Balance>
+    class Map {
+    public:
+        static const std::size_t CHUNK = 4096;
+
+        Map() : count(0) {}
+
+        Map(const Map&) = delete;
+        Map& operator=(const Map&) = delete;
+
+        Balance* find(std::uint64_t key) { return table.find(key); }
+
+        Balance* insert(std::uint64_t key, int initial_balance) {
+            if (key == 0 || table.find(key) != nullptr) {
+                return nullptr;
+            }
+            if (count % CHUNK == 0) {
+                chunks.push_back(std::unique_ptr<Chunk>(new Chunk()));
+            }
+            std::uint32_t index = static_cast<std::uint32_t>(count++);
+            Balance* balance = cell(index);
+            set(*balance, initial_balance);
+            table.insert(key, balance);
+            return balance;
+        }
+
+        std::size_t size() const { return count; }
+
+    private:
+        struct Chunk {
+            Balance balances[CHUNK];
+        };
+
+        detail::CellTable<Balance> table;
+        std::vector<std::unique_ptr<Chunk>> chunks;
+        std::size_t count;
+
+        Balance* cell(std::uint32_t index) { return &chunks[index / CHUNK]->balances[index % CHUNK]; }
+
+        static void set(int& balance, int value) { balance = value; }
+        static void set(std::atomic<int>& balance, int value) { balance.store(value, std::memory_order_relaxed); }
+    };
+};
+
+// ---------------------------------------------------------------------------
+// Concurrency: how callers are kept apart. A concurrency policy provides
+//   typedef ... Balance;                 // Cell type stored per account.
+//   static const std::size_t PARTITIONS; // Storage maps the table is split into.
+//   class TableLock;                     // (policy&, partition): guards a map for find/insert.
+//   int load(Balance&);                  // Reads a balance.
+//   Result<int> apply(Balance&, int delta, bool floor); // Adds delta; with floor, never below zero.
+// ---------------------------------------------------------------------------
+
+// Adds delta to value unless that would take a floored balance below zero.
+inline Result<int> adjusted(int value, int delta, bool floor) {
+    if (floor && value < -delta) {
+        return TxError::InsufficientFunds;
+    }
+    return value + delta;
+}
+
+// No synchronization at all: for single-threaded rigs.
+struct NoLocking {
+    typedef int Balance;
+    static const std::size_t PARTITIONS = 1;
+
+    class TableLock {
+    public:
+        TableLock(NoLocking&, std::size_t) {}
+    };
+
+    int load(Balance& balance) { return balance; }
+
+    Result<int> apply(Balance& balance, int delta, bool floor) {
+        Result<int> next = adjusted(balance, delta, floor);
+        if (next) {
+            balance = next.value();
+        }
+        return next;
+    }
+};
+
+// One mutex around the table and every balance.
+struct GlobalMutexLocking {
+    typedef int Balance;
+    static const std::size_t PARTITIONS = 1;
+
+    class TableLock {
+    public:
+        TableLock(GlobalMutexLocking& policy, std::size_t) : lock(policy.mutex) {}
+
+    private:
+        std::lock_guard<std::mutex> lock;
+    };
+
+    int load(Balance& balance) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return balance;
+    }
+
+    Result<int> apply(Balance& balance, int delta, bool floor) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Result<int> next = adjusted(balance, delta, floor);
+        if (next) {
+            balance = next.value();
+        }
+        return next;
+    }
+
+    std::mutex mutex;
+};
+
+// One lock per table shard, and balances updated under a lock striped by
+// account and read without one: BankSystem's locked mode.
+template <std::size_t Shards = 16, std::size_t Stripes = 1024>
+struct ShardedLocking {
+    typedef std::atomic<int> Balance;
+    static const std::size_t PARTITIONS = Shards;
+
+    class TableLock {
+    public:
+        TableLock(ShardedLocking& policy, std::size_t partition) : lock(policy.shards[partition]) {}
+
+    private:
+        std::lock_guard<std::mutex> lock;
+    };
+
+    int load(Balance& balance) { return balance.load(std::memory_order_acquire); }
+
+    Result<int> apply(Balance& balance, int delta, bool floor) {
+        std::lock_guard<std::mutex> lock(stripes[reinterpret_cast<std::uintptr_t>(&balance) / sizeof(Balance) % Stripes]);
+        Result<int> next = adjusted(balance.load(std::memory_order_relaxed), delta, floor);
+        if (next) {
+            balance.store(next.value(), std::memory_order_release);
+        }
+        return next;
+    }
+
+    std::mutex shards[Shards];
+    std::mutex stripes[Stripes];
+};
+
+// Locked table shards and compare-and-swap balance updates: BankSystem's lock-free mode.
+template <std::size_t Shards = 16>
+struct AtomicBalances {
+    typedef std::atomic<int> Balance;
+    static const std::size_t PARTITIONS = Shards;
+
+    class TableLock {
+    public:
+        TableLock(AtomicBalances& policy, std::size_t partition) : lock(policy.shards[partition]) {}
+
+    private:
+        std::lock_guard<std::mutex> lock;
+    };
+
+    int load(Balance& balance) { return balance.load(std::memory_order_acquire); }
+
+    Result<int> apply(Balance& balance, int delta, bool floor) {
+        int current = balance.load(std::memory_order_relaxed);
+        for (;;) {
+            Result<int> next = adjusted(current, delta, floor);
+            if (!next) {
+                return next;
+            }
+            if (balance.compare_exchange_weak(current, next.value(), std::memory_order_acq_rel,
+                                              std::memory_order_relaxed)) {
+                return next;
+            }
+        }
+    }
+
+    std::mutex shards[Shards];
+};
+
+// ---------------------------------------------------------------------------
+// Logging: a logging policy provides static
+//   void account_added(std::uint64_t key, int balance);
+//   void deposit(int amount, int balance);
+//   void withdrawal(int amount, int balance);
+// ---------------------------------------------------------------------------
+
+// Logs nothing.
+struct NoLogging {
+    static void account_added(std::uint64_t, int) {}
+    static void deposit(int, int) {}
+    static void withdrawal(int, int) {}
+};
+
+// Queues Info lines on the asynchronous Logger, as Account and BankSystem do.
+struct AsyncLogging {
+    static void account_added(std::uint64_t key, int balance) {
+        ATM_LOG_INFO("Account added. Key: " << static_cast<unsigned long long>(key) << ", Initial Balance: "
+                     << balance);
+    }
+    static void deposit(int amount, int balance) {
+        ATM_LOG_INFO("Deposit: " << amount << " | New Balance: " << balance);
+    }
+    static void withdrawal(int amount, int balance) {
+        ATM_LOG_INFO("Withdrawal: " << amount << " | New Balance: " << balance);
+    }
+};
+
+// Writes each line to a stream on the calling thread, under a mutex.
+struct SyncLogging {
+    // Retrieves the stream lines go to (std::clog unless changed).
+    static std::ostream*& sink() {
+        static std::ostream* stream = &std::clog;
+        return stream;
+    }
+
+    static void account_added(std::uint64_t key, int balance) {
+        std::lock_guard<std::mutex> lock(mutex());
+        *sink() << "[INFO] Account added. Key: " << key << ", Initial Balance: " << balance << '\n';
+    }
+    static void deposit(int amount, int balance) {
+        std::lock_guard<std::mutex> lock(mutex());
+        *sink() << "[INFO] Deposit: " << amount << " | New Balance: " << balance << '\n';
+    }
+    static void withdrawal(int amount, int balance) {
+        std::lock_guard<std::mutex> lock(mutex());
+        *sink() << "[INFO] Withdrawal: " << amount << " | New Balance: " << balance << '\n';
+    }
+
+private:
+    static std::mutex& mutex() {
+        static std::mutex lock;
+        return lock;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Metrics: a metrics policy provides a Timer type constructed from a
+// MetricOp, with void fail() and TxError fail(TxError), like MetricsTimer.
+// ---------------------------------------------------------------------------
+
+// Records nothing.
+struct NoMetrics {
+    class Timer {
+    public:
+        explicit Timer(MetricOp) {}
+        void fail() {}
+        TxError fail(TxError error) { return error; }
+    };
+};
+
+// Records into the process-wide Metrics registry.
+struct RecordMetrics {
+    typedef MetricsTimer Timer;
+};
+
+} // namespace bank_policy
+
+// Account table and balance operations assembled from the policies above.
+// Accounts are addressed by a handle (the balance cell) resolved once with
+// find(), as ATM sessions hold their Account. Thread safety is whatever the
+// concurrency policy provides.
+template <typename Storage = bank_policy::FlatMapStorage,
+          typename Concurrency = bank_policy::ShardedLocking<>,
+          typename Logging = bank_policy::AsyncLogging,
+          typename MetricsSink = bank_policy::RecordMetrics>
+class BasicBank {
+public:
+    typedef typename Concurrency::Balance Balance;
+    typedef Balance* Handle;
+
+    BasicBank() {}
+
+    BasicBank(const BasicBank&) = delete;
+    BasicBank& operator=(const BasicBank&) = delete;
+
+    // Adds an account and returns its handle.
+    // Throws an exception if the key is 0, already present, or the balance is negative.
+    Handle add_account(std::uint64_t key, int initial_balance = 0) {
+        typename MetricsSink::Timer timer(MetricOp::BankAddAccount);
+        if (initial_balance < 0) {
+            timer.fail(TxError::InvalidAmount);
+            throw std::invalid_argument("Initial balance cannot be negative.");
+        }
+        Handle handle;
+        {
+            std::size_t partition = partition_of(key);
+            typename Concurrency::TableLock lock(concurrency, partition);
+            handle = maps[partition].insert(key, initial_balance);
+        }
+        if (handle == nullptr) {
+            timer.fail(TxError::InvalidAmount);
+            throw std::invalid_argument("Account key is 0 or already exists.");
+        }
+        Logging::account_added(key, initial_balance);
+        return handle;
+    }
+
+    // Returns the handle of an account, or null if there is none.
+    Handle find(std::uint64_t key) {
+        typename MetricsSink::Timer timer(MetricOp::BankGetAccount);
+        std::size_t partition = partition_of(key);
+        typename Concurrency::TableLock lock(concurrency, partition);
+        return maps[partition].find(key);
+    }
+
+    // Deposits into an account; returns the new balance or TxError::InvalidAmount.
+    Result<int> try_deposit(Handle account, int amount) {
+        typename MetricsSink::Timer timer(MetricOp::AtmDeposit);
+        if (amount <= 0) {
+            return timer.fail(TxError::InvalidAmount);
+        }
+        Result<int> balance = concurrency.apply(*account, amount, false);
+        if (balance) {
+            Logging::deposit(amount, balance.value());
+        }
+        return balance;
+    }
+
+    // Withdraws from an account; returns the new balance, TxError::InvalidAmount
+    // or TxError::InsufficientFunds.
+    Result<int> try_withdraw(Handle account, int amount) {
+        typename MetricsSink::Timer timer(MetricOp::AtmWithdraw);
+        if (amount <= 0) {
+            return timer.fail(TxError::InvalidAmount);
+        }
+        Result<int> balance = concurrency.apply(*account, -amount, true);
+        if (!balance) {
+            return timer.fail(balance.error());
+        }
+        Logging::withdrawal(amount, balance.value());
+        return balance;
+    }
+
+    // Retrieves an account's balance.
+    int balance(Handle account) { return concurrency.load(*account); }
+
+    // Retrieves the number of accounts.
+    std::size_t size() {
+        std::size_t total = 0;
+        for (std::size_t partition = 0; partition < Concurrency::PARTITIONS; ++partition) {
+            typename Concurrency::TableLock lock(concurrency, partition);
+            total += maps[partition].size();
+        }
+        return total;
+    }
+
+private:
+    typedef typename Storage::template Map<Balance> Map;
+
+    Concurrency concurrency;
+    Map maps[Concurrency::PARTITIONS];
+
+    // Picks the partition from the high hash bits, as BankSystem picks shards.
+    static std::size_t partition_of(std::uint64_t key) {
+        return static_cast<std::size_t>((FlatAccountTable::hash(key) >> 40) % Concurrency::PARTITIONS);
+    }
+};
+
+// BankSystem's balance-path strategies, without the rest of BankSystem.
+typedef BasicBank<> DefaultBank;
+
+#endif // POLICYBANK_H
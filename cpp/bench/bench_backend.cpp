@@ -0,0 +1,92 @@
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include "BenchHarness.h"
+#include "../include/BankServer.h"
+#include "../include/BankSystem.h"
+#include "../include/Card.h"
+#include "../include/Logger.h"
+#include "../include/RemoteBankBackend.h"
+
+// Measures the remote backend against a local BankServer that adds a fixed
+// latency to every request: a login as two round trips (authenticate, then
+// a balance request) versus authenticate alone, whose reply carries the
+// balance, and deposits with 1, 8 and 64 requests in flight on a single
+// connection.
+
+namespace {
+
+const char* SOCKET_PATH = "bench_backend.sock";
+const std::size_t WINDOWS[] = {1, 8, 64};
+
+} // namespace
+
+int main() {
+    Logger::set_level(LogLevel::Error); // Every request logs at Info level.
+    bench::Report report("backend");
+
+    PinHashConfig cheap_pins; // Keeps the measurement about round trips, not hashing.
+    cheap_pins.iterations = 1;
+    BankSystem bank(BankSystem::DEFAULT_SHARD_COUNT, cheap_pins);
+    bank.add_account(make_card_number(0), "1234", 0);
+    const std::uint64_t key = Card(make_card_number(0)).get_key();
+
+    BankServerConfig server_config;
+    server_config.latency = std::chrono::microseconds(100);
+    BankServer server(bank, SOCKET_PATH, server_config);
+    const std::string latency = std::to_string(server_config.latency.count());
+
+    const std::size_t logins = bench::scaled(2000);
+    {
+        RemoteBankBackend backend{RemoteBackendConfig(SOCKET_PATH)};
+        report.add("login", {{"requests", "2"}, {"latency_us", latency}},
+                   bench::run(1, logins, [&](int, std::size_t) {
+                       BackendReply reply = backend.call(BackendRequest::authenticate(key, "1234"));
+                       if (reply.error != TxError::None ||
+                           backend.call(BackendRequest::balance(key, reply.session)).error != TxError::None) {
+                           std::abort();
+                       }
+                   }));
+        report.add("login", {{"requests", "1"}, {"latency_us", latency}},
+                   bench::run(1, logins, [&](int, std::size_t) {
+                       if (backend.call(BackendRequest::authenticate(key, "1234")).error != TxError::None) {
+                           std::abort();
+                       }
+                   }));
+    }
+
+    // Latency runs from the call to submit, including any wait for window space, to the callback.
+    const std::size_t deposits = bench::scaled(20000);
+    std::uint64_t session = 0;
+    {
+        RemoteBankBackend backend{RemoteBackendConfig(SOCKET_PATH)};
+        session = backend.call(BackendRequest::authenticate(key, "1234")).session;
+    }
+    for (std::size_t window : WINDOWS) {
+        RemoteBackendConfig config(SOCKET_PATH);
+        config.max_in_flight = window;
+        RemoteBankBackend backend(config);
+
+        std::mutex done_mutex;
+        std::condition_variable done_signal;
+        std::vector<std::uint32_t> samples;
+        samples.reserve(deposits);
+        std::uint64_t start = bench::now_ns();
+        for (std::size_t i = 0; i < deposits; ++i) {
+            std::uint64_t submitted = bench::now_ns();
+            backend.submit(BackendRequest::deposit(key, session, 1), [&, submitted](const BackendReply& reply) {
+                if (reply.error != TxError::None) std::abort();
+                std::uint64_t elapsed = bench::now_ns() - submitted;
+                std::lock_guard<std::mutex> lock(done_mutex);
+                samples.push_back(elapsed > 0xFFFFFFFFu ? 0xFFFFFFFFu : static_cast<std::uint32_t>(elapsed));
+                done_signal.notify_one();
+            });
+        }
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done_signal.wait(lock, [&]() { return samples.size() == deposits; });
+        double seconds = (bench::now_ns() - start) / 1e9;
+        report.add("deposit", {{"in_flight", std::to_string(window)}, {"latency_us", latency}},
+                   bench::summarize(samples, seconds));
+    }
+    return 0;
+}
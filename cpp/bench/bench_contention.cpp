@@ -0,0 +1,63 @@
+#include <string>
+#include "BenchHarness.h"
+#include "../include/Account.h"
+#include "../include/Logger.h"
+
+// Hammers one hot account from a growing number of threads and compares the
+// mutex-per-account design (BalanceMode::Locked) with compare-and-swap
+// updates (BalanceMode::LockFree), for pure updates and for a read-mostly
+// mix where most calls are balance checks.
+
+namespace {
+
+const int THREAD_COUNTS[] = {1, 2, 4, 8, 16};
+
+struct Mode {
+    const char* name;
+    BalanceMode mode;
+};
+
+const Mode MODES[] = {{"locked", BalanceMode::Locked}, {"lock_free", BalanceMode::LockFree}};
+
+} // namespace
+
+int main() {
+    Logger::set_level(LogLevel::Warn);
+    bench::Report report("contention");
+
+    const std::size_t ops = bench::scaled(200000);
+    for (const Mode& mode : MODES) {
+        for (int threads : THREAD_COUNTS) {
+            // Deposits and withdrawals alternate, so the balance never runs out.
+            Account hot("4539578763621486", 1000000, mode.mode);
+            report.add("hot_account_update", {{"mode", mode.name}, {"threads", std::to_string(threads)}},
+                       bench::run(threads, ops, [&](int, std::size_t i) {
+                           if (i % 2 == 0) {
+                               hot.deposit(10);
+                           } else {
+                               hot.withdraw(10);
+                           }
+                       }));
+        }
+    }
+    for (const Mode& mode : MODES) {
+        for (int threads : THREAD_COUNTS) {
+            // Nine balance checks per update, as on a busy account viewed from many ATMs.
+            Account hot("4539578763621486", 1000000, mode.mode);
+            report.add("hot_account_read_mostly", {{"mode", mode.name}, {"threads", std::to_string(threads)}},
+                       bench::run(threads, ops, [&](int, std::size_t i) {
+                           switch (i % 20) {
+                           case 0:
+                               hot.deposit(10);
+                               break;
+                           case 10:
+                               hot.withdraw(10);
+                               break;
+                           default:
+                               if (hot.get_balance() < 0) std::abort();
+                           }
+                       }));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <vector>
+#include <string>
+#include <memory>
+#include <random>
+#include <cstdio>
+#include "BenchHarness.h"
+#include "../include/ATMController.h"
+#include "../include/Logger.h"
+#include "../include/Utility.h"
+
+// Hot-path microbenchmarks: account creation, PIN validation, account lookup,
+// deposit/withdraw, full ATM sessions and logMessage, swept over account-table
+// sizes and thread counts.
+
+namespace {
+
+const std::size_t TABLE_SIZES[] = {1000, 100000, 1000000};
+const int THREAD_COUNTS[] = {1, 2, 4, 8};
+
+// PIN hashing at production cost would dominate provisioning a million accounts;
+// bench_pin measures it separately, so these benchmarks use the minimum cost.
+PinHashConfig cheap_pins() {
+    PinHashConfig config;
+    config.iterations = 1;
+    return config;
+}
+
+std::string str(std::size_t value) {
+    return std::to_string(static_cast<unsigned long long>(value));
+}
+
+// Fills a bank with size accounts and returns their cards.
+std::vector<Card> populate(BankSystem& bank, std::size_t size) {
+    std::vector<Card> cards;
+    cards.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        std::string number = make_card_number(i);
+        bank.add_account(number, "1234", 1000000000);
+        cards.emplace_back(number);
+    }
+    return cards;
+}
+
+// Precomputes random card indexes so the timed loop does no RNG work.
+std::vector<std::uint32_t> random_indexes(std::size_t count, std::size_t bound, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<std::uint32_t> pick(0, static_cast<std::uint32_t>(bound - 1));
+    std::vector<std::uint32_t> indexes(count);
+    for (std::uint32_t& index : indexes) {
+        index = pick(rng);
+    }
+    return indexes;
+}
+
+void bench_add_account(bench::Report& report) {
+    for (std::size_t size : TABLE_SIZES) {
+        for (int threads : THREAD_COUNTS) {
+            BankSystem bank(BankSystem::DEFAULT_SHARD_COUNT, cheap_pins());
+            std::size_t per_thread = size / threads;
+            std::vector<std::string> numbers(per_thread * threads);
+            for (std::size_t i = 0; i < numbers.size(); ++i) {
+                numbers[i] = make_card_number(i);
+            }
+            bench::Stats stats = bench::run(threads, per_thread, [&](int t, std::size_t i) {
+                bank.add_account(numbers[t * per_thread + i], "1234", 100);
+            });
+            report.add("add_account", {{"accounts", str(size)}, {"threads", str(threads)}}, stats);
+        }
+    }
+}
+
+void bench_lookups(bench::Report& report) {
+    const std::size_t ops = bench::scaled(200000);
+    for (std::size_t size : TABLE_SIZES) {
+        BankSystem bank(BankSystem::DEFAULT_SHARD_COUNT, cheap_pins());
+        std::vector<Card> cards = populate(bank, size);
+        for (int threads : THREAD_COUNTS) {
+            std::vector<std::vector<std::uint32_t>> picks;
+            for (int t = 0; t < threads; ++t) {
+                picks.push_back(random_indexes(ops, size, 17 + t));
+            }
+            bench::Params params = {{"accounts", str(size)}, {"threads", str(threads)}};
+
+            report.add("validate_pin", params, bench::run(threads, ops, [&](int t, std::size_t i) {
+                bank.validate_pin(cards[picks[t][i]], "1234");
+            }));
+            report.add("get_account", params, bench::run(threads, ops, [&](int t, std::size_t i) {
+                bank.get_account(cards[picks[t][i]]);
+            }));
+            report.add("deposit_withdraw", params, bench::run(threads, ops, [&](int t, std::size_t i) {
+                Account& account = bank.get_account(cards[picks[t][i]]);
+                if (i % 2 == 0) {
+                    account.deposit(10);
+                } else {
+                    account.withdraw(10);
+                }
+            }));
+        }
+    }
+}
+
+void bench_sessions(bench::Report& report) {
+    const std::size_t ops = bench::scaled(100000);
+    for (std::size_t size : TABLE_SIZES) {
+        BankSystem bank(BankSystem::DEFAULT_SHARD_COUNT, cheap_pins());
+        std::vector<Card> cards = populate(bank, size);
+        for (int threads : THREAD_COUNTS) {
+            std::vector<std::unique_ptr<ATMController>> atms;
+            std::vector<std::vector<std::uint32_t>> picks;
+            for (int t = 0; t < threads; ++t) {
+                atms.emplace_back(new ATMController(bank));
+                picks.push_back(random_indexes(ops, size, 91 + t));
+            }
+            report.add("atm_session", {{"accounts", str(size)}, {"threads", str(threads)}},
+                       bench::run(threads, ops, [&](int t, std::size_t i) {
+                           ATMController& atm = *atms[t];
+                           atm.insert_card(cards[picks[t][i]]);
+                           atm.enter_pin("1234");
+                           atm.select_account();
+                           atm.withdraw(1);
+                           atm.eject_card();
+                       }));
+        }
+    }
+}
+
+void bench_log_message(bench::Report& report) {
+    const std::size_t ops = bench::scaled(200000);
+    Logger& logger = Logger::instance();
+    logger.set_console_enabled(false);
+    Logger::set_level(LogLevel::Info);
+    const std::string log_file = "bench_log_message.log";
+    for (int threads : THREAD_COUNTS) {
+        report.add("logMessage", {{"threads", str(threads)}}, bench::run(threads, ops, [&](int, std::size_t) {
+            logMessage("Withdrawal made. Amount: 20, New Balance: 980", "INFO", log_file);
+        }));
+        logger.flush();
+    }
+    report.add("log_level_disabled", {{"threads", "1"}}, bench::run(1, ops, [&](int, std::size_t i) {
+        ATM_LOG_DEBUG("Filtered message " << i);
+    }));
+    Logger::set_level(LogLevel::Warn);
+    logger.set_console_enabled(true);
+    std::remove(log_file.c_str());
+}
+
+} // namespace
+
+int main() {
+    Logger::set_level(LogLevel::Warn);
+    bench::Report report("core");
+    bench_add_account(report);
+    bench_lookups(report);
+    bench_sessions(report);
+    bench_log_message(report);
+    return 0;
+}
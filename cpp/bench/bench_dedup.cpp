@@ -0,0 +1,78 @@
+#include <string>
+#include "BenchHarness.h"
+#include "../include/ATMController.h"
+#include "../include/TransactionDedup.h"
+#include "../include/Logger.h"
+
+// Measures the transaction deduplication cache: recording new requests in a
+// cache that is warm (slots reused after expiry) and one that is full of live
+// entries (every new request evicts), answering retries, and the cost a
+// transaction ID adds to an ATM withdrawal.
+
+int main() {
+    Logger::set_level(LogLevel::Error); // Every withdrawal logs at Info level.
+    bench::Report report("dedup");
+
+    const std::size_t ops = bench::scaled(2000000);
+    DedupConfig config;
+    config.capacity = 65536;
+    for (int threads : {1, 4}) {
+        // A 1 ms TTL with one millisecond per thousand requests keeps about
+        // a thousand live entries, so new requests take expired slots.
+        config.ttl = std::chrono::milliseconds(1);
+        TransactionDedupCache warm(config);
+        report.add("new", {{"cache", "expiring"}, {"threads", std::to_string(threads)}},
+                   bench::run(threads, ops, [&](int t, std::size_t i) {
+                       DedupRequest request = {static_cast<std::uint32_t>(t), i, LedgerEntryType::Withdrawal, 1, 10};
+                       int balance = 0;
+                       std::int64_t now = static_cast<std::int64_t>(i / 1000);
+                       if (warm.begin(request, balance, now) != DedupStatus::New) std::abort();
+                       warm.complete(request, 0, now);
+                   }));
+
+        config.ttl = std::chrono::hours(1);
+        TransactionDedupCache full(config);
+        report.add("new", {{"cache", "full"}, {"threads", std::to_string(threads)}},
+                   bench::run(threads, ops, [&](int t, std::size_t i) {
+                       DedupRequest request = {static_cast<std::uint32_t>(t), i, LedgerEntryType::Withdrawal, 1, 10};
+                       int balance = 0;
+                       std::int64_t now = static_cast<std::int64_t>(i);
+                       if (full.begin(request, balance, now) != DedupStatus::New) std::abort();
+                       full.complete(request, 0, now);
+                   }));
+        DedupStats stats = full.stats(static_cast<std::int64_t>(ops));
+        std::cout << "  " << threads << " threads: " << stats.entries << " of " << stats.capacity
+                  << " entries, " << stats.evictions << " evictions" << std::endl;
+
+        // Replay the most recent requests, which are still cached.
+        const std::size_t recent = 1024;
+        report.add("replay", {{"threads", std::to_string(threads)}},
+                   bench::run(threads, ops, [&](int t, std::size_t i) {
+                       DedupRequest request = {static_cast<std::uint32_t>(t), ops - 1 - i % recent,
+                                               LedgerEntryType::Withdrawal, 1, 10};
+                       int balance = 0;
+                       if (full.begin(request, balance, static_cast<std::int64_t>(ops)) != DedupStatus::Replayed) {
+                           std::abort();
+                       }
+                   }));
+    }
+
+    const std::size_t withdrawals = bench::scaled(500000);
+    for (int with_ids = 0; with_ids < 2; ++with_ids) {
+        BankSystem bank(1);
+        if (with_ids) {
+            bank.enable_deduplication();
+        }
+        bank.add_account(make_card_number(0), "1234", 1 << 30);
+        Card card(make_card_number(0));
+        ATMController atm(bank, 1);
+        atm.insert_card(card);
+        atm.enter_pin("1234");
+        report.add("atm_withdraw", {{"transaction_id", with_ids ? "yes" : "no"}},
+                   bench::run(1, withdrawals, [&](int, std::size_t i) {
+                       Result<int> result = with_ids ? atm.try_withdraw(1, i) : atm.try_withdraw(1);
+                       if (!result) std::abort();
+                   }));
+    }
+    return 0;
+}
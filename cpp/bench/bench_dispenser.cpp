@@ -0,0 +1,81 @@
+#include <string>
+#include <vector>
+#include "BenchHarness.h"
+#include "../include/CashDispenser.h"
+
+// Compares choosing notes from the dispenser's precomputed table with
+// solving every withdrawal from scratch, for cassettes that are well
+// stocked (one table serves every withdrawal) and for ATMs running low,
+// where each withdrawal moves to a new inventory state and tables are
+// rebuilt or taken from the cache.
+
+namespace {
+
+struct Layout {
+    const char* name;
+    std::vector<int> denominations;
+};
+
+// Returns a withdrawal amount from a fixed pseudo-random sequence, in multiples of 10 up to 400.
+int amount_for(std::size_t i) {
+    return static_cast<int>((i * 2654435761u) % 40 + 1) * 10;
+}
+
+} // namespace
+
+int main() {
+    bench::Report report("dispenser");
+
+    const std::vector<Layout> layouts = {{"4x", {100, 50, 20, 10}}, {"6x", {200, 100, 50, 20, 10, 5}}};
+    const std::size_t ops = bench::scaled(1000000);
+    for (const Layout& layout : layouts) {
+        std::vector<Cassette> stocked;
+        for (int denomination : layout.denominations) {
+            stocked.push_back(Cassette(denomination, 2000));
+        }
+
+        CashDispenser dispenser(stocked);
+        report.add("withdraw", {{"cassettes", layout.name}, {"stock", "full"}, {"method", "table"}},
+                   bench::run(1, ops, [&](int, std::size_t i) {
+                       Result<DispensePlan> plan = dispenser.try_reserve(amount_for(i));
+                       if (!plan) std::abort();
+                       dispenser.release(plan.value());
+                   }));
+        report.add("withdraw", {{"cassettes", layout.name}, {"stock", "full"}, {"method", "solve"}},
+                   bench::run(1, ops / 20, [&](int, std::size_t i) {
+                       if (!CashDispenser::solve(stocked, amount_for(i))) std::abort();
+                   }));
+
+        // Runs the ATM down from a small load, then refills it, so counts keep crossing the cap.
+        std::vector<Cassette> low;
+        for (int denomination : layout.denominations) {
+            low.push_back(Cassette(denomination, 60));
+        }
+        CashDispenser draining(low);
+        report.add("withdraw", {{"cassettes", layout.name}, {"stock", "draining"}, {"method", "table"}},
+                   bench::run(1, ops / 20, [&](int, std::size_t i) {
+                       if (!draining.try_reserve(amount_for(i))) {
+                           for (std::size_t c = 0; c < low.size(); ++c) {
+                               draining.refill(c, 60 - draining.inventory()[c].count);
+                           }
+                       }
+                   }));
+        DispenserStats stats = draining.stats();
+        std::cout << "  draining " << layout.name << ": " << stats.reservations << " reservations, "
+                  << stats.table_builds << " table builds, " << stats.cache_hits << " cache hits" << std::endl;
+
+        std::vector<Cassette> state = low;
+        report.add("withdraw", {{"cassettes", layout.name}, {"stock", "draining"}, {"method", "solve"}},
+                   bench::run(1, ops / 20, [&](int, std::size_t i) {
+                       Result<DispensePlan> plan = CashDispenser::solve(state, amount_for(i));
+                       if (!plan) {
+                           state = low;
+                           return;
+                       }
+                       for (std::size_t c = 0; c < state.size(); ++c) {
+                           state[c].count -= plan.value().notes[c];
+                       }
+                   }));
+    }
+    return 0;
+}
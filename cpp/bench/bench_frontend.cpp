@@ -0,0 +1,234 @@
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "BenchHarness.h"
+#include "../include/BankServer.h"
+#include "../include/BankSystem.h"
+#include "../include/Card.h"
+#include "../include/Logger.h"
+#include "../include/RemoteATMController.h"
+#include "../include/RemoteBankBackend.h"
+#include "../include/ShmBankBackend.h"
+#include "../include/ShmBankServer.h"
+
+// Measures a multi-process front end against a bank process serving one
+// BankSystem over shared memory (ShmBankServer) and a Unix domain socket
+// (BankServer) at once, as tools/atm_bankd does: the round trip of one
+// request at a time, sessions on several threads sharing one backend with
+// one request each in flight, a pipelined window of 64, and whole ATM
+// sessions (card in, PIN, balance, deposit, withdrawal, card out) driven by
+// a RemoteATMController. The bank runs in a forked child; for the shared
+// memory runs the child also reports how many requests its poller picked
+// up per batch.
+
+namespace {
+
+const char* SHM_NAME = "/atm_bench_frontend";
+const char* SOCKET_PATH = "bench_frontend.sock";
+const int SESSIONS = 8;
+const std::size_t WINDOW = 64;
+
+// Batching counters of the bank process.
+struct ServerCounters {
+    std::uint64_t requests;
+    std::uint64_t batches;
+};
+
+// Bank process: serves both transports and answers counter queries on
+// commands until the pipe closes.
+void serve_bank(int commands, int answers) {
+    Logger::set_level(LogLevel::Error);
+    PinHashConfig cheap_pins;
+    cheap_pins.iterations = 1;
+    BankSystem bank(BankSystem::DEFAULT_SHARD_COUNT, cheap_pins);
+    for (int i = 0; i < SESSIONS; ++i) {
+        bank.add_account(make_card_number(i), "1234", 0);
+    }
+    BankServer socket_server(bank, SOCKET_PATH, BankServerConfig());
+    ShmBankServer shm_server(bank, SHM_NAME);
+
+    char command = 'r';
+    if (::write(answers, &command, 1) != 1) {
+        return;
+    }
+    while (::read(commands, &command, 1) == 1) {
+        ServerCounters counters = {shm_server.requests_served(), shm_server.batches_served()};
+        if (::write(answers, &counters, sizeof(counters)) != static_cast<ssize_t>(sizeof(counters))) {
+            break;
+        }
+    }
+}
+
+// Front end's handle on the bank process.
+class BankProcess {
+public:
+    BankProcess() {
+        int to_child[2];
+        int from_child[2];
+        if (::pipe(to_child) != 0 || ::pipe(from_child) != 0) {
+            std::perror("pipe");
+            std::exit(1);
+        }
+        child = ::fork();
+        if (child == 0) {
+            ::close(to_child[1]);
+            ::close(from_child[0]);
+            serve_bank(to_child[0], from_child[1]);
+            std::_Exit(0);
+        }
+        ::close(to_child[0]);
+        ::close(from_child[1]);
+        commands = to_child[1];
+        answers = from_child[0];
+        char ready;
+        if (::read(answers, &ready, 1) != 1) {
+            std::fprintf(stderr, "Bank process failed to start.\n");
+            std::exit(1);
+        }
+    }
+
+    // Closing the command pipe lets the bank process shut its servers down cleanly.
+    ~BankProcess() {
+        ::close(commands);
+        ::waitpid(child, nullptr, 0);
+        ::close(answers);
+    }
+
+    // Retrieves the shared memory server's counters.
+    ServerCounters counters() {
+        char command = 's';
+        ServerCounters result = {0, 0};
+        if (::write(commands, &command, 1) != 1 ||
+            ::read(answers, &result, sizeof(result)) != static_cast<ssize_t>(sizeof(result))) {
+            std::fprintf(stderr, "Bank process stopped answering.\n");
+            std::exit(1);
+        }
+        return result;
+    }
+
+private:
+    pid_t child;
+    int commands;
+    int answers;
+};
+
+// Submits deposits from SESSIONS threads, pipelined through one backend,
+// timing each from submit to callback.
+bench::Stats pipelined(BankBackend& backend, const std::vector<std::uint64_t>& keys,
+                       const std::vector<std::uint64_t>& tokens, std::size_t per_thread) {
+    std::mutex done_mutex;
+    std::condition_variable done_signal;
+    std::vector<std::uint32_t> samples;
+    samples.reserve(SESSIONS * per_thread);
+    std::uint64_t start = bench::now_ns();
+    std::vector<std::thread> submitters;
+    for (int t = 0; t < SESSIONS; ++t) {
+        submitters.emplace_back([&, t]() {
+            for (std::size_t i = 0; i < per_thread; ++i) {
+                BackendRequest deposit = BackendRequest::deposit(keys[t], tokens[t], 1);
+                std::uint64_t submitted = bench::now_ns();
+                backend.submit(deposit, [&, submitted](const BackendReply& reply) {
+                    if (reply.error != TxError::None) std::abort();
+                    std::uint64_t elapsed = bench::now_ns() - submitted;
+                    std::lock_guard<std::mutex> lock(done_mutex);
+                    samples.push_back(elapsed > 0xFFFFFFFFu ? 0xFFFFFFFFu : static_cast<std::uint32_t>(elapsed));
+                    done_signal.notify_one();
+                });
+            }
+        });
+    }
+    for (std::thread& submitter : submitters) {
+        submitter.join();
+    }
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done_signal.wait(lock, [&]() { return samples.size() == SESSIONS * per_thread; });
+    return bench::summarize(samples, (bench::now_ns() - start) / 1e9);
+}
+
+// Adds the mean shared memory batch size between two counter readings to params.
+void add_mean_batch(bench::Params& params, const ServerCounters& before, const ServerCounters& after) {
+    std::uint64_t batches = after.batches - before.batches;
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.1f",
+                  batches == 0 ? 0.0 : static_cast<double>(after.requests - before.requests) / batches);
+    params.push_back({"mean_batch", text});
+}
+
+} // namespace
+
+int main() {
+    // Forked before this process starts any thread.
+    BankProcess bank;
+    Logger::set_level(LogLevel::Error);
+    bench::Report report("frontend");
+
+    std::vector<std::uint64_t> keys;
+    for (int i = 0; i < SESSIONS; ++i) {
+        keys.push_back(Card(make_card_number(i)).get_key());
+    }
+    const std::size_t round_trips = bench::scaled(20000);
+    const std::size_t per_session = bench::scaled(5000);
+    const std::size_t sessions = bench::scaled(5000);
+    const std::string transports[] = {"shm", "uds"};
+
+    for (const std::string& transport : transports) {
+        RemoteBackendConfig config(SOCKET_PATH);
+        config.max_in_flight = WINDOW;
+        const bool shm = transport == "shm";
+        std::unique_ptr<BankBackend> backend;
+        if (shm) {
+            backend.reset(new ShmBankBackend(SHM_NAME, WINDOW));
+        } else {
+            backend.reset(new RemoteBankBackend(config));
+        }
+        std::vector<std::uint64_t> tokens; // Each key's session; the PIN checks are not measured.
+        for (std::uint64_t key : keys) {
+            BackendReply reply = backend->call(BackendRequest::authenticate(key, "1234"));
+            if (reply.error != TxError::None) std::abort();
+            tokens.push_back(reply.session);
+        }
+
+        ServerCounters before = bank.counters();
+        bench::Stats stats = bench::run(1, round_trips, [&](int, std::size_t) {
+            if (backend->call(BackendRequest::balance(keys[0], tokens[0])).error != TxError::None) std::abort();
+        });
+        ServerCounters after = bank.counters();
+        bench::Params params = {{"transport", transport}};
+        if (shm) add_mean_batch(params, before, after);
+        report.add("round_trip", params, stats);
+
+        before = after;
+        stats = bench::run(SESSIONS, per_session, [&](int t, std::size_t) {
+            if (backend->call(BackendRequest::deposit(keys[t], tokens[t], 1)).error != TxError::None) std::abort();
+        });
+        after = bank.counters();
+        params = {{"transport", transport}, {"sessions", std::to_string(SESSIONS)}};
+        if (shm) add_mean_batch(params, before, after);
+        report.add("sessions", params, stats);
+
+        before = after;
+        stats = pipelined(*backend, keys, tokens, per_session);
+        after = bank.counters();
+        params = {{"transport", transport}, {"in_flight", std::to_string(WINDOW)}};
+        if (shm) add_mean_batch(params, before, after);
+        report.add("pipelined", params, stats);
+
+        RemoteATMController atm(*backend);
+        const Card card(make_card_number(0));
+        stats = bench::run(1, sessions, [&](int, std::size_t) {
+            atm.insert_card(card);
+            atm.enter_pin("1234");
+            atm.view_balance();
+            atm.deposit(10);
+            atm.withdraw(10);
+            atm.eject_card();
+        });
+        report.add("atm_session", {{"transport", transport}}, stats);
+    }
+    return 0;
+}
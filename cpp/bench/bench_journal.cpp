@@ -0,0 +1,56 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <unistd.h>
+#include "BenchHarness.h"
+#include "../include/BankSystem.h"
+#include "../include/Logger.h"
+
+// Measures journaled deposit throughput at several group-commit windows.
+// Every deposit waits for its fsync, so throughput is bounded by how many
+// concurrent deposits share one fsync.
+
+namespace {
+
+const int THREADS = 32;
+const std::size_t ACCOUNTS = 4;
+
+void run(bench::Report& report, long window_us) {
+    char directory_template[] = "/tmp/atm_bench_journal_XXXXXX";
+    std::string directory = mkdtemp(directory_template);
+    JournalConfig config(directory);
+    config.commit_window = std::chrono::microseconds(window_us);
+
+    {
+        BankSystem bank;
+        bank.open_journal(config);
+        std::vector<Card> cards;
+        for (std::size_t i = 0; i < ACCOUNTS; ++i) {
+            bank.add_account(make_card_number(i), "1234", 0);
+            cards.emplace_back(make_card_number(i));
+        }
+
+        bench::Stats stats = bench::run(THREADS, bench::scaled(200), [&](int t, std::size_t) {
+            bank.get_account(cards[t % ACCOUNTS]).deposit(1);
+        });
+        JournalStats journal = bank.get_journal()->stats();
+        report.add("durable_deposit", {{"commit_window_us", std::to_string(window_us)},
+                                       {"threads", std::to_string(THREADS)},
+                                       {"records_per_fsync", std::to_string(journal.records / journal.batches)}},
+                   stats);
+    }
+    std::system(("rm -rf " + directory).c_str());
+}
+
+} // namespace
+
+int main() {
+    Logger::set_level(LogLevel::Warn);
+    bench::Report report("journal");
+    const long windows_us[] = {0, 100, 500, 1000, 5000};
+    for (long window : windows_us) {
+        run(report, window);
+    }
+    return 0;
+}
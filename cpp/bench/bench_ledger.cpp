@@ -0,0 +1,71 @@
+#include <string>
+#include "BenchHarness.h"
+#include "../include/BankSystem.h"
+#include "../include/Ledger.h"
+#include "../include/Logger.h"
+
+// Measures the transaction ledger: the cost it adds to a deposit, raw
+// appends with and without a reserved pool, and mini-statement and
+// time-range queries on one account with a long history.
+
+namespace {
+
+// Builds an entry made t milliseconds into the history.
+LedgerEntry entry_at(std::uint64_t t) {
+    LedgerEntry entry = {static_cast<std::int64_t>(t) * 1000, 1, LedgerEntryType::Deposit, 1,
+                         static_cast<std::int32_t>(t)};
+    return entry;
+}
+
+} // namespace
+
+int main() {
+    Logger::set_level(LogLevel::Error); // Every deposit logs at Info level.
+    bench::Report report("ledger");
+
+    const std::size_t deposits = bench::scaled(1000000);
+    for (int with_ledger = 0; with_ledger < 2; ++with_ledger) {
+        BankSystem bank(1);
+        if (with_ledger) {
+            bank.open_ledger(deposits);
+        }
+        bank.add_account(make_card_number(0), "1234", 0);
+        Account& account = bank.get_account(Card(make_card_number(0)));
+        report.add("deposit", {{"ledger", with_ledger ? "on" : "off"}},
+                   bench::run(1, deposits, [&](int, std::size_t) { account.deposit(1); }));
+    }
+
+    const std::size_t appends = bench::scaled(2000000);
+    for (int reserved = 0; reserved < 2; ++reserved) {
+        Ledger ledger(reserved ? appends : 0);
+        AccountLedger& history = ledger.create_account_ledger();
+        report.add("append", {{"pool", reserved ? "reserved" : "on_demand"}},
+                   bench::run(1, appends, [&](int, std::size_t i) { history.append(entry_at(i)); }));
+    }
+
+    // One entry per millisecond, so a one-second window holds 1000 entries.
+    const std::size_t rows = bench::scaled(20000000);
+    Ledger ledger(rows);
+    AccountLedger& history = ledger.create_account_ledger();
+    for (std::size_t i = 0; i < rows; ++i) {
+        history.append(entry_at(i));
+    }
+    const std::string row_count = std::to_string(rows);
+    const std::size_t queries = bench::scaled(200000);
+    for (std::size_t count : {10, 100}) {
+        report.add("last", {{"rows", row_count}, {"count", std::to_string(count)}},
+                   bench::run(1, queries, [&](int, std::size_t) {
+                       if (history.last(count).size() != count) std::abort();
+                   }));
+    }
+    for (std::size_t window_ms : {10, 1000}) {
+        report.add("between", {{"rows", row_count}, {"window_ms", std::to_string(window_ms)}},
+                   bench::run(1, queries / 10, [&](int, std::size_t i) {
+                       // Spread the windows over the whole history, oldest included.
+                       std::int64_t from = static_cast<std::int64_t>((i * 7919) % (rows - window_ms)) * 1000;
+                       std::int64_t to = from + static_cast<std::int64_t>(window_ms) * 1000 - 1;
+                       if (history.between(from, to).size() != window_ms) std::abort();
+                   }));
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include <string>
+#include "BenchHarness.h"
+#include "../include/ATMController.h"
+#include "../include/Limits.h"
+#include "../include/Logger.h"
+
+// Measures the velocity-limit counters: a check-and-add on one hot key and
+// spread over far more keys than the table holds (so most adds evict), a
+// read after the window has slid, and the cost the limits add to an ATM
+// withdrawal.
+
+int main() {
+    Logger::set_level(LogLevel::Error); // Every withdrawal logs at Info level.
+    bench::Report report("limits");
+
+    const std::size_t ops = bench::scaled(2000000);
+    const std::size_t capacity = 16384;
+    for (int threads : {1, 4}) {
+        SlidingWindowCounters counters(std::chrono::hours(24), 24, capacity);
+        report.add("try_add", {{"keys", "1"}, {"threads", std::to_string(threads)}},
+                   bench::run(threads, ops, [&](int, std::size_t i) {
+                       counters.try_add(1, 1, 1LL << 40, static_cast<std::int64_t>(i));
+                   }));
+
+        SlidingWindowCounters spread(std::chrono::hours(24), 24, capacity);
+        report.add("try_add", {{"keys", "1000000"}, {"threads", std::to_string(threads)}},
+                   bench::run(threads, ops, [&](int, std::size_t i) {
+                       spread.try_add((i * 2654435761u) % 1000000, 1, 1000, static_cast<std::int64_t>(i));
+                   }));
+        WindowCounterStats stats = spread.stats(static_cast<std::int64_t>(ops));
+        std::cout << "  " << threads << " threads: " << stats.active << " of " << stats.capacity
+                  << " slots active, " << stats.evictions << " evictions" << std::endl;
+    }
+
+    // Each read lands in a later hour, so every bucket of the key expires in turn.
+    SlidingWindowCounters sliding(std::chrono::hours(24), 24, capacity);
+    const std::int64_t hour = 3600 * 1000LL;
+    report.add("total", {{"advance", "hourly"}}, bench::run(1, ops, [&](int, std::size_t i) {
+                   std::int64_t now = static_cast<std::int64_t>(i) * hour;
+                   sliding.add(i % 64, 5, now);
+                   if (sliding.total(i % 64, now) <= 0) std::abort();
+               }));
+
+    const std::size_t withdrawals = bench::scaled(500000);
+    for (int with_limits = 0; with_limits < 2; ++with_limits) {
+        BankSystem bank(1);
+        if (with_limits) {
+            LimitsConfig config;
+            // High enough to be checked on every withdrawal but never reached.
+            config.max_daily_withdrawal = 1LL << 40;
+            config.max_atm_transactions = 1 << 30;
+            bank.enable_limits(config);
+        }
+        bank.add_account(make_card_number(0), "1234", 1 << 30);
+        Card card(make_card_number(0));
+        ATMController atm(bank, 1);
+        atm.insert_card(card);
+        atm.enter_pin("1234");
+        report.add("atm_withdraw", {{"limits", with_limits ? "on" : "off"}},
+                   bench::run(1, withdrawals, [&](int, std::size_t) {
+                       if (!atm.try_withdraw(1)) std::abort();
+                   }));
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include <string>
+#include "BenchHarness.h"
+#include "../include/ATMController.h"
+#include "../include/Logger.h"
+#include "../include/Metrics.h"
+
+// Cost of the operation metrics: an empty MetricsTimer scope, and
+// ATMController::view_balance with its timer. Build with `make METRICS=off`
+// (after `make clean`) to compare against the same calls compiled without them.
+
+namespace {
+
+const int THREAD_COUNTS[] = {1, 4};
+
+} // namespace
+
+int main() {
+    Logger::set_level(LogLevel::Warn);
+    bench::Report report("metrics");
+#ifdef ATM_METRICS_DISABLED
+    const char* metrics = "off";
+#else
+    const char* metrics = "on";
+#endif
+
+    const std::size_t ops = bench::scaled(1000000);
+    for (int threads : THREAD_COUNTS) {
+        report.add("timer_scope", {{"metrics", metrics}, {"threads", std::to_string(threads)}},
+                   bench::run(threads, ops, [](int, std::size_t) {
+                       MetricsTimer timer(MetricOp::AtmViewBalance);
+                   }));
+    }
+
+    PinHashConfig cheap_pins;
+    cheap_pins.iterations = 1;
+    BankSystem bank(BankSystem::DEFAULT_SHARD_COUNT, cheap_pins);
+    bank.add_account(make_card_number(0), "1234", 100);
+    Card card(make_card_number(0));
+    ATMController atm(bank);
+    atm.insert_card(card);
+    atm.enter_pin("1234");
+    report.add("view_balance", {{"metrics", metrics}, {"threads", "1"}},
+               bench::run(1, ops, [&](int, std::size_t) {
+                   if (atm.view_balance() != 100) std::abort();
+               }));
+
+    report.add("snapshot", {{"metrics", metrics}},
+               bench::run(1, bench::scaled(200), [](int, std::size_t) {
+                   if (Metrics::instance().snapshot().operations.size() != METRIC_OP_COUNT) std::abort();
+               }));
+    return 0;
+}
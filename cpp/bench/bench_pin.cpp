@@ -0,0 +1,60 @@
+#include <string>
+#include <vector>
+#include "BenchHarness.h"
+#include "../include/BankSystem.h"
+#include "../include/Logger.h"
+
+// Measures PIN verification through BankSystem's verifier pool: login
+// throughput and latency at several KDF costs and pool sizes, with the time
+// checks spent queued reported alongside.
+
+namespace {
+
+const int CLIENT_THREADS = 16;
+const std::size_t ACCOUNTS = 64;
+const std::uint32_t COSTS[] = {1000, 10000};
+const std::size_t POOL_SIZES[] = {1, 2, 4};
+
+std::string str(std::uint64_t value) {
+    return std::to_string(static_cast<unsigned long long>(value));
+}
+
+void bench_verify(bench::Report& report, std::uint32_t iterations, std::size_t pool_size) {
+    PinHashConfig config;
+    config.iterations = iterations;
+    config.verifier_threads = pool_size;
+    BankSystem bank(BankSystem::DEFAULT_SHARD_COUNT, config);
+    std::vector<Card> cards;
+    for (std::size_t i = 0; i < ACCOUNTS; ++i) {
+        bank.add_account(make_card_number(i), "1234", 0);
+        cards.emplace_back(make_card_number(i));
+    }
+
+    // Roughly a second of work at one core per pool thread.
+    std::size_t per_thread = bench::scaled(iterations >= 10000 ? 8 : 64);
+    bank.get_pin_verifier().reset_stats();
+    bench::Stats stats = bench::run(CLIENT_THREADS, per_thread, [&](int t, std::size_t i) {
+        bank.authenticate(cards[(t + i) % ACCOUNTS], i % 4 == 3 ? "9999" : "1234");
+    });
+    PinVerifierStats verifier = bank.get_pin_verifier().stats();
+    report.add("authenticate", {{"iterations", str(iterations)},
+                                {"verifier_threads", str(pool_size)},
+                                {"client_threads", str(CLIENT_THREADS)},
+                                {"queue_wait_p50_us", str(verifier.queue_wait_p50_ns / 1000)},
+                                {"queue_wait_p99_us", str(verifier.queue_wait_p99_ns / 1000)},
+                                {"checks_per_batch", str(verifier.batches == 0 ? 0 : verifier.verified / verifier.batches)}},
+               stats);
+}
+
+} // namespace
+
+int main() {
+    Logger::set_level(LogLevel::Error);
+    bench::Report report("pin");
+    for (std::uint32_t iterations : COSTS) {
+        for (std::size_t pool_size : POOL_SIZES) {
+            bench_verify(report, iterations, pool_size);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <string>
+#include <vector>
+#include <sstream>
+#include "BenchHarness.h"
+#include "PolicyBank.h"
+#include "../include/Logger.h"
+
+// Measures BasicBank across policy combinations: every storage policy with
+// every concurrency policy (logging and metrics off), adding accounts and
+// then a lookup plus a deposit or withdrawal on a random account, on one
+// thread and, where the policy is thread-safe, on four. The default
+// instantiation is then measured with each logging and metrics policy.
+
+namespace {
+
+const std::size_t ACCOUNTS = 1 << 16;
+
+// Spreads operation i of thread t over the accounts.
+std::uint64_t key_for(int t, std::size_t i) {
+    return FlatAccountTable::hash(static_cast<std::uint64_t>(t) << 32 | i) % ACCOUNTS + 1;
+}
+
+// Adds the accounts, then runs lookups and updates; records both.
+template <typename Bank>
+void measure(bench::Report& report, const bench::Params& params, const std::vector<int>& thread_counts,
+             std::size_t ops) {
+    Bank bank;
+    bench::Params add_params = params;
+    add_params.push_back(std::make_pair(std::string("threads"), std::string("1")));
+    report.add("add_account", add_params, bench::run(1, ACCOUNTS, [&](int, std::size_t i) {
+                   bank.add_account(i + 1, 1 << 20);
+               }));
+    for (int threads : thread_counts) {
+        bench::Params update_params = params;
+        update_params.push_back(std::make_pair(std::string("threads"), std::to_string(threads)));
+        report.add("find_update", update_params, bench::run(threads, ops, [&](int t, std::size_t i) {
+                       typename Bank::Handle account = bank.find(key_for(t, i));
+                       Result<int> result = i % 2 ? bank.try_withdraw(account, 10) : bank.try_deposit(account, 10);
+                       if (!result) std::abort();
+                   }));
+    }
+}
+
+// Runs every concurrency policy over one storage policy.
+template <typename Storage>
+void measure_storage(bench::Report& report, const std::string& storage, std::size_t ops) {
+    using namespace bank_policy;
+    const std::vector<int> single = {1};
+    const std::vector<int> both = {1, 4};
+    measure<BasicBank<Storage, NoLocking, NoLogging, NoMetrics>>(
+        report, {{"storage", storage}, {"concurrency", "none"}}, single, ops);
+    measure<BasicBank<Storage, GlobalMutexLocking, NoLogging, NoMetrics>>(
+        report, {{"storage", storage}, {"concurrency", "mutex"}}, both, ops);
+    measure<BasicBank<Storage, ShardedLocking<>, NoLogging, NoMetrics>>(
+        report, {{"storage", storage}, {"concurrency", "sharded"}}, both, ops);
+    measure<BasicBank<Storage, AtomicBalances<>, NoLogging, NoMetrics>>(
+        report, {{"storage", storage}, {"concurrency", "atomic"}}, both, ops);
+}
+
+} // namespace
+
+int main() {
+    using namespace bank_policy;
+    bench::Report report("policies");
+    const std::size_t ops = bench::scaled(2000000);
+
+    measure_storage<NodeMapStorage>(report, "node_map", ops);
+    measure_storage<FlatMapStorage>(report, "flat_map", ops);
+    measure_storage<SoAStorage>(report, "soa", ops);
+
+    // Logging and metrics on the default storage and concurrency. Async lines
+    // are filtered at the call site by level, so it is measured both enabled
+    // and filtered; sync lines go to a string stream and async ones
+    // to a disabled console.
+    const std::vector<int> single = {1};
+    const std::size_t logged_ops = bench::scaled(200000);
+    measure<BasicBank<FlatMapStorage, ShardedLocking<>, NoLogging, RecordMetrics>>(
+        report, {{"logging", "none"}, {"metrics", "on"}}, single, ops);
+    std::ostringstream sink;
+    SyncLogging::sink() = &sink;
+    measure<BasicBank<FlatMapStorage, ShardedLocking<>, SyncLogging, NoMetrics>>(
+        report, {{"logging", "sync"}, {"metrics", "off"}}, single, logged_ops);
+    SyncLogging::sink() = &std::clog;
+    Logger::set_level(LogLevel::Error);
+    measure<BasicBank<FlatMapStorage, ShardedLocking<>, AsyncLogging, NoMetrics>>(
+        report, {{"logging", "async_filtered"}, {"metrics", "off"}}, single, ops);
+    Logger::set_level(LogLevel::Info);
+    Logger::instance().set_console_enabled(false);
+    measure<DefaultBank>(report, {{"logging", "async"}, {"metrics", "on"}}, single, logged_ops);
+    Logger::instance().flush();
+    std::cout << "  async: " << Logger::instance().dropped_count() << " lines dropped" << std::endl;
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "BenchHarness.h"
+#include "../include/BankSystem.h"
+#include "../include/Posting.h"
+#include "../include/Logger.h"
+
+// Measures overnight batch posting: the interest and fee kernels on
+// contiguous balances (each operation is one block of 1024 balances), a
+// whole BankSystem::post_batch() against the loop it replaces, which calls
+// Account::deposit or withdraw per account, and the latency of live ATM
+// withdrawals while batches post on the same bank.
+
+namespace {
+
+const std::size_t BLOCK = 1024;
+
+// Interest, and a fee for small balances.
+PostingRules overnight_rules() {
+    PostingRules rules;
+    rules.interest_bp = 3;
+    rules.fee = 25;
+    rules.fee_waiver_balance = 500000;
+    return rules;
+}
+
+// Opens count accounts with balances spread around the fee waiver.
+void open_accounts(BankSystem& bank, std::size_t count) {
+    PinCredential credential = hash_pin("1234", 1);
+    std::vector<BankSystem::NewAccount> accounts(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        pack_card_number(make_card_number(i), accounts[i].key);
+        accounts[i].packed_pin = 0;
+        accounts[i].credential = credential;
+        accounts[i].balance = static_cast<int>(FlatAccountTable::hash(i) % 1000000);
+    }
+    bank.add_accounts(accounts);
+}
+
+} // namespace
+
+int main() {
+    Logger::set_level(LogLevel::Warn);
+    bench::Report report("posting");
+    const PostingRules rules = overnight_rules();
+
+    std::vector<int> balances(BLOCK * 1024);
+    for (std::size_t i = 0; i < balances.size(); ++i) {
+        balances[i] = static_cast<int>(FlatAccountTable::hash(i) % 1000000);
+    }
+    std::vector<int> deltas(balances.size());
+    const std::size_t blocks = bench::scaled(200000);
+    for (PostingKernel kernel : {PostingKernel::Scalar, PostingKernel::SSE2, PostingKernel::AVX2}) {
+        if (!posting_kernel_supported(kernel)) {
+            continue;
+        }
+        report.add("kernel_1024_balances", {{"kernel", posting_kernel_name(kernel)}},
+                   bench::run(1, blocks, [&](int, std::size_t i) {
+                       std::size_t offset = (i % 1024) * BLOCK;
+                       compute_postings(&balances[offset], &deltas[offset], BLOCK, rules, kernel);
+                   }));
+    }
+
+    // The loop batch posting replaces, with its log line per account and
+    // without, then whole batches in both balance modes.
+    const std::size_t account_count = std::max<std::size_t>(2000, bench::scaled(1000000));
+    const std::size_t rounds = 5;
+    const bench::Params accounts_param = {{"accounts", std::to_string(account_count)}};
+    BankSystem bank(16, PinHashConfig(), BalanceMode::Locked);
+    open_accounts(bank, account_count);
+    std::vector<Account*> accounts;
+    for (std::size_t i = 0; i < account_count; ++i) {
+        accounts.push_back(&bank.get_account(Card(make_card_number(i))));
+    }
+    Logger::instance().set_console_enabled(false);
+    for (int logged = 1; logged >= 0; --logged) {
+        Logger::set_level(logged ? LogLevel::Info : LogLevel::Warn);
+        bench::Params params = accounts_param;
+        params.push_back(std::make_pair(std::string("logging"), std::string(logged ? "info" : "off")));
+        report.add("deposit_loop", params, bench::run(1, rounds, [&](int, std::size_t) {
+                       for (Account* account : accounts) {
+                           int delta = posting_delta(account->get_balance(), rules);
+                           if (delta > 0) {
+                               account->deposit(delta);
+                           } else if (delta < 0) {
+                               account->withdraw(-delta);
+                           }
+                       }
+                   }));
+    }
+    Logger::instance().flush();
+    Logger::instance().set_console_enabled(true);
+
+    BankSystem lock_free_bank(16, PinHashConfig(), BalanceMode::LockFree);
+    open_accounts(lock_free_bank, account_count);
+    for (int mode = 0; mode < 2; ++mode) {
+        BankSystem& target = mode == 0 ? bank : lock_free_bank;
+        for (int threads : {1, 2, 4}) {
+            bench::Params params = accounts_param;
+            params.push_back(std::make_pair(std::string("mode"), std::string(mode == 0 ? "locked" : "lock_free")));
+            params.push_back(std::make_pair(std::string("threads"), std::to_string(threads)));
+            report.add("post_batch", params, bench::run(1, rounds, [&](int, std::size_t) {
+                           target.post_batch(rules, std::vector<BankSystem::PostingAdjustment>(),
+                                             static_cast<std::size_t>(threads));
+                       }));
+        }
+    }
+
+    // Live withdrawals on hot accounts, alone and while batches post.
+    const std::size_t withdrawals = bench::scaled(200000);
+    for (int posting = 0; posting < 2; ++posting) {
+        std::atomic<bool> stop(false);
+        std::thread poster;
+        if (posting) {
+            poster = std::thread([&]() {
+                while (!stop.load()) {
+                    bank.post_batch(rules, std::vector<BankSystem::PostingAdjustment>(), 2);
+                }
+            });
+        }
+        report.add("live_withdraw", {{"during_posting", posting ? "yes" : "no"}},
+                   bench::run(2, withdrawals, [&](int t, std::size_t i) {
+                       Account& account = *accounts[static_cast<std::size_t>(t) * 1000 + i % 1000];
+                       account.deposit(10);
+                       account.withdraw(10);
+                   }));
+        stop.store(true);
+        if (poster.joinable()) {
+            poster.join();
+        }
+    }
+    return 0;
+}
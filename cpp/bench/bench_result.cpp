@@ -0,0 +1,78 @@
+#include <stdexcept>
+#include <string>
+#include "BenchHarness.h"
+#include "../include/ATMController.h"
+#include "../include/Logger.h"
+
+// Compares the throwing API with the non-throwing try_* API on routine
+// failures (declined withdrawals and wrong PINs) and on successful
+// withdrawals, where both styles should cost the same.
+
+namespace {
+
+const int THREAD_COUNTS[] = {1, 4};
+
+} // namespace
+
+int main() {
+    Logger::set_level(LogLevel::Error); // Wrong PINs log a warning each.
+    bench::Report report("result");
+
+    PinHashConfig cheap_pins; // Keeps the wrong-PIN path about control flow, not hashing.
+    cheap_pins.iterations = 1;
+    BankSystem bank(BankSystem::DEFAULT_SHARD_COUNT, cheap_pins);
+    const int max_threads = 4;
+    std::vector<Card> cards;
+    for (int t = 0; t < max_threads; ++t) {
+        bank.add_account(make_card_number(t), "1234", 1000000000);
+        cards.emplace_back(make_card_number(t));
+    }
+
+    const std::size_t ops = bench::scaled(200000);
+    for (int threads : THREAD_COUNTS) {
+        std::vector<std::unique_ptr<ATMController>> atms;
+        for (int t = 0; t < threads; ++t) {
+            atms.emplace_back(new ATMController(bank));
+            atms.back()->insert_card(cards[t]);
+            atms.back()->enter_pin("1234");
+        }
+        std::string thread_count = std::to_string(threads);
+
+        report.add("declined_withdraw", {{"style", "exception"}, {"threads", thread_count}},
+                   bench::run(threads, ops, [&](int t, std::size_t) {
+                       try {
+                           atms[t]->withdraw(2000000000);
+                           std::abort();
+                       } catch (const std::invalid_argument&) {
+                       }
+                   }));
+        report.add("declined_withdraw", {{"style", "result"}, {"threads", thread_count}},
+                   bench::run(threads, ops, [&](int t, std::size_t) {
+                       if (atms[t]->try_withdraw(2000000000).error() != TxError::InsufficientFunds) std::abort();
+                   }));
+
+        report.add("withdraw", {{"style", "exception"}, {"threads", thread_count}},
+                   bench::run(threads, ops, [&](int t, std::size_t) {
+                       atms[t]->withdraw(1);
+                   }));
+        report.add("withdraw", {{"style", "result"}, {"threads", thread_count}},
+                   bench::run(threads, ops, [&](int t, std::size_t) {
+                       if (!atms[t]->try_withdraw(1)) std::abort();
+                   }));
+
+        const std::size_t pin_ops = ops / 10;
+        report.add("wrong_pin", {{"style", "exception"}, {"threads", thread_count}},
+                   bench::run(threads, pin_ops, [&](int t, std::size_t) {
+                       try {
+                           atms[t]->enter_pin("9999");
+                           std::abort();
+                       } catch (const std::invalid_argument&) {
+                       }
+                   }));
+        report.add("wrong_pin", {{"style", "result"}, {"threads", thread_count}},
+                   bench::run(threads, pin_ops, [&](int t, std::size_t) {
+                       if (atms[t]->try_enter_pin("9999").error() != TxError::WrongPin) std::abort();
+                   }));
+    }
+    return 0;
+}
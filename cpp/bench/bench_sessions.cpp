@@ -0,0 +1,152 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include "BenchHarness.h"
+#include "../include/ATMController.h"
+#include "../include/BankSystem.h"
+#include "../include/Card.h"
+#include "../include/Logger.h"
+#include "../include/SessionManager.h"
+
+// Measures SessionManager against a controller per customer: a whole
+// session (card in, PIN, withdrawal, card out) with the heap allocations it
+// makes, requests spread over many open sessions at once, and an expiry
+// sweep of every session. The pool's memory per session is reported too.
+
+namespace {
+
+std::atomic<std::uint64_t> allocations(0);
+std::atomic<std::uint64_t> allocated_bytes(0);
+
+const std::size_t ACCOUNTS = 1024;
+const char* PIN = "1234";
+
+// Returns the allocations made while op ran.
+template <typename Op>
+std::uint64_t count_allocations(Op op) {
+    std::uint64_t before = allocations.load();
+    op();
+    return allocations.load() - before;
+}
+
+// Formats a number for a parameter.
+std::string format(double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.2f", value);
+    return text;
+}
+
+} // namespace
+
+// Counts every allocation of the process.
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    void* memory = std::malloc(size == 0 ? 1 : size);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+// GCC takes free() in a replacement operator delete for a mismatch.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+#pragma GCC diagnostic pop
+
+int main() {
+    Logger::set_level(LogLevel::Error); // Every request logs at Info level.
+    bench::Report report("sessions");
+
+    PinHashConfig cheap_pins; // Keeps the measurement about sessions, not hashing.
+    cheap_pins.iterations = 1;
+    BankSystem bank(BankSystem::DEFAULT_SHARD_COUNT, cheap_pins);
+    std::vector<Card> cards;
+    for (std::size_t i = 0; i < ACCOUNTS; ++i) {
+        bank.add_account(make_card_number(i), PIN, 1000000000);
+        cards.push_back(Card(make_card_number(i)));
+    }
+    const std::string pin = PIN;
+
+    // Whole sessions, one after another.
+    const std::size_t cycles = bench::scaled(200000);
+    bench::Stats stats;
+    std::uint64_t made = count_allocations([&]() {
+        stats = bench::run(1, cycles, [&](int, std::size_t i) {
+            std::unique_ptr<ATMController> atm(new ATMController(bank));
+            atm->insert_card(cards[i % ACCOUNTS]);
+            atm->enter_pin(pin);
+            atm->withdraw(1);
+            atm->eject_card();
+        });
+    });
+    report.add("session", {{"via", "controller"}, {"allocs_per_session", format(static_cast<double>(made) / cycles)}},
+               stats);
+
+    SessionConfig config;
+    config.capacity = 1024;
+    SessionManager small(bank, config);
+    made = count_allocations([&]() {
+        stats = bench::run(1, cycles, [&](int, std::size_t i) {
+            SessionHandle session = small.open_session(cards[i % ACCOUNTS]);
+            small.enter_pin(session, pin);
+            small.withdraw(session, 1);
+            small.close_session(session);
+        });
+    });
+    report.add("session", {{"via", "pool"}, {"allocs_per_session", format(static_cast<double>(made) / cycles)}},
+               stats);
+
+    // Requests on random sessions of a large pool, all open and authenticated.
+    const std::size_t open_sessions[] = {bench::scaled(1000), bench::scaled(100000), bench::scaled(500000)};
+    for (std::size_t count : open_sessions) {
+        config.capacity = count;
+        std::uint64_t bytes_before = allocated_bytes.load();
+        SessionManager pool(bank, config);
+        const double bytes_per_session = static_cast<double>(allocated_bytes.load() - bytes_before) / count;
+        std::vector<SessionHandle> handles(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            handles[i] = pool.open_session(cards[i % ACCOUNTS]);
+            pool.enter_pin(handles[i], pin);
+        }
+        std::mt19937_64 random(42);
+        std::vector<std::uint32_t> order(bench::scaled(1000000));
+        for (std::uint32_t& index : order) {
+            index = static_cast<std::uint32_t>(random() % count);
+        }
+        report.add("request", {{"open", std::to_string(count)}, {"bytes_per_session", format(bytes_per_session)}},
+                   bench::run(1, order.size(), [&](int, std::size_t i) {
+                       if (!pool.try_deposit(handles[order[i]], 1)) std::abort();
+                   }));
+    }
+
+    // One sweep expiring every session, all idle past the timeout.
+    const std::size_t idle = bench::scaled(500000);
+    config.capacity = idle;
+    config.idle_timeout = std::chrono::milliseconds(1000);
+    config.tick = std::chrono::milliseconds(50);
+    SessionManager expiring(bank, config);
+    for (std::size_t i = 0; i < idle; ++i) {
+        expiring.open_session(cards[i % ACCOUNTS]);
+    }
+    std::this_thread::sleep_for(config.idle_timeout + 4 * config.tick);
+    std::size_t swept = 0;
+    bench::Stats sweep = bench::run(1, 1, [&](int, std::size_t) { swept = expiring.expire_idle(); });
+    if (swept != idle) std::abort();
+    sweep.ops = swept;
+    sweep.ops_per_sec = sweep.seconds > 0 ? swept / sweep.seconds : 0;
+    report.add("expire_sweep", {{"idle", std::to_string(idle)}}, sweep);
+    return 0;
+}
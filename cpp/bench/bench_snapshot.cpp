@@ -0,0 +1,96 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include "BenchHarness.h"
+#include "../include/BankSystem.h"
+#include "../include/BalanceSnapshot.h"
+#include "../include/Logger.h"
+
+// Measures point-in-time balance snapshots: the time to take one over a
+// large bank at several thread counts and to export it, and the latency of
+// live ATM withdrawals on a bank without snapshots, with snapshots enabled
+// but idle, and while snapshots are taken back to back.
+
+namespace {
+
+// Opens count accounts through the bulk loader.
+void open_accounts(BankSystem& bank, std::size_t count) {
+    PinCredential credential = hash_pin("1234", 1);
+    std::vector<BankSystem::NewAccount> accounts(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        pack_card_number(make_card_number(i), accounts[i].key);
+        accounts[i].packed_pin = 0;
+        accounts[i].credential = credential;
+        accounts[i].balance = static_cast<int>(FlatAccountTable::hash(i) % 1000000);
+    }
+    bank.add_accounts(accounts);
+}
+
+} // namespace
+
+int main() {
+    Logger::set_level(LogLevel::Warn); // Every deposit and withdrawal logs at Info level.
+    bench::Report report("snapshot");
+
+    const std::size_t account_count = std::max<std::size_t>(2000, bench::scaled(1000000));
+    const bench::Params accounts_param = {{"accounts", std::to_string(account_count)}};
+    BankSystem plain(16);
+    open_accounts(plain, account_count);
+    BankSystem bank(16);
+    bank.enable_balance_snapshots();
+    open_accounts(bank, account_count);
+
+    const std::size_t rounds = 5;
+    for (int threads : {1, 2, 4}) {
+        bench::Params params = accounts_param;
+        params.push_back(std::make_pair(std::string("threads"), std::to_string(threads)));
+        report.add("take_snapshot", params, bench::run(1, rounds, [&](int, std::size_t) {
+                       if (bank.snapshot_balances(static_cast<std::size_t>(threads)).size() != account_count) {
+                           std::abort();
+                       }
+                   }));
+    }
+    BalanceSnapshot snapshot = bank.snapshot_balances();
+    char directory_template[] = "/tmp/atm_bench_snapshot_XXXXXX";
+    const std::string path = std::string(mkdtemp(directory_template)) + "/balances.bin";
+    report.add("write_file", accounts_param, bench::run(1, rounds, [&](int, std::size_t) { snapshot.write(path); }));
+    std::remove(path.c_str());
+    std::remove(path.substr(0, path.rfind('/')).c_str());
+
+    // Live withdrawals on hot accounts.
+    std::vector<Account*> plain_accounts;
+    std::vector<Account*> accounts;
+    for (std::size_t i = 0; i < 2000; ++i) {
+        plain_accounts.push_back(&plain.get_account(Card(make_card_number(i))));
+        accounts.push_back(&bank.get_account(Card(make_card_number(i))));
+    }
+    const std::size_t withdrawals = bench::scaled(200000);
+    for (int variant = 0; variant < 3; ++variant) {
+        const char* names[] = {"disabled", "idle", "running"};
+        std::vector<Account*>& targets = variant == 0 ? plain_accounts : accounts;
+        std::atomic<bool> stop(false);
+        std::thread snapshotter;
+        if (variant == 2) {
+            snapshotter = std::thread([&]() {
+                while (!stop.load()) {
+                    bank.snapshot_balances(1);
+                }
+            });
+        }
+        report.add("live_withdraw", {{"snapshots", names[variant]}},
+                   bench::run(2, withdrawals, [&](int t, std::size_t i) {
+                       Account& account = *targets[static_cast<std::size_t>(t) * 1000 + i % 1000];
+                       account.deposit(10);
+                       account.withdraw(10);
+                   }));
+        stop.store(true);
+        if (snapshotter.joinable()) {
+            snapshotter.join();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+#include "BenchHarness.h"
+#include "../include/Account.h"
+#include "../include/Card.h"
+#include "../include/CompactAccountStore.h"
+#include "../include/FlatAccountTable.h"
+#include "../include/Logger.h"
+
+// Compares one Account object per account (as BankSystem stores them) with
+// the struct-of-arrays CompactAccountStore: memory per account, a full scan
+// over every balance, and random deposits/withdrawals.
+
+namespace {
+
+const std::size_t ACCOUNTS = 1000000;
+const int THREAD_COUNTS[] = {1, 4};
+
+std::string str(std::size_t value) {
+    return std::to_string(static_cast<unsigned long long>(value));
+}
+
+std::vector<std::uint32_t> random_indexes(std::size_t count, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<std::uint32_t> pick(0, static_cast<std::uint32_t>(ACCOUNTS - 1));
+    std::vector<std::uint32_t> indexes(count);
+    for (std::uint32_t& index : indexes) {
+        index = pick(rng);
+    }
+    return indexes;
+}
+
+} // namespace
+
+int main() {
+    Logger::set_level(LogLevel::Warn);
+    bench::Report report("store");
+
+    std::deque<Account> objects;
+    FlatAccountTable table(ACCOUNTS);
+    CompactAccountStore store(ACCOUNTS);
+    for (std::size_t i = 0; i < ACCOUNTS; ++i) {
+        std::string id = make_card_number(i);
+        objects.emplace_back(id, 1000000);
+        std::uint64_t key = 0;
+        pack_card_number(id, key);
+        table.insert(key, nullptr, &objects.back());
+        store.add(id, 1000000);
+    }
+
+    // An Account object, its heap-allocated 16-digit ID and its table slot.
+    std::size_t object_bytes = sizeof(Account) + 32 + table.capacity() * sizeof(AccountEntry) / ACCOUNTS;
+    std::size_t compact_bytes = store.memory_usage() / ACCOUNTS;
+
+    const std::size_t scans = bench::scaled(20);
+    report.add("scan_balances", {{"store", "objects"}, {"accounts", str(ACCOUNTS)},
+                                 {"bytes_per_account", str(object_bytes)}},
+               bench::run(1, scans, [&](int, std::size_t) {
+                   long long total = 0;
+                   for (const Account& account : objects) {
+                       total += account.get_balance();
+                   }
+                   if (total == 0) std::abort();
+               }));
+    report.add("scan_balances", {{"store", "compact"}, {"accounts", str(ACCOUNTS)},
+                                 {"bytes_per_account", str(compact_bytes)}},
+               bench::run(1, scans, [&](int, std::size_t) {
+                   if (store.total_balance() == 0) std::abort();
+               }));
+
+    const std::size_t ops = bench::scaled(500000);
+    for (int threads : THREAD_COUNTS) {
+        std::vector<std::vector<std::uint32_t>> picks;
+        for (int t = 0; t < threads; ++t) {
+            picks.push_back(random_indexes(ops, 29 + t));
+        }
+        report.add("deposit_withdraw", {{"store", "objects"}, {"threads", str(threads)}},
+                   bench::run(threads, ops, [&](int t, std::size_t i) {
+                       Account& account = objects[picks[t][i]];
+                       if (i % 2 == 0) {
+                           account.deposit(10);
+                       } else {
+                           account.withdraw(10);
+                       }
+                   }));
+        report.add("deposit_withdraw", {{"store", "compact"}, {"threads", str(threads)}},
+                   bench::run(threads, ops, [&](int t, std::size_t i) {
+                       AccountHandle handle = picks[t][i];
+                       if (i % 2 == 0) {
+                           store.deposit(handle, 10);
+                       } else {
+                           store.withdraw(handle, 10);
+                       }
+                   }));
+    }
+    return 0;
+}
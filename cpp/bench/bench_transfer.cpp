@@ -0,0 +1,80 @@
+#include <string>
+#include <deque>
+#include "BenchHarness.h"
+#include "../include/Account.h"
+#include "../include/Card.h"
+#include "../include/FlatAccountTable.h"
+#include "../include/Logger.h"
+
+// Stresses Account::try_transfer under high contention: a hot pair of
+// accounts with half the threads transferring each way, so every transfer
+// races an opposing one for the same two locks, and random transfers among
+// a handful of accounts. Both balance modes are measured, and after every
+// run the total balance is checked to be unchanged.
+
+namespace {
+
+const int THREAD_COUNTS[] = {1, 2, 4, 8, 16};
+const int INITIAL_BALANCE = 1 << 30; // Covers every transfer of a run in one direction.
+
+struct Mode {
+    const char* name;
+    BalanceMode mode;
+};
+
+const Mode MODES[] = {{"locked", BalanceMode::Locked}, {"lock_free", BalanceMode::LockFree}};
+
+// Opens count accounts with INITIAL_BALANCE each.
+void open_accounts(std::deque<Account>& accounts, std::size_t count, BalanceMode mode) {
+    for (std::size_t i = 0; i < count; ++i) {
+        accounts.emplace_back(make_card_number(i), INITIAL_BALANCE, mode);
+    }
+}
+
+// Aborts unless the transfers kept the total balance.
+void check_total(const std::deque<Account>& accounts) {
+    long long total = 0;
+    for (const Account& account : accounts) {
+        total += account.get_balance();
+    }
+    if (total != static_cast<long long>(accounts.size()) * INITIAL_BALANCE) {
+        std::abort();
+    }
+}
+
+} // namespace
+
+int main() {
+    Logger::set_level(LogLevel::Warn); // Every transfer logs at Info level.
+    bench::Report report("transfer");
+
+    const std::size_t ops = bench::scaled(200000);
+    for (const Mode& mode : MODES) {
+        for (int threads : THREAD_COUNTS) {
+            std::deque<Account> pair;
+            open_accounts(pair, 2, mode.mode);
+            report.add("hot_pair_opposing", {{"mode", mode.name}, {"threads", std::to_string(threads)}},
+                       bench::run(threads, ops, [&](int t, std::size_t) {
+                           Account& from = pair[t % 2];
+                           if (!from.try_transfer(pair[1 - t % 2], 10)) std::abort();
+                       }));
+            check_total(pair);
+        }
+    }
+    for (const Mode& mode : MODES) {
+        for (int threads : THREAD_COUNTS) {
+            // Eight accounts, so most transfers share an account with another thread's.
+            std::deque<Account> few;
+            open_accounts(few, 8, mode.mode);
+            report.add("few_accounts_random", {{"mode", mode.name}, {"threads", std::to_string(threads)}},
+                       bench::run(threads, ops, [&](int t, std::size_t i) {
+                           std::uint64_t h = FlatAccountTable::hash(static_cast<std::uint64_t>(t) << 32 | i);
+                           std::size_t from = h % 8;
+                           std::size_t to = (from + 1 + (h >> 8) % 7) % 8;
+                           if (!few[from].try_transfer(few[to], 10)) std::abort();
+                       }));
+            check_total(few);
+        }
+    }
+    return 0;
+}
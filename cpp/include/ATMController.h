@@ -1,34 +1,109 @@
 #ifndef ATMCONTROLLER_H
 #define ATMCONTROLLER_H
 
+#include <vector>
+#include <memory>
+#include <cstdint>
 #include "BankSystem.h"
 #include "Card.h"
 #include "Account.h"
+#include "Result.h"
+#include "Ledger.h"
+#include "CashDispenser.h"
+
+// What an ATMController knows about the customer it serves: the inserted
+// card and, once the PIN is validated, the resolved accounts, so later
+// requests need no lookup. Kept apart from the controller so that one
+// controller can serve many interleaved customers (see resume()).
+struct ATMSession {
+    Card card;                // The inserted card, while card_inserted is set.
+    bool card_inserted;
+    bool authenticated;       // Authentication status.
+    Account* current_account; // The selected account.
+    Account* primary_account; // The account keyed by the card number, selected after PIN validation.
+
+    ATMSession()
+        : card(Card::from_key(0)), card_inserted(false), authenticated(false), current_account(nullptr),
+          primary_account(nullptr) {}
+};
 
 // The ATMController class manages ATM operations and user interactions.
 class ATMController {
 private:
     BankSystem& bank_system;     // Reference to the bank system.
-    Card* current_card;          // Pointer to the currently inserted card.
-    Account* current_account;    // Pointer to the current account.
-    bool authenticated;          // Authentication status.
+    ATMSession own_session;      // The customer served when no other session is resumed.
+    ATMSession* session;         // The customer being served.
+    std::uint32_t atm_id;        // Recorded in the ledger with every transaction made here.
+    std::unique_ptr<CashDispenser> dispenser; // Cash in the machine; null if not modeled.
+
+    // Bodies of the deposit and withdrawal methods; transaction_id is null for requests without one.
+    Result<int> run_deposit(int amount, const std::uint64_t* transaction_id);
+    Result<int> run_withdraw(int amount, const std::uint64_t* transaction_id);
+
+    // Finds one of the current card's accounts by ID, or returns null.
+    Account* find_card_account(const std::string& account_id) const;
 
 public:
-    // Constructor that initializes the ATMController with a given bank system.
-    ATMController(BankSystem& bank_system);
+    // Constructor that initializes the ATMController with a given bank system
+    // and the ID of the ATM it runs (0 if unspecified).
+    ATMController(BankSystem& bank_system, std::uint32_t atm_id = 0);
+
+    ATMController(const ATMController&) = delete;
+    ATMController& operator=(const ATMController&) = delete;
+
+    // Serves the customer whose state is in session until the next resume()
+    // or suspend(); requests update session in place. The session must
+    // outlive its use here and be served by one controller at a time.
+    void resume(ATMSession& session);
+
+    // Goes back to serving the controller's own session.
+    void suspend();
+
+    // Retrieves the ID of the ATM.
+    std::uint32_t get_atm_id() const;
+
+    // Loads the cassettes, replacing any loaded before. From then on a
+    // withdrawal also needs notes that make up the amount, and the notes
+    // are reserved and the account debited together: if either step fails,
+    // neither takes effect.
+    // Throws an exception if the cassettes are invalid (see CashDispenser).
+    void load_cash(const std::vector<Cassette>& cassettes, int max_notes = CashDispenser::DEFAULT_MAX_NOTES);
+
+    // Retrieves the cash inventory, or null if no cash is loaded.
+    CashDispenser* get_cash_dispenser() const;
 
-    // Simulates inserting a card into the ATM.
-    void insert_card(Card& card);
+    // Simulates inserting a card into the ATM. The card is copied.
+    void insert_card(const Card& card);
 
     // Simulates ejecting the currently inserted card.
     void eject_card();
 
     // Validates the PIN for the inserted card.
+    // Throws an exception if no card is inserted or the PIN is wrong.
     void enter_pin(const std::string& pin);
 
-    // Selects the account associated with the current card after PIN validation.
+    // Non-throwing form of enter_pin(): returns TxError::NoCard or TxError::WrongPin on failure,
+    // or with limits enabled TxError::RateLimited or TxError::CardLocked.
+    Result<void> try_enter_pin(const std::string& pin);
+
+    // Selects the account keyed by the card number, which is also the one
+    // selected when the PIN is validated.
+    // Throws an exception if the user is not authenticated.
     void select_account();
 
+    // Selects another account of the current card, e.g. its savings account.
+    // Throws an exception if the user is not authenticated or the card has no such account.
+    void select_account(const std::string& account_id);
+
+    // Non-throwing form of select_account(const std::string&): returns
+    // TxError::NoAccountSelected if the user is not authenticated, or
+    // TxError::UnknownAccount if the card has no such account.
+    Result<void> try_select_account(const std::string& account_id);
+
+    // Retrieves the IDs of the current card's accounts, the card's own first.
+    // Throws an exception if the user is not authenticated.
+    std::vector<std::string> list_accounts() const;
+
     // Displays the balance of the selected account.
     // Throws an exception if no account is selected or the user is not authenticated.
     int view_balance() const;
@@ -37,9 +112,52 @@ public:
     // Throws an exception if no account is selected or the user is not authenticated.
     int deposit(int amount);
 
+    // Non-throwing form of deposit(): returns the new balance, or
+    // TxError::NoAccountSelected, TxError::InvalidAmount or, with limits
+    // enabled, TxError::RateLimited.
+    Result<int> try_deposit(int amount);
+
+    // Deposits at most once per transaction ID, chosen by the client and
+    // unique per ATM: a retry with the same ID returns the first attempt's
+    // balance without depositing again, and waits if that attempt is still
+    // running. A failed attempt is forgotten, so its retry runs again. Returns
+    // TxError::TransactionIdReused if the ID was used for a different request.
+    // Throws std::logic_error if the bank does not track transaction IDs
+    // (see BankSystem::enable_deduplication()).
+    int deposit(int amount, std::uint64_t transaction_id);
+    Result<int> try_deposit(int amount, std::uint64_t transaction_id);
+
     // Withdraws a specified amount from the selected account.
     // Throws an exception if no account is selected or the user is not authenticated.
     int withdraw(int amount);
+
+    // Non-throwing form of withdraw(): returns the new balance, or
+    // TxError::NoAccountSelected, TxError::InvalidAmount, TxError::InsufficientFunds
+    // or, with cash loaded, TxError::CannotDispense, or with limits enabled
+    // TxError::RateLimited or TxError::DailyLimitExceeded. With a journal,
+    // TxError::NotDurable reports a withdrawal that was applied, and its
+    // cash dispensed, but not saved (see Account::try_deposit()).
+    Result<int> try_withdraw(int amount);
+
+    // Withdraws at most once per transaction ID, like deposit(int, std::uint64_t).
+    int withdraw(int amount, std::uint64_t transaction_id);
+    Result<int> try_withdraw(int amount, std::uint64_t transaction_id);
+
+    // Moves amount from the selected account to another account of the same
+    // card, atomically (see Account::try_transfer()). No cash moves, so the
+    // daily withdrawal limit does not apply.
+    // Throws an exception if no account is selected or the transfer fails.
+    int transfer(const std::string& to_account_id, int amount);
+
+    // Non-throwing form of transfer(): returns the selected account's new
+    // balance, or TxError::NoAccountSelected, TxError::UnknownAccount,
+    // TxError::SameAccount, TxError::InvalidAmount, TxError::InsufficientFunds
+    // or, with limits enabled, TxError::RateLimited.
+    Result<int> try_transfer(const std::string& to_account_id, int amount);
+
+    // Retrieves the newest count transactions of the selected account, oldest first.
+    // Throws an exception if no account is selected or the bank keeps no ledger.
+    std::vector<LedgerEntry> mini_statement(std::size_t count = 10) const;
 };
 
 #endif // ATMCONTROLLER_H
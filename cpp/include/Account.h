@@ -3,33 +3,130 @@
 
 #include <string>
 #include <stdexcept>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include "Result.h"
+#include "Ledger.h"
+
+class Journal;
+class AccountLedger;
+
+// How an account serializes concurrent balance updates.
+enum class BalanceMode {
+    Locked,  // Each update holds the account's mutex.
+    LockFree // Updates are compare-and-swap loops on the balance; no lock is taken.
+};
 
 // The Account class represents a bank account with basic operations.
 class Account {
 protected:
-    std::string account_id; // Unique identifier for the account.
-    int balance;            // Current balance of the account.
+    std::string account_id;   // Unique identifier for the account.
+    std::atomic<int> balance; // Current balance; always readable without the lock.
+    mutable std::mutex mutex; // Serializes locked-mode updates and their journal records.
+    Journal* journal;         // Receives every mutation when the bank is durable; may be null.
+    AccountLedger* ledger;    // Records every completed transaction when the bank keeps a ledger; may be null.
+    BalanceMode mode;
+    const std::atomic<std::uint64_t>* snapshot_epoch; // The bank's balance snapshot epoch; null unless enabled.
+    std::uint64_t opened_epoch;  // Snapshot epoch when the bank added the account.
+    std::uint64_t written_epoch; // Snapshot epoch of the last update. Guarded by the lock.
+    int snapshot_balance;        // Balance before the first update of written_epoch. Guarded by the lock.
+
+    friend class BankSystem;
 
 public:
-    // Constructor to initialize an account with an ID and optional initial balance.
-    Account(const std::string& account_id, int balance = 0);
+    // Constructor to initialize an account with an ID, optional initial balance and update mode.
+    Account(const std::string& account_id, int balance = 0, BalanceMode mode = BalanceMode::Locked);
+
+    // Accounts own a lock and are shared by reference, so they are not copyable.
+    Account(const Account&) = delete;
+    Account& operator=(const Account&) = delete;
 
     // Deposits a specified amount into the account.
+    // Safe to call from several threads on the same account.
+    // With a journal attached, returns only once the deposit is durable, or
+    // TxError::BackendUnavailable without changing anything once the journal
+    // has failed to write. A deposit already applied when the journal fails
+    // stands, but is not durable: it returns TxError::NotDurable.
+    // Returns the new balance, or TxError::InvalidAmount if the amount is not positive.
+    // Subclasses customize deposits by overriding this method.
+    virtual Result<int> try_deposit(int amount);
+
+    // Withdraws a specified amount from the account.
+    // The balance check and the update are one atomic step in either mode,
+    // so concurrent withdrawals never overdraw. A failed journal is handled as for try_deposit().
+    // Returns the new balance, or TxError::InvalidAmount or TxError::InsufficientFunds.
+    // Subclasses customize withdrawals by overriding this method.
+    virtual Result<int> try_withdraw(int amount);
+
+    // Throwing form of try_deposit().
     // Throws an exception if the amount is negative.
     virtual int deposit(int amount);
 
-    // Withdraws a specified amount from the account.
+    // Throwing form of try_withdraw().
     // Throws an exception if the amount is negative or exceeds the balance.
     virtual int withdraw(int amount);
 
-    // Retrieves the current balance of the account.
+    // Moves amount from this account to another account of the same bank.
+    // The debit and the credit are one step: unless both accounts are lock-free,
+    // both locks are held, taken in address order so that opposing transfers
+    // cannot deadlock, and the two journal records are applied together or
+    // not at all on recovery. Between two lock-free accounts the debit is a
+    // compare-and-swap and the credit follows it, so a concurrent reader may
+    // briefly see the amount in neither balance, but never in both.
+    // Goes around try_deposit() and try_withdraw(), so subclass overrides do not apply.
+    // Returns this account's new balance, or TxError::InvalidAmount,
+    // TxError::InsufficientFunds or TxError::SameAccount, or
+    // TxError::BackendUnavailable or TxError::NotDurable as for try_deposit().
+    Result<int> try_transfer(Account& to, int amount);
+
+    // Throwing form of try_transfer().
+    int transfer(Account& to, int amount);
+
+    // Retrieves the current balance of the account. Never blocks.
     int get_balance() const;
 
     // Retrieves the account ID.
     std::string get_account_id() const;
 
+    // Retrieves how the account serializes balance updates.
+    // A LockFree account with a journal or ledger attached, or in a bank
+    // that takes balance snapshots, takes the locked path so its records
+    // stay in balance order.
+    BalanceMode get_balance_mode() const;
+
+    // Retrieves the account's transaction history, or null if the bank keeps no ledger.
+    const AccountLedger* get_ledger() const;
+
     // Virtual destructor for safe polymorphic use.
     virtual ~Account() = default;
+
+private:
+    // True if updates may skip the lock: lock-free mode, no journal or ledger
+    // to keep in order and no balance snapshots.
+    bool lock_free() const;
+
+    // Saves the balance for a running snapshot before the first update
+    // after the snapshot epoch advanced. Requires the lock.
+    void preserve_balance();
+
+    // Saves the balance for epoch, as read once by an update that changes
+    // several accounts. Requires the lock.
+    void preserve_balance(std::uint64_t epoch);
+
+    // Reads the bank's snapshot epoch, or 0 without balance snapshots.
+    std::uint64_t current_snapshot_epoch() const;
+
+    // Waits for an applied update's journal record. Returns false, and logs
+    // it, if the record will never reach disk.
+    bool wait_durable(std::uint64_t lsn);
+
+    // Appends a transaction to the ledger. Requires the lock.
+    void record(LedgerEntryType type, int amount, int new_balance);
+
+    // Subtracts amount if the balance covers it; returns false otherwise.
+    // Atomic on its own, so it is safe whether or not the lock is held.
+    bool debit(int amount, int& new_balance);
 };
 
 #endif // ACCOUNT_H
@@ -0,0 +1,45 @@
+#ifndef BACKENDPROTOCOL_H
+#define BACKENDPROTOCOL_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include "BankBackend.h"
+
+// Wire format shared by RemoteBankBackend and BankServer. Every frame has a
+// fixed size, so a reader never needs a length prefix, and carries the
+// request ID so replies can arrive in any order. Both ends run on one host
+// (a Unix domain socket), so integers are in host byte order.
+//
+// Request (48 bytes): id u64, op u8, pin length u8, reserved u16, amount i32,
+//                     card key u64, pin (12 bytes), reserved u32, session u64.
+// Reply (32 bytes):   id u64, error u8, reserved (3 bytes), balance i32, card key u64,
+//                     session u64.
+const std::size_t BACKEND_REQUEST_SIZE = 48;
+const std::size_t BACKEND_REPLY_SIZE = 32;
+const std::size_t BACKEND_MAX_PIN_LENGTH = 12;
+
+// Encodes a request. Throws an exception if the PIN is longer than 12 characters.
+void encode_backend_request(std::uint64_t id, const BackendRequest& request, char* out);
+
+// Decodes a request. Returns false if the frame is malformed.
+bool decode_backend_request(const char* frame, std::uint64_t& id, BackendRequest& request);
+
+// Encodes a reply.
+void encode_backend_reply(std::uint64_t id, const BackendReply& reply, char* out);
+
+// Decodes a reply.
+void decode_backend_reply(const char* frame, std::uint64_t& id, BackendReply& reply);
+
+// Sends the whole buffer, retrying on short writes and EINTR. Never raises SIGPIPE.
+// Returns false if the connection is broken.
+bool send_all(int fd, const char* data, std::size_t size);
+
+// Opens a listening Unix domain socket at path, replacing a stale socket file.
+// Throws an exception on failure.
+int listen_unix(const std::string& path);
+
+// Connects to a Unix domain socket. Throws an exception on failure.
+int connect_unix(const std::string& path);
+
+#endif // BACKENDPROTOCOL_H
@@ -0,0 +1,74 @@
+#ifndef BALANCESNAPSHOT_H
+#define BALANCESNAPSHOT_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "Result.h"
+
+// Every balance of a bank as of one instant, taken by
+// BankSystem::snapshot_balances() while transactions keep running, e.g. for
+// end-of-day reconciliation or a regulatory report. A transfer is either in
+// both of its accounts or in neither, so the total is exactly the money the
+// bank held at that instant. Card accounts are kept as packed card numbers
+// next to their balances, 12 bytes each in the exported file.
+class BalanceSnapshot {
+public:
+    // The balance of an account keyed by its card number.
+    struct CardBalance {
+        std::uint64_t key;   // Packed card number (see pack_card_number).
+        std::int32_t balance;
+    };
+
+    // The balance of an account added with BankSystem::add_linked_account().
+    struct LinkedBalance {
+        std::string account_id;
+        std::uint64_t card_key; // The card it belongs to.
+        std::int32_t balance;
+    };
+
+    // Creates an empty snapshot.
+    BalanceSnapshot();
+
+    // Retrieves the snapshot's sequence number within its bank, starting at 1.
+    std::uint64_t epoch() const;
+
+    // Retrieves the instant the snapshot shows, in microseconds since the Unix epoch.
+    std::int64_t taken_at_us() const;
+
+    // Retrieves the number of accounts in the snapshot.
+    std::size_t size() const;
+
+    // Retrieves the card accounts, ascending by key.
+    const std::vector<CardBalance>& card_balances() const;
+
+    // Retrieves the linked accounts, ascending by account ID.
+    const std::vector<LinkedBalance>& linked_balances() const;
+
+    // Retrieves the sum of all balances.
+    std::int64_t total_balance() const;
+
+    // Looks up one account by card number or linked account ID.
+    // Returns TxError::UnknownAccount if the snapshot does not contain it.
+    Result<int> find(const std::string& account_id) const;
+
+    // Writes the snapshot to a file in a compact binary format with a
+    // checksum, replacing an existing file atomically.
+    // Throws an exception if the file cannot be written.
+    void write(const std::string& path) const;
+
+    // Reads a file written by write().
+    // Throws an exception if the file is missing, truncated or corrupt.
+    static BalanceSnapshot read(const std::string& path);
+
+private:
+    std::uint64_t sequence;
+    std::int64_t taken_at;
+    std::vector<CardBalance> cards;
+    std::vector<LinkedBalance> linked;
+
+    friend class BankSystem; // Fills the lists, already sorted.
+};
+
+#endif // BALANCESNAPSHOT_H
@@ -0,0 +1,149 @@
+#ifndef BANKBACKEND_H
+#define BANKBACKEND_H
+
+#include <string>
+#include <functional>
+#include <unordered_map>
+#include <mutex>
+#include <random>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "Result.h"
+
+class BankSystem;
+
+// Operations a bank backend serves. PIN checks count against the bank's
+// failed-PIN limit, if it has limits. Every operation on an account needs
+// the session token of a successful Authenticate for the same card.
+enum class BackendOp : std::uint8_t {
+    Authenticate = 1, // Checks the PIN, fetches the account and opens a session.
+    ValidatePin = 2,  // Checks the PIN only; opens no session.
+    GetAccount = 3,   // Fetches the account of the session's card.
+    Balance = 4,
+    Deposit = 5,
+    Withdraw = 6,
+    EndSession = 7    // Closes the session, e.g. when the card is ejected.
+};
+
+// One backend request. Accounts are addressed by their packed card key,
+// because an account's ID is its card number.
+struct BackendRequest {
+    BackendOp op;
+    std::uint64_t card_key;
+    std::int32_t amount;   // Deposit and Withdraw only.
+    std::string pin;       // Authenticate and ValidatePin only; 4 to 12 digits.
+    std::uint64_t session; // Token from Authenticate; every operation but the PIN checks.
+
+    // Builds the request for each operation.
+    static BackendRequest authenticate(std::uint64_t card_key, const std::string& pin);
+    static BackendRequest validate_pin(std::uint64_t card_key, const std::string& pin);
+    static BackendRequest get_account(std::uint64_t card_key, std::uint64_t session);
+    static BackendRequest balance(std::uint64_t card_key, std::uint64_t session);
+    static BackendRequest deposit(std::uint64_t card_key, std::uint64_t session, std::int32_t amount);
+    static BackendRequest withdraw(std::uint64_t card_key, std::uint64_t session, std::int32_t amount);
+    static BackendRequest end_session(std::uint64_t card_key, std::uint64_t session);
+};
+
+// Outcome of a backend request.
+struct BackendReply {
+    TxError error;             // TxError::None on success.
+    std::uint64_t card_key;    // The account that was used.
+    std::int32_t balance;      // Balance after the operation; 0 for ValidatePin and failures.
+    std::uint64_t session;     // Token of the session a successful Authenticate opened; 0 otherwise.
+
+    BackendReply() : error(TxError::None), card_key(0), balance(0), session(0) {}
+};
+
+// Sessions a backend has opened for authenticated cards. A token is a
+// random 64-bit value bound to one card, so a client can neither guess
+// another's session nor use its own for a different card. A session closes
+// on request or after idle_timeout without use; while max_sessions are
+// open, a new one is refused. All methods are thread-safe.
+class BackendSessions {
+public:
+    static const std::size_t DEFAULT_MAX_SESSIONS = 65536;
+
+    // Constructor that applies the given idle timeout and bound.
+    explicit BackendSessions(std::chrono::milliseconds idle_timeout = std::chrono::minutes(5),
+                             std::size_t max_sessions = DEFAULT_MAX_SESSIONS);
+
+    // Opens a session for the card; returns its token, or 0 if max_sessions
+    // are open and none has expired.
+    std::uint64_t open(std::uint64_t card_key);
+
+    // Returns true if token is an open session of the card, and counts this
+    // as a use. An expired session is closed and fails the check.
+    bool check(std::uint64_t token, std::uint64_t card_key);
+
+    // Closes the card's session; returns false if it was not open.
+    bool close(std::uint64_t token, std::uint64_t card_key);
+
+    // Retrieves the number of sessions held, expired ones not yet swept included.
+    std::size_t size() const;
+
+private:
+    struct Session {
+        std::uint64_t card_key;
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    std::chrono::milliseconds idle_timeout;
+    std::size_t max_sessions;
+    mutable std::mutex mutex; // Guards everything below.
+    std::unordered_map<std::uint64_t, Session> sessions; // By token.
+    std::random_device entropy;
+
+    // Closes every session idle for longer than the timeout. Requires the lock.
+    void sweep(std::chrono::steady_clock::time_point now);
+};
+
+typedef std::function<void(const BackendReply&)> BackendCallback;
+
+// Where ATM transactions are executed: the in-process BankSystem, or a
+// core-banking service behind a connection. Requests are asynchronous so a
+// remote implementation can keep many of them in flight at once.
+class BankBackend {
+public:
+    virtual ~BankBackend() = default;
+
+    // Starts a request; done runs exactly once with the reply, possibly on
+    // another thread and possibly before submit returns. May block while the
+    // backend has too many requests in flight.
+    virtual void submit(const BackendRequest& request, BackendCallback done) = 0;
+
+    // Submits a request and waits for its reply.
+    BackendReply call(const BackendRequest& request);
+};
+
+// Runs a request against a BankSystem on the calling thread, opening and
+// checking sessions in sessions. Returns TxError::SessionExpired for an
+// account operation without an open session of its card,
+// TxError::CardLocked once the card has too many wrong PINs and
+// TxError::TooManySessions if no session can be opened. Failures that are
+// not routine outcomes are reported as TxError::BackendUnavailable.
+BackendReply execute_backend_request(BankSystem& bank, BackendSessions& sessions, const BackendRequest& request);
+
+// BankBackend served by an in-process BankSystem, with its own sessions.
+// PIN checks go through the bank's verifier pool without blocking the
+// caller; everything else completes before submit returns. The bank servers
+// serve their clients through one of these.
+class LocalBankBackend : public BankBackend {
+public:
+    // Constructor that serves requests from the given bank.
+    explicit LocalBankBackend(BankSystem& bank);
+
+    void submit(const BackendRequest& request, BackendCallback done) override;
+
+    // Runs a request on the calling thread, PIN checks included.
+    BackendReply execute(const BackendRequest& request);
+
+    // Retrieves the sessions opened through this backend.
+    BackendSessions& get_sessions() { return sessions; }
+
+private:
+    BankSystem& bank;
+    BackendSessions sessions;
+};
+
+#endif // BANKBACKEND_H
@@ -0,0 +1,111 @@
+#ifndef BANKSERVER_H
+#define BANKSERVER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <queue>
+#include <unordered_map>
+#include <chrono>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "BankBackend.h"
+
+class BankSystem;
+
+// Settings of a BankServer.
+struct BankServerConfig {
+    std::chrono::microseconds latency; // Added to every request, standing in for the network and the core system.
+    std::chrono::microseconds jitter;  // Up to this much more, chosen at random per request.
+    std::size_t workers;               // Threads executing requests once their delay has passed.
+
+    BankServerConfig() : latency(0), jitter(0), workers(2) {}
+};
+
+// Local stand-in for a core-banking backend: serves a BankSystem to
+// RemoteBankBackend clients over a Unix domain socket, so the remote mode
+// can be tested and benchmarked offline. Each request is held for the
+// configured latency without occupying a thread, so pipelined requests
+// overlap their delays as they would against a real service, and replies go
+// out as soon as each is ready rather than in request order. Clients must
+// authenticate a card before using its account, as with LocalBankBackend.
+class BankServer {
+public:
+    // Starts listening at socket_path. Throws an exception if it cannot.
+    BankServer(BankSystem& bank, const std::string& socket_path, const BankServerConfig& config = BankServerConfig());
+
+    BankServer(const BankServer&) = delete;
+    BankServer& operator=(const BankServer&) = delete;
+
+    // Disconnects every client, drops requests not yet executed and removes the socket file.
+    ~BankServer();
+
+    // Retrieves the number of requests answered so far.
+    std::uint64_t requests_served() const { return served.load(std::memory_order_relaxed); }
+
+    // Retrieves the number of clients connected now.
+    std::size_t client_count() const;
+
+private:
+    // One client connection. The socket is closed when the last reference
+    // goes, so a worker replying to a client that just left never writes to
+    // a reused descriptor.
+    struct Connection {
+        int fd;
+        std::mutex write_mutex; // Keeps replies from concurrent workers whole.
+
+        explicit Connection(int fd) : fd(fd) {}
+        ~Connection();
+    };
+
+    // A decoded request waiting for its injected delay to pass.
+    struct Delayed {
+        std::chrono::steady_clock::time_point due;
+        std::uint64_t sequence; // Keeps requests with the same due time in arrival order.
+        std::uint64_t id;
+        BackendRequest request;
+        std::shared_ptr<Connection> connection;
+
+        bool operator>(const Delayed& other) const {
+            return due != other.due ? due > other.due : sequence > other.sequence;
+        }
+    };
+
+    LocalBankBackend backend; // Checks PIN limits and sessions.
+    std::string socket_path;
+    BankServerConfig config;
+    int listen_fd;
+
+    mutable std::mutex mutex; // Guards everything below.
+    std::condition_variable wake;
+    std::priority_queue<Delayed, std::vector<Delayed>, std::greater<Delayed>> delayed;
+    std::uint64_t next_sequence;
+    bool stopping;
+    std::vector<std::shared_ptr<Connection>> clients;
+    std::unordered_map<unsigned, std::thread> readers; // By reader ID.
+    std::vector<unsigned> finished_readers;            // Readers that exited and await a join.
+
+    std::atomic<std::uint64_t> served;
+    std::thread acceptor;
+    std::vector<std::thread> workers;
+
+    // Acceptor thread body: starts a reader per client and joins readers
+    // whose client has left.
+    void accept_clients();
+
+    // Reader thread body: decodes a client's requests and schedules them
+    // until the client leaves, then retires itself.
+    void read_requests(std::shared_ptr<Connection> connection, unsigned reader_id);
+
+    // Drops a departed client and queues its reader to be joined.
+    void retire_reader(const std::shared_ptr<Connection>& connection, unsigned reader_id);
+
+    // Worker thread body: executes requests whose delay has passed and replies.
+    void run_worker();
+};
+
+#endif // BANKSERVER_H
@@ -2,29 +2,348 @@
 #define BANKSYSTEM_H
 
 #include <string>
-#include <unordered_map>
 #include <stdexcept>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 #include "Account.h"
+#include "BalanceSnapshot.h"
 #include "Card.h"
+#include "Journal.h"
+#include "Ledger.h"
+#include "Limits.h"
+#include "TransactionDedup.h"
+#include "FlatAccountTable.h"
+#include "PinVerifier.h"
+#include "Posting.h"
+#include "Result.h"
 
 // The BankSystem class simulates interaction with a bank's backend system.
+// Accounts are keyed by the packed 64-bit card number, which is also the
+// account ID. The table is split into shards selected by the key hash; each
+// shard has its own lock, so sessions on different shards never contend, and
+// balance updates are serialized per account by the Account itself.
+// A card may also hold further accounts with IDs of their own, e.g. savings
+// next to the checking account keyed by the card number; a secondary index
+// per shard maps each card to them and each such ID to its account.
+// PINs are stored only as salted PBKDF2 hashes and checked on a dedicated
+// PinVerifier pool, never while a shard lock is held.
 class BankSystem {
 private:
-    std::unordered_map<std::string, Account> accounts; // Maps account IDs to Account objects.
-    std::unordered_map<std::string, std::string> pins; // Maps account IDs to PIN codes.
+    // An account added to a card with add_linked_account().
+    struct LinkedAccount {
+        Account* account;
+        std::uint64_t card_key; // The card it belongs to.
+    };
+
+    // One slice of the account table together with the lock that guards it.
+    struct Shard {
+        mutable std::mutex mutex;
+        std::atomic<std::uint64_t> acquisitions; // Times the lock was taken.
+        std::atomic<std::uint64_t> contended;    // Times a thread found the lock already held.
+        FlatAccountTable table;      // Maps card keys to PIN credential and account in one probe.
+        std::deque<Account> storage; // Owns the accounts; a deque never moves its elements.
+        std::deque<PinCredential> credentials; // Owns the PIN hashes the table points to.
+        std::unordered_map<std::uint64_t, std::vector<Account*>> linked; // Linked accounts of this shard's cards.
+        std::unordered_map<std::string, LinkedAccount> linked_by_id;     // Linked accounts whose ID hashes here.
+
+        Shard() : acquisitions(0), contended(0) {}
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    // Returns the index of the shard responsible for the given card key.
+    std::size_t shard_index(std::uint64_t card_key) const;
+
+    // Returns the shard responsible for the given card key.
+    Shard& shard_for(std::uint64_t card_key) const;
+
+    // Locks a shard, counting the acquisition and whether it had to wait.
+    static std::unique_lock<std::mutex> lock_shard(Shard& shard);
+
+    // Reads an account's balance under its lock, for a checkpoint.
+    static int committed_balance(const Account& account);
+
+    // Packs an account ID (the card number) into its table key, or throws.
+    static std::uint64_t key_for(const std::string& account_id);
+
+    // Returns the shard that indexes a linked account ID.
+    Shard& shard_for_id(const std::string& account_id) const;
+
+    // Creates a linked account under the card's shard lock and the ID's
+    // shard lock, taken in shard order. Journals it if the bank is durable
+    // and returns the record's LSN (0 if not journaled).
+    // Throws an exception if the card has no account or the ID is taken.
+    std::uint64_t link_account(std::uint64_t card_key, const std::string& account_id, int balance);
+
+    PinHashConfig pin_config;
+    BalanceMode balance_mode; // Given to every account the bank creates.
+    PinCredential unknown_card_credential; // Checked for unknown cards so they take as long as known ones.
+    std::unique_ptr<PinVerifier> verifier;
+
+    // Copies the PIN credential and account for a card under the shard lock.
+    // Unknown cards get unknown_card_credential and a null account.
+    Account* find_credential(const Card& card, PinCredential& credential) const;
+
+    // Returns the account if the card exists and the PIN matches, null otherwise. Does not log.
+    Account* find_authenticated(const Card& card, const std::string& pin) const;
+
+    std::unique_ptr<Journal> journal; // Null unless open_journal() was called.
+    JournalConfig journal_config;
+    std::mutex checkpoint_mutex;      // Serializes checkpoints.
+    std::mutex checkpointer_mutex;
+    std::condition_variable checkpointer_wake;
+    bool checkpointer_stopping;
+    std::thread checkpointer;         // Takes periodic snapshots when configured.
+
+    // Creates or overwrites an account during recovery, without logging or journaling.
+    // credential is an encoded PIN credential; a plain PIN from an older journal is hashed.
+    // For a linked account it is the card number, needed only to create the account.
+    void restore_account(const std::string& account_id, const std::string& credential, int balance);
+
+    // Checkpointer thread body.
+    void run_checkpointer();
+
+    // How post_batch() left one account.
+    enum class PostingOutcome { Unchanged, Posted, Rejected };
+
+    // Applies one account's posting as a single update. snapshot is the
+    // balance delta was computed from; if the balance has moved since, the
+    // change is recomputed from the current balance (recomputed is then set).
+    // Journals the change and returns its LSN in lsn (0 if not journaled).
+    static PostingOutcome post_to_account(Account& account, int snapshot, int delta, std::int64_t adjustment,
+                                          const PostingRules& rules, int& change, bool& recomputed,
+                                          std::uint64_t& lsn);
+
+    std::unique_ptr<Ledger> ledger; // Null unless open_ledger() was called.
+
+    // Throws std::logic_error with the given message if any account exists.
+    void require_no_accounts(const char* message) const;
+
+    // Gives a newly created account its history if the bank keeps a ledger.
+    void attach_ledger(Account& account);
+
+    bool balance_snapshots;                     // Set by enable_balance_snapshots().
+    std::atomic<std::uint64_t> snapshot_epoch;  // Epoch of the latest balance snapshot; 0 before the first.
+    std::mutex snapshot_mutex;                  // Serializes balance snapshots.
+
+    // Lets a newly created account keep balances for snapshots if they are enabled. Requires its shard lock.
+    void attach_snapshot_epoch(Account& account);
+
+    std::unique_ptr<TransactionLimits> limits; // Null unless enable_limits() was called.
+    std::unique_ptr<TransactionDedupCache> dedup_cache; // Null unless enable_deduplication() was called.
 
 public:
+    static const std::size_t DEFAULT_SHARD_COUNT = 16;
+
+    // Lock statistics of one shard, for finding contention hot spots.
+    struct ShardStats {
+        std::size_t accounts;       // Accounts stored in the shard.
+        std::uint64_t acquisitions; // Times the shard lock was taken.
+        std::uint64_t contended;    // Acquisitions that found the lock held by another thread.
+    };
+
+    // One account for add_accounts(); 72 bytes.
+    struct NewAccount {
+        std::uint64_t key;        // Packed card number (see pack_card_number).
+        std::uint64_t packed_pin; // PIN to hash (see pack_pin) when credential.iterations is 0.
+        PinCredential credential; // Precomputed PIN hash, e.g. from a core-banking export.
+        int balance;
+    };
+
+    // Outcome of add_accounts().
+    struct BulkLoadResult {
+        std::size_t added;
+        std::size_t duplicates;            // Keys that already existed or came earlier in the same load.
+        std::size_t invalid;               // Malformed keys or PINs, keys failing Luhn, or negative balances.
+        std::vector<std::size_t> rejected; // Indices of duplicate and invalid records, ascending.
+    };
+
+    // An account-specific change for post_batch(), e.g. a refund or a correction.
+    struct PostingAdjustment {
+        std::string account_id; // A card number or a linked account ID.
+        int amount;             // Added to the balance; negative amounts debit.
+    };
+
+    // Outcome of post_batch().
+    struct PostingResult {
+        std::size_t accounts;   // Accounts visited.
+        std::size_t posted;     // Accounts whose balance changed.
+        std::size_t rejected;   // Accounts left unchanged because the change would overdraw or overflow them.
+        std::size_t recomputed; // Accounts updated by live traffic during the batch, whose change was recomputed.
+        std::int64_t credited;  // Sum of the positive changes.
+        std::int64_t debited;   // Sum of the negative changes, as a positive amount.
+    };
+
+    // Constructor that creates an empty bank split into the given number of shards.
+    // A shard count of 1 behaves like a single global lock. pin_config sets
+    // the PIN hashing cost and the size of the verification pool.
+    // balance_mode selects how accounts serialize balance updates; LockFree
+    // suits hot accounts hit by many sessions at once.
+    explicit BankSystem(std::size_t shard_count = DEFAULT_SHARD_COUNT,
+                        const PinHashConfig& pin_config = PinHashConfig(),
+                        BalanceMode balance_mode = BalanceMode::Locked);
+
+    BankSystem(const BankSystem&) = delete;
+    BankSystem& operator=(const BankSystem&) = delete;
+
+    // Stops periodic snapshots and commits any journal records still buffered.
+    ~BankSystem();
+
+    // Retrieves the number of shards the account table is split into.
+    std::size_t shard_count() const;
+
+    // Retrieves how the bank's accounts serialize balance updates.
+    BalanceMode get_balance_mode() const;
+
+    // Retrieves the lock statistics of every shard, indexed by shard.
+    std::vector<ShardStats> shard_stats() const;
+
     // Adds a new account to the bank system.
-    // Throws an exception if the account ID already exists.
+    // The account ID is the 16-digit card number and the PIN must be 4 to 12 digits.
+    // Throws an exception if the account ID already exists or either value is malformed.
     void add_account(const std::string& account_id, const std::string& pin, int initial_balance = 0);
 
+    // Adds many accounts at once, for provisioning from a nightly file.
+    // PINs are checked and hashed on up to threads threads (0: one per core),
+    // records are grouped by shard, and each shard is then filled by one
+    // thread in a single pass: its table is grown once, duplicates are
+    // detected against it, and every account is inserted under one lock
+    // acquisition. The first record for a key wins; duplicate and invalid
+    // records are skipped and reported rather than thrown. Journaled banks
+    // record every opening and return once all are durable. Logs one summary
+    // line instead of one per account.
+    BulkLoadResult add_accounts(const std::vector<NewAccount>& accounts, std::size_t threads = 0);
+
+    // Adds a further account to an existing card, e.g. savings next to checking.
+    // The account ID must be unique, at most 255 characters and not a card
+    // number, which would collide with the IDs of card accounts.
+    // Throws an exception if the card has no account, the ID is malformed or
+    // taken, or the balance is negative.
+    void add_linked_account(const std::string& card_number, const std::string& account_id, int initial_balance = 0);
+
+    // Applies interest, fees and adjustments to every account, e.g. overnight.
+    // Shards are split across up to threads threads (0: one per core). Each
+    // thread copies a shard's account list under the shard lock, gathers the
+    // balances into a contiguous array, computes every change with the
+    // vectorized compute_postings() kernel and then applies each account's
+    // change as one update, so live ATM traffic keeps running and sees an
+    // account either before or after the whole of its posting. An account
+    // whose balance moved since it was gathered has its change recomputed
+    // from the current balance. A change that would overdraw an account or
+    // overflow its balance is not applied. Goes around try_deposit() and
+    // try_withdraw(), so subclass overrides do not apply; ledgers record one
+    // LedgerEntryType::Posting per changed account. Journaled banks return
+    // once every change is durable. Logs one summary line.
+    // Throws an exception, before changing anything, if the rules are out of
+    // range or an adjustment names an unknown account.
+    PostingResult post_batch(const PostingRules& rules,
+                             const std::vector<PostingAdjustment>& adjustments = std::vector<PostingAdjustment>(),
+                             std::size_t threads = 0);
+
+    // Starts keeping what snapshot_balances() needs: each account remembers
+    // its balance from before the first update after a snapshot began.
+    // Every update then takes the account's lock, including in LockFree mode.
+    // Must be called before any account is added, including before open_journal().
+    // Throws an exception if snapshots are already enabled.
+    void enable_balance_snapshots();
+
+    // Captures every balance as of one instant without stopping transactions.
+    // Advancing the snapshot epoch is the instant: an update that reads the
+    // new epoch saves the account's old balance before changing it, and the
+    // snapshot then reads each account under its lock, taking the saved
+    // balance if the account has been updated since. Writers are never
+    // paused; an update waits at most for one account read. Accounts added
+    // after the instant are left out. Shards are read on up to threads
+    // threads (0: one per core). Snapshots run one at a time. Logs one
+    // summary line.
+    // Throws an exception if enable_balance_snapshots() was not called.
+    BalanceSnapshot snapshot_balances(std::size_t threads = 0);
+
     // Validates the PIN for a given card.
     // Returns true if the PIN is correct, false otherwise.
     bool validate_pin(const Card& card, const std::string& pin) const;
 
+    // Like validate_pin(), but returns TxError::WrongPin instead of false.
+    // An unknown card is reported the same way as a wrong PIN.
+    Result<void> try_validate_pin(const Card& card, const std::string& pin) const;
+
+    // Validates the PIN and resolves the account with a single table lookup.
+    // Returns the account on success, or null if the card is unknown or the PIN is wrong.
+    Account* authenticate(const Card& card, const std::string& pin);
+
+    // Starts authenticate() without waiting: done(account) runs on a verifier
+    // thread with the account, or null if the card is unknown or the PIN is wrong.
+    // A PIN that is not 4 to 12 digits is rejected at once on the calling thread.
+    void authenticate_async(const Card& card, const std::string& pin, std::function<void(Account*)> done);
+
     // Retrieves the Account object associated with a given card.
+    // Accounts are never removed, so the reference stays valid for the bank's lifetime.
     // Throws an exception if the account does not exist.
     Account& get_account(const Card& card);
+
+    // Non-throwing form of get_account(): returns TxError::UnknownAccount if the card has no account.
+    Result<Account*> try_get_account(const Card& card);
+
+    // Retrieves every account of a card: the one keyed by the card number
+    // first, then its linked accounts in the order they were added.
+    // Returns an empty list if the card has no account.
+    std::vector<Account*> get_accounts(const Card& card) const;
+
+    // Makes the bank durable: loads the latest snapshot in config.directory,
+    // replays the journal tail after it, and journals every later mutation.
+    // Must be called before any account is added.
+    // Returns the LSN of the last recovered record (0 for a fresh directory).
+    std::uint64_t open_journal(const JournalConfig& config);
+
+    // Writes a snapshot of all accounts and deletes journal segments and
+    // snapshots it makes obsolete. Writers keep running during the snapshot.
+    // Throws an exception if no journal is open.
+    void checkpoint();
+
+    // Retrieves the journal, or null if the bank is not durable.
+    Journal* get_journal() const;
+
+    // Starts recording every deposit and withdrawal, with its time, ATM ID
+    // and resulting balance, in a per-account history (see Account::get_ledger()).
+    // reserve_entries sizes the chunk pool up front so appends do not allocate.
+    // Must be called before any account is added, including before open_journal();
+    // the history is kept in memory only and starts empty.
+    Ledger& open_ledger(std::size_t reserve_entries = 0);
+
+    // Retrieves the ledger, or null if the bank keeps none.
+    Ledger* get_ledger() const;
+
+    // Starts enforcing velocity limits at every ATM of the bank: failed-PIN
+    // lockout per card, a rolling withdrawal limit per account and a
+    // transaction rate per ATM; backends apply the failed-PIN lockout. Must be
+    // called before any ATM session starts or any backend serves the bank.
+    // Throws an exception if limits are already enabled or the config is invalid.
+    TransactionLimits& enable_limits(const LimitsConfig& config = LimitsConfig());
+
+    // Retrieves the limits, or null if none are enforced.
+    TransactionLimits* get_limits() const;
+
+    // Starts remembering client transaction IDs, so that a deposit or
+    // withdrawal retried with the same ID returns the first result instead of
+    // running again (see ATMController::try_withdraw(int, std::uint64_t)).
+    // Must be called before any ATM session starts.
+    // Throws an exception if deduplication is already enabled or the config is invalid.
+    TransactionDedupCache& enable_deduplication(const DedupConfig& config = DedupConfig());
+
+    // Retrieves the deduplication cache, or null if transaction IDs are not tracked.
+    TransactionDedupCache* get_dedup_cache() const;
+
+    // Retrieves the PIN verification pool, e.g. for its throughput and queue-wait statistics.
+    PinVerifier& get_pin_verifier() const;
 };
 
 #endif // BANKSYSTEM_H
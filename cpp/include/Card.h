@@ -2,23 +2,40 @@
 #define CARD_H
 
 #include <string>
+#include <cstdint>
+
+// Packs a 16-digit card number into its numeric value.
+// Returns false if the string is not exactly 16 decimal digits.
+bool pack_card_number(const std::string& card_number, std::uint64_t& key);
+
+// Formats a packed card key back into its 16-digit string (with leading zeros).
+std::string unpack_card_number(std::uint64_t key);
 
 // The Card class represents a user's ATM card.
 class Card {
 private:
-    std::string card_number; // Unique identifier for the card.
+    std::uint64_t card_key; // Card number packed into 64 bits; unique identifier for the card.
+
+    Card() : card_key(0) {}
 
     // Validates the card number using the Luhn algorithm.
     bool is_valid_card_number(const std::string& card_number) const;
 
 public:
     // Constructor that initializes the card with a given card number.
-    // Throws an exception if the card number is invalid.
+    // Throws an exception if the card number is not 16 digits or fails the Luhn checksum.
     explicit Card(const std::string& card_number);
 
+    // Rebuilds a card from its packed key, e.g. one kept by a suspended
+    // session. The key is not checked.
+    static Card from_key(std::uint64_t key);
+
     // Retrieves the card number.
     std::string get_card_number() const;
 
+    // Retrieves the packed card number used as the bank's lookup key.
+    std::uint64_t get_key() const { return card_key; }
+
     // Retrieves the masked version of the card number (e.g., "****-****-****-1234").
     std::string get_masked_card_number() const;
 };
@@ -0,0 +1,47 @@
+#ifndef CARDVALIDATION_H
+#define CARDVALIDATION_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Implementation used by validate_card_numbers.
+enum class LuhnKernel {
+    Auto,   // Fastest kernel the CPU supports.
+    Scalar, // One digit at a time; available everywhere.
+    SSE2,   // One card per 128-bit vector (x86-64 baseline).
+    AVX2    // Two cards per 256-bit vector.
+};
+
+// Returns the kernel that LuhnKernel::Auto resolves to on this CPU.
+LuhnKernel best_luhn_kernel();
+
+// Returns a printable name for a kernel (e.g. "avx2").
+const char* luhn_kernel_name(LuhnKernel kernel);
+
+// Returns true if the kernel can run on this CPU.
+bool luhn_kernel_supported(LuhnKernel kernel);
+
+// Checks that 16 characters are all digits and pass the Luhn checksum.
+bool is_valid_pan16(const char* digits);
+
+// Validates count card numbers of exactly 16 characters each, stored at
+// numbers, numbers + stride, numbers + 2 * stride, ... (stride >= 16).
+// Bit i of the bitmap (bitmap[i / 64] >> (i % 64)) is set if card i is 16
+// digits and passes the Luhn checksum. The bitmap must hold (count + 63) / 64
+// words. Throws an exception if the requested kernel is not supported.
+void validate_card_numbers(const char* numbers, std::size_t count, std::size_t stride,
+                           std::uint64_t* bitmap, LuhnKernel kernel = LuhnKernel::Auto);
+
+// Validates card numbers of any length; anything not exactly 16 digits is invalid.
+// Returns the validity bitmap described above.
+std::vector<std::uint64_t> validate_card_numbers(const std::vector<std::string>& numbers,
+                                                 LuhnKernel kernel = LuhnKernel::Auto);
+
+// Returns whether bit i is set in a validity bitmap.
+inline bool card_bit(const std::vector<std::uint64_t>& bitmap, std::size_t i) {
+    return (bitmap[i / 64] >> (i % 64)) & 1;
+}
+
+#endif // CARDVALIDATION_H
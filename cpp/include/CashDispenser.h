@@ -0,0 +1,113 @@
+#ifndef CASHDISPENSER_H
+#define CASHDISPENSER_H
+
+#include <vector>
+#include <mutex>
+#include <cstddef>
+#include <cstdint>
+#include "Result.h"
+
+// Most cassettes an ATM can hold.
+const std::size_t MAX_CASSETTES = 8;
+
+// One cassette of notes of a single denomination.
+struct Cassette {
+    int denomination; // Value of one note.
+    int count;        // Notes loaded.
+    int cost;         // Preference weight of each note; the solver minimizes the total. Raise it to spare a cassette.
+
+    Cassette(int denomination, int count, int cost = 1) : denomination(denomination), count(count), cost(cost) {}
+};
+
+// Notes to take from each cassette for one withdrawal.
+struct DispensePlan {
+    std::uint8_t notes[MAX_CASSETTES]; // Indexed like the dispenser's cassettes.
+    int total_notes;
+};
+
+// Counters of a CashDispenser.
+struct DispenserStats {
+    std::uint64_t reservations;  // Successful reservations.
+    std::uint64_t rejections;    // Amounts that could not be dispensed.
+    std::uint64_t table_builds;  // Times a solution table was computed.
+    std::uint64_t cache_hits;    // Inventory changes served by a table computed earlier.
+    std::uint64_t direct_solves; // Lookups solved for that amount alone, in a state without a table.
+};
+
+// Cash inventory of one ATM and the solver that chooses the notes for a
+// withdrawal. For every amount up to max_notes times the largest note it
+// keeps a precomputed plan with the lowest total cost (then the fewest
+// notes, then the largest notes), so a withdrawal is a table lookup.
+//
+// A table depends on the inventory only through each cassette's count
+// capped at max_notes, so it stays valid while cassettes are well stocked.
+// Once a cassette runs low, most withdrawals lead to a new state, so a new
+// state is first solved for each requested amount alone; it gets a table
+// once those solves add up to the work of building one, which bounds the
+// cost at twice that of never building tables. The most recent tables are
+// kept, so states that come back (for example after a refill or a released
+// reservation) are not solved again. All methods are thread-safe.
+class CashDispenser {
+public:
+    static const int DEFAULT_MAX_NOTES = 40;
+
+    // Constructor that loads the given cassettes. At most max_notes notes
+    // (up to 255) are dispensed per withdrawal.
+    // Throws an exception if there are no cassettes or more than MAX_CASSETTES,
+    // or a denomination, count, cost or max_notes is out of range.
+    explicit CashDispenser(const std::vector<Cassette>& cassettes, int max_notes = DEFAULT_MAX_NOTES);
+
+    // Chooses notes for the amount and removes them from the inventory until
+    // they are released. Returns TxError::InvalidAmount or TxError::CannotDispense on failure.
+    Result<DispensePlan> try_reserve(int amount);
+
+    // Returns reserved notes to the inventory, e.g. when the account debit fails.
+    void release(const DispensePlan& plan);
+
+    // Adds notes to a cassette. Throws an exception for an unknown cassette or a negative count.
+    void refill(std::size_t cassette, int count);
+
+    // Retrieves the cassettes with their current counts.
+    std::vector<Cassette> inventory() const;
+
+    // Retrieves the total value of the notes available.
+    long long cash_available() const;
+
+    // Retrieves the counters.
+    DispenserStats stats() const;
+
+    // Solves one amount from scratch against the given cassettes, with the
+    // same preferences as the table. Used to check and benchmark the table.
+    static Result<DispensePlan> solve(const std::vector<Cassette>& cassettes, int amount,
+                                      int max_notes = DEFAULT_MAX_NOTES);
+
+private:
+    // Best plan for every amount, in units, under one set of capped counts.
+    struct Table {
+        std::uint8_t caps[MAX_CASSETTES]; // Counts capped at max_notes the table was built for.
+        std::vector<DispensePlan> plans;  // Indexed by amount / unit; total_notes < 0 if impossible.
+    };
+
+    static const std::size_t CACHED_TABLES = 8;
+
+    mutable std::mutex mutex; // Guards everything below.
+    std::vector<Cassette> cassettes;
+    int max_notes;
+    int unit;                 // Greatest common divisor of the denominations.
+    int max_units;            // Largest amount in units that max_notes notes can make up.
+    std::vector<Table> tables; // Most recently used first.
+    std::uint8_t untabled_caps[MAX_CASSETTES]; // Last state solved without a table.
+    int untabled_work;        // Amounts, in units, solved directly in that state.
+    DispenserStats counters;
+
+    // Returns the best plan for an amount in units under the current inventory,
+    // from a cached table, a new table, or a solve for that amount alone.
+    DispensePlan plan_for(int units);
+
+    // Builds the table up to max_units for the given capped counts. Plans
+    // with more than max_notes notes are marked impossible.
+    static Table build_table(const std::vector<Cassette>& cassettes, const std::uint8_t* caps, int unit,
+                             int max_units, int max_notes);
+};
+
+#endif // CASHDISPENSER_H
@@ -0,0 +1,161 @@
+#ifndef COMPACTACCOUNTSTORE_H
+#define COMPACTACCOUNTSTORE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include "Account.h"
+
+// Stable integer identifier of an account in a CompactAccountStore.
+typedef std::uint32_t AccountHandle;
+
+const AccountHandle INVALID_ACCOUNT_HANDLE = 0xFFFFFFFFu;
+
+// Per-account flag bits.
+enum AccountFlag : std::uint8_t {
+    ACCOUNT_FROZEN = 1, // Deposits and withdrawals are refused.
+    ACCOUNT_CUSTOM = 2  // Backed by an Account object whose virtual methods handle every operation.
+};
+
+// Compact, optional alternative to keeping one Account object per account.
+// Card keys, balances and flags live in parallel arrays inside fixed-size
+// chunks taken from a pool, so an account costs about 20 bytes instead of a
+// heap object with a string, a lock and a vtable, and a scan over balances
+// reads contiguous memory. Chunks never move, so handles and the values
+// behind them stay valid for the store's lifetime.
+//
+// Plain accounts take a non-virtual fast path; accounts registered with
+// add_custom() keep their own Account subclass and go through its virtual
+// methods. Balance updates are serialized by striped locks (one per group of
+// handles); balance reads and lookups never block.
+class CompactAccountStore {
+public:
+    static const std::size_t CHUNK_BITS = 14;
+    static const std::size_t CHUNK_SIZE = std::size_t(1) << CHUNK_BITS; // Accounts per pooled chunk.
+    static const std::size_t MAX_CHUNKS = 4096;                          // Up to 67 million accounts.
+
+    // Constructor that creates an empty store sized for the expected number of accounts.
+    explicit CompactAccountStore(std::size_t expected_accounts = 0);
+
+    CompactAccountStore(const CompactAccountStore&) = delete;
+    CompactAccountStore& operator=(const CompactAccountStore&) = delete;
+
+    ~CompactAccountStore();
+
+    // Adds a plain account. The account ID is the 16-digit card number.
+    // Throws an exception if the ID is malformed or already present, or the balance is negative.
+    AccountHandle add(const std::string& account_id, int initial_balance = 0);
+
+    // Adds an account whose behavior is defined by an Account subclass.
+    // The store keeps a reference; the account must outlive the store.
+    AccountHandle add_custom(Account& account);
+
+    // Finds an account by card number or packed card key.
+    // Returns INVALID_ACCOUNT_HANDLE if it is not present.
+    AccountHandle find(const std::string& account_id) const;
+    AccountHandle find(std::uint64_t card_key) const;
+
+    // Deposits into an account and returns the new balance.
+    // Throws an exception if the amount is not positive, or the handle is unknown or frozen.
+    int deposit(AccountHandle handle, int amount);
+
+    // Withdraws from an account and returns the new balance.
+    // Throws an exception if the amount is not positive or exceeds the balance,
+    // or the handle is unknown or frozen.
+    int withdraw(AccountHandle handle, int amount);
+
+    // Retrieves the balance of an account without blocking.
+    int get_balance(AccountHandle handle) const;
+
+    // Retrieves the account ID (card number) of an account.
+    std::string get_account_id(AccountHandle handle) const;
+
+    // Retrieves the packed card key of an account.
+    std::uint64_t get_key(AccountHandle handle) const;
+
+    // Freezes or unfreezes an account. Updates already holding the account's stripe lock finish first.
+    void set_frozen(AccountHandle handle, bool frozen);
+
+    // Retrieves the flag bits (AccountFlag) of an account.
+    std::uint8_t get_flags(AccountHandle handle) const;
+
+    // Retrieves the number of accounts.
+    std::size_t size() const { return count.load(std::memory_order_acquire); }
+
+    // Sums every balance; reads each chunk's balance array front to back.
+    std::int64_t total_balance() const;
+
+    // Calls visit(handle, card_key, balance) for every account in handle order.
+    template <typename Visitor>
+    void for_each(Visitor visit) const {
+        std::size_t total = size();
+        for (std::size_t first = 0; first < total; first += CHUNK_SIZE) {
+            const Chunk& chunk = *chunks[first >> CHUNK_BITS].load(std::memory_order_acquire);
+            std::size_t end = total - first < CHUNK_SIZE ? total - first : CHUNK_SIZE;
+            for (std::size_t i = 0; i < end; ++i) {
+                AccountHandle handle = static_cast<AccountHandle>(first + i);
+                int balance = chunk.flags[i].load(std::memory_order_relaxed) & ACCOUNT_CUSTOM
+                                  ? custom_account(handle).get_balance()
+                                  : chunk.balances[i].load(std::memory_order_relaxed);
+                visit(handle, chunk.keys[i], balance);
+            }
+        }
+    }
+
+    // Retrieves the bytes held by chunks and the index.
+    std::size_t memory_usage() const;
+
+private:
+    // One pooled block of accounts, stored as parallel arrays.
+    struct Chunk {
+        std::uint64_t keys[CHUNK_SIZE];
+        std::atomic<std::int32_t> balances[CHUNK_SIZE];
+        std::atomic<std::uint8_t> flags[CHUNK_SIZE];
+    };
+
+    // Open-addressing index from card key to handle + 1 (0 marks an empty slot).
+    struct Index {
+        std::size_t mask;
+        std::unique_ptr<std::atomic<std::uint32_t>[]> slots;
+    };
+
+    // A lock padded to its own cache line.
+    struct Stripe {
+        std::mutex mutex;
+        char padding[64 > sizeof(std::mutex) ? 64 - sizeof(std::mutex) : 1];
+    };
+
+    static const std::size_t LOCK_STRIPES = 256;
+
+    std::unique_ptr<std::atomic<Chunk*>[]> chunks; // MAX_CHUNKS entries; filled as the store grows.
+    std::atomic<std::size_t> count;
+    std::atomic<Index*> index;
+    std::vector<std::unique_ptr<Index>> index_generations; // Older indexes stay readable until destruction.
+    mutable std::mutex add_mutex;                           // Serializes add() and index growth.
+    mutable Stripe stripes[LOCK_STRIPES];
+
+    mutable std::mutex custom_mutex;
+    std::unordered_map<AccountHandle, Account*> custom; // Accounts flagged ACCOUNT_CUSTOM.
+
+    // Appends an account under add_mutex and publishes it in the index.
+    AccountHandle append(std::uint64_t key, int balance, std::uint8_t flags, Account* account);
+
+    // Inserts a handle into the current index, growing it first if needed. Requires add_mutex.
+    void index_insert(std::uint64_t key, AccountHandle handle);
+
+    // Returns the chunk and slot of a handle, or throws if the handle is unknown.
+    Chunk& locate(AccountHandle handle, std::size_t& slot) const;
+
+    // Returns the Account object behind a custom handle.
+    Account& custom_account(AccountHandle handle) const;
+
+    // Deposits or withdraws through a custom account's virtual methods unless it is frozen.
+    int custom_update(AccountHandle handle, int amount, bool withdrawal);
+};
+
+#endif // COMPACTACCOUNTSTORE_H
@@ -0,0 +1,80 @@
+#ifndef FLATACCOUNTTABLE_H
+#define FLATACCOUNTTABLE_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+class Account;
+struct PinCredential;
+
+// Packs a PIN of 4 to 12 decimal digits (ISO 9564) into 64 bits: the digit
+// count in the top byte and the numeric value below it, so "0012" and "12"
+// stay distinct. Returns false for any other string.
+bool pack_pin(const std::string& pin, std::uint64_t& packed);
+
+// Formats a packed PIN back into its digit string.
+std::string unpack_pin(std::uint64_t packed);
+
+// One slot of the account table: everything a login needs in 24 bytes.
+struct AccountEntry {
+    std::uint64_t key;          // Packed card number.
+    PinCredential* credential;  // Salted PIN hash, owned by the caller.
+    Account* account;           // Null marks an empty slot.
+};
+
+// Open-addressing hash table from packed card keys to PIN credential and account.
+// Slots live in one contiguous array and are probed linearly, so a lookup
+// usually touches a single cache line. Entries are never removed.
+// The table is not synchronized; BankSystem guards each one with its shard lock.
+class FlatAccountTable {
+public:
+    // Constructor that creates an empty table with room for the given number of entries.
+    explicit FlatAccountTable(std::size_t expected_entries = 0);
+
+    // Finds the entry for a key. Returns null if the key is absent.
+    AccountEntry* find(std::uint64_t key);
+    const AccountEntry* find(std::uint64_t key) const;
+
+    // Inserts a new entry. Returns false (and changes nothing) if the key already exists.
+    bool insert(std::uint64_t key, PinCredential* credential, Account* account);
+
+    // Grows the table so that the given number of entries fit without rehashing.
+    void reserve(std::size_t expected_entries);
+
+    // Retrieves the number of entries.
+    std::size_t size() const { return count; }
+
+    // Retrieves the number of slots.
+    std::size_t capacity() const { return slots.size(); }
+
+    // Calls visit for every entry, in slot order.
+    template <typename Visitor>
+    void for_each(Visitor visit) const {
+        for (const AccountEntry& slot : slots) {
+            if (slot.account != nullptr) {
+                visit(slot);
+            }
+        }
+    }
+
+    // Scrambles a card key so that sequential card numbers spread over the table.
+    static std::uint64_t hash(std::uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return key;
+    }
+
+private:
+    std::vector<AccountEntry> slots; // Size is zero or a power of two.
+    std::size_t count;
+
+    // Rebuilds the table with the given number of slots.
+    void rehash(std::size_t slot_count);
+};
+
+#endif // FLATACCOUNTTABLE_H
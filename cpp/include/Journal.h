@@ -0,0 +1,215 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+// Settings for the write-ahead journal kept by BankSystem.
+struct JournalConfig {
+    std::string directory;                       // Holds journal segments and snapshots.
+    std::chrono::microseconds commit_window;     // Longest a mutation waits for its group fsync.
+    std::size_t max_batch_bytes;                 // A batch this large is committed immediately.
+    std::chrono::milliseconds snapshot_interval; // Period between automatic snapshots (0 disables them).
+    bool sync;                                   // Calls fdatasync per batch; disable only for tests.
+
+    explicit JournalConfig(const std::string& directory = "")
+        : directory(directory), commit_window(1000), max_batch_bytes(1 << 20),
+          snapshot_interval(0), sync(true) {}
+};
+
+// Kind of mutation recorded in the journal.
+enum class JournalRecordType : std::uint8_t {
+    AccountOpened = 1,
+    Deposit = 2,
+    Withdrawal = 3,
+    AccountLinked = 4, // An account added to a card; pin holds the card number.
+    TransferOut = 5,   // Always directly followed by its TransferIn.
+    TransferIn = 6,
+    Posting = 7        // A batch posting; amount is the net change and may be negative.
+};
+
+// One decoded journal record.
+// Records carry the resulting balance, so replaying one twice is harmless.
+struct JournalEntry {
+    std::uint64_t lsn;              // Log sequence number, strictly increasing.
+    JournalRecordType type;
+    std::string account_id;
+    std::string pin;                // Encoded PIN credential for AccountOpened, card number for AccountLinked.
+    std::int32_t amount;
+    std::int32_t balance;           // Balance after the mutation.
+};
+
+// Counters describing how well mutations are being grouped.
+struct JournalStats {
+    std::uint64_t records;
+    std::uint64_t batches;
+    std::uint64_t bytes;
+};
+
+// Append-only binary journal of account mutations with group commit.
+// Writers serialize a record into an in-memory batch and receive its LSN;
+// a flusher thread writes and fsyncs whole batches, so many mutations share
+// one fsync. wait_durable() blocks until a given LSN is on disk, which takes
+// at most about one commit window.
+// The journal is split into segment files named by their first LSN so that
+// segments covered by a snapshot can be deleted.
+class Journal {
+public:
+    // Opens (or creates) the journal in config.directory and starts a new segment
+    // whose first LSN follows last_lsn.
+    Journal(const JournalConfig& config, std::uint64_t last_lsn);
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Commits everything still buffered and stops the flusher thread.
+    ~Journal();
+
+    // Buffers one record and returns its LSN. Does not wait for disk.
+    // Throws std::runtime_error, buffering nothing, once the journal has
+    // failed to write; callers append before changing anything.
+    std::uint64_t append(JournalRecordType type, const std::string& account_id,
+                         std::int32_t amount, std::int32_t balance, const std::string& pin = "");
+
+    // Non-throwing form of append(): returns 0 once the journal has failed.
+    std::uint64_t try_append(JournalRecordType type, const std::string& account_id,
+                             std::int32_t amount, std::int32_t balance, const std::string& pin = "");
+
+    // Buffers the two records of a transfer, TransferOut for from_id and
+    // TransferIn for to_id, with consecutive LSNs in the same batch. Returns
+    // the LSN of the TransferIn. Recovery applies the pair together or, if
+    // the TransferIn was torn off, not at all. Returns 0, buffering
+    // nothing, once the journal has failed to write.
+    std::uint64_t try_append_transfer(const std::string& from_id, const std::string& to_id, std::int32_t amount,
+                                      std::int32_t from_balance, std::int32_t to_balance);
+
+    // Blocks until the record with the given LSN has been fsynced.
+    // Throws an exception if the journal can no longer write to disk.
+    void wait_durable(std::uint64_t lsn);
+
+    // Non-throwing form of wait_durable(): returns false if the record will
+    // never reach disk.
+    bool try_wait_durable(std::uint64_t lsn);
+
+    // Retrieves the LSN of the last appended record.
+    std::uint64_t last_lsn() const;
+
+    // Retrieves the LSN of the last record known to be on disk.
+    std::uint64_t durable_lsn() const;
+
+    // Commits the current batch and starts a new segment file.
+    // Returns the first LSN of the new segment.
+    std::uint64_t rotate();
+
+    // Deletes segments whose records all have an LSN of at most the given one.
+    void prune_through(std::uint64_t lsn);
+
+    // Retrieves grouping counters.
+    JournalStats stats() const;
+
+    // Calls visit for every intact record with an LSN greater than after_lsn,
+    // in LSN order. The rest of a segment after a torn or corrupt record is skipped.
+    // Returns the LSN of the last record read (or after_lsn if none).
+    static std::uint64_t replay(const std::string& directory, std::uint64_t after_lsn,
+                                const std::function<void(const JournalEntry&)>& visit);
+
+    // Decodes one record from a buffer. Returns the encoded size, or 0 if the
+    // buffer does not start with an intact record.
+    static std::size_t decode(const char* data, std::size_t size, JournalEntry& entry);
+
+private:
+    JournalConfig config;
+    int fd;                                   // Current segment file.
+    std::vector<std::uint64_t> segments;      // First LSN of every segment, ascending.
+
+    mutable std::mutex mutex;
+    std::condition_variable pending;          // Signals the flusher that a batch has data.
+    std::condition_variable committed;        // Signals waiters that durable_lsn advanced.
+    std::condition_variable rotated;          // Signals rotate() that the new segment is open.
+    std::vector<char> batch;                  // Records not yet written.
+    std::chrono::steady_clock::time_point batch_started;
+    std::uint64_t next_lsn;
+    std::uint64_t flushed_lsn;
+    std::uint64_t rotated_lsn;                // First LSN of the segment opened by the last rotation.
+    bool rotate_requested;
+    JournalStats counters;
+    bool failed;                              // Set when a write or fsync fails; waiters then throw.
+    bool stopping;
+    std::thread flusher;
+
+    // Flusher thread body.
+    void run();
+
+    // Writes and syncs one batch; called by the flusher without the mutex held.
+    // Returns false if the data could not be made durable.
+    bool write_batch(const std::vector<char>& data);
+
+    // Opens a new segment starting at the given LSN.
+    void open_segment(std::uint64_t first_lsn);
+
+    // Serializes one record into the batch and returns its LSN. Requires the mutex.
+    std::uint64_t put_record(JournalRecordType type, const std::string& account_id,
+                             std::int32_t amount, std::int32_t balance, const std::string& pin);
+
+    // Wakes the flusher if the batch just became non-empty or full. Releases the lock.
+    void notify_flusher(std::unique_lock<std::mutex>& lock, bool was_empty);
+};
+
+// Writes a snapshot of every account to a temporary file and atomically
+// renames it into place once it is complete and synced.
+class SnapshotWriter {
+public:
+    // Starts a snapshot that covers every journal record up to lsn.
+    SnapshotWriter(const std::string& directory, std::uint64_t lsn);
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    // Removes the temporary file if commit() was never called.
+    ~SnapshotWriter();
+
+    // Adds one account to the snapshot; pin is stored as given (BankSystem passes the encoded credential).
+    void add(const std::string& account_id, const std::string& pin, std::int32_t balance);
+
+    // Syncs the file and publishes it as the latest snapshot.
+    void commit();
+
+private:
+    std::string directory;
+    std::string temp_path;
+    std::string final_path;
+    std::vector<char> buffer;
+    std::uint64_t count;
+    int fd;
+
+    // Writes the buffered bytes to the temporary file.
+    void write_buffer();
+};
+
+// Loads the newest intact snapshot in a directory, calling visit for each account.
+// Returns the LSN the snapshot covers, or 0 if there is no snapshot.
+std::uint64_t load_latest_snapshot(
+    const std::string& directory,
+    const std::function<void(const std::string& account_id, const std::string& pin, std::int32_t balance)>& visit);
+
+// Deletes every snapshot older than the one covering the given LSN.
+void prune_snapshots(const std::string& directory, std::uint64_t keep_lsn);
+
+// Lists the first LSN of every journal segment in a directory, ascending.
+std::vector<std::uint64_t> list_journal_segments(const std::string& directory);
+
+// Returns the path of the journal segment that starts at the given LSN.
+std::string journal_segment_path(const std::string& directory, std::uint64_t first_lsn);
+
+// Computes the CRC-32 (IEEE 802.3) that journal records and snapshots carry,
+// for other files that want the same corruption check.
+std::uint32_t journal_crc32(const char* data, std::size_t size);
+
+#endif // JOURNAL_H
@@ -0,0 +1,110 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Log-linear latency histogram in nanoseconds.
+// Values are grouped by power of two and each group is split into
+// SUB_BUCKETS linear buckets, so every bucket is within about 6% of the
+// values it holds. Recording is a few instructions and never allocates.
+// A histogram has a single writer; merge per-thread histograms to combine them.
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const std::size_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const std::size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    // Constructor that creates an empty histogram.
+    LatencyHistogram();
+
+    // Records one value.
+    void record(std::uint64_t value_ns) {
+        ++buckets[bucket_for(value_ns)];
+        ++total;
+        sum += value_ns;
+        if (value_ns > max_value) {
+            max_value = value_ns;
+        }
+    }
+
+    // Adds every value recorded in another histogram.
+    void merge(const LatencyHistogram& other);
+
+    // Forgets every recorded value.
+    void reset();
+
+    // Retrieves the number of recorded values.
+    std::uint64_t count() const { return total; }
+
+    // Retrieves the largest recorded value.
+    std::uint64_t max() const { return max_value; }
+
+    // Retrieves the mean of the recorded values.
+    double mean() const { return total == 0 ? 0.0 : static_cast<double>(sum) / total; }
+
+    // Retrieves an upper bound of the q-quantile (0 <= q <= 1).
+    std::uint64_t percentile(double q) const;
+
+    // Retrieves the count stored in one bucket.
+    std::uint64_t bucket_count(std::size_t bucket) const { return buckets[bucket]; }
+
+    // Retrieves the largest value that falls into a bucket.
+    static std::uint64_t bucket_upper_bound(std::size_t bucket);
+
+    // Returns the bucket a value falls into.
+    static std::size_t bucket_for(std::uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return static_cast<std::size_t>(value);
+        }
+        int magnitude = 63 - __builtin_clzll(value);       // Index of the highest set bit.
+        int shift = magnitude - SUB_BUCKET_BITS;
+        std::size_t sub = static_cast<std::size_t>(value >> shift) & (SUB_BUCKETS - 1);
+        return static_cast<std::size_t>(shift + 1) * SUB_BUCKETS + sub;
+    }
+
+private:
+    std::uint64_t buckets[BUCKET_COUNT];
+    std::uint64_t total;
+    std::uint64_t sum;
+    std::uint64_t max_value;
+
+    friend class AtomicLatencyHistogram;
+};
+
+// LatencyHistogram with the same buckets that other threads may read while
+// its owner records. Still a single writer: recording is relaxed loads and
+// stores with no read-modify-write, so it costs about as much as the plain one.
+class AtomicLatencyHistogram {
+public:
+    // Constructor that creates an empty histogram.
+    AtomicLatencyHistogram();
+
+    AtomicLatencyHistogram(const AtomicLatencyHistogram&) = delete;
+    AtomicLatencyHistogram& operator=(const AtomicLatencyHistogram&) = delete;
+
+    // Records one value. Only the owning thread may call this.
+    void record(std::uint64_t value_ns) {
+        bump(buckets[LatencyHistogram::bucket_for(value_ns)], 1);
+        bump(sum, value_ns);
+        if (value_ns > max_value.load(std::memory_order_relaxed)) {
+            max_value.store(value_ns, std::memory_order_relaxed);
+        }
+    }
+
+    // Adds the values recorded so far to a plain histogram. Safe from any thread;
+    // the count is taken from the buckets so it always matches them.
+    void add_to(LatencyHistogram& histogram) const;
+
+private:
+    std::atomic<std::uint64_t> buckets[LatencyHistogram::BUCKET_COUNT];
+    std::atomic<std::uint64_t> sum;
+    std::atomic<std::uint64_t> max_value;
+
+    static void bump(std::atomic<std::uint64_t>& counter, std::uint64_t amount) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+};
+
+#endif // LATENCYHISTOGRAM_H
@@ -0,0 +1,156 @@
+#ifndef LEDGER_H
+#define LEDGER_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Kind of a ledger entry.
+enum class LedgerEntryType : std::uint8_t {
+    Deposit = 1,
+    Withdrawal = 2,
+    TransferOut = 3, // Sent to another account; amount is positive.
+    TransferIn = 4,  // Received from another account.
+    Posting = 5      // Net interest, fees and adjustments of a batch posting; amount may be negative.
+};
+
+// One completed transaction. 24 bytes, stored inline in ledger chunks.
+struct LedgerEntry {
+    std::int64_t timestamp_us; // Microseconds since the Unix epoch; never decreases within an account.
+    std::uint32_t atm_id;      // ATM that made the transaction; 0 if not made at an ATM.
+    LedgerEntryType type;
+    std::int32_t amount;
+    std::int32_t balance;      // Balance right after the transaction.
+};
+
+// Entries per chunk. Each account's history is a chain of such chunks.
+const std::size_t LEDGER_CHUNK_ENTRIES = 32;
+
+// Fixed-size block of an account's history, taken from the Ledger's pool.
+// Only the writer changes a chunk; count is published with release order
+// after the entries, and the other fields are set before the chunk is
+// published, so readers need no lock.
+struct LedgerChunk {
+    LedgerEntry entries[LEDGER_CHUNK_ENTRIES];
+    std::atomic<std::uint32_t> count; // Entries written so far; at least 1 once published.
+    std::uint64_t index;              // Position in the account's chain, starting at 0.
+    const LedgerChunk* prev;          // Previous chunk, or null for the first.
+    const LedgerChunk* jump;          // Older chunk used to skip ahead when searching by time.
+
+    LedgerChunk() : count(0), index(0), prev(nullptr), jump(nullptr) {}
+};
+
+class Ledger;
+
+// Append-only transaction history of one account.
+// append() must be called by one thread at a time (Account calls it under
+// its lock); queries may run on any thread at the same time as appends.
+// "Last N" costs O(N); a time-range query finds its starting chunk with
+// skew-binary jump pointers in O(log chunks), then costs O(entries returned),
+// so both stay fast however long the history grows.
+class AccountLedger {
+public:
+    // Constructor for an empty history whose chunks come from ledger.
+    explicit AccountLedger(Ledger& ledger);
+
+    AccountLedger(const AccountLedger&) = delete;
+    AccountLedger& operator=(const AccountLedger&) = delete;
+
+    // Appends an entry. A timestamp earlier than the previous entry's is
+    // raised to it, so the history stays sorted by time. Does not allocate
+    // unless the ledger's reserved chunks run out.
+    void append(const LedgerEntry& entry);
+
+    // Retrieves the number of entries.
+    std::uint64_t size() const;
+
+    // Retrieves the newest count entries, oldest first.
+    std::vector<LedgerEntry> last(std::size_t count) const;
+
+    // Retrieves the entries with from_us <= timestamp_us <= to_us, oldest first.
+    std::vector<LedgerEntry> between(std::int64_t from_us, std::int64_t to_us) const;
+
+private:
+    Ledger& ledger;
+    std::atomic<LedgerChunk*> head; // Newest chunk, or null while empty.
+    std::int64_t last_timestamp;    // Writer only.
+
+    // Returns the newest chunk whose first entry is no later than time_us, or null.
+    static const LedgerChunk* find_chunk(const LedgerChunk* newest, std::int64_t time_us);
+};
+
+// Memory use of a Ledger.
+struct LedgerStats {
+    std::size_t accounts;        // Account histories created.
+    std::size_t chunks_used;     // Chunks holding entries.
+    std::size_t chunks_reserved; // Chunks allocated but not yet used.
+    std::size_t bytes;           // Bytes allocated for chunks.
+};
+
+// Owner of every account history of a bank, and of the pool their chunks
+// come from. Chunks are allocated in large slabs and never freed before the
+// ledger, so an append only takes a chunk from the pool when its current one
+// fills up (one append in LEDGER_CHUNK_ENTRIES), and allocates only if the
+// reserved chunks have run out.
+class Ledger {
+public:
+    // Constructor that reserves room for reserve_entries entries in total.
+    explicit Ledger(std::size_t reserve_entries = 0);
+
+    Ledger(const Ledger&) = delete;
+    Ledger& operator=(const Ledger&) = delete;
+
+    // Creates an empty account history. It lives as long as the ledger.
+    AccountLedger& create_account_ledger();
+
+    // Allocates chunks ahead of time, enough for about this many more
+    // entries, so that appends do not allocate.
+    void reserve(std::size_t entries);
+
+    // Retrieves the memory use.
+    LedgerStats stats() const;
+
+private:
+    friend class AccountLedger;
+
+    static const std::size_t SLAB_CHUNKS = 256;
+
+    mutable std::mutex mutex; // Guards everything below.
+    std::vector<std::unique_ptr<LedgerChunk[]>> slabs;
+    std::size_t next_chunk;   // Index of the next unused chunk across all slabs.
+    std::deque<AccountLedger> accounts;
+
+    // Hands out an unused chunk, allocating a slab if none is left.
+    LedgerChunk* acquire_chunk();
+
+    // Allocates slabs until at least the given number of chunks are unused. Requires the mutex.
+    void reserve_chunks(std::size_t chunks);
+};
+
+// Returns the current time in microseconds since the Unix epoch, as stored in ledger entries.
+std::int64_t ledger_clock_us();
+
+// Names the ATM that transactions on this thread are made at while the
+// scope is alive. ATMController opens one around each deposit and
+// withdrawal, so Account can record the ATM ID without it being passed
+// through every overridable method. Scopes nest.
+class LedgerAtmScope {
+public:
+    explicit LedgerAtmScope(std::uint32_t atm_id);
+    ~LedgerAtmScope();
+
+    LedgerAtmScope(const LedgerAtmScope&) = delete;
+    LedgerAtmScope& operator=(const LedgerAtmScope&) = delete;
+
+    // Retrieves the ATM ID of the innermost scope on this thread, or 0 if there is none.
+    static std::uint32_t current();
+
+private:
+    std::uint32_t previous;
+};
+
+#endif // LEDGER_H
@@ -0,0 +1,187 @@
+#ifndef LIMITS_H
+#define LIMITS_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include "Result.h"
+
+// Returns the current time in milliseconds on the monotonic clock the limits use.
+std::int64_t limits_clock_ms();
+
+// Counters of a SlidingWindowCounters table.
+struct WindowCounterStats {
+    std::size_t capacity;      // Keys that fit; fixed at construction.
+    std::size_t active;        // Keys with activity inside the window.
+    std::uint64_t evictions;   // Active keys displaced because their set was full.
+    std::uint64_t refusals;    // New keys turned away because every key in their set was at its limit.
+};
+
+// Fixed-size table of per-key counters over a sliding time window, e.g.
+// failed PINs per card in the last 24 hours. The window is split into
+// buckets, and a key's total is kept up to date as buckets expire, so reads
+// and updates take constant time; the window slides with bucket granularity.
+//
+// Keys are spread over sets of a few slots each. A key whose buckets have
+// all expired is idle and its slot is reused by the next new key in the
+// set, so idle entries expire without a sweep and memory never grows past
+// the capacity. If every slot in a set is active, the least recently
+// updated key is evicted and counted. try_add() never evicts a key that has
+// reached its limit, since that would lift the limit, e.g. unlock a card;
+// if every key in the set has, the new key is refused instead. Sets are
+// guarded by striped locks, so concurrent callers only contend on the same
+// stripe.
+class SlidingWindowCounters {
+public:
+    static const std::size_t WAYS = 8; // Slots per set.
+
+    // Constructor for a table holding at least capacity keys, with the
+    // window split into the given number of buckets.
+    // Throws an exception if the window, buckets or capacity are not positive
+    // or the window is shorter than one millisecond per bucket.
+    SlidingWindowCounters(std::chrono::milliseconds window, std::size_t buckets, std::size_t capacity);
+
+    SlidingWindowCounters(const SlidingWindowCounters&) = delete;
+    SlidingWindowCounters& operator=(const SlidingWindowCounters&) = delete;
+
+    // Retrieves a key's total over the window ending at now_ms.
+    std::int64_t total(std::uint64_t key, std::int64_t now_ms);
+
+    // Adds to a key's counter and returns its new total. A negative amount is
+    // taken from the newest buckets first and never leaves a bucket below zero.
+    std::int64_t add(std::uint64_t key, std::int64_t amount, std::int64_t now_ms);
+
+    // Adds to a key's counter only if its total stays at or below limit.
+    // The check and the update are one atomic step. Returns true if added,
+    // and false for a new key whose set is full of keys at the limit.
+    bool try_add(std::uint64_t key, std::int64_t amount, std::int64_t limit, std::int64_t now_ms);
+
+    // Forgets a key.
+    void reset(std::uint64_t key);
+
+    // Retrieves the counters; active keys are counted as of now_ms.
+    WindowCounterStats stats(std::int64_t now_ms) const;
+
+private:
+    // One key's counter; its buckets live in the counts array.
+    struct Slot {
+        std::uint64_t key;
+        std::int64_t head;  // Bucket number of the newest bucket (now_ms / bucket_ms).
+        std::int64_t total; // Sum of the key's buckets.
+        bool used;
+    };
+
+    static const std::size_t LOCK_STRIPES = 64;
+
+    std::int64_t bucket_ms;
+    std::size_t buckets;
+    std::size_t set_mask;
+    std::vector<Slot> slots;
+    std::vector<std::int64_t> counts; // buckets entries per slot.
+    std::unique_ptr<std::mutex[]> locks;
+    std::atomic<std::uint64_t> evictions;
+    std::atomic<std::uint64_t> refusals;
+
+    // Returns a key's slot with its buckets moved up to now, or null if the
+    // key is absent and create is false. A new key never evicts one whose
+    // total is at or above keep_from; null if that leaves no slot.
+    // Requires the set's lock.
+    Slot* find(std::uint64_t key, std::int64_t now_bucket, bool create,
+               std::int64_t keep_from = std::numeric_limits<std::int64_t>::max());
+
+    // Expires the buckets of a slot that fall out of the window ending at now_bucket.
+    void advance(Slot& slot, std::int64_t now_bucket);
+
+    // Returns the index of the first slot of a key's set.
+    std::size_t set_for(std::uint64_t key) const;
+
+    // Returns the lock stripe guarding the set that starts at slot first.
+    std::mutex& lock_for(std::size_t first) const;
+};
+
+// Thresholds of TransactionLimits. A limit of 0 turns its check off.
+struct LimitsConfig {
+    int max_pin_failures;                        // Wrong PINs that lock a card...
+    std::chrono::milliseconds pin_failure_window; // ...within this window; the lock lifts as they age out.
+    std::int64_t max_daily_withdrawal;           // Total an account may withdraw...
+    std::chrono::milliseconds withdrawal_window; // ...within this rolling window.
+    int max_atm_transactions;                    // Transactions one ATM may start...
+    std::chrono::milliseconds atm_rate_window;   // ...within this window.
+    std::size_t capacity;                        // Cards, accounts and ATMs tracked by each table.
+
+    LimitsConfig()
+        : max_pin_failures(3), pin_failure_window(std::chrono::hours(24)), max_daily_withdrawal(1000),
+          withdrawal_window(std::chrono::hours(24)), max_atm_transactions(600),
+          atm_rate_window(std::chrono::minutes(1)), capacity(16384) {}
+};
+
+// Returns the key a linked account's withdrawals are limited under: a hash of
+// its ID with the top bit set, so it never equals a card key (below 10^16),
+// which is the key of the card's own account.
+std::uint64_t linked_account_limit_key(const std::string& account_id);
+
+// Velocity limits of a bank, kept in memory so checking them costs no
+// lookup beyond the counters themselves: a card is locked after too many
+// wrong PINs, an account's withdrawals are capped over a rolling day, and
+// each ATM may start only so many transactions per window.
+// Each has its own SlidingWindowCounters table. All methods are thread-safe.
+class TransactionLimits {
+public:
+    static const std::size_t WINDOW_BUCKETS = 24; // Hourly buckets for a daily window.
+
+    // Constructor that applies the given thresholds.
+    // Throws an exception if a limit is negative or a window or the capacity is not positive.
+    explicit TransactionLimits(const LimitsConfig& config = LimitsConfig());
+
+    // Counts a PIN attempt as a failure until pin_accepted clears it, or
+    // returns TxError::CardLocked if the card already has too many failures
+    // within the window. Counting first keeps concurrent guesses at one card
+    // from slipping past the limit. A locked card is never evicted from the
+    // table; if its set is full of locked cards, a new card is refused as
+    // locked rather than unlocking one of them.
+    Result<void> try_pin_attempt(std::uint64_t card_key, std::int64_t now_ms = limits_clock_ms());
+
+    // Clears a card's failures after a correct PIN.
+    void pin_accepted(std::uint64_t card_key);
+
+    // Retrieves the wrong PINs counted for a card within the window.
+    std::int64_t pin_failures_for(std::uint64_t card_key, std::int64_t now_ms = limits_clock_ms());
+
+    // Counts a withdrawal against the account's rolling limit, or returns
+    // TxError::DailyLimitExceeded and counts nothing. account_key is the card
+    // key for a card's own account and linked_account_limit_key() for a
+    // linked one, so each account of a card has its own limit.
+    Result<void> try_reserve_withdrawal(std::uint64_t account_key, int amount,
+                                        std::int64_t now_ms = limits_clock_ms());
+
+    // Takes back a reserved withdrawal that did not go through.
+    void release_withdrawal(std::uint64_t account_key, int amount, std::int64_t now_ms = limits_clock_ms());
+
+    // Retrieves what the account has withdrawn within the rolling window.
+    std::int64_t withdrawn(std::uint64_t account_key, std::int64_t now_ms = limits_clock_ms());
+
+    // Counts a transaction started at an ATM, or returns TxError::RateLimited and counts nothing.
+    Result<void> try_atm_transaction(std::uint32_t atm_id, std::int64_t now_ms = limits_clock_ms());
+
+    // Retrieves the thresholds.
+    const LimitsConfig& get_config() const { return config; }
+
+    // Retrieves the counters of each table.
+    WindowCounterStats pin_stats(std::int64_t now_ms = limits_clock_ms()) const;
+    WindowCounterStats withdrawal_stats(std::int64_t now_ms = limits_clock_ms()) const;
+    WindowCounterStats atm_stats(std::int64_t now_ms = limits_clock_ms()) const;
+
+private:
+    LimitsConfig config;
+    SlidingWindowCounters pin_failures;
+    SlidingWindowCounters withdrawals;
+    SlidingWindowCounters atm_transactions;
+};
+
+#endif // LIMITS_H
@@ -0,0 +1,194 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Severity of a log message, ordered from most to least verbose.
+enum class LogLevel : int { Debug = 0, Info = 1, Warn = 2, Error = 3, Off = 4 };
+
+// Returns the label printed for a level (e.g. "INFO").
+const char* log_level_name(LogLevel level);
+
+// Parses a label such as "INFO" or "WARN". Unknown labels map to Info.
+LogLevel parse_log_level(const std::string& name);
+
+// A fixed-size message buffer filled with operator<<.
+// Formatting never allocates; text beyond the capacity is truncated.
+class LogLine {
+public:
+    static const std::size_t CAPACITY = 240;
+
+    LogLine() : length(0) {}
+
+    LogLine& operator<<(const char* text) { append(text, std::strlen(text)); return *this; }
+    LogLine& operator<<(const std::string& text) { append(text.data(), text.size()); return *this; }
+    LogLine& operator<<(char c) { append(&c, 1); return *this; }
+    LogLine& operator<<(int value) { return append_signed(value); }
+    LogLine& operator<<(long value) { return append_signed(value); }
+    LogLine& operator<<(long long value) { return append_signed(value); }
+    LogLine& operator<<(unsigned value) { return append_unsigned(value); }
+    LogLine& operator<<(unsigned long value) { return append_unsigned(value); }
+    LogLine& operator<<(unsigned long long value) { return append_unsigned(value); }
+    LogLine& operator<<(double value);
+
+    const char* data() const { return buffer; }
+    std::size_t size() const { return length; }
+
+private:
+    char buffer[CAPACITY];
+    std::size_t length;
+
+    void append(const char* text, std::size_t count) {
+        if (count > CAPACITY - length) {
+            count = CAPACITY - length;
+        }
+        std::memcpy(buffer + length, text, count);
+        length += count;
+    }
+
+    LogLine& append_signed(long long value) {
+        if (value < 0) {
+            append("-", 1);
+            return append_unsigned(0ULL - static_cast<unsigned long long>(value));
+        }
+        return append_unsigned(static_cast<unsigned long long>(value));
+    }
+
+    LogLine& append_unsigned(unsigned long long value) {
+        char digits[20];
+        std::size_t count = 0;
+        do {
+            digits[sizeof(digits) - 1 - count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        append(digits + sizeof(digits) - count, count);
+        return *this;
+    }
+};
+
+// Asynchronous logger shared by the whole process.
+// Callers copy their message into a bounded lock-free ring buffer and return
+// immediately; a background thread drains the ring and writes whole batches
+// to the console and to any file sinks, flushing once per batch.
+// When the ring is full new messages are dropped and counted instead of
+// blocking the caller or growing memory.
+class Logger {
+public:
+    static const std::size_t RING_CAPACITY = 4096; // Must be a power of two.
+    static const std::size_t MAX_FILE_SINKS = 8;
+
+    // Retrieves the process-wide logger, starting its writer thread on first use.
+    static Logger& instance();
+
+    // Returns true if messages of the given level are currently written.
+    // This is a single relaxed load, so disabled levels cost almost nothing.
+    static bool enabled(LogLevel level) {
+        return static_cast<int>(level) >= min_level.load(std::memory_order_relaxed);
+    }
+
+    // Sets the minimum level that is written. LogLevel::Off silences everything.
+    static void set_level(LogLevel level);
+
+    // Retrieves the minimum level that is written.
+    static LogLevel level();
+
+    // Queues a message for the writer thread. Never blocks.
+    // file_sink is an ID returned by open_file_sink, or -1 for console only.
+    // Returns false if the message was dropped because the ring is full.
+    bool submit(LogLevel level, const char* text, std::size_t length,
+                int file_sink = -1, bool with_timestamp = false);
+
+    // Queues a formatted line. See submit above.
+    bool submit(LogLevel level, const LogLine& line) {
+        return submit(level, line.data(), line.size());
+    }
+
+    // Returns the ID of an append-mode file sink, opening it on first use.
+    // Returns -1 if the file cannot be opened or too many sinks are open.
+    int open_file_sink(const std::string& path);
+
+    // Enables or disables writing to std::cout.
+    void set_console_enabled(bool enabled);
+
+    // Blocks until every message queued before the call has been written.
+    void flush();
+
+    // Retrieves the number of messages dropped because the ring was full.
+    std::uint64_t dropped_count() const;
+
+    // Retrieves the number of messages written by the background thread.
+    std::uint64_t written_count() const;
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // Drains the remaining messages and stops the writer thread.
+    ~Logger();
+
+private:
+    struct Slot {
+        std::atomic<std::size_t> sequence;
+        LogLevel level;
+        std::int16_t file_sink;
+        bool with_timestamp;
+        std::uint16_t length;
+        std::int64_t time_us;
+        char text[LogLine::CAPACITY];
+    };
+
+    static std::atomic<int> min_level;
+
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<std::size_t> enqueue_pos;
+    std::size_t dequeue_pos; // Owned by the writer thread.
+    std::atomic<std::size_t> written_pos;
+    std::atomic<std::uint64_t> dropped;
+    std::uint64_t dropped_reported; // Owned by the writer thread.
+    std::atomic<bool> console_enabled;
+
+    std::mutex sink_mutex;
+    std::vector<std::pair<std::string, std::unique_ptr<std::ofstream>>> file_sinks;
+
+    std::mutex wake_mutex;
+    std::condition_variable wake;     // Signals the writer that work is queued.
+    std::condition_variable progress; // Signals flush() that written_pos advanced.
+    std::atomic<bool> writer_idle;
+    bool stopping;
+    std::thread writer;
+
+    Logger();
+
+    // Writer thread body.
+    void run();
+
+    // Moves up to one batch from the ring into the output buffers; returns the count.
+    std::size_t drain(std::string& console, std::vector<std::string>& files);
+};
+
+// Logs a streamed expression at the given level. The expression is not
+// evaluated at all when the level is disabled.
+#define ATM_LOG(level, expr)                                 \
+    do {                                                     \
+        if (Logger::enabled(level)) {                        \
+            LogLine atm_log_line_;                           \
+            atm_log_line_ << expr;                           \
+            Logger::instance().submit(level, atm_log_line_); \
+        }                                                    \
+    } while (0)
+
+#define ATM_LOG_DEBUG(expr) ATM_LOG(LogLevel::Debug, expr)
+#define ATM_LOG_INFO(expr) ATM_LOG(LogLevel::Info, expr)
+#define ATM_LOG_WARN(expr) ATM_LOG(LogLevel::Warn, expr)
+#define ATM_LOG_ERROR(expr) ATM_LOG(LogLevel::Error, expr)
+
+#endif // LOGGER_H
@@ -0,0 +1,188 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <ostream>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "LatencyHistogram.h"
+#include "Result.h"
+
+// Entry points of ATMController and BankSystem that record metrics.
+enum class MetricOp : int {
+    AtmInsertCard,
+    AtmEjectCard,
+    AtmEnterPin,
+    AtmSelectAccount,
+    AtmViewBalance,
+    AtmDeposit,
+    AtmWithdraw,
+    AtmMiniStatement,
+    AtmTransfer,
+    BankAddAccount,
+    BankValidatePin,
+    BankAuthenticate,
+    BankGetAccount,
+    Count
+};
+
+// Exception types that failed calls are counted under.
+enum class MetricError : int {
+    InvalidArgument, // std::invalid_argument
+    LengthError,     // std::length_error
+    LogicError,      // Any other std::logic_error
+    RuntimeError,    // std::runtime_error and subclasses
+    Other,           // Anything else
+    Count
+};
+
+const std::size_t METRIC_OP_COUNT = static_cast<std::size_t>(MetricOp::Count);
+const std::size_t METRIC_ERROR_COUNT = static_cast<std::size_t>(MetricError::Count);
+
+// Returns the label an operation is exported under (e.g. "atm_enter_pin").
+const char* metric_op_name(MetricOp op);
+
+// Returns the label an exception type is exported under (e.g. "invalid_argument").
+const char* metric_error_name(MetricError error);
+
+// Totals of one operation across all threads.
+struct OperationMetrics {
+    std::uint64_t calls;                      // Completed calls, failed ones included.
+    std::uint64_t errors[METRIC_ERROR_COUNT]; // Failed calls by exception type.
+    LatencyHistogram latency;                 // Wall time of every call, in nanoseconds.
+};
+
+// Point-in-time totals of every operation, indexed by MetricOp.
+struct MetricsSnapshot {
+    std::vector<OperationMetrics> operations;
+
+    const OperationMetrics& operator[](MetricOp op) const { return operations[static_cast<std::size_t>(op)]; }
+};
+
+// Process-wide operation metrics.
+// Each thread records into its own block of counters and histograms, so
+// recording never contends and never takes a lock; snapshot() sums the blocks.
+// Blocks of exited threads are kept (and reused by new threads), so totals
+// never go backwards.
+// Building with -DATM_METRICS_DISABLED (make METRICS=off) compiles every
+// MetricsTimer away; snapshots are then all zero.
+class Metrics {
+public:
+    // Retrieves the process-wide metrics.
+    static Metrics& instance();
+
+    // Records one completed call and its duration on the calling thread.
+    static void record(MetricOp op, std::uint64_t elapsed_ns);
+
+    // Counts a failed call under the type of the exception being handled.
+    // Must be called from inside a catch block.
+    static void record_current_exception(MetricOp op);
+
+    // Counts a failed call under the given exception type.
+    static void record_error(MetricOp op, MetricError error);
+
+    // Sums every thread's counters and histograms. Never blocks recording threads.
+    MetricsSnapshot snapshot() const;
+
+    // Writes a snapshot in Prometheus text exposition format.
+    static void write_prometheus(const MetricsSnapshot& snapshot, std::ostream& out);
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+private:
+    // One thread's counters. Only the owning thread writes; anyone may read.
+    struct ThreadBlock {
+        std::atomic<std::uint64_t> calls[METRIC_OP_COUNT];
+        std::atomic<std::uint64_t> errors[METRIC_OP_COUNT][METRIC_ERROR_COUNT];
+        AtomicLatencyHistogram latency[METRIC_OP_COUNT];
+
+        ThreadBlock();
+    };
+
+    mutable std::mutex blocks_mutex;                  // Guards the block lists, not the counters.
+    std::vector<std::unique_ptr<ThreadBlock>> blocks; // Every block ever handed out.
+    std::vector<ThreadBlock*> free_blocks;            // Blocks of exited threads, ready for reuse.
+
+    Metrics() {}
+
+    // Returns the calling thread's block, taking one on first use.
+    static ThreadBlock& local();
+
+    // Hands a block to a new thread, or takes one back from an exiting thread.
+    ThreadBlock* acquire_block();
+    void release_block(ThreadBlock* block);
+
+    friend struct MetricsThreadSlot;
+};
+
+// Times one call of an instrumented entry point and records it when the
+// scope ends. Call fail() from a catch block to count the exception, or
+// fail(error) to count a TxError under the exception the throwing API
+// would raise for it.
+class MetricsTimer {
+public:
+#ifndef ATM_METRICS_DISABLED
+    explicit MetricsTimer(MetricOp op) : op(op), start(std::chrono::steady_clock::now()) {}
+
+    ~MetricsTimer() {
+        Metrics::record(op, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count()));
+    }
+
+    void fail() { Metrics::record_current_exception(op); }
+
+    TxError fail(TxError error) {
+        Metrics::record_error(op, tx_error_is_runtime(error) ? MetricError::RuntimeError : MetricError::InvalidArgument);
+        return error;
+    }
+
+private:
+    MetricOp op;
+    std::chrono::steady_clock::time_point start;
+#else
+    explicit MetricsTimer(MetricOp) {}
+
+    void fail() {}
+
+    TxError fail(TxError error) { return error; }
+#endif
+};
+
+// Periodically writes the current metrics to a file in Prometheus text
+// format, for a node exporter textfile collector or similar to pick up.
+// Each write replaces the file atomically (write to a temporary, then rename).
+class MetricsExporter {
+public:
+    // Starts a background thread that writes to path once per interval.
+    MetricsExporter(const std::string& path, std::chrono::milliseconds interval);
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // Stops the thread after one final write.
+    ~MetricsExporter();
+
+    // Writes the file now. Throws an exception if it cannot be written.
+    void write_now();
+
+private:
+    std::string path;
+    std::chrono::milliseconds interval;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+    std::thread writer;
+
+    // Writer thread body.
+    void run();
+};
+
+#endif // METRICS_H
@@ -0,0 +1,46 @@
+#ifndef PINHASH_H
+#define PINHASH_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// Salted PIN hashes: PBKDF2-HMAC-SHA256 (RFC 8018) with a per-credential
+// iteration count, so the cost can be raised for new PINs without
+// invalidating existing ones.
+
+const std::size_t SHA256_DIGEST_SIZE = 32;
+const std::size_t PIN_SALT_SIZE = 16;
+
+// Computes the SHA-256 digest of a byte string.
+void sha256(const void* data, std::size_t size, std::uint8_t digest[SHA256_DIGEST_SIZE]);
+
+// Derives size bytes from a password and salt with PBKDF2-HMAC-SHA256.
+void pbkdf2_hmac_sha256(const void* password, std::size_t password_size, const void* salt, std::size_t salt_size,
+                        std::uint32_t iterations, std::uint8_t* out, std::size_t size);
+
+// A stored PIN: the salt, the cost it was hashed at and the derived key.
+// An iteration count of 0 marks an account without a PIN, which never verifies.
+struct PinCredential {
+    std::uint32_t iterations;
+    std::uint8_t salt[PIN_SALT_SIZE];
+    std::uint8_t hash[SHA256_DIGEST_SIZE];
+};
+
+// Hashes a PIN with a fresh random salt at the given cost.
+PinCredential hash_pin(const std::string& pin, std::uint32_t iterations);
+
+// Returns a credential that no PIN matches.
+PinCredential empty_pin_credential();
+
+// Checks a PIN against a credential. The comparison of the derived keys
+// takes the same time wherever they differ.
+bool verify_pin(const PinCredential& credential, const std::string& pin);
+
+// Formats a credential as "pbkdf2-sha256$<iterations>$<salt hex>$<hash hex>" for journals and snapshots.
+std::string encode_pin_credential(const PinCredential& credential);
+
+// Parses a string produced by encode_pin_credential. Returns false if it is malformed.
+bool decode_pin_credential(const std::string& text, PinCredential& credential);
+
+#endif // PINHASH_H
@@ -0,0 +1,95 @@
+#ifndef PINVERIFIER_H
+#define PINVERIFIER_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include "PinHash.h"
+#include "LatencyHistogram.h"
+
+// Settings for PIN hashing and verification in BankSystem.
+struct PinHashConfig {
+    std::uint32_t iterations;     // PBKDF2 cost for newly stored PINs; existing hashes keep theirs.
+    std::size_t verifier_threads; // Workers that run PIN checks.
+    std::size_t max_batch;        // Most checks a worker takes from the queue at once.
+
+    PinHashConfig() : iterations(10000), verifier_threads(2), max_batch(16) {}
+};
+
+// Verification throughput and queue-wait latency since the verifier started
+// or its statistics were last reset.
+struct PinVerifierStats {
+    std::uint64_t verified;         // Checks completed.
+    std::uint64_t batches;          // Times a worker took work from the queue.
+    std::size_t queue_depth;        // Checks waiting right now.
+    double seconds;                 // Wall-clock time covered.
+    double verifications_per_sec;   // verified / seconds.
+    double worker_utilization;      // Fraction of worker time spent hashing.
+    double queue_wait_mean_ns;
+    std::uint64_t queue_wait_p50_ns;
+    std::uint64_t queue_wait_p99_ns;
+    std::uint64_t queue_wait_max_ns;
+};
+
+// Dedicated pool of threads that checks PINs against their salted hashes.
+// Callers enqueue a check and either wait for it or get a callback, so the
+// deliberately slow KDF runs on a bounded number of cores and never while a
+// bank lock is held. Idle workers take up to max_batch queued checks per wake-up.
+class PinVerifier {
+public:
+    // Starts the worker threads.
+    explicit PinVerifier(const PinHashConfig& config);
+
+    PinVerifier(const PinVerifier&) = delete;
+    PinVerifier& operator=(const PinVerifier&) = delete;
+
+    // Finishes every queued check and stops the workers.
+    ~PinVerifier();
+
+    // Queues a check; done(matched) is called on a worker thread.
+    void submit(const PinCredential& credential, const std::string& pin, std::function<void(bool)> done);
+
+    // Queues a check and waits for its result.
+    bool verify(const PinCredential& credential, const std::string& pin);
+
+    // Retrieves throughput and queue-wait statistics.
+    PinVerifierStats stats() const;
+
+    // Starts a new statistics interval.
+    void reset_stats();
+
+private:
+    struct Job {
+        PinCredential credential; // Copied so the check never reads shared state.
+        std::string pin;
+        std::function<void(bool)> done;
+        std::uint64_t enqueued_ns;
+    };
+
+    std::size_t thread_count;
+    std::size_t max_batch;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<Job> queue;  // Checks from queue_head on are waiting; reused, so queuing does not allocate.
+    std::size_t queue_head;
+    bool stopping;
+    std::vector<std::thread> workers;
+
+    // Statistics; the histogram and start time are guarded by mutex.
+    LatencyHistogram queue_wait;
+    std::uint64_t stats_start_ns;
+    std::atomic<std::uint64_t> verified;
+    std::atomic<std::uint64_t> batches;
+    std::atomic<std::uint64_t> busy_ns;
+
+    // Worker thread body.
+    void run();
+};
+
+#endif // PINVERIFIER_H
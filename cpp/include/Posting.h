@@ -0,0 +1,48 @@
+#ifndef POSTING_H
+#define POSTING_H
+
+#include <cstddef>
+#include <cstdint>
+
+// What a batch posting applies to every account, e.g. overnight.
+// Interest is balance * interest_bp / 10000, rounded down. Accounts holding
+// less than fee_waiver_balance also pay the fee, capped at their balance so
+// that it never overdraws. Every kernel gives exactly the same results.
+struct PostingRules {
+    int interest_bp;        // Interest in basis points per posting, 0 to 9999.
+    int fee;                // Flat fee; 0 charges nothing.
+    int fee_waiver_balance; // Balances at or above this pay no fee.
+
+    PostingRules() : interest_bp(0), fee(0), fee_waiver_balance(0) {}
+};
+
+// Implementation used by compute_postings.
+enum class PostingKernel {
+    Auto,   // Fastest kernel the CPU supports.
+    Scalar, // One balance at a time; available everywhere.
+    SSE2,   // Four balances per 128-bit vector (x86-64 baseline).
+    AVX2    // Eight balances per 256-bit vector.
+};
+
+// Returns the kernel that PostingKernel::Auto resolves to on this CPU.
+PostingKernel best_posting_kernel();
+
+// Returns a printable name for a kernel (e.g. "avx2").
+const char* posting_kernel_name(PostingKernel kernel);
+
+// Returns true if the kernel can run on this CPU.
+bool posting_kernel_supported(PostingKernel kernel);
+
+// Throws std::invalid_argument unless the rules are in range.
+void check_posting_rules(const PostingRules& rules);
+
+// Returns the net change the rules make to one non-negative balance.
+int posting_delta(int balance, const PostingRules& rules);
+
+// Writes posting_delta(balances[i], rules) to deltas[i] for count
+// non-negative balances. Throws an exception if the rules are out of range
+// or the requested kernel is not supported.
+void compute_postings(const int* balances, int* deltas, std::size_t count, const PostingRules& rules,
+                      PostingKernel kernel = PostingKernel::Auto);
+
+#endif // POSTING_H
@@ -0,0 +1,102 @@
+#ifndef REMOTEATMCONTROLLER_H
+#define REMOTEATMCONTROLLER_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include "BankBackend.h"
+#include "Card.h"
+#include "Result.h"
+#include "CashDispenser.h"
+
+// ATMController for a terminal process that does not hold the BankSystem,
+// e.g. a front end of tools/atm_bankd: the same session API, with every
+// account operation sent as a request through a BankBackend
+// (ShmBankBackend or RemoteBankBackend, see connect_bank_daemon(), or
+// LocalBankBackend in process). Cash, if loaded, stays in the terminal:
+// the notes are reserved before the withdrawal is sent and given back if
+// the bank declines it. A successful enter_pin() opens a session at the
+// bank, which every later request of the card carries and eject_card()
+// closes; wrong PINs count against the bank's lockout as they do locally.
+//
+// The backend protocol addresses the card's own account only and carries
+// no ATM ID or transaction ID, so linked accounts, transfers, mini
+// statements, retry deduplication and the bank's amount and per-ATM
+// limits are only available through ATMController in the bank's process.
+class RemoteATMController {
+public:
+    // Constructor that sends requests through backend, which must outlive
+    // the controller, for the ATM with the given ID (0 if unspecified).
+    explicit RemoteATMController(BankBackend& backend, std::uint32_t atm_id = 0);
+
+    RemoteATMController(const RemoteATMController&) = delete;
+    RemoteATMController& operator=(const RemoteATMController&) = delete;
+
+    // Retrieves the ID of the ATM.
+    std::uint32_t get_atm_id() const;
+
+    // Loads the cassettes, replacing any loaded before (see ATMController::load_cash()).
+    void load_cash(const std::vector<Cassette>& cassettes, int max_notes = CashDispenser::DEFAULT_MAX_NOTES);
+
+    // Retrieves the cash inventory, or null if no cash is loaded.
+    CashDispenser* get_cash_dispenser() const;
+
+    // Simulates inserting a card into the ATM. The card is copied.
+    // Throws an exception if a card is already inserted.
+    void insert_card(const Card& card);
+
+    // Simulates ejecting the currently inserted card.
+    // Throws an exception if no card is inserted.
+    void eject_card();
+
+    // Validates the PIN for the inserted card with one Authenticate request.
+    // Throws an exception if no card is inserted, the PIN is wrong or the bank cannot be reached.
+    void enter_pin(const std::string& pin);
+
+    // Non-throwing form of enter_pin(): returns TxError::NoCard,
+    // TxError::WrongPin, TxError::CardLocked, TxError::TooManySessions or
+    // TxError::BackendUnavailable on failure.
+    Result<void> try_enter_pin(const std::string& pin);
+
+    // Retrieves the balance of the card's account from the bank.
+    // Throws an exception if the user is not authenticated or the bank cannot be reached.
+    int view_balance();
+
+    // Non-throwing form of view_balance(): returns TxError::NoAccountSelected,
+    // TxError::SessionExpired or TxError::BackendUnavailable on failure.
+    Result<int> try_view_balance();
+
+    // Deposits a specified amount into the card's account.
+    // Throws an exception if the user is not authenticated or the deposit fails.
+    int deposit(int amount);
+
+    // Non-throwing form of deposit(): returns the new balance, or
+    // TxError::NoAccountSelected, TxError::InvalidAmount, TxError::SessionExpired
+    // or TxError::BackendUnavailable.
+    Result<int> try_deposit(int amount);
+
+    // Withdraws a specified amount from the card's account.
+    // Throws an exception if the user is not authenticated or the withdrawal fails.
+    int withdraw(int amount);
+
+    // Non-throwing form of withdraw(): returns the new balance, or
+    // TxError::NoAccountSelected, TxError::InvalidAmount,
+    // TxError::InsufficientFunds, TxError::SessionExpired,
+    // TxError::BackendUnavailable or, with cash
+    // loaded, TxError::CannotDispense. A withdrawal whose reply is lost
+    // (TxError::BackendUnavailable) dispenses nothing; whether the bank
+    // applied it is left to reconciliation. One the bank applied but could
+    // not save (TxError::NotDurable) is dispensed.
+    Result<int> try_withdraw(int amount);
+
+private:
+    BankBackend& backend;
+    std::uint32_t atm_id;
+    Card card;           // The inserted card, while card_inserted is set.
+    bool card_inserted;
+    std::uint64_t session; // Bank session of the inserted card; 0 until its PIN is accepted.
+    std::unique_ptr<CashDispenser> dispenser; // Cash in the machine; null if not modeled.
+};
+
+#endif // REMOTEATMCONTROLLER_H
@@ -0,0 +1,81 @@
+#ifndef REMOTEBANKBACKEND_H
+#define REMOTEBANKBACKEND_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "BankBackend.h"
+
+// Settings of a RemoteBankBackend.
+struct RemoteBackendConfig {
+    std::string socket_path;   // Unix domain socket the server listens on.
+    std::size_t connections;   // Connections opened; requests are spread over them round robin.
+    std::size_t max_in_flight; // Requests awaiting a reply per connection before submit() blocks.
+
+    explicit RemoteBackendConfig(const std::string& socket_path)
+        : socket_path(socket_path), connections(1), max_in_flight(64) {}
+};
+
+// Pipelined, asynchronous client for a bank backend behind a Unix domain
+// socket (see BankServer). submit() writes the request and returns at once;
+// many requests share a connection, and a reader thread per connection
+// matches replies to requests by ID, so replies may arrive in any order.
+// Callbacks run on the reader thread and should be short.
+// If a connection breaks, its outstanding and later requests fail with
+// TxError::BackendUnavailable.
+class RemoteBankBackend : public BankBackend {
+public:
+    // Connects to the server. Throws an exception if it cannot be reached.
+    explicit RemoteBankBackend(const RemoteBackendConfig& config);
+
+    RemoteBankBackend(const RemoteBankBackend&) = delete;
+    RemoteBankBackend& operator=(const RemoteBankBackend&) = delete;
+
+    // Closes the connections; requests still awaiting a reply fail.
+    ~RemoteBankBackend();
+
+    void submit(const BackendRequest& request, BackendCallback done) override;
+
+    // Retrieves the number of requests awaiting a reply on all connections.
+    std::size_t in_flight() const;
+
+private:
+    // A request awaiting its reply.
+    struct PendingRequest {
+        BackendCallback done;
+        std::uint64_t card_key; // Reported back if the request fails.
+    };
+
+    // One socket with its outstanding requests.
+    struct Connection {
+        int fd;
+        std::mutex write_mutex; // Keeps frames from concurrent submitters whole.
+        mutable std::mutex pending_mutex;
+        std::condition_variable window; // Signaled when a request completes or the connection closes.
+        std::unordered_map<std::uint64_t, PendingRequest> pending;
+        std::uint64_t next_id;
+        bool closed;
+        std::thread reader;
+
+        Connection() : fd(-1), next_id(1), closed(false) {}
+    };
+
+    RemoteBackendConfig config;
+    std::vector<std::unique_ptr<Connection>> connections;
+    std::atomic<std::size_t> next_connection;
+
+    // Reader thread body: completes requests as their replies arrive.
+    void read_replies(Connection& connection);
+
+    // Marks a connection broken and fails everything still pending on it.
+    static void fail_pending(Connection& connection);
+};
+
+#endif // REMOTEBANKBACKEND_H
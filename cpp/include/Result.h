@@ -0,0 +1,92 @@
+#ifndef RESULT_H
+#define RESULT_H
+
+#include <cstdint>
+
+// Routine ways a transaction step can fail. The non-throwing try_* methods
+// return these instead of throwing; the throwing methods turn them into the
+// exception listed for each.
+enum class TxError : std::uint8_t {
+    None = 0,
+    InvalidAmount,       // Amount is zero or negative (std::invalid_argument).
+    InsufficientFunds,   // Withdrawal exceeds the balance (std::invalid_argument).
+    WrongPin,            // PIN does not match, or the card is unknown (std::invalid_argument).
+    UnknownAccount,      // No account for the card (std::invalid_argument).
+    NoCard,              // No card inserted (std::runtime_error).
+    NoAccountSelected,   // No authenticated account at the ATM (std::runtime_error).
+    BackendUnavailable,  // The bank backend could not be reached or failed (std::runtime_error).
+    CannotDispense,      // The ATM's notes cannot make up the amount (std::invalid_argument).
+    CardLocked,          // Too many wrong PINs for the card recently (std::runtime_error).
+    DailyLimitExceeded,  // Withdrawal would pass the account's rolling limit (std::invalid_argument).
+    RateLimited,         // The ATM has started too many transactions recently (std::runtime_error).
+    TransactionIdReused, // The transaction ID was used for a different request (std::invalid_argument).
+    SameAccount,         // A transfer names one account as both source and destination (std::invalid_argument).
+    SessionExpired,      // The session was closed or expired while idle (std::runtime_error).
+    TooManySessions,     // Every session slot is in use (std::runtime_error).
+    NotDurable           // Applied in memory, but its journal record failed to write (std::runtime_error).
+};
+
+// Returns the message used for an error, e.g. "Insufficient balance.".
+const char* tx_error_message(TxError error);
+
+// Returns true if the throwing API reports the error as std::runtime_error
+// rather than std::invalid_argument.
+bool tx_error_is_runtime(TxError error);
+
+// Throws the exception the throwing API uses for an error.
+[[noreturn]] void throw_tx_error(TxError error);
+
+// Either a value or a TxError. Converts implicitly from both, so a try_*
+// method can `return balance;` or `return TxError::InsufficientFunds;`.
+template <typename T>
+class Result {
+public:
+    Result(const T& value) : stored(value), failure(TxError::None) {}
+    Result(TxError error) : stored(), failure(error) {}
+
+    // Returns true if the result holds a value.
+    bool ok() const { return failure == TxError::None; }
+    explicit operator bool() const { return ok(); }
+
+    // Retrieves the error, or TxError::None on success.
+    TxError error() const { return failure; }
+
+    // Retrieves the value. Throws the error's exception if there is none.
+    const T& value() const {
+        if (failure != TxError::None) {
+            throw_tx_error(failure);
+        }
+        return stored;
+    }
+
+private:
+    T stored;
+    TxError failure;
+};
+
+// Outcome of a step that produces no value.
+template <>
+class Result<void> {
+public:
+    Result() : failure(TxError::None) {}
+    Result(TxError error) : failure(error) {}
+
+    // Returns true if the step succeeded.
+    bool ok() const { return failure == TxError::None; }
+    explicit operator bool() const { return ok(); }
+
+    // Retrieves the error, or TxError::None on success.
+    TxError error() const { return failure; }
+
+    // Throws the error's exception if the step failed.
+    void value() const {
+        if (failure != TxError::None) {
+            throw_tx_error(failure);
+        }
+    }
+
+private:
+    TxError failure;
+};
+
+#endif // RESULT_H
@@ -0,0 +1,185 @@
+#ifndef SESSIONMANAGER_H
+#define SESSIONMANAGER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "ATMController.h"
+#include "BankSystem.h"
+#include "Card.h"
+#include "Result.h"
+
+// Identifies an open session: the slot index in the low 32 bits and the
+// slot's generation in the high 32 bits, so a handle kept after its session
+// closed or expired is refused instead of reaching the slot's next session.
+typedef std::uint64_t SessionHandle;
+
+// No session; never returned for an open one.
+const SessionHandle INVALID_SESSION_HANDLE = 0;
+
+// Settings for a SessionManager.
+struct SessionConfig {
+    std::size_t capacity;                   // Sessions open at once; all slots are allocated up front.
+    std::chrono::milliseconds idle_timeout; // A session idle this long expires.
+    std::chrono::milliseconds tick;         // Granularity of the expiry timer wheel.
+    std::uint32_t atm_id;                   // Recorded in the ledger with every transaction (see ATMController).
+
+    SessionConfig()
+        : capacity(65536), idle_timeout(std::chrono::seconds(120)), tick(std::chrono::seconds(1)), atm_id(0) {}
+};
+
+// Counters of a SessionManager.
+struct SessionStats {
+    std::size_t open;       // Sessions open now.
+    std::uint64_t opened;   // Sessions opened so far.
+    std::uint64_t closed;   // Sessions closed by their terminal.
+    std::uint64_t expired;  // Sessions closed for being idle.
+    std::uint64_t rejected; // Sessions refused because every slot was in use.
+};
+
+// Serves many concurrent or interleaved ATM sessions in one process, e.g. a
+// terminal server, without a controller per customer. Each session is an
+// ATMSession in a slot of a pool allocated up front and is named by a
+// SessionHandle. Requests run through ATMController::resume(), so they
+// behave exactly as on a controller, and the accounts resolved by the PIN
+// check are kept in the slot, so later requests need no lookup. Opening,
+// using and closing a session allocates nothing.
+//
+// A session idle for config.idle_timeout expires: requests on it fail with
+// TxError::SessionExpired and its slot is reused. Open sessions sit on a
+// timer wheel of config.tick buckets, filed by when they would expire.
+// Requests only record when they ran; a session is filed again when its
+// bucket comes due and it turns out to have been used since, so busy
+// sessions cost the wheel one move per timeout instead of one per request.
+// The wheel advances when sessions are opened and on expire_idle().
+//
+// All methods may be called from any thread. Requests on different sessions
+// run in parallel; requests on one session are serialized.
+// Cash is not modeled: sessions withdraw without a CashDispenser.
+class SessionManager {
+public:
+    // Allocates config.capacity session slots.
+    // Throws std::invalid_argument if the capacity is 0 or above 2^32 - 2,
+    // or the tick is not positive and shorter than the idle timeout.
+    explicit SessionManager(BankSystem& bank, const SessionConfig& config = SessionConfig());
+
+    SessionManager(const SessionManager&) = delete;
+    SessionManager& operator=(const SessionManager&) = delete;
+
+    // Opens a session for an inserted card.
+    // Throws std::runtime_error if every slot is in use.
+    SessionHandle open_session(const Card& card);
+
+    // Non-throwing form of open_session(): returns TxError::TooManySessions
+    // if every slot is in use.
+    Result<SessionHandle> try_open_session(const Card& card);
+
+    // Ejects the session's card and frees its slot. Returns false if the
+    // session had already closed or expired.
+    bool close_session(SessionHandle session);
+
+    // Validates the PIN for the session's card (see ATMController::try_enter_pin()).
+    // Every request on a session fails with TxError::SessionExpired once it has closed or expired.
+    void enter_pin(SessionHandle session, const std::string& pin);
+    Result<void> try_enter_pin(SessionHandle session, const std::string& pin);
+
+    // Selects another account of the session's card (see ATMController::try_select_account()).
+    void select_account(SessionHandle session, const std::string& account_id);
+    Result<void> try_select_account(SessionHandle session, const std::string& account_id);
+
+    // Retrieves the selected account's balance, or TxError::NoAccountSelected.
+    int view_balance(SessionHandle session);
+    Result<int> try_view_balance(SessionHandle session);
+
+    // Deposits into the selected account (see ATMController::try_deposit()).
+    int deposit(SessionHandle session, int amount);
+    Result<int> try_deposit(SessionHandle session, int amount);
+
+    // Withdraws from the selected account (see ATMController::try_withdraw()).
+    int withdraw(SessionHandle session, int amount);
+    Result<int> try_withdraw(SessionHandle session, int amount);
+
+    // Transfers to another account of the card (see ATMController::try_transfer()).
+    int transfer(SessionHandle session, const std::string& to_account_id, int amount);
+    Result<int> try_transfer(SessionHandle session, const std::string& to_account_id, int amount);
+
+    // Advances the timer wheel to now and expires the sessions idle for
+    // longer than the timeout. Returns how many expired. Terminals that open
+    // sessions rarely should call it once per tick.
+    std::size_t expire_idle();
+
+    // Retrieves the counters.
+    SessionStats stats() const;
+
+    // Retrieves the number of session slots.
+    std::size_t capacity() const { return slot_count; }
+
+private:
+    // Lifecycle of a slot.
+    enum class SlotState : std::uint8_t {
+        Free,    // On the free list.
+        Open,    // Serving a session; on the wheel.
+        Closing  // Closed by its terminal, which is about to take it off the wheel.
+    };
+
+    // One session. Wheel and free-list links are slot indices.
+    struct Slot {
+        std::mutex mutex;                      // Serializes requests on the session.
+        ATMSession session;
+        std::uint32_t generation;              // Advanced whenever the slot's session ends.
+        SlotState state;
+        std::atomic<std::uint32_t> last_used;  // Tick of the latest request.
+        std::uint32_t bucket;                  // Wheel bucket the slot is filed in.
+        std::uint32_t prev;                    // Bucket neighbors; a free slot keeps the next free one in next.
+        std::uint32_t next;
+
+        Slot() : generation(1), state(SlotState::Free), last_used(0), bucket(0), prev(NO_SLOT), next(NO_SLOT) {}
+    };
+
+    static const std::uint32_t NO_SLOT = 0xFFFFFFFFu;
+
+    BankSystem& bank;
+    SessionConfig config;
+    std::chrono::steady_clock::time_point started;
+    std::uint32_t timeout_ticks;
+    std::unique_ptr<Slot[]> slots;
+    std::size_t slot_count;
+
+    mutable std::mutex wheel_mutex;   // Guards the wheel, the free list, slot states and the counters below.
+    std::vector<std::uint32_t> wheel; // First slot of each bucket; a power of two of buckets.
+    std::uint32_t wheel_tick;         // Every bucket due up to this tick has been handled.
+    std::uint32_t free_head;
+    std::size_t open_count;
+    std::uint64_t opened;
+    std::uint64_t closed;
+    std::uint64_t expired;
+    std::uint64_t rejected;
+
+    // Returns the current tick.
+    std::uint32_t now_tick() const;
+
+    // Locks the session's slot and runs request(controller, session) on a
+    // controller resumed on it, or returns TxError::SessionExpired.
+    template <typename T, typename Request>
+    Result<T> run(SessionHandle handle, Request request);
+
+    // Files a slot in the bucket of tick due. Needs wheel_mutex.
+    void file(std::uint32_t index, std::uint32_t due);
+
+    // Takes a slot off its bucket. Needs wheel_mutex.
+    void unlink(std::uint32_t index);
+
+    // Puts a slot whose session has ended on the free list, advancing its
+    // generation. Needs wheel_mutex and the slot's mutex.
+    void release(std::uint32_t index);
+
+    // Handles every bucket due up to now. Returns how many sessions expired. Needs wheel_mutex.
+    std::size_t advance(std::uint32_t now);
+};
+
+#endif // SESSIONMANAGER_H
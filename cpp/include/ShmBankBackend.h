@@ -0,0 +1,82 @@
+#ifndef SHMBANKBACKEND_H
+#define SHMBANKBACKEND_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "BankBackend.h"
+#include "RemoteBankBackend.h"
+#include "ShmTransport.h"
+
+// Client for a ShmBankServer in another process on the same host. The
+// backend claims one channel of the server's shared memory region; submit()
+// encodes the request straight into the next slot of the channel's request
+// ring and publishes it with one store, waking the server only if it is
+// asleep, and a reader thread completes requests as replies appear in the
+// reply ring. All sessions of a process share the channel, so requests
+// submitted while the server is busy are picked up together as one batch.
+// Callbacks run on the reader thread and should be short.
+// If the server shuts down or its process exits, outstanding and later
+// requests fail with TxError::BackendUnavailable.
+class ShmBankBackend : public BankBackend {
+public:
+    // Claims a channel of the region name. max_in_flight bounds the
+    // requests awaiting a reply before submit() blocks, up to SHM_RING_SLOTS.
+    // Throws an exception if the region cannot be opened, the server has
+    // shut down or every channel is in use.
+    explicit ShmBankBackend(const std::string& name, std::size_t max_in_flight = 64);
+
+    ShmBankBackend(const ShmBankBackend&) = delete;
+    ShmBankBackend& operator=(const ShmBankBackend&) = delete;
+
+    // Fails requests still awaiting a reply and gives the channel back.
+    ~ShmBankBackend();
+
+    void submit(const BackendRequest& request, BackendCallback done) override;
+
+    // Retrieves the number of requests awaiting a reply.
+    std::size_t in_flight() const;
+
+private:
+    // A request awaiting its reply, in the pending slot named by the low byte of its ID.
+    struct PendingRequest {
+        BackendCallback done;
+        std::uint64_t id;
+        std::uint64_t card_key; // Reported back if the request fails.
+    };
+
+    ShmRegion* region;
+    ShmChannel* channel;
+
+    mutable std::mutex pending_mutex;
+    std::condition_variable window; // Signaled when a request completes or the server goes away.
+    std::vector<PendingRequest> pending;
+    std::vector<std::size_t> free_slots; // Pending slots not in use.
+    std::uint64_t next_sequence;
+    bool closed;
+
+    std::mutex write_mutex; // Serializes writers of the request ring.
+    std::atomic<bool> stopping;
+    std::thread reader;
+
+    // Reader thread body: completes requests as their replies arrive.
+    void read_replies();
+
+    // Marks the backend closed and fails everything still pending.
+    void fail_pending();
+};
+
+// Connects to a bank daemon (see tools/atm_bankd.cpp) over shared memory
+// if region_name can be opened and has a free channel, and otherwise over
+// the Unix domain socket in socket_config, e.g. from another container.
+// Throws an exception if neither can be reached.
+std::unique_ptr<BankBackend> connect_bank_daemon(const std::string& region_name,
+                                                 const RemoteBackendConfig& socket_config);
+
+#endif // SHMBANKBACKEND_H
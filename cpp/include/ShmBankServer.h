@@ -0,0 +1,79 @@
+#ifndef SHMBANKSERVER_H
+#define SHMBANKSERVER_H
+
+#include <string>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "BankBackend.h"
+#include "ShmTransport.h"
+
+class BankSystem;
+
+// Serves a BankSystem to ShmBankBackend clients in other processes through
+// a shared memory region (see ShmTransport.h). One poller thread drains
+// every channel's request ring in turn: all the requests a channel has
+// queued since the last pass are executed as one batch, their replies are
+// written straight into the reply ring and the client is woken once per
+// batch, and only if it is asleep. PIN checks run on the bank's verifier
+// pool, so a login never holds up the other requests of its batch.
+// Channels of clients that exit, or die without releasing them, are reset
+// and freed for new clients.
+class ShmBankServer {
+public:
+    // Creates the region name (e.g. "/atm_bank") and starts serving.
+    // Throws an exception if the region cannot be created.
+    ShmBankServer(BankSystem& bank, const std::string& name);
+
+    ShmBankServer(const ShmBankServer&) = delete;
+    ShmBankServer& operator=(const ShmBankServer&) = delete;
+
+    // Stops serving, tells every client the server is gone and removes the region's name.
+    ~ShmBankServer();
+
+    // Retrieves the number of requests answered so far.
+    std::uint64_t requests_served() const { return served.load(std::memory_order_relaxed); }
+
+    // Retrieves the number of batches executed; requests_served() divided
+    // by it is the mean batch size.
+    std::uint64_t batches_served() const { return batches.load(std::memory_order_relaxed); }
+
+private:
+    LocalBankBackend backend; // Runs PIN checks on the verifier pool; holds the sessions.
+    std::string name;
+    ShmRegion* region;
+    std::mutex reply_mutexes[SHM_MAX_CHANNELS]; // Keep replies from the poller and verifier threads whole.
+
+    std::mutex async_mutex;
+    std::condition_variable async_done;
+    std::size_t async_pending; // PIN checks whose reply is still to be written.
+
+    std::atomic<bool> stopping;
+    std::atomic<std::uint64_t> served;
+    std::atomic<std::uint64_t> batches;
+    std::thread poller;
+
+    // Poller thread body: serves every channel until stopped, sleeping when all are idle.
+    void run();
+
+    // Executes the requests queued on one channel. Returns how many there were.
+    std::size_t serve_channel(std::size_t index);
+
+    // Writes a reply into a channel's reply ring unless the channel has
+    // since been reset for another client.
+    void put_reply(std::size_t index, std::uint32_t generation, std::uint64_t id, const BackendReply& reply);
+
+    // Wakes a channel's client if it is asleep.
+    void notify_client(ShmChannel& channel);
+
+    // Empties both rings of a channel given up by its client and frees it.
+    void reset_channel(std::size_t index);
+
+    // Marks channels whose client process no longer exists for reset.
+    void reclaim_abandoned();
+};
+
+#endif // SHMBANKSERVER_H
@@ -0,0 +1,90 @@
+#ifndef SHMTRANSPORT_H
+#define SHMTRANSPORT_H
+
+#include <string>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "BackendProtocol.h"
+
+// Shared memory layout used by ShmBankServer and ShmBankBackend to carry
+// BackendProtocol frames between processes on one host without a system
+// call per request. The server creates a POSIX shared memory region split
+// into channels; each client process claims one channel, which holds a
+// request ring (client to server) and a reply ring (server to client).
+// Frames are encoded and decoded in place in the ring slots. Each ring has
+// one producer and one consumer, so a frame is published with a single
+// release store of the producer position. A side that finds nothing to do
+// sleeps on a futex in the region and is woken only if it said it would
+// sleep, so while both sides are busy no system calls are made at all.
+
+const std::size_t SHM_RING_SLOTS = 256;  // Frames per ring; a power of two.
+const std::size_t SHM_MAX_CHANNELS = 64; // Client processes served at once.
+
+// Ring of fixed-size frames with one producer and one consumer. Positions
+// only grow; a position's slot is position % SHM_RING_SLOTS.
+template <std::size_t FrameSize>
+struct ShmFrameRing {
+    alignas(64) std::atomic<std::uint64_t> head; // Next frame to consume; written by the consumer.
+    alignas(64) std::atomic<std::uint64_t> tail; // Next frame to produce; written by the producer.
+    alignas(64) char frames[SHM_RING_SLOTS][FrameSize];
+
+    // Returns the slot of a position.
+    char* frame(std::uint64_t position) { return frames[position % SHM_RING_SLOTS]; }
+};
+
+// Lifecycle of a channel.
+enum class ShmChannelState : std::uint32_t {
+    Free = 0,      // Available to a client.
+    Claimed = 1,   // In use by the client in owner.
+    Releasing = 2  // Given up by its client; the server resets it and frees it.
+};
+
+// The two rings of one client process and the futex its reader sleeps on.
+struct ShmChannel {
+    std::atomic<std::uint32_t> state;          // A ShmChannelState.
+    std::atomic<std::uint32_t> owner;          // Process ID of the client.
+    std::atomic<std::uint32_t> generation;     // Advanced on every reset, so late replies for a former client are dropped.
+    std::atomic<std::uint32_t> reply_doorbell; // Futex word; bumped by the server to wake the client.
+    std::atomic<std::uint32_t> client_waiting; // Set while the client sleeps or is about to.
+    ShmFrameRing<BACKEND_REQUEST_SIZE> requests;
+    ShmFrameRing<BACKEND_REPLY_SIZE> replies;
+};
+
+// The whole shared memory region.
+struct ShmRegion {
+    std::atomic<std::uint64_t> magic; // Stored last (release) by the server, once the region is initialized.
+    std::uint32_t version;  // Layout version.
+    std::uint32_t channel_count;
+    std::atomic<std::uint32_t> server_pid;
+    std::atomic<std::uint32_t> closed;         // Set when the server shuts down.
+    std::atomic<std::uint32_t> doorbell;       // Futex word; bumped by clients to wake the server.
+    std::atomic<std::uint32_t> server_waiting; // Set while the server sleeps or is about to.
+    ShmChannel channels[SHM_MAX_CHANNELS];
+};
+
+// Creates a region named name (e.g. "/atm_bank"), replacing a stale one
+// left by an earlier server, and maps it. Only the same user may open it.
+// Throws an exception on failure.
+ShmRegion* create_shm_region(const std::string& name);
+
+// Maps an existing region. Throws an exception if there is none or it was
+// created by an incompatible server.
+ShmRegion* open_shm_region(const std::string& name);
+
+// Unmaps a region.
+void unmap_shm_region(ShmRegion* region);
+
+// Removes a region's name; processes that still map it keep their mapping.
+void remove_shm_region(const std::string& name);
+
+// Sleeps until word no longer holds expected, a wake, or the timeout.
+void shm_futex_wait(std::atomic<std::uint32_t>& word, std::uint32_t expected, int timeout_ms);
+
+// Bumps word and wakes every process sleeping on it.
+void shm_futex_wake(std::atomic<std::uint32_t>& word);
+
+// Returns true if a process with the given ID exists.
+bool shm_process_alive(std::uint32_t pid);
+
+#endif // SHMTRANSPORT_H
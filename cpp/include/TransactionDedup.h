@@ -0,0 +1,140 @@
+#ifndef TRANSACTIONDEDUP_H
+#define TRANSACTIONDEDUP_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "Ledger.h"
+
+// Returns the current time in milliseconds on the monotonic clock the cache uses.
+std::int64_t dedup_clock_ms();
+
+// One client request, identified by the ATM that sent it and the ID it chose.
+// The remaining fields tell a retry apart from a different request that
+// reuses the ID.
+struct DedupRequest {
+    std::uint32_t atm_id;
+    std::uint64_t transaction_id;
+    LedgerEntryType type;
+    std::uint64_t account_key;
+    int amount;
+};
+
+// What begin() found for a request.
+enum class DedupStatus : std::uint8_t {
+    New,      // First time seen; the caller runs it, then calls complete() or abandon().
+    Replayed, // Already completed; the caller returns the recorded balance.
+    Conflict  // The ID was completed for a different request.
+};
+
+// Settings of a TransactionDedupCache.
+struct DedupConfig {
+    std::chrono::milliseconds ttl; // How long a completed request is remembered.
+    std::size_t capacity;          // Requests remembered at most.
+
+    DedupConfig() : ttl(std::chrono::minutes(10)), capacity(65536) {}
+};
+
+// Counters of a TransactionDedupCache.
+struct DedupStats {
+    std::size_t capacity;     // Slots; fixed at construction.
+    std::size_t entries;      // Requests running or remembered.
+    std::uint64_t started;    // Requests seen for the first time.
+    std::uint64_t replays;    // Retries answered with the recorded result.
+    std::uint64_t conflicts;  // IDs reused for a different request.
+    std::uint64_t waits;      // Times a caller waited for a running request or a free slot.
+    std::uint64_t expirations; // Completed requests whose slot was reused after the TTL.
+    std::uint64_t evictions;  // Completed requests displaced before the TTL because their set was full.
+};
+
+// Bounded cache of recent client transaction IDs, so that a retried deposit
+// or withdrawal returns the first attempt's result instead of running again.
+//
+// Requests are spread over sets of a few slots, each set guarded by one of
+// a fixed number of striped locks, so a lookup is one hash and a scan of
+// one set. A request is recorded as running before it executes; a retry
+// that arrives meanwhile waits for it rather than running a second time. A
+// completed request is remembered for the TTL and its slot is reused after
+// that. If every slot of a set is taken, the completed request closest to
+// expiry is evicted and counted; running requests are never evicted.
+// Memory is fixed at construction. All methods are thread-safe.
+class TransactionDedupCache {
+public:
+    static const std::size_t WAYS = 8; // Slots per set.
+
+    // Constructor for a cache holding at least config.capacity requests.
+    // Throws an exception if the TTL or the capacity is not positive.
+    explicit TransactionDedupCache(const DedupConfig& config = DedupConfig());
+
+    TransactionDedupCache(const TransactionDedupCache&) = delete;
+    TransactionDedupCache& operator=(const TransactionDedupCache&) = delete;
+
+    // Looks the request up. Returns DedupStatus::New and records it as running
+    // if its ID is unknown, DedupStatus::Replayed with the recorded balance if
+    // it already completed, or DedupStatus::Conflict if the ID belongs to a
+    // different request. Waits while the same ID is running elsewhere.
+    DedupStatus begin(const DedupRequest& request, int& balance, std::int64_t now_ms = dedup_clock_ms());
+
+    // Records the result of a request begin() returned New for.
+    void complete(const DedupRequest& request, int balance, std::int64_t now_ms = dedup_clock_ms());
+
+    // Forgets a request begin() returned New for, e.g. because it failed
+    // without changing anything, so a retry runs again.
+    void abandon(const DedupRequest& request);
+
+    // Retrieves the counters; entries are counted as of now_ms.
+    DedupStats stats(std::int64_t now_ms = dedup_clock_ms()) const;
+
+    // Retrieves the settings.
+    const DedupConfig& get_config() const { return config; }
+
+private:
+    enum class SlotState : std::uint8_t { Empty, Running, Done };
+
+    // One remembered request; 40 bytes.
+    struct Slot {
+        std::uint64_t transaction_id;
+        std::uint64_t account_key;
+        std::int64_t expires_ms; // For Done slots.
+        std::uint32_t atm_id;
+        std::int32_t amount;
+        std::int32_t balance;    // For Done slots.
+        LedgerEntryType type;
+        SlotState state;
+    };
+
+    // A lock stripe and the condition running requests signal when they finish.
+    struct Stripe {
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    static const std::size_t LOCK_STRIPES = 64;
+
+    DedupConfig config;
+    std::size_t set_mask;
+    std::vector<Slot> slots;
+    std::unique_ptr<Stripe[]> stripes;
+    std::atomic<std::uint64_t> started;
+    std::atomic<std::uint64_t> replays;
+    std::atomic<std::uint64_t> conflicts;
+    std::atomic<std::uint64_t> waits;
+    std::atomic<std::uint64_t> expirations;
+    std::atomic<std::uint64_t> evictions;
+
+    // Returns the index of the first slot of a request's set.
+    std::size_t set_for(std::uint32_t atm_id, std::uint64_t transaction_id) const;
+
+    // Returns the lock stripe guarding the set that starts at slot first.
+    Stripe& stripe_for(std::size_t first) const;
+
+    // Returns the slot holding the request's ID in the set starting at first, or null. Requires the stripe lock.
+    Slot* find(std::size_t first, const DedupRequest& request);
+};
+
+#endif // TRANSACTIONDEDUP_H
@@ -4,6 +4,7 @@
 #include <string>
 
 // Logs a message with an optional log level, optionally writes to a log file.
+// The call only queues the message; see Logger for the asynchronous writer.
 void logMessage(const std::string& message, const std::string& level = "INFO", const std::string& logFile = "");
 
 #endif // UTILITY_H
@@ -1,97 +1,525 @@
 #include "ATMController.h"
 #include <stdexcept>
-#include <iostream> // For optional logging
+#include "Logger.h"
+#include "Metrics.h"
+
+namespace {
+
+// Gives back what a withdrawal reserved, its notes and its share of the
+// account's daily limit, unless the withdrawal went through.
+class WithdrawalHolds {
+public:
+    WithdrawalHolds() : dispenser(nullptr), limits(nullptr), account_key(0), amount(0) {}
+
+    ~WithdrawalHolds() {
+        if (dispenser != nullptr) {
+            dispenser->release(plan);
+        }
+        if (limits != nullptr) {
+            limits->release_withdrawal(account_key, amount);
+        }
+    }
+
+    // Takes charge of notes reserved from dispenser.
+    void hold_notes(CashDispenser& from, const DispensePlan& reserved) {
+        dispenser = &from;
+        plan = reserved;
+    }
+
+    // Takes charge of an amount counted against an account's daily limit.
+    void hold_allowance(TransactionLimits& from, std::uint64_t key, int reserved) {
+        limits = &from;
+        account_key = key;
+        amount = reserved;
+    }
+
+    // Keeps everything reserved: the cash is being dispensed.
+    void commit() {
+        dispenser = nullptr;
+        limits = nullptr;
+    }
+
+private:
+    CashDispenser* dispenser;
+    DispensePlan plan;
+    TransactionLimits* limits;
+    std::uint64_t account_key;
+    int amount;
+};
+
+// Forgets a request with a transaction ID unless it completed, so a retry of
+// a failed attempt runs again.
+class DedupTicket {
+public:
+    DedupTicket() : cache(nullptr) {}
+
+    ~DedupTicket() {
+        if (cache != nullptr) {
+            cache->abandon(request);
+        }
+    }
+
+    // Takes charge of a request the cache recorded as running.
+    void hold(TransactionDedupCache& from, const DedupRequest& running) {
+        cache = &from;
+        request = running;
+    }
+
+    // Records the result for retries.
+    void complete(int balance) {
+        if (cache != nullptr) {
+            cache->complete(request, balance);
+            cache = nullptr;
+        }
+    }
+
+private:
+    TransactionDedupCache* cache;
+    DedupRequest request;
+};
+
+// Looks a request up in the bank's deduplication cache. Returns true if the
+// caller is done: result then holds the first attempt's balance or an error.
+// Otherwise the ticket holds the request as running.
+// Throws std::logic_error if the bank does not track transaction IDs.
+bool replay_or_hold(BankSystem& bank, const DedupRequest& request, DedupTicket& ticket, Result<int>& result) {
+    TransactionDedupCache* cache = bank.get_dedup_cache();
+    if (cache == nullptr) {
+        throw std::logic_error("The bank does not track transaction IDs.");
+    }
+    int balance = 0;
+    switch (cache->begin(request, balance)) {
+    case DedupStatus::Replayed:
+        result = balance;
+        return true;
+    case DedupStatus::Conflict:
+        result = TxError::TransactionIdReused;
+        return true;
+    case DedupStatus::New:
+        break;
+    }
+    ticket.hold(*cache, request);
+    return false;
+}
+
+// Identifies an account in the deduplication cache, so that a card's
+// accounts never share a cached result.
+std::uint64_t account_key(const Account* account) {
+    return static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(account));
+}
+
+// Identifies the selected account in the withdrawal limits: the card key for
+// the card's own account, its ID's key for a linked one.
+std::uint64_t withdrawal_limit_key(const ATMSession& session) {
+    if (session.current_account == session.primary_account) {
+        return session.card.get_key();
+    }
+    return linked_account_limit_key(session.current_account->get_account_id());
+}
+
+} // namespace
 
 // Constructor initializes the ATMController with a given bank system.
-ATMController::ATMController(BankSystem& bank_system)
-    : bank_system(bank_system), current_card(nullptr), current_account(nullptr), authenticated(false) {}
+ATMController::ATMController(BankSystem& bank_system, std::uint32_t atm_id)
+    : bank_system(bank_system), session(&own_session), atm_id(atm_id) {}
+
+// Serves another customer's session.
+void ATMController::resume(ATMSession& resumed) {
+    session = &resumed;
+}
+
+// Goes back to serving the controller's own session.
+void ATMController::suspend() {
+    session = &own_session;
+}
+
+// Retrieves the ID of the ATM.
+std::uint32_t ATMController::get_atm_id() const {
+    return atm_id;
+}
+
+// Loads the cassettes, replacing any loaded before.
+void ATMController::load_cash(const std::vector<Cassette>& cassettes, int max_notes) {
+    dispenser.reset(new CashDispenser(cassettes, max_notes));
+}
+
+// Retrieves the cash inventory, or null if no cash is loaded.
+CashDispenser* ATMController::get_cash_dispenser() const {
+    return dispenser.get();
+}
 
 // Simulates inserting a card into the ATM.
-void ATMController::insert_card(Card& card) {
-    if (current_card != nullptr) {
-        throw std::runtime_error("A card is already inserted.");
-    }
-    current_card = &card;
-    authenticated = false;
-    current_account = nullptr;
+void ATMController::insert_card(const Card& card) {
+    MetricsTimer timer(MetricOp::AtmInsertCard);
+    try {
+        if (session->card_inserted) {
+            throw std::runtime_error("A card is already inserted.");
+        }
+        session->card = card;
+        session->card_inserted = true;
+        session->authenticated = false;
+        session->current_account = nullptr;
+        session->primary_account = nullptr;
 
-    // Optional logging
-    std::cout << "[INFO] Card inserted: " << card.get_card_number() << std::endl;
+        // Optional logging
+        ATM_LOG_INFO("Card inserted: " << card.get_card_number());
+    } catch (...) {
+        timer.fail();
+        throw;
+    }
 }
 
 // Simulates ejecting the currently inserted card.
 void ATMController::eject_card() {
-    if (current_card == nullptr) {
-        throw std::runtime_error("No card to eject.");
+    MetricsTimer timer(MetricOp::AtmEjectCard);
+    try {
+        if (!session->card_inserted) {
+            throw std::runtime_error("No card to eject.");
+        }
+
+        // Optional logging
+        ATM_LOG_INFO("Card ejected: " << session->card.get_card_number());
+
+        session->card_inserted = false;
+        session->authenticated = false;
+        session->current_account = nullptr;
+        session->primary_account = nullptr;
+    } catch (...) {
+        timer.fail();
+        throw;
     }
+}
 
-    // Optional logging
-    std::cout << "[INFO] Card ejected: " << current_card->get_card_number() << std::endl;
+// Validates the PIN for the inserted card without throwing on a wrong PIN.
+Result<void> ATMController::try_enter_pin(const std::string& pin) {
+    MetricsTimer timer(MetricOp::AtmEnterPin);
+    try {
+        if (!session->card_inserted) {
+            return timer.fail(TxError::NoCard);
+        }
+        // The attempt counts as a failure until the PIN proves right.
+        TransactionLimits* limits = bank_system.get_limits();
+        if (limits != nullptr) {
+            Result<void> allowed = limits->try_atm_transaction(atm_id);
+            if (allowed) {
+                allowed = limits->try_pin_attempt(session->card.get_key());
+            }
+            if (!allowed) {
+                return timer.fail(allowed.error());
+            }
+        }
+        Account* account = bank_system.authenticate(session->card, pin);
+        if (account == nullptr) {
+            return timer.fail(TxError::WrongPin);
+        }
+        if (limits != nullptr) {
+            limits->pin_accepted(session->card.get_key());
+        }
+        session->authenticated = true;
+        session->current_account = account;
+        session->primary_account = account;
 
-    current_card = nullptr;
-    authenticated = false;
-    current_account = nullptr;
+        // Optional logging
+        ATM_LOG_INFO("PIN validated for card: " << session->card.get_card_number());
+        return Result<void>();
+    } catch (...) {
+        timer.fail();
+        throw;
+    }
 }
 
 // Validates the PIN for the inserted card.
 void ATMController::enter_pin(const std::string& pin) {
-    if (current_card == nullptr) {
-        throw std::runtime_error("No card inserted.");
+    try_enter_pin(pin).value();
+}
+
+// Selects the account keyed by the card number.
+void ATMController::select_account() {
+    MetricsTimer timer(MetricOp::AtmSelectAccount);
+    try {
+        if (!session->authenticated) {
+            throw std::runtime_error("PIN not validated.");
+        }
+        if (session->primary_account == nullptr) {
+            throw std::runtime_error("No account associated with this card.");
+        }
+        session->current_account = session->primary_account;
+
+        // Optional logging
+        ATM_LOG_INFO("Account selected: " << session->current_account->get_account_id());
+    } catch (...) {
+        timer.fail();
+        throw;
     }
-    if (bank_system.validate_pin(*current_card, pin)) {
-        authenticated = true;
-        current_account = &bank_system.get_account(*current_card);
+}
+
+// Selects another account of the current card without throwing on a routine failure.
+Result<void> ATMController::try_select_account(const std::string& account_id) {
+    MetricsTimer timer(MetricOp::AtmSelectAccount);
+    try {
+        if (!session->authenticated) {
+            return timer.fail(TxError::NoAccountSelected);
+        }
+        Account* account = find_card_account(account_id);
+        if (account == nullptr) {
+            return timer.fail(TxError::UnknownAccount);
+        }
+        session->current_account = account;
 
         // Optional logging
-        std::cout << "[INFO] PIN validated for card: " << current_card->get_card_number() << std::endl;
-    } else {
-        throw std::invalid_argument("Invalid PIN.");
+        ATM_LOG_INFO("Account selected: " << account_id);
+        return Result<void>();
+    } catch (...) {
+        timer.fail();
+        throw;
     }
 }
 
-// Selects the account associated with the current card after PIN validation.
-void ATMController::select_account() {
-    if (!authenticated) {
+// Selects another account of the current card.
+void ATMController::select_account(const std::string& account_id) {
+    try_select_account(account_id).value();
+}
+
+// Retrieves the IDs of the current card's accounts.
+std::vector<std::string> ATMController::list_accounts() const {
+    if (!session->authenticated) {
         throw std::runtime_error("PIN not validated.");
     }
-    if (current_account == nullptr) {
-        throw std::runtime_error("No account associated with this card.");
+    std::vector<std::string> ids;
+    for (const Account* account : bank_system.get_accounts(session->card)) {
+        ids.push_back(account->get_account_id());
     }
+    return ids;
+}
 
-    // Optional logging
-    std::cout << "[INFO] Account selected: " << current_account->get_account_id() << std::endl;
+// Finds one of the current card's accounts by ID.
+Account* ATMController::find_card_account(const std::string& account_id) const {
+    for (Account* account : bank_system.get_accounts(session->card)) {
+        if (account->get_account_id() == account_id) {
+            return account;
+        }
+    }
+    return nullptr;
 }
 
 // Displays the balance of the selected account.
 int ATMController::view_balance() const {
-    if (current_account == nullptr) {
-        throw std::runtime_error("Account not selected.");
+    MetricsTimer timer(MetricOp::AtmViewBalance);
+    try {
+        if (session->current_account == nullptr) {
+            throw std::runtime_error("Account not selected.");
+        }
+        return session->current_account->get_balance();
+    } catch (...) {
+        timer.fail();
+        throw;
+    }
+}
+
+// Deposits into the selected account without throwing on a routine failure.
+Result<int> ATMController::try_deposit(int amount) {
+    return run_deposit(amount, nullptr);
+}
+
+// Deposits once per transaction ID.
+Result<int> ATMController::try_deposit(int amount, std::uint64_t transaction_id) {
+    return run_deposit(amount, &transaction_id);
+}
+
+// Deposits, first consulting the deduplication cache if given a transaction ID.
+Result<int> ATMController::run_deposit(int amount, const std::uint64_t* transaction_id) {
+    MetricsTimer timer(MetricOp::AtmDeposit);
+    try {
+        if (session->current_account == nullptr) {
+            return timer.fail(TxError::NoAccountSelected);
+        }
+        DedupTicket ticket;
+        if (transaction_id != nullptr) {
+            DedupRequest request = {atm_id, *transaction_id, LedgerEntryType::Deposit,
+                                    account_key(session->current_account), amount};
+            Result<int> replayed(0);
+            if (replay_or_hold(bank_system, request, ticket, replayed)) {
+                return replayed ? replayed : timer.fail(replayed.error());
+            }
+        }
+        TransactionLimits* limits = bank_system.get_limits();
+        if (limits != nullptr) {
+            Result<void> allowed = limits->try_atm_transaction(atm_id);
+            if (!allowed) {
+                return timer.fail(allowed.error());
+            }
+        }
+        LedgerAtmScope scope(atm_id);
+        // Fails before the credit, or with NotDurable after it once the
+        // journal has failed, which refuses any retry; either way a failed
+        // ticket is safe to retry.
+        Result<int> new_balance = session->current_account->try_deposit(amount);
+        if (!new_balance) {
+            return timer.fail(new_balance.error());
+        }
+        ticket.complete(new_balance.value());
+
+        // Optional logging
+        ATM_LOG_INFO("Deposit made. Amount: " << amount << ", New Balance: " << new_balance.value());
+
+        return new_balance;
+    } catch (...) {
+        timer.fail();
+        throw;
     }
-    return current_account->get_balance();
 }
 
 // Deposits a specified amount into the selected account.
 int ATMController::deposit(int amount) {
-    if (current_account == nullptr) {
-        throw std::runtime_error("Account not selected.");
-    }
-    int new_balance = current_account->deposit(amount);
+    return try_deposit(amount).value();
+}
 
-    // Optional logging
-    std::cout << "[INFO] Deposit made. Amount: " << amount << ", New Balance: " << new_balance << std::endl;
+// Deposits a specified amount once per transaction ID.
+int ATMController::deposit(int amount, std::uint64_t transaction_id) {
+    return try_deposit(amount, transaction_id).value();
+}
+
+// Withdraws from the selected account without throwing on a routine failure.
+Result<int> ATMController::try_withdraw(int amount) {
+    return run_withdraw(amount, nullptr);
+}
 
-    return new_balance;
+// Withdraws once per transaction ID.
+Result<int> ATMController::try_withdraw(int amount, std::uint64_t transaction_id) {
+    return run_withdraw(amount, &transaction_id);
+}
+
+// Withdraws, first consulting the deduplication cache if given a transaction ID.
+Result<int> ATMController::run_withdraw(int amount, const std::uint64_t* transaction_id) {
+    MetricsTimer timer(MetricOp::AtmWithdraw);
+    try {
+        if (session->current_account == nullptr) {
+            return timer.fail(TxError::NoAccountSelected);
+        }
+        DedupTicket ticket;
+        if (transaction_id != nullptr) {
+            DedupRequest request = {atm_id, *transaction_id, LedgerEntryType::Withdrawal,
+                                    account_key(session->current_account), amount};
+            Result<int> replayed(0);
+            if (replay_or_hold(bank_system, request, ticket, replayed)) {
+                return replayed ? replayed : timer.fail(replayed.error());
+            }
+        }
+        LedgerAtmScope scope(atm_id);
+
+        // Reserve the daily allowance and, with cash loaded, the notes first
+        // so no other withdrawal can take them; both go back unless the debit
+        // goes through.
+        WithdrawalHolds holds;
+        TransactionLimits* limits = bank_system.get_limits();
+        if (limits != nullptr) {
+            Result<void> allowed = limits->try_atm_transaction(atm_id);
+            if (!allowed) {
+                return timer.fail(allowed.error());
+            }
+            const std::uint64_t limit_key = withdrawal_limit_key(*session);
+            allowed = limits->try_reserve_withdrawal(limit_key, amount);
+            if (!allowed) {
+                return timer.fail(allowed.error());
+            }
+            holds.hold_allowance(*limits, limit_key, amount);
+        }
+        if (dispenser != nullptr) {
+            Result<DispensePlan> plan = dispenser->try_reserve(amount);
+            if (!plan) {
+                return timer.fail(plan.error());
+            }
+            holds.hold_notes(*dispenser, plan.value());
+        }
+        // try_withdraw() fails before the debit, a failed journal included,
+        // so on failure the holds and the ticket can be let go. NotDurable
+        // comes after the debit: the withdrawal stands, so its notes are
+        // dispensed and its allowance stays taken, while the ticket is let go
+        // because the failed journal refuses a retry anyway.
+        Result<int> new_balance = session->current_account->try_withdraw(amount);
+        if (new_balance.error() == TxError::NotDurable) {
+            holds.commit();
+        }
+        if (!new_balance) {
+            return timer.fail(new_balance.error());
+        }
+        holds.commit();
+        ticket.complete(new_balance.value());
+
+        // Optional logging
+        ATM_LOG_INFO("Withdrawal made. Amount: " << amount << ", New Balance: " << new_balance.value());
+
+        return new_balance;
+    } catch (...) {
+        timer.fail();
+        throw;
+    }
 }
 
 // Withdraws a specified amount from the selected account.
 int ATMController::withdraw(int amount) {
-    if (current_account == nullptr) {
-        throw std::runtime_error("Account not selected.");
+    return try_withdraw(amount).value();
+}
+
+// Withdraws a specified amount once per transaction ID.
+int ATMController::withdraw(int amount, std::uint64_t transaction_id) {
+    return try_withdraw(amount, transaction_id).value();
+}
+
+// Transfers between two accounts of the current card without throwing on a routine failure.
+Result<int> ATMController::try_transfer(const std::string& to_account_id, int amount) {
+    MetricsTimer timer(MetricOp::AtmTransfer);
+    try {
+        if (session->current_account == nullptr) {
+            return timer.fail(TxError::NoAccountSelected);
+        }
+        Account* to = find_card_account(to_account_id);
+        if (to == nullptr) {
+            return timer.fail(TxError::UnknownAccount);
+        }
+        TransactionLimits* limits = bank_system.get_limits();
+        if (limits != nullptr) {
+            Result<void> allowed = limits->try_atm_transaction(atm_id);
+            if (!allowed) {
+                return timer.fail(allowed.error());
+            }
+        }
+        LedgerAtmScope scope(atm_id);
+        Result<int> new_balance = session->current_account->try_transfer(*to, amount);
+        if (!new_balance) {
+            return timer.fail(new_balance.error());
+        }
+
+        // Optional logging
+        ATM_LOG_INFO("Transfer made. Amount: " << amount << ", To: " << to_account_id
+                     << ", New Balance: " << new_balance.value());
+
+        return new_balance;
+    } catch (...) {
+        timer.fail();
+        throw;
     }
-    int new_balance = current_account->withdraw(amount);
+}
 
-    // Optional logging
-    std::cout << "[INFO] Withdrawal made. Amount: " << amount << ", New Balance: " << new_balance << std::endl;
+// Transfers between two accounts of the current card.
+int ATMController::transfer(const std::string& to_account_id, int amount) {
+    return try_transfer(to_account_id, amount).value();
+}
 
-    return new_balance;
+// Retrieves the newest transactions of the selected account.
+std::vector<LedgerEntry> ATMController::mini_statement(std::size_t count) const {
+    MetricsTimer timer(MetricOp::AtmMiniStatement);
+    try {
+        if (session->current_account == nullptr) {
+            throw std::runtime_error("Account not selected.");
+        }
+        const AccountLedger* ledger = session->current_account->get_ledger();
+        if (ledger == nullptr) {
+            throw std::logic_error("The bank keeps no transaction ledger.");
+        }
+        return ledger->last(count);
+    } catch (...) {
+        timer.fail();
+        throw;
+    }
 }
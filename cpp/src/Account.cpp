@@ -1,10 +1,13 @@
 #include "Account.h"
 #include <stdexcept>
-#include <iostream> // For logging (optional)
+#include <functional>
+#include "Journal.h"
+#include "Logger.h"
 
-// Constructor initializes the account with an ID and initial balance.
-Account::Account(const std::string& account_id, int balance)
-    : account_id(account_id), balance(balance) {
+// Constructor initializes the account with an ID, initial balance and update mode.
+Account::Account(const std::string& account_id, int balance, BalanceMode mode)
+    : account_id(account_id), balance(balance), journal(nullptr), ledger(nullptr), mode(mode),
+      snapshot_epoch(nullptr), opened_epoch(0), written_epoch(0), snapshot_balance(0) {
     if (balance < 0) {
         throw std::invalid_argument("Initial balance cannot be negative.");
     }
@@ -12,41 +15,241 @@ Account::Account(const std::string& account_id, int balance)
 
 // Deposits a specified amount into the account.
 // Returns the updated account balance.
-int Account::deposit(int amount) {
+Result<int> Account::try_deposit(int amount) {
     if (amount <= 0) {
-        throw std::invalid_argument("Deposit amount must be positive.");
+        return TxError::InvalidAmount;
+    }
+    int new_balance;
+    std::uint64_t lsn = 0;
+    if (lock_free()) {
+        new_balance = balance.fetch_add(amount, std::memory_order_acq_rel) + amount;
+    } else {
+        std::lock_guard<std::mutex> lock(mutex);
+        new_balance = balance.load(std::memory_order_relaxed) + amount;
+        if (journal != nullptr) {
+            lsn = journal->try_append(JournalRecordType::Deposit, account_id, amount, new_balance);
+            if (lsn == 0) {
+                return TxError::BackendUnavailable;
+            }
+        }
+        preserve_balance();
+        balance.store(new_balance, std::memory_order_release);
+        if (ledger != nullptr) {
+            record(LedgerEntryType::Deposit, amount, new_balance);
+        }
+    }
+    if (lsn != 0 && !wait_durable(lsn)) { // Group commit: shares one fsync with concurrent mutations.
+        return TxError::NotDurable;
     }
-    balance += amount;
 
     // Log the deposit (optional)
-    std::cout << "[INFO] Deposit: " << amount << " | New Balance: " << balance << std::endl;
+    ATM_LOG_INFO("Deposit: " << amount << " | New Balance: " << new_balance);
 
-    return balance;
+    return new_balance;
 }
 
 // Withdraws a specified amount from the account.
 // Returns the updated account balance.
-int Account::withdraw(int amount) {
+Result<int> Account::try_withdraw(int amount) {
     if (amount <= 0) {
-        throw std::invalid_argument("Withdrawal amount must be positive.");
+        return TxError::InvalidAmount;
+    }
+    int new_balance;
+    std::uint64_t lsn = 0;
+    if (lock_free()) {
+        if (!debit(amount, new_balance)) {
+            return TxError::InsufficientFunds;
+        }
+    } else {
+        std::lock_guard<std::mutex> lock(mutex);
+        int current = balance.load(std::memory_order_relaxed);
+        if (amount > current) {
+            return TxError::InsufficientFunds;
+        }
+        new_balance = current - amount;
+        if (journal != nullptr) {
+            lsn = journal->try_append(JournalRecordType::Withdrawal, account_id, amount, new_balance);
+            if (lsn == 0) {
+                return TxError::BackendUnavailable;
+            }
+        }
+        preserve_balance();
+        balance.store(new_balance, std::memory_order_release);
+        if (ledger != nullptr) {
+            record(LedgerEntryType::Withdrawal, amount, new_balance);
+        }
     }
-    if (amount > balance) {
-        throw std::invalid_argument("Insufficient balance.");
+    if (lsn != 0 && !wait_durable(lsn)) {
+        return TxError::NotDurable;
     }
-    balance -= amount;
 
     // Log the withdrawal (optional)
-    std::cout << "[INFO] Withdrawal: " << amount << " | New Balance: " << balance << std::endl;
+    ATM_LOG_INFO("Withdrawal: " << amount << " | New Balance: " << new_balance);
+
+    return new_balance;
+}
+
+// Moves amount to another account, locking both in address order unless both are lock-free.
+Result<int> Account::try_transfer(Account& to, int amount) {
+    if (&to == this) {
+        return TxError::SameAccount;
+    }
+    if (amount <= 0) {
+        return TxError::InvalidAmount;
+    }
+    int from_balance;
+    int to_balance;
+    std::uint64_t lsn = 0;
+    if (lock_free() && to.lock_free()) {
+        if (!debit(amount, from_balance)) {
+            return TxError::InsufficientFunds;
+        }
+        to_balance = to.balance.fetch_add(amount, std::memory_order_acq_rel) + amount;
+    } else {
+        // A global order on the two locks rules out a cycle between opposing transfers.
+        bool this_first = std::less<Account*>()(this, &to);
+        std::lock_guard<std::mutex> first_lock(this_first ? mutex : to.mutex);
+        std::lock_guard<std::mutex> second_lock(this_first ? to.mutex : mutex);
+        if (journal != nullptr) {
+            // A journaled account is never lock-free, so under both locks the
+            // balances to record are known before anything changes.
+            int current = balance.load(std::memory_order_relaxed);
+            if (amount > current) {
+                return TxError::InsufficientFunds;
+            }
+            lsn = journal->try_append_transfer(account_id, to.account_id, amount, current - amount,
+                                               to.balance.load(std::memory_order_relaxed) + amount);
+            if (lsn == 0) {
+                return TxError::BackendUnavailable;
+            }
+        }
+        // One epoch, read once under both locks, for both sides, so a snapshot
+        // has the transfer in both or neither. The bank may advance it at any
+        // time, so two separate reads could disagree.
+        const std::uint64_t epoch = current_snapshot_epoch();
+        preserve_balance(epoch);
+        to.preserve_balance(epoch);
+        // Atomic updates keep this correct even if one side is lock-free and updated without its lock.
+        if (!debit(amount, from_balance)) {
+            return TxError::InsufficientFunds;
+        }
+        to_balance = to.balance.fetch_add(amount, std::memory_order_acq_rel) + amount;
+        if (ledger != nullptr) {
+            record(LedgerEntryType::TransferOut, amount, from_balance);
+        }
+        if (to.ledger != nullptr) {
+            to.record(LedgerEntryType::TransferIn, amount, to_balance);
+        }
+    }
+    if (lsn != 0 && !wait_durable(lsn)) {
+        return TxError::NotDurable;
+    }
+
+    // Log the transfer (optional)
+    ATM_LOG_INFO("Transfer: " << amount << " | To: " << to.account_id << " | New Balance: " << from_balance);
 
-    return balance;
+    return from_balance;
+}
+
+// Transfers through try_transfer() and throws if it fails.
+int Account::transfer(Account& to, int amount) {
+    return try_transfer(to, amount).value();
+}
+
+// Deposits through try_deposit() and throws if it fails.
+int Account::deposit(int amount) {
+    return try_deposit(amount).value();
+}
+
+// Withdraws through try_withdraw() and throws if it fails.
+int Account::withdraw(int amount) {
+    return try_withdraw(amount).value();
 }
 
-// Retrieves the current balance of the account.
+// Retrieves the current balance of the account without taking the lock.
 int Account::get_balance() const {
-    return balance;
+    return balance.load(std::memory_order_acquire);
 }
 
 // Retrieves the account ID.
 std::string Account::get_account_id() const {
     return account_id;
 }
+
+// Retrieves how the account serializes balance updates.
+BalanceMode Account::get_balance_mode() const {
+    return mode;
+}
+
+// Retrieves the account's transaction history, or null without a ledger.
+const AccountLedger* Account::get_ledger() const {
+    return ledger;
+}
+
+// Journal and ledger records carry the resulting balance, so an account
+// that keeps either must append under the same lock that orders its updates.
+// Balance snapshots need every update under the lock as well (see
+// preserve_balance()). All are attached before the account is shared, so
+// reading them here is safe.
+bool Account::lock_free() const {
+    return mode == BalanceMode::LockFree && journal == nullptr && ledger == nullptr && snapshot_epoch == nullptr;
+}
+
+// An update reads the epoch under the lock, and the snapshot reads the
+// account under the same lock, so every update falls wholly before the
+// snapshot (the snapshot sees its result) or after it (the first such
+// update has saved the balance the snapshot needs).
+void Account::preserve_balance() {
+    preserve_balance(current_snapshot_epoch());
+}
+
+// Saves the balance for the given epoch unless an update of it already did.
+void Account::preserve_balance(std::uint64_t epoch) {
+    if (snapshot_epoch == nullptr) {
+        return;
+    }
+    if (written_epoch != epoch) {
+        snapshot_balance = balance.load(std::memory_order_relaxed);
+        written_epoch = epoch;
+    }
+}
+
+// Reads the bank's snapshot epoch, or 0 without balance snapshots.
+std::uint64_t Account::current_snapshot_epoch() const {
+    return snapshot_epoch == nullptr ? 0 : snapshot_epoch->load(std::memory_order_acquire);
+}
+
+// Appends a transaction, stamped with the time and the ATM of the current LedgerAtmScope.
+void Account::record(LedgerEntryType type, int amount, int new_balance) {
+    LedgerEntry entry;
+    entry.timestamp_us = ledger_clock_us();
+    entry.atm_id = LedgerAtmScope::current();
+    entry.type = type;
+    entry.amount = amount;
+    entry.balance = new_balance;
+    ledger->append(entry);
+}
+
+// The update is already applied and visible, so a journal that fails now
+// cannot undo it; the update stands, the failure is logged and the caller
+// is told. Later updates are refused before they change anything.
+bool Account::wait_durable(std::uint64_t lsn) {
+    if (!journal->try_wait_durable(lsn)) {
+        ATM_LOG_ERROR("Journal write failed; update of account " << account_id << " is applied but not durable.");
+        return false;
+    }
+    return true;
+}
+
+// Retries until no other update slipped in between the check and the swap.
+bool Account::debit(int amount, int& new_balance) {
+    int current = balance.load(std::memory_order_acquire);
+    do {
+        if (amount > current) {
+            return false;
+        }
+        new_balance = current - amount;
+    } while (!balance.compare_exchange_weak(current, new_balance, std::memory_order_acq_rel,
+                                            std::memory_order_acquire));
+    return true;
+}
@@ -0,0 +1,133 @@
+#include "BackendProtocol.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+template <typename T>
+void put(char* out, std::size_t offset, const T& value) {
+    std::memcpy(out + offset, &value, sizeof(T));
+}
+
+template <typename T>
+T get(const char* data, std::size_t offset) {
+    T value;
+    std::memcpy(&value, data + offset, sizeof(T));
+    return value;
+}
+
+// Fills a socket address for path, or throws if the path does not fit.
+sockaddr_un unix_address(const std::string& path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Unix socket path is empty or too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    return address;
+}
+
+} // namespace
+
+// Encodes a request.
+void encode_backend_request(std::uint64_t id, const BackendRequest& request, char* out) {
+    if (request.pin.size() > BACKEND_MAX_PIN_LENGTH) {
+        throw std::invalid_argument("PIN is too long for a backend request.");
+    }
+    std::memset(out, 0, BACKEND_REQUEST_SIZE);
+    put(out, 0, id);
+    put(out, 8, static_cast<std::uint8_t>(request.op));
+    put(out, 9, static_cast<std::uint8_t>(request.pin.size()));
+    put(out, 12, request.amount);
+    put(out, 16, request.card_key);
+    std::memcpy(out + 24, request.pin.data(), request.pin.size());
+    put(out, 40, request.session);
+}
+
+// Decodes a request.
+bool decode_backend_request(const char* frame, std::uint64_t& id, BackendRequest& request) {
+    id = get<std::uint64_t>(frame, 0);
+    std::uint8_t op = get<std::uint8_t>(frame, 8);
+    std::uint8_t pin_length = get<std::uint8_t>(frame, 9);
+    if (op < static_cast<std::uint8_t>(BackendOp::Authenticate) ||
+        op > static_cast<std::uint8_t>(BackendOp::EndSession) || pin_length > BACKEND_MAX_PIN_LENGTH) {
+        return false;
+    }
+    request.op = static_cast<BackendOp>(op);
+    request.amount = get<std::int32_t>(frame, 12);
+    request.card_key = get<std::uint64_t>(frame, 16);
+    request.pin.assign(frame + 24, pin_length);
+    request.session = get<std::uint64_t>(frame, 40);
+    return true;
+}
+
+// Encodes a reply.
+void encode_backend_reply(std::uint64_t id, const BackendReply& reply, char* out) {
+    std::memset(out, 0, BACKEND_REPLY_SIZE);
+    put(out, 0, id);
+    put(out, 8, static_cast<std::uint8_t>(reply.error));
+    put(out, 12, reply.balance);
+    put(out, 16, reply.card_key);
+    put(out, 24, reply.session);
+}
+
+// Decodes a reply.
+void decode_backend_reply(const char* frame, std::uint64_t& id, BackendReply& reply) {
+    id = get<std::uint64_t>(frame, 0);
+    reply.error = static_cast<TxError>(get<std::uint8_t>(frame, 8));
+    reply.balance = get<std::int32_t>(frame, 12);
+    reply.card_key = get<std::uint64_t>(frame, 16);
+    reply.session = get<std::uint64_t>(frame, 24);
+}
+
+// Sends the whole buffer without raising SIGPIPE on a closed peer.
+bool send_all(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += sent;
+        size -= static_cast<std::size_t>(sent);
+    }
+    return true;
+}
+
+// Opens a listening Unix domain socket.
+int listen_unix(const std::string& path) {
+    sockaddr_un address = unix_address(path);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to create socket: " + std::string(std::strerror(errno)));
+    }
+    ::unlink(path.c_str()); // A socket file left by an earlier run would make bind fail.
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Unable to listen on " + path + ": " + std::strerror(error));
+    }
+    return fd;
+}
+
+// Connects to a Unix domain socket.
+int connect_unix(const std::string& path) {
+    sockaddr_un address = unix_address(path);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to create socket: " + std::string(std::strerror(errno)));
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Unable to connect to " + path + ": " + std::strerror(error));
+    }
+    return fd;
+}
@@ -0,0 +1,186 @@
+#include "BalanceSnapshot.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include "Card.h"
+#include "Journal.h"
+
+namespace {
+
+// File layout: magic, epoch, time, card count, linked count, the card
+// records (key, balance), the linked records (ID length, ID, card key,
+// balance) and a CRC-32 of everything before it.
+const char BALANCES_MAGIC[8] = {'A', 'T', 'M', 'B', 'A', 'L', 'S', '1'};
+const std::size_t HEADER_SIZE = sizeof(BALANCES_MAGIC) + 8 + 8 + 8 + 8;
+const std::size_t CARD_RECORD_SIZE = 8 + 4;
+const std::size_t MAX_ID_LENGTH = 255;
+
+template <typename T>
+void put(std::vector<char>& out, const T& value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+T get(const char* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+} // namespace
+
+// Creates an empty snapshot.
+BalanceSnapshot::BalanceSnapshot() : sequence(0), taken_at(0) {}
+
+// Retrieves the snapshot's sequence number within its bank.
+std::uint64_t BalanceSnapshot::epoch() const {
+    return sequence;
+}
+
+// Retrieves the instant the snapshot shows.
+std::int64_t BalanceSnapshot::taken_at_us() const {
+    return taken_at;
+}
+
+// Retrieves the number of accounts in the snapshot.
+std::size_t BalanceSnapshot::size() const {
+    return cards.size() + linked.size();
+}
+
+// Retrieves the card accounts, ascending by key.
+const std::vector<BalanceSnapshot::CardBalance>& BalanceSnapshot::card_balances() const {
+    return cards;
+}
+
+// Retrieves the linked accounts, ascending by account ID.
+const std::vector<BalanceSnapshot::LinkedBalance>& BalanceSnapshot::linked_balances() const {
+    return linked;
+}
+
+// Adds up every balance.
+std::int64_t BalanceSnapshot::total_balance() const {
+    std::int64_t total = 0;
+    for (const CardBalance& card : cards) {
+        total += card.balance;
+    }
+    for (const LinkedBalance& account : linked) {
+        total += account.balance;
+    }
+    return total;
+}
+
+// Binary search in whichever list the ID belongs to.
+Result<int> BalanceSnapshot::find(const std::string& account_id) const {
+    std::uint64_t key;
+    if (pack_card_number(account_id, key)) {
+        std::vector<CardBalance>::const_iterator found = std::lower_bound(
+            cards.begin(), cards.end(), key, [](const CardBalance& card, std::uint64_t k) { return card.key < k; });
+        if (found != cards.end() && found->key == key) {
+            return found->balance;
+        }
+        return TxError::UnknownAccount;
+    }
+    std::vector<LinkedBalance>::const_iterator found =
+        std::lower_bound(linked.begin(), linked.end(), account_id,
+                         [](const LinkedBalance& account, const std::string& id) { return account.account_id < id; });
+    if (found != linked.end() && found->account_id == account_id) {
+        return found->balance;
+    }
+    return TxError::UnknownAccount;
+}
+
+// Serializes into memory, then writes a temporary file and renames it into place.
+void BalanceSnapshot::write(const std::string& path) const {
+    std::vector<char> data;
+    data.reserve(HEADER_SIZE + cards.size() * CARD_RECORD_SIZE + 4);
+    data.insert(data.end(), BALANCES_MAGIC, BALANCES_MAGIC + sizeof(BALANCES_MAGIC));
+    put(data, sequence);
+    put(data, taken_at);
+    put(data, static_cast<std::uint64_t>(cards.size()));
+    put(data, static_cast<std::uint64_t>(linked.size()));
+    for (const CardBalance& card : cards) {
+        put(data, card.key);
+        put(data, card.balance);
+    }
+    for (const LinkedBalance& account : linked) {
+        if (account.account_id.size() > MAX_ID_LENGTH) {
+            throw std::invalid_argument("Account ID too long for a balance snapshot: " + account.account_id);
+        }
+        put(data, static_cast<std::uint8_t>(account.account_id.size()));
+        data.insert(data.end(), account.account_id.begin(), account.account_id.end());
+        put(data, account.card_key);
+        put(data, account.balance);
+    }
+    put(data, journal_crc32(data.data(), data.size()));
+
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path.c_str(), std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Cannot open balance snapshot file: " + temp_path);
+        }
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!out) {
+            throw std::runtime_error("Cannot write balance snapshot file: " + temp_path);
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Cannot replace balance snapshot file: " + path);
+    }
+}
+
+// Checks the magic, the checksum and every record length before trusting the contents.
+BalanceSnapshot BalanceSnapshot::read(const std::string& path) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open balance snapshot file: " + path);
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.size() < HEADER_SIZE + 4 ||
+        std::memcmp(data.data(), BALANCES_MAGIC, sizeof(BALANCES_MAGIC)) != 0 ||
+        get<std::uint32_t>(data.data() + data.size() - 4) != journal_crc32(data.data(), data.size() - 4)) {
+        throw std::runtime_error("Corrupt balance snapshot file: " + path);
+    }
+
+    BalanceSnapshot snapshot;
+    const char* cursor = data.data() + sizeof(BALANCES_MAGIC);
+    const char* end = data.data() + data.size() - 4;
+    snapshot.sequence = get<std::uint64_t>(cursor);
+    snapshot.taken_at = get<std::int64_t>(cursor + 8);
+    std::uint64_t card_count = get<std::uint64_t>(cursor + 16);
+    std::uint64_t linked_count = get<std::uint64_t>(cursor + 24);
+    cursor += 32;
+    if (card_count > static_cast<std::uint64_t>(end - cursor) / CARD_RECORD_SIZE) {
+        throw std::runtime_error("Truncated balance snapshot file: " + path);
+    }
+    snapshot.cards.resize(card_count);
+    for (CardBalance& card : snapshot.cards) {
+        card.key = get<std::uint64_t>(cursor);
+        card.balance = get<std::int32_t>(cursor + 8);
+        cursor += CARD_RECORD_SIZE;
+    }
+    for (std::uint64_t i = 0; i < linked_count; ++i) {
+        if (end - cursor < 1) {
+            throw std::runtime_error("Truncated balance snapshot file: " + path);
+        }
+        std::size_t id_length = static_cast<unsigned char>(*cursor);
+        if (static_cast<std::size_t>(end - cursor) < 1 + id_length + 8 + 4) {
+            throw std::runtime_error("Truncated balance snapshot file: " + path);
+        }
+        LinkedBalance account;
+        account.account_id.assign(cursor + 1, id_length);
+        cursor += 1 + id_length;
+        account.card_key = get<std::uint64_t>(cursor);
+        account.balance = get<std::int32_t>(cursor + 8);
+        cursor += 8 + 4;
+        snapshot.linked.push_back(account);
+    }
+    if (cursor != end) {
+        throw std::runtime_error("Corrupt balance snapshot file: " + path);
+    }
+    return snapshot;
+}
@@ -0,0 +1,259 @@
+#include "BankBackend.h"
+#include <future>
+#include <stdexcept>
+#include "BankSystem.h"
+#include "Card.h"
+#include "Limits.h"
+
+namespace {
+
+// Builds a request with every field set.
+BackendRequest make_request(BackendOp op, std::uint64_t card_key, std::int32_t amount, const std::string& pin,
+                            std::uint64_t session) {
+    BackendRequest request;
+    request.op = op;
+    request.card_key = card_key;
+    request.amount = amount;
+    request.pin = pin;
+    request.session = session;
+    return request;
+}
+
+// Builds a reply.
+BackendReply make_reply(TxError error, std::uint64_t card_key, std::int32_t balance) {
+    BackendReply reply;
+    reply.error = error;
+    reply.card_key = card_key;
+    reply.balance = balance;
+    return reply;
+}
+
+// Returns the card for a key, or throws std::invalid_argument if the key is
+// not a valid card number (including keys with more than 16 digits).
+Card card_for_key(std::uint64_t card_key) {
+    if (card_key > 9999999999999999ULL) {
+        throw std::invalid_argument("Card key has more than 16 digits.");
+    }
+    return Card(unpack_card_number(card_key));
+}
+
+// Counts a PIN attempt against the bank's limits, if it has any.
+Result<void> try_pin_attempt(BankSystem& bank, std::uint64_t card_key) {
+    TransactionLimits* limits = bank.get_limits();
+    return limits != nullptr ? limits->try_pin_attempt(card_key) : Result<void>();
+}
+
+// Builds the reply to an Authenticate: on success clears the card's failed
+// PINs and opens its session.
+BackendReply authenticated(BankSystem& bank, BackendSessions& sessions, std::uint64_t card_key,
+                           Account* account) {
+    if (account == nullptr) {
+        return make_reply(TxError::WrongPin, card_key, 0);
+    }
+    TransactionLimits* limits = bank.get_limits();
+    if (limits != nullptr) {
+        limits->pin_accepted(card_key);
+    }
+    std::uint64_t session = sessions.open(card_key);
+    if (session == 0) {
+        return make_reply(TxError::TooManySessions, card_key, 0);
+    }
+    BackendReply reply = make_reply(TxError::None, card_key, account->get_balance());
+    reply.session = session;
+    return reply;
+}
+
+} // namespace
+
+// Constructor that applies the given idle timeout and bound.
+BackendSessions::BackendSessions(std::chrono::milliseconds idle_timeout, std::size_t max_sessions)
+    : idle_timeout(idle_timeout), max_sessions(max_sessions) {}
+
+// Opens a session for the card.
+std::uint64_t BackendSessions::open(std::uint64_t card_key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (sessions.size() >= max_sessions) {
+        sweep(now);
+        if (sessions.size() >= max_sessions) {
+            return 0;
+        }
+    }
+    std::uint64_t token = 0;
+    while (token == 0 || sessions.count(token) != 0) {
+        token = (static_cast<std::uint64_t>(entropy()) << 32) | entropy();
+    }
+    Session session = {card_key, now};
+    sessions.emplace(token, session);
+    return token;
+}
+
+// Checks a token against the card and refreshes its session.
+bool BackendSessions::check(std::uint64_t token, std::uint64_t card_key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unordered_map<std::uint64_t, Session>::iterator it = sessions.find(token);
+    if (it == sessions.end() || it->second.card_key != card_key) {
+        return false;
+    }
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now - it->second.last_used > idle_timeout) {
+        sessions.erase(it);
+        return false;
+    }
+    it->second.last_used = now;
+    return true;
+}
+
+// Closes the card's session.
+bool BackendSessions::close(std::uint64_t token, std::uint64_t card_key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unordered_map<std::uint64_t, Session>::iterator it = sessions.find(token);
+    if (it == sessions.end() || it->second.card_key != card_key) {
+        return false;
+    }
+    sessions.erase(it);
+    return true;
+}
+
+// Retrieves the number of sessions held.
+std::size_t BackendSessions::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sessions.size();
+}
+
+// Closes every session idle for longer than the timeout.
+void BackendSessions::sweep(std::chrono::steady_clock::time_point now) {
+    for (std::unordered_map<std::uint64_t, Session>::iterator it = sessions.begin(); it != sessions.end();) {
+        if (now - it->second.last_used > idle_timeout) {
+            it = sessions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// Builds an Authenticate request.
+BackendRequest BackendRequest::authenticate(std::uint64_t card_key, const std::string& pin) {
+    return make_request(BackendOp::Authenticate, card_key, 0, pin, 0);
+}
+
+// Builds a ValidatePin request.
+BackendRequest BackendRequest::validate_pin(std::uint64_t card_key, const std::string& pin) {
+    return make_request(BackendOp::ValidatePin, card_key, 0, pin, 0);
+}
+
+// Builds a GetAccount request.
+BackendRequest BackendRequest::get_account(std::uint64_t card_key, std::uint64_t session) {
+    return make_request(BackendOp::GetAccount, card_key, 0, std::string(), session);
+}
+
+// Builds a Balance request.
+BackendRequest BackendRequest::balance(std::uint64_t card_key, std::uint64_t session) {
+    return make_request(BackendOp::Balance, card_key, 0, std::string(), session);
+}
+
+// Builds a Deposit request.
+BackendRequest BackendRequest::deposit(std::uint64_t card_key, std::uint64_t session, std::int32_t amount) {
+    return make_request(BackendOp::Deposit, card_key, amount, std::string(), session);
+}
+
+// Builds a Withdraw request.
+BackendRequest BackendRequest::withdraw(std::uint64_t card_key, std::uint64_t session, std::int32_t amount) {
+    return make_request(BackendOp::Withdraw, card_key, amount, std::string(), session);
+}
+
+// Builds an EndSession request.
+BackendRequest BackendRequest::end_session(std::uint64_t card_key, std::uint64_t session) {
+    return make_request(BackendOp::EndSession, card_key, 0, std::string(), session);
+}
+
+// Submits a request and waits for its reply.
+BackendReply BankBackend::call(const BackendRequest& request) {
+    std::promise<BackendReply> promise;
+    std::future<BackendReply> reply = promise.get_future();
+    submit(request, [&promise](const BackendReply& result) { promise.set_value(result); });
+    return reply.get();
+}
+
+// Runs a request against a BankSystem on the calling thread.
+BackendReply execute_backend_request(BankSystem& bank, BackendSessions& sessions, const BackendRequest& request) {
+    try {
+        Card card = card_for_key(request.card_key);
+
+        if (request.op == BackendOp::Authenticate || request.op == BackendOp::ValidatePin) {
+            Result<void> allowed = try_pin_attempt(bank, request.card_key);
+            if (!allowed) {
+                return make_reply(allowed.error(), request.card_key, 0);
+            }
+            if (request.op == BackendOp::Authenticate) {
+                return authenticated(bank, sessions, request.card_key, bank.authenticate(card, request.pin));
+            }
+            Result<void> valid = bank.try_validate_pin(card, request.pin);
+            if (valid) {
+                TransactionLimits* limits = bank.get_limits();
+                if (limits != nullptr) {
+                    limits->pin_accepted(request.card_key);
+                }
+            }
+            return make_reply(valid.error(), request.card_key, 0);
+        }
+        if (request.op == BackendOp::EndSession) {
+            bool closed = sessions.close(request.session, request.card_key);
+            return make_reply(closed ? TxError::None : TxError::SessionExpired, request.card_key, 0);
+        }
+        if (!sessions.check(request.session, request.card_key)) {
+            return make_reply(TxError::SessionExpired, request.card_key, 0);
+        }
+
+        Result<Account*> account = bank.try_get_account(card);
+        if (!account) {
+            return make_reply(account.error(), request.card_key, 0);
+        }
+        Result<int> balance = account.value()->get_balance();
+        if (request.op == BackendOp::Deposit) {
+            balance = account.value()->try_deposit(request.amount);
+        } else if (request.op == BackendOp::Withdraw) {
+            balance = account.value()->try_withdraw(request.amount);
+        } else if (request.op != BackendOp::GetAccount && request.op != BackendOp::Balance) {
+            return make_reply(TxError::BackendUnavailable, request.card_key, 0);
+        }
+        return make_reply(balance.error(), request.card_key, balance.ok() ? balance.value() : 0);
+    } catch (const std::invalid_argument&) {
+        TxError error = request.op == BackendOp::Authenticate || request.op == BackendOp::ValidatePin
+                            ? TxError::WrongPin // Do not reveal which cards exist.
+                            : TxError::UnknownAccount;
+        return make_reply(error, request.card_key, 0);
+    } catch (const std::exception&) {
+        return make_reply(TxError::BackendUnavailable, request.card_key, 0);
+    }
+}
+
+// Constructor that serves requests from the given bank.
+LocalBankBackend::LocalBankBackend(BankSystem& bank) : bank(bank) {}
+
+// Runs the request, handing PIN checks to the bank's verifier pool.
+void LocalBankBackend::submit(const BackendRequest& request, BackendCallback done) {
+    if (request.op == BackendOp::Authenticate) {
+        std::uint64_t card_key = request.card_key;
+        try {
+            Card card = card_for_key(card_key);
+            Result<void> allowed = try_pin_attempt(bank, card_key);
+            if (!allowed) {
+                done(make_reply(allowed.error(), card_key, 0));
+                return;
+            }
+            bank.authenticate_async(card, request.pin, [this, card_key, done](Account* account) {
+                done(authenticated(bank, sessions, card_key, account));
+            });
+        } catch (const std::invalid_argument&) {
+            done(make_reply(TxError::WrongPin, card_key, 0));
+        }
+        return;
+    }
+    done(execute(request));
+}
+
+// Runs a request on the calling thread.
+BackendReply LocalBankBackend::execute(const BackendRequest& request) {
+    return execute_backend_request(bank, sessions, request);
+}
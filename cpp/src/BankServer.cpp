@@ -0,0 +1,185 @@
+#include "BankServer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "BackendProtocol.h"
+#include "BankSystem.h"
+#include "Logger.h"
+
+// Starts listening and launches the acceptor and worker threads.
+BankServer::BankServer(BankSystem& bank, const std::string& socket_path, const BankServerConfig& config)
+    : backend(bank), socket_path(socket_path), config(config), listen_fd(-1), next_sequence(0), stopping(false),
+      served(0) {
+    if (config.workers == 0 || config.latency.count() < 0 || config.jitter.count() < 0) {
+        throw std::invalid_argument("Server workers must be positive and delays must not be negative.");
+    }
+    listen_fd = listen_unix(socket_path);
+    for (std::size_t i = 0; i < config.workers; ++i) {
+        workers.emplace_back(&BankServer::run_worker, this);
+    }
+    acceptor = std::thread(&BankServer::accept_clients, this);
+
+    // Optional logging
+    ATM_LOG_INFO("Bank server listening on " << socket_path);
+}
+
+// Closes the client's socket once nothing refers to the connection.
+BankServer::Connection::~Connection() {
+    ::close(fd);
+}
+
+// Stops accepting, disconnects clients and joins every thread.
+BankServer::~BankServer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        for (const std::shared_ptr<Connection>& client : clients) {
+            ::shutdown(client->fd, SHUT_RDWR);
+        }
+    }
+    wake.notify_all();
+    ::shutdown(listen_fd, SHUT_RDWR); // Wakes the acceptor.
+    acceptor.join();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (std::pair<const unsigned, std::thread>& reader : readers) {
+        reader.second.join(); // No lock needed: the acceptor, the only other writer, has exited.
+    }
+    ::close(listen_fd);
+    ::unlink(socket_path.c_str());
+}
+
+// Retrieves the number of clients connected now.
+std::size_t BankServer::client_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return clients.size();
+}
+
+// Accepts clients until the listening socket is shut down. Readers of
+// departed clients are joined on each accept, so at most the readers that
+// finished since the last client arrived are left to the destructor.
+void BankServer::accept_clients() {
+    unsigned reader_id = 0;
+    for (;;) {
+        int fd = ::accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;
+        }
+        std::vector<std::thread> finished;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                ::close(fd);
+                return;
+            }
+            for (unsigned id : finished_readers) {
+                std::unordered_map<unsigned, std::thread>::iterator reader = readers.find(id);
+                finished.push_back(std::move(reader->second));
+                readers.erase(reader);
+            }
+            finished_readers.clear();
+            clients.emplace_back(new Connection(fd));
+            ++reader_id;
+            readers[reader_id] = std::thread(&BankServer::read_requests, this, clients.back(), reader_id);
+        }
+        for (std::thread& reader : finished) {
+            reader.join(); // Already past retire_reader(), so this does not wait on the lock.
+        }
+    }
+}
+
+// Decodes a client's requests and schedules each for when its delay has passed.
+void BankServer::read_requests(std::shared_ptr<Connection> connection, unsigned reader_id) {
+    std::mt19937 rng(reader_id);
+    std::uniform_int_distribution<long long> jitter(0, config.jitter.count());
+    char buffer[BACKEND_REQUEST_SIZE * 256];
+    std::size_t filled = 0;
+    bool open = true;
+    while (open) {
+        ssize_t count = ::recv(connection->fd, buffer + filled, sizeof(buffer) - filled, 0);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
+        }
+        filled += static_cast<std::size_t>(count);
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::size_t offset = 0;
+        std::size_t scheduled = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (; filled - offset >= BACKEND_REQUEST_SIZE; offset += BACKEND_REQUEST_SIZE) {
+                Delayed entry;
+                if (!decode_backend_request(buffer + offset, entry.id, entry.request)) {
+                    ATM_LOG_WARN("Bank server dropped a client that sent a malformed request.");
+                    ::shutdown(connection->fd, SHUT_RDWR);
+                    open = false;
+                    break;
+                }
+                entry.due = now + config.latency + std::chrono::microseconds(jitter(rng));
+                entry.sequence = next_sequence++;
+                entry.connection = connection;
+                delayed.push(entry);
+                ++scheduled;
+            }
+        }
+        if (scheduled == 1) {
+            wake.notify_one();
+        } else if (scheduled > 1) {
+            wake.notify_all();
+        }
+        std::memmove(buffer, buffer + offset, filled - offset);
+        filled -= offset;
+    }
+    retire_reader(connection, reader_id);
+}
+
+// Drops a departed client; its socket closes once no queued request refers to it.
+void BankServer::retire_reader(const std::shared_ptr<Connection>& connection, unsigned reader_id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    clients.erase(std::remove(clients.begin(), clients.end(), connection), clients.end());
+    finished_readers.push_back(reader_id);
+}
+
+// Executes requests whose delay has passed and sends their replies.
+void BankServer::run_worker() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        if (stopping) {
+            return;
+        }
+        if (delayed.empty()) {
+            wake.wait(lock);
+            continue;
+        }
+        std::chrono::steady_clock::time_point due = delayed.top().due;
+        if (std::chrono::steady_clock::now() < due) {
+            wake.wait_until(lock, due);
+            continue;
+        }
+        Delayed entry = delayed.top();
+        delayed.pop();
+        lock.unlock();
+
+        BackendReply reply = backend.execute(entry.request);
+        char frame[BACKEND_REPLY_SIZE];
+        encode_backend_reply(entry.id, reply, frame);
+        served.fetch_add(1, std::memory_order_relaxed); // Before the reply, so a client sees it counted.
+        {
+            std::lock_guard<std::mutex> write_lock(entry.connection->write_mutex);
+            send_all(entry.connection->fd, frame, sizeof(frame)); // A client that left no longer needs the reply.
+        }
+        lock.lock();
+    }
+}
@@ -1,44 +1,1044 @@
 #include "BankSystem.h"
+#include <algorithm>
+#include <exception>
 #include <stdexcept>
-#include <iostream> // For logging
+#include <limits>
+#include "Logger.h"
+#include "Metrics.h"
+
+// Constructor creates the requested number of empty shards and the PIN verifier pool.
+BankSystem::BankSystem(std::size_t shard_count, const PinHashConfig& pin_config, BalanceMode balance_mode)
+    : pin_config(pin_config), balance_mode(balance_mode), checkpointer_stopping(false),
+      balance_snapshots(false), snapshot_epoch(0) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("Shard count must be positive.");
+    }
+    shards.reserve(shard_count);
+    for (std::size_t i = 0; i < shard_count; ++i) {
+        shards.emplace_back(new Shard());
+    }
+    unknown_card_credential = hash_pin("unknown card", pin_config.iterations);
+    verifier.reset(new PinVerifier(pin_config));
+}
+
+// Stops periodic snapshots; the journal commits what is still buffered when destroyed.
+BankSystem::~BankSystem() {
+    if (checkpointer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(checkpointer_mutex);
+            checkpointer_stopping = true;
+        }
+        checkpointer_wake.notify_one();
+        checkpointer.join();
+    }
+}
+
+// Retrieves the number of shards the account table is split into.
+std::size_t BankSystem::shard_count() const {
+    return shards.size();
+}
+
+// Retrieves how the bank's accounts serialize balance updates.
+BalanceMode BankSystem::get_balance_mode() const {
+    return balance_mode;
+}
+
+// Returns the index of the shard responsible for the given card key.
+// Uses the high hash bits so they stay independent of the slot bits used inside the shard.
+std::size_t BankSystem::shard_index(std::uint64_t card_key) const {
+    return static_cast<std::size_t>((FlatAccountTable::hash(card_key) >> 40) % shards.size());
+}
+
+// Returns the shard responsible for the given card key.
+BankSystem::Shard& BankSystem::shard_for(std::uint64_t card_key) const {
+    return *shards[shard_index(card_key)];
+}
+
+// Retrieves the lock statistics of every shard.
+std::vector<BankSystem::ShardStats> BankSystem::shard_stats() const {
+    std::vector<ShardStats> stats;
+    stats.reserve(shards.size());
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        ShardStats entry;
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            entry.accounts = shard->table.size();
+        }
+        entry.acquisitions = shard->acquisitions.load(std::memory_order_relaxed);
+        entry.contended = shard->contended.load(std::memory_order_relaxed);
+        stats.push_back(entry);
+    }
+    return stats;
+}
+
+// Locks a shard; a failed try_lock marks the acquisition as contended before blocking.
+std::unique_lock<std::mutex> BankSystem::lock_shard(Shard& shard) {
+    std::unique_lock<std::mutex> lock(shard.mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        shard.contended.fetch_add(1, std::memory_order_relaxed);
+        lock.lock();
+    }
+    shard.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    return lock;
+}
+
+// Packs an account ID (the card number) into its table key, or throws.
+std::uint64_t BankSystem::key_for(const std::string& account_id) {
+    std::uint64_t key;
+    if (!pack_card_number(account_id, key)) {
+        throw std::invalid_argument("Account ID must be a 16-digit card number: " + account_id);
+    }
+    return key;
+}
+
+// Returns the shard that indexes a linked account ID.
+BankSystem::Shard& BankSystem::shard_for_id(const std::string& account_id) const {
+    return shard_for(std::hash<std::string>()(account_id));
+}
 
 // Adds a new account to the bank system.
 void BankSystem::add_account(const std::string& account_id, const std::string& pin, int initial_balance) {
-    if (accounts.find(account_id) != accounts.end()) {
-        throw std::invalid_argument("Account with this ID already exists: " + account_id);
+    MetricsTimer timer(MetricOp::BankAddAccount);
+    try {
+        std::uint64_t key = key_for(account_id);
+        std::uint64_t packed_pin;
+        if (!pack_pin(pin, packed_pin)) {
+            throw std::invalid_argument("PIN must be 4 to 12 digits.");
+        }
+        PinCredential credential = hash_pin(pin, pin_config.iterations); // Slow by design; done before locking.
+
+        Shard& shard = shard_for(key);
+        std::uint64_t lsn = 0;
+        {
+            std::unique_lock<std::mutex> lock = lock_shard(shard);
+            if (shard.table.find(key) != nullptr) {
+                throw std::invalid_argument("Account with this ID already exists: " + account_id);
+            }
+            // Journaled first, so a failed journal refuses the account before it exists.
+            if (journal) {
+                lsn = journal->append(JournalRecordType::AccountOpened, account_id, initial_balance, initial_balance,
+                                      encode_pin_credential(credential));
+            }
+
+            shard.storage.emplace_back(account_id, initial_balance, balance_mode);
+            Account& account = shard.storage.back();
+            attach_ledger(account);
+            attach_snapshot_epoch(account);
+            account.journal = journal.get();
+            shard.credentials.push_back(credential);
+            shard.table.insert(key, &shard.credentials.back(), &account);
+        }
+        if (lsn != 0) {
+            journal->wait_durable(lsn);
+        }
+
+        // Optional logging
+        ATM_LOG_INFO("Account added. ID: " << account_id << ", Initial Balance: " << initial_balance);
+    } catch (...) {
+        timer.fail();
+        throw;
+    }
+}
+
+namespace {
+
+const std::uint64_t CARD_KEY_LIMIT = 10000000000000000ULL; // 10^16: keys of 16-digit card numbers are below it.
+const std::size_t MAX_LINKED_ID_LENGTH = 255; // Longest field a journal record holds.
+const std::size_t POSTING_BLOCK = 1024;       // Accounts per post_batch() kernel call.
+
+// Returns true if packed is what pack_pin produces for some PIN.
+bool is_packed_pin(std::uint64_t packed) {
+    std::uint64_t repacked;
+    return pack_pin(unpack_pin(packed), repacked) && repacked == packed;
+}
+
+// Returns true if a card key below CARD_KEY_LIMIT passes the Luhn checksum
+// as a 16-digit card number, computed on the key without formatting it.
+bool passes_luhn(std::uint64_t key) {
+    unsigned sum = 0;
+    for (int position = 0; position < 16; ++position, key /= 10) {
+        unsigned digit = static_cast<unsigned>(key % 10);
+        if (position % 2 == 1) { // Every second digit from the right, the check digit excluded, is doubled.
+            digit = digit * 2 > 9 ? digit * 2 - 9 : digit * 2;
+        }
+        sum += digit;
+    }
+    return sum % 10 == 0;
+}
+
+// Runs task(0) to task(count - 1) on count threads, the calling thread
+// included, and rethrows the first exception any of them threw.
+template <typename Task>
+void run_on_threads(std::size_t count, Task task) {
+    std::vector<std::exception_ptr> errors(count);
+    std::vector<std::thread> pool;
+    for (std::size_t t = 1; t < count; ++t) {
+        pool.emplace_back([&task, &errors, t]() {
+            try {
+                task(t);
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+    try {
+        task(0);
+    } catch (...) {
+        errors[0] = std::current_exception();
+    }
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+} // namespace
+
+// Adds many accounts: validates and hashes in parallel, groups records by
+// shard, then fills each shard in one pass under one lock acquisition.
+BankSystem::BulkLoadResult BankSystem::add_accounts(const std::vector<NewAccount>& accounts, std::size_t threads) {
+    const std::size_t count = accounts.size();
+    const std::size_t shard_total = shards.size();
+    const std::size_t unassigned = static_cast<std::size_t>(-1);
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
     }
+    threads = std::max<std::size_t>(1, std::min(threads, count / 4096)); // Small loads stay on the calling thread.
 
-    accounts.emplace(account_id, Account(account_id, initial_balance));
-    pins[account_id] = pin;
+    // Pass 1: each thread checks a contiguous range, hashes plain PINs and counts records per shard.
+    std::vector<std::size_t> shard_of(count);
+    std::vector<PinCredential> hashed;
+    if (std::any_of(accounts.begin(), accounts.end(),
+                    [](const NewAccount& account) { return account.credential.iterations == 0; })) {
+        hashed.resize(count);
+    }
+    std::vector<std::vector<std::size_t>> counts(threads, std::vector<std::size_t>(shard_total, 0));
+    run_on_threads(threads, [&](std::size_t t) {
+        for (std::size_t i = count * t / threads; i < count * (t + 1) / threads; ++i) {
+            const NewAccount& account = accounts[i];
+            bool plain = account.credential.iterations == 0;
+            if (account.key >= CARD_KEY_LIMIT || !passes_luhn(account.key) || account.balance < 0 ||
+                (plain && !is_packed_pin(account.packed_pin))) {
+                shard_of[i] = unassigned;
+                continue;
+            }
+            if (plain) {
+                hashed[i] = hash_pin(unpack_pin(account.packed_pin), pin_config.iterations);
+            }
+            shard_of[i] = shard_index(account.key);
+            ++counts[t][shard_of[i]];
+        }
+    });
+
+    // Pass 2: scatter record indices into one array grouped by shard, keeping file order within each shard.
+    std::vector<std::size_t> shard_begin(shard_total + 1);
+    std::vector<std::vector<std::size_t>> cursors(threads, std::vector<std::size_t>(shard_total));
+    std::size_t offset = 0;
+    for (std::size_t s = 0; s < shard_total; ++s) {
+        shard_begin[s] = offset;
+        for (std::size_t t = 0; t < threads; ++t) {
+            cursors[t][s] = offset;
+            offset += counts[t][s];
+        }
+    }
+    shard_begin[shard_total] = offset;
+    std::vector<std::size_t> order(offset);
+    run_on_threads(threads, [&](std::size_t t) {
+        for (std::size_t i = count * t / threads; i < count * (t + 1) / threads; ++i) {
+            if (shard_of[i] != unassigned) {
+                order[cursors[t][shard_of[i]]++] = i;
+            }
+        }
+    });
+
+    // Pass 3: each thread fills whole shards; the table grows once and every probe doubles as the duplicate check.
+    std::vector<std::vector<std::size_t>> duplicates(threads);
+    std::vector<std::uint64_t> last_lsn(threads, 0);
+    run_on_threads(threads, [&](std::size_t t) {
+        for (std::size_t s = t; s < shard_total; s += threads) {
+            Shard& shard = *shards[s];
+            std::unique_lock<std::mutex> lock = lock_shard(shard);
+            shard.table.reserve(shard.table.size() + (shard_begin[s + 1] - shard_begin[s]));
+            for (std::size_t j = shard_begin[s]; j < shard_begin[s + 1]; ++j) {
+                const std::size_t i = order[j];
+                const NewAccount& record = accounts[i];
+                if (shard.table.find(record.key) != nullptr) {
+                    duplicates[t].push_back(i);
+                    continue;
+                }
+                std::string account_id = unpack_card_number(record.key);
+                const PinCredential& credential = record.credential.iterations == 0 ? hashed[i] : record.credential;
+                if (journal) {
+                    last_lsn[t] = journal->append(JournalRecordType::AccountOpened, account_id, record.balance,
+                                                  record.balance, encode_pin_credential(credential));
+                }
+                shard.storage.emplace_back(account_id, record.balance, balance_mode);
+                Account& account = shard.storage.back();
+                attach_ledger(account);
+                attach_snapshot_epoch(account);
+                account.journal = journal.get();
+                shard.credentials.push_back(credential);
+                shard.table.insert(record.key, &shard.credentials.back(), &account);
+            }
+        }
+    });
+    std::uint64_t durable_lsn = *std::max_element(last_lsn.begin(), last_lsn.end());
+    if (durable_lsn != 0) {
+        journal->wait_durable(durable_lsn);
+    }
+
+    BulkLoadResult result;
+    result.invalid = count - offset;
+    result.duplicates = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (shard_of[i] == unassigned) {
+            result.rejected.push_back(i);
+        }
+    }
+    for (const std::vector<std::size_t>& part : duplicates) {
+        result.duplicates += part.size();
+        result.rejected.insert(result.rejected.end(), part.begin(), part.end());
+    }
+    std::sort(result.rejected.begin(), result.rejected.end());
+    result.added = offset - result.duplicates;
+
+    // Optional logging
+    ATM_LOG_INFO("Accounts added in bulk. Added: " << result.added << ", Duplicates: " << result.duplicates
+                 << ", Invalid: " << result.invalid);
+    return result;
+}
+
+// Posts to every account: per shard, gather the balances, compute all
+// changes with the vector kernel, then apply each as one account update.
+BankSystem::PostingResult BankSystem::post_batch(const PostingRules& rules,
+                                                 const std::vector<PostingAdjustment>& adjustments,
+                                                 std::size_t threads) {
+    check_posting_rules(rules);
+    std::unordered_map<const Account*, std::int64_t> adjusted;
+    for (const PostingAdjustment& adjustment : adjustments) {
+        std::uint64_t key;
+        Account* account = nullptr;
+        if (pack_card_number(adjustment.account_id, key)) {
+            Result<Account*> found = try_get_account(Card(adjustment.account_id));
+            account = found ? found.value() : nullptr;
+        } else {
+            Shard& id_shard = shard_for_id(adjustment.account_id);
+            std::lock_guard<std::mutex> lock(id_shard.mutex);
+            std::unordered_map<std::string, LinkedAccount>::const_iterator found =
+                id_shard.linked_by_id.find(adjustment.account_id);
+            account = found != id_shard.linked_by_id.end() ? found->second.account : nullptr;
+        }
+        if (account == nullptr) {
+            throw std::invalid_argument("Adjustment for unknown account: " + adjustment.account_id);
+        }
+        adjusted[account] += adjustment.amount;
+    }
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::max<std::size_t>(1, std::min(threads, shards.size()));
+
+    std::vector<PostingResult> partial(threads, PostingResult());
+    std::vector<std::uint64_t> last_lsn(threads, 0);
+    run_on_threads(threads, [&](std::size_t t) {
+        PostingResult& result = partial[t];
+        std::vector<Account*> accounts; // Reused across shards so they keep their capacity.
+        std::vector<int> balances(POSTING_BLOCK);
+        std::vector<int> deltas(POSTING_BLOCK);
+        for (std::size_t s = t; s < shards.size(); s += threads) {
+            Shard& shard = *shards[s];
+            accounts.clear();
+            {
+                std::unique_lock<std::mutex> lock = lock_shard(shard);
+                for (Account& account : shard.storage) {
+                    accounts.push_back(&account);
+                }
+            }
+            // Blocks small enough that the accounts gathered are still cached when the changes are applied.
+            for (std::size_t begin = 0; begin < accounts.size(); begin += POSTING_BLOCK) {
+                const std::size_t end = std::min(accounts.size(), begin + POSTING_BLOCK);
+                for (std::size_t i = begin; i < end; ++i) {
+                    balances[i - begin] = accounts[i]->get_balance();
+                }
+                compute_postings(balances.data(), deltas.data(), end - begin, rules);
+
+                for (std::size_t i = begin; i < end; ++i) {
+                    std::int64_t adjustment = 0;
+                    if (!adjusted.empty()) {
+                        std::unordered_map<const Account*, std::int64_t>::const_iterator found =
+                            adjusted.find(accounts[i]);
+                        adjustment = found != adjusted.end() ? found->second : 0;
+                    }
+                    int change = 0;
+                    bool recomputed = false;
+                    std::uint64_t lsn = 0;
+                    PostingOutcome outcome = post_to_account(*accounts[i], balances[i - begin], deltas[i - begin],
+                                                             adjustment, rules, change, recomputed, lsn);
+                    if (outcome == PostingOutcome::Posted) {
+                        ++result.posted;
+                        if (change > 0) {
+                            result.credited += change;
+                        } else {
+                            result.debited -= change;
+                        }
+                    } else if (outcome == PostingOutcome::Rejected) {
+                        ++result.rejected;
+                    }
+                    if (recomputed) {
+                        ++result.recomputed;
+                    }
+                    if (lsn != 0) {
+                        last_lsn[t] = lsn;
+                    }
+                }
+            }
+            result.accounts += accounts.size();
+        }
+    });
+    std::uint64_t durable_lsn = *std::max_element(last_lsn.begin(), last_lsn.end());
+    if (durable_lsn != 0) {
+        journal->wait_durable(durable_lsn);
+    }
+
+    PostingResult total = PostingResult();
+    for (const PostingResult& part : partial) {
+        total.accounts += part.accounts;
+        total.posted += part.posted;
+        total.rejected += part.rejected;
+        total.recomputed += part.recomputed;
+        total.credited += part.credited;
+        total.debited += part.debited;
+    }
 
     // Optional logging
-    std::cout << "[INFO] Account added. ID: " << account_id << ", Initial Balance: " << initial_balance << std::endl;
+    ATM_LOG_INFO("Batch posted. Accounts: " << total.accounts << ", Posted: " << total.posted
+                 << ", Rejected: " << total.rejected << ", Recomputed: " << total.recomputed
+                 << ", Credited: " << static_cast<long long>(total.credited)
+                 << ", Debited: " << static_cast<long long>(total.debited));
+    return total;
+}
+
+// Applies one account's posting as a single compare-and-swap or locked update.
+BankSystem::PostingOutcome BankSystem::post_to_account(Account& account, int snapshot, int delta,
+                                                       std::int64_t adjustment, const PostingRules& rules,
+                                                       int& change, bool& recomputed, std::uint64_t& lsn) {
+    const std::int64_t max_balance = std::numeric_limits<int>::max();
+    if (account.lock_free()) {
+        int current = snapshot;
+        int base = snapshot; // The balance total was computed from.
+        std::int64_t total = delta + adjustment;
+        for (;;) {
+            std::int64_t next = current + total;
+            if (next < 0 || next > max_balance) {
+                return PostingOutcome::Rejected;
+            }
+            if (total == 0) {
+                return PostingOutcome::Unchanged;
+            }
+            if (account.balance.compare_exchange_weak(current, static_cast<int>(next), std::memory_order_acq_rel,
+                                                      std::memory_order_acquire)) {
+                change = static_cast<int>(total);
+                return PostingOutcome::Posted;
+            }
+            // Compared with base, not snapshot: a balance that moved away and
+            // back to snapshot still needs the total recomputed.
+            if (current != base) {
+                total = posting_delta(current, rules) + adjustment;
+                base = current;
+                recomputed = true;
+            }
+        }
+    }
+
+    // A posting that changes nothing needs no lock if the balance has not moved.
+    std::int64_t total = delta + adjustment;
+    if (total == 0 && account.balance.load(std::memory_order_acquire) == snapshot) {
+        return PostingOutcome::Unchanged;
+    }
+    std::lock_guard<std::mutex> lock(account.mutex);
+    int current = account.balance.load(std::memory_order_relaxed);
+    if (current != snapshot) {
+        total = posting_delta(current, rules) + adjustment;
+        recomputed = true;
+    }
+    std::int64_t next = current + total;
+    if (next < 0 || next > max_balance) {
+        return PostingOutcome::Rejected;
+    }
+    if (total == 0) {
+        return PostingOutcome::Unchanged;
+    }
+    change = static_cast<int>(total);
+    if (account.journal != nullptr) {
+        lsn = account.journal->append(JournalRecordType::Posting, account.account_id, change, static_cast<int>(next));
+    }
+    account.preserve_balance();
+    account.balance.store(static_cast<int>(next), std::memory_order_release);
+    if (account.ledger != nullptr) {
+        account.record(LedgerEntryType::Posting, change, static_cast<int>(next));
+    }
+    return PostingOutcome::Posted;
+}
+
+// Adds a further account to an existing card.
+void BankSystem::add_linked_account(const std::string& card_number, const std::string& account_id,
+                                    int initial_balance) {
+    MetricsTimer timer(MetricOp::BankAddAccount);
+    try {
+        std::uint64_t card_key = key_for(card_number);
+        std::uint64_t unused;
+        if (account_id.empty() || account_id.size() > MAX_LINKED_ID_LENGTH || pack_card_number(account_id, unused)) {
+            throw std::invalid_argument("Linked account ID must be 1 to 255 characters and not a card number: " +
+                                        account_id);
+        }
+        if (initial_balance < 0) {
+            throw std::invalid_argument("Initial balance cannot be negative.");
+        }
+        std::uint64_t lsn = link_account(card_key, account_id, initial_balance);
+        if (lsn != 0) {
+            journal->wait_durable(lsn);
+        }
+
+        // Optional logging
+        ATM_LOG_INFO("Linked account added. ID: " << account_id << ", Card: " << card_number
+                     << ", Initial Balance: " << initial_balance);
+    } catch (...) {
+        timer.fail();
+        throw;
+    }
+}
+
+// Creates a linked account holding both shard locks, the lower-numbered one first.
+std::uint64_t BankSystem::link_account(std::uint64_t card_key, const std::string& account_id, int balance) {
+    Shard& card_shard = shard_for(card_key);
+    Shard& id_shard = shard_for_id(account_id);
+    bool card_first = shard_index(card_key) <= shard_index(std::hash<std::string>()(account_id));
+    std::unique_lock<std::mutex> first_lock = lock_shard(card_first ? card_shard : id_shard);
+    std::unique_lock<std::mutex> second_lock;
+    if (&card_shard != &id_shard) {
+        second_lock = lock_shard(card_first ? id_shard : card_shard);
+    }
+
+    if (card_shard.table.find(card_key) == nullptr) {
+        throw std::invalid_argument("No account for card: " + unpack_card_number(card_key));
+    }
+    if (id_shard.linked_by_id.count(account_id) != 0) {
+        throw std::invalid_argument("Account with this ID already exists: " + account_id);
+    }
+    std::uint64_t lsn = 0;
+    if (journal) {
+        lsn = journal->append(JournalRecordType::AccountLinked, account_id, balance, balance,
+                              unpack_card_number(card_key));
+    }
+    card_shard.storage.emplace_back(account_id, balance, balance_mode);
+    Account& account = card_shard.storage.back();
+    attach_ledger(account);
+    attach_snapshot_epoch(account);
+    account.journal = journal.get();
+    card_shard.linked[card_key].push_back(&account);
+    LinkedAccount entry = {&account, card_key};
+    id_shard.linked_by_id[account_id] = entry;
+    return lsn;
+}
+
+// Copies the PIN credential and account for a card with a single table probe.
+Account* BankSystem::find_credential(const Card& card, PinCredential& credential) const {
+    Shard& shard = shard_for(card.get_key()); // Use getter for encapsulated access
+    std::unique_lock<std::mutex> lock = lock_shard(shard);
+    const AccountEntry* entry = shard.table.find(card.get_key());
+    if (entry == nullptr) {
+        credential = unknown_card_credential;
+        return nullptr;
+    }
+    credential = *entry->credential;
+    return entry->account;
+}
+
+// Looks up the account for a card and checks its PIN on the verifier pool, outside the shard lock.
+Account* BankSystem::find_authenticated(const Card& card, const std::string& pin) const {
+    std::uint64_t packed_pin;
+    if (!pack_pin(pin, packed_pin)) {
+        return nullptr;
+    }
+    PinCredential credential;
+    Account* account = find_credential(card, credential);
+    return verifier->verify(credential, pin) ? account : nullptr;
+}
+
+// Validates the PIN for a given card, reporting a mismatch as TxError::WrongPin.
+Result<void> BankSystem::try_validate_pin(const Card& card, const std::string& pin) const {
+    MetricsTimer timer(MetricOp::BankValidatePin);
+    try {
+        if (find_authenticated(card, pin) != nullptr) {
+            // Optional logging
+            ATM_LOG_INFO("PIN validation successful for card: " << card.get_card_number());
+            return Result<void>();
+        }
+
+        // Optional logging
+        ATM_LOG_WARN("PIN validation failed for card: " << card.get_card_number());
+        return timer.fail(TxError::WrongPin);
+    } catch (...) {
+        timer.fail();
+        throw;
+    }
 }
 
 // Validates the PIN for a given card.
 bool BankSystem::validate_pin(const Card& card, const std::string& pin) const {
-    auto it = pins.find(card.get_card_number()); // Use getter for encapsulated access
-    if (it != pins.end() && it->second == pin) {
+    return try_validate_pin(card, pin).ok();
+}
+
+// Validates the PIN and resolves the account in one lookup.
+Account* BankSystem::authenticate(const Card& card, const std::string& pin) {
+    MetricsTimer timer(MetricOp::BankAuthenticate);
+    try {
+        Account* account = find_authenticated(card, pin);
+        if (account != nullptr) {
+            // Optional logging
+            ATM_LOG_INFO("PIN validation successful for card: " << card.get_card_number()
+                         << ", Account: " << account->get_account_id());
+        } else {
+            // Optional logging
+            ATM_LOG_WARN("PIN validation failed for card: " << card.get_card_number());
+        }
+        return account;
+    } catch (...) {
+        timer.fail();
+        throw;
+    }
+}
+
+// Starts authenticate() and reports the result from a verifier thread.
+void BankSystem::authenticate_async(const Card& card, const std::string& pin, std::function<void(Account*)> done) {
+    std::uint64_t packed_pin;
+    if (!pack_pin(pin, packed_pin)) {
+        done(nullptr);
+        return;
+    }
+    PinCredential credential;
+    Account* account = find_credential(card, credential);
+    verifier->submit(credential, pin, [account, done](bool matched) { done(matched ? account : nullptr); });
+}
+
+// Retrieves the account for a card, reporting a missing one as TxError::UnknownAccount.
+Result<Account*> BankSystem::try_get_account(const Card& card) {
+    MetricsTimer timer(MetricOp::BankGetAccount);
+    try {
+        Shard& shard = shard_for(card.get_key()); // Use getter for encapsulated access
+        Account* account = nullptr;
+        {
+            std::unique_lock<std::mutex> lock = lock_shard(shard);
+            const AccountEntry* entry = shard.table.find(card.get_key());
+            if (entry != nullptr) {
+                account = entry->account;
+            }
+        }
+
+        if (account == nullptr) {
+            return timer.fail(TxError::UnknownAccount);
+        }
+
         // Optional logging
-        std::cout << "[INFO] PIN validation successful for card: " << card.get_card_number() << std::endl;
-        return true;
+        ATM_LOG_INFO("Account retrieved. ID: " << account->get_account_id());
+        return account;
+    } catch (...) {
+        timer.fail();
+        throw;
     }
+}
 
-    // Optional logging
-    std::cout << "[WARN] PIN validation failed for card: " << card.get_card_number() << std::endl;
-    return false;
+// Retrieves the card's own account followed by its linked accounts.
+std::vector<Account*> BankSystem::get_accounts(const Card& card) const {
+    std::vector<Account*> accounts;
+    Shard& shard = shard_for(card.get_key());
+    std::unique_lock<std::mutex> lock = lock_shard(shard);
+    const AccountEntry* entry = shard.table.find(card.get_key());
+    if (entry == nullptr) {
+        return accounts;
+    }
+    accounts.push_back(entry->account);
+    std::unordered_map<std::uint64_t, std::vector<Account*>>::const_iterator linked = shard.linked.find(card.get_key());
+    if (linked != shard.linked.end()) {
+        accounts.insert(accounts.end(), linked->second.begin(), linked->second.end());
+    }
+    return accounts;
 }
 
 // Retrieves the Account object associated with a given card.
 Account& BankSystem::get_account(const Card& card) {
-    auto it = accounts.find(card.get_card_number()); // Use getter for encapsulated access
-    if (it != accounts.end()) {
-        // Optional logging
-        std::cout << "[INFO] Account retrieved. ID: " << it->second.get_account_id() << std::endl;
-        return it->second;
-    } else {
+    Result<Account*> account = try_get_account(card);
+    if (!account) {
         throw std::invalid_argument("Account does not exist for card: " + card.get_card_number());
     }
+    return *account.value();
+}
+
+// Creates or overwrites an account during recovery, without logging or journaling.
+void BankSystem::restore_account(const std::string& account_id, const std::string& credential, int balance) {
+    std::uint64_t key;
+    if (!pack_card_number(account_id, key)) {
+        Shard& id_shard = shard_for_id(account_id);
+        {
+            std::lock_guard<std::mutex> lock(id_shard.mutex);
+            std::unordered_map<std::string, LinkedAccount>::iterator found = id_shard.linked_by_id.find(account_id);
+            if (found != id_shard.linked_by_id.end()) {
+                Account* account = found->second.account;
+                std::lock_guard<std::mutex> account_lock(account->mutex);
+                account->preserve_balance();
+                account->balance.store(balance, std::memory_order_release);
+                return;
+            }
+        }
+        std::uint64_t card_key;
+        if (!pack_card_number(credential, card_key)) {
+            throw std::runtime_error("Recovery found records of an account that was never opened: " + account_id);
+        }
+        link_account(card_key, account_id, balance); // Recovery is single-threaded.
+        return;
+    }
+    PinCredential decoded;
+    bool has_credential = decode_pin_credential(credential, decoded);
+    std::uint64_t packed_pin;
+    if (!has_credential && pack_pin(credential, packed_pin)) {
+        decoded = hash_pin(credential, pin_config.iterations); // Written before PINs were hashed.
+        has_credential = true;
+    }
+
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    AccountEntry* entry = shard.table.find(key);
+    if (entry == nullptr) {
+        shard.storage.emplace_back(account_id, balance, balance_mode);
+        attach_ledger(shard.storage.back());
+        attach_snapshot_epoch(shard.storage.back());
+        shard.credentials.push_back(has_credential ? decoded : empty_pin_credential());
+        shard.table.insert(key, &shard.credentials.back(), &shard.storage.back());
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> account_lock(entry->account->mutex);
+        entry->account->preserve_balance();
+        entry->account->balance.store(balance, std::memory_order_release);
+    }
+    if (has_credential) {
+        *entry->credential = decoded;
+    }
+}
+
+// Loads the latest snapshot, replays the journal tail, and starts journaling.
+std::uint64_t BankSystem::open_journal(const JournalConfig& config) {
+    if (journal) {
+        throw std::logic_error("Journal is already open.");
+    }
+    require_no_accounts("Journal must be opened before any account is added.");
+
+    std::uint64_t snapshot_lsn = load_latest_snapshot(
+        config.directory, [this](const std::string& account_id, const std::string& pin, std::int32_t balance) {
+            restore_account(account_id, pin, balance);
+        });
+    // A transfer is applied only if both of its records survived: its
+    // TransferOut waits for the TransferIn with the next LSN, and is dropped
+    // if a crash tore that off.
+    std::uint64_t replayed = 0;
+    std::uint64_t dropped = 0;
+    JournalEntry transfer_out;
+    bool transfer_pending = false;
+    std::uint64_t last_lsn = Journal::replay(config.directory, snapshot_lsn, [&](const JournalEntry& entry) {
+        if (transfer_pending) {
+            transfer_pending = false;
+            if (entry.type == JournalRecordType::TransferIn && entry.lsn == transfer_out.lsn + 1) {
+                restore_account(transfer_out.account_id, transfer_out.pin, transfer_out.balance);
+                restore_account(entry.account_id, entry.pin, entry.balance);
+                replayed += 2;
+                return;
+            }
+            ++dropped;
+        }
+        if (entry.type == JournalRecordType::TransferOut) {
+            transfer_out = entry;
+            transfer_pending = true;
+            return;
+        }
+        if (entry.type == JournalRecordType::TransferIn) {
+            ++dropped; // Its TransferOut is missing.
+            return;
+        }
+        restore_account(entry.account_id, entry.pin, entry.balance);
+        ++replayed;
+    });
+    if (transfer_pending) {
+        ++dropped;
+    }
+
+    journal_config = config;
+    journal.reset(new Journal(config, last_lsn));
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (Account& account : shard->storage) {
+            std::lock_guard<std::mutex> account_lock(account.mutex);
+            account.journal = journal.get();
+        }
+    }
+
+    if (config.snapshot_interval.count() > 0) {
+        checkpointer = std::thread(&BankSystem::run_checkpointer, this);
+    }
+
+    ATM_LOG_INFO("Journal opened. Snapshot LSN: " << static_cast<unsigned long long>(snapshot_lsn)
+                 << ", Replayed records: " << static_cast<unsigned long long>(replayed)
+                 << ", Incomplete transfers dropped: " << static_cast<unsigned long long>(dropped)
+                 << ", Last LSN: " << static_cast<unsigned long long>(last_lsn));
+    return last_lsn;
+}
+
+// Reads a balance under the account's lock, so no update is between its
+// journal record and its store.
+int BankSystem::committed_balance(const Account& account) {
+    std::lock_guard<std::mutex> lock(account.mutex);
+    return account.get_balance();
+}
+
+// Writes a snapshot of all accounts and prunes what it makes obsolete.
+void BankSystem::checkpoint() {
+    if (!journal) {
+        throw std::logic_error("Checkpoint requires an open journal.");
+    }
+    std::lock_guard<std::mutex> guard(checkpoint_mutex);
+
+    // An update appends its record and stores its balance under the
+    // account's lock, so a balance read under that lock includes every record
+    // before the new segment: an update whose record is older either finished
+    // before the read or holds the lock until its balance is stored.
+    std::uint64_t covered_lsn = journal->rotate() - 1;
+    SnapshotWriter writer(journal_config.directory, covered_lsn);
+    std::size_t count = 0;
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->table.for_each([&writer, &count](const AccountEntry& entry) {
+            writer.add(entry.account->get_account_id(), encode_pin_credential(*entry.credential),
+                       committed_balance(*entry.account));
+            ++count;
+        });
+        // Linked accounts follow their cards' accounts, which restore needs first.
+        for (const std::pair<const std::uint64_t, std::vector<Account*>>& card : shard->linked) {
+            std::string card_number = unpack_card_number(card.first);
+            for (const Account* account : card.second) {
+                writer.add(account->get_account_id(), card_number, committed_balance(*account));
+                ++count;
+            }
+        }
+    }
+    writer.commit();
+    prune_snapshots(journal_config.directory, covered_lsn);
+    journal->prune_through(covered_lsn);
+
+    ATM_LOG_INFO("Checkpoint written. LSN: " << static_cast<unsigned long long>(covered_lsn)
+                 << ", Accounts: " << static_cast<unsigned long long>(count));
+}
+
+// Retrieves the journal, or null if the bank is not durable.
+Journal* BankSystem::get_journal() const {
+    return journal.get();
+}
+
+// Creates the ledger; accounts added from now on record their transactions in it.
+Ledger& BankSystem::open_ledger(std::size_t reserve_entries) {
+    if (ledger) {
+        throw std::logic_error("Ledger is already open.");
+    }
+    require_no_accounts("Ledger must be opened before any account is added.");
+    ledger.reset(new Ledger(reserve_entries));
+    return *ledger;
+}
+
+// Retrieves the ledger, or null if the bank keeps none.
+Ledger* BankSystem::get_ledger() const {
+    return ledger.get();
+}
+
+// Makes every account added from now on keep its balance for snapshots.
+void BankSystem::enable_balance_snapshots() {
+    if (balance_snapshots) {
+        throw std::logic_error("Balance snapshots are already enabled.");
+    }
+    require_no_accounts("Balance snapshots must be enabled before any account is added.");
+    balance_snapshots = true;
+}
+
+// Advances the epoch, then reads every account under its lock: the saved
+// balance if an update has already run in the new epoch, the current one otherwise.
+BalanceSnapshot BankSystem::snapshot_balances(std::size_t threads) {
+    if (!balance_snapshots) {
+        throw std::logic_error("Balance snapshots are not enabled.");
+    }
+    std::lock_guard<std::mutex> guard(snapshot_mutex);
+    BalanceSnapshot snapshot;
+    snapshot.sequence = snapshot_epoch.load() + 1;
+    snapshot.taken_at = ledger_clock_us();
+    snapshot_epoch.store(snapshot.sequence);
+    const std::uint64_t epoch = snapshot.sequence;
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::max<std::size_t>(1, std::min(threads, shards.size()));
+    std::vector<std::vector<BalanceSnapshot::CardBalance>> cards(threads);
+    std::vector<std::vector<BalanceSnapshot::LinkedBalance>> linked(threads);
+    run_on_threads(threads, [&](std::size_t t) {
+        std::vector<Account*> accounts; // Reused across shards so they keep their capacity.
+        std::vector<std::pair<std::uint64_t, Account*>> linked_accounts;
+        for (std::size_t s = t; s < shards.size(); s += threads) {
+            Shard& shard = *shards[s];
+            accounts.clear();
+            linked_accounts.clear();
+            {
+                std::unique_lock<std::mutex> lock = lock_shard(shard);
+                // Storage order walks memory sequentially, unlike the table.
+                for (Account& account : shard.storage) {
+                    accounts.push_back(&account);
+                }
+                for (const std::pair<const std::uint64_t, std::vector<Account*>>& card : shard.linked) {
+                    for (Account* account : card.second) {
+                        linked_accounts.push_back(std::make_pair(card.first, account));
+                    }
+                }
+            }
+            // The value an account had at the instant of the snapshot, or false if it was added later.
+            auto balance_at_epoch = [epoch](Account& account, std::int32_t& balance) {
+                std::lock_guard<std::mutex> lock(account.mutex);
+                if (account.opened_epoch >= epoch) {
+                    return false;
+                }
+                balance = account.written_epoch >= epoch ? account.snapshot_balance
+                                                         : account.balance.load(std::memory_order_relaxed);
+                return true;
+            };
+            for (Account* account : accounts) {
+                BalanceSnapshot::CardBalance card;
+                if (!pack_card_number(account->account_id, card.key)) {
+                    continue; // A linked account; read below with its card.
+                }
+                if (balance_at_epoch(*account, card.balance)) {
+                    cards[t].push_back(card);
+                }
+            }
+            for (const std::pair<std::uint64_t, Account*>& entry : linked_accounts) {
+                BalanceSnapshot::LinkedBalance account;
+                account.account_id = entry.second->account_id;
+                account.card_key = entry.first;
+                if (balance_at_epoch(*entry.second, account.balance)) {
+                    linked[t].push_back(account);
+                }
+            }
+        }
+        std::sort(cards[t].begin(), cards[t].end(),
+                  [](const BalanceSnapshot::CardBalance& a, const BalanceSnapshot::CardBalance& b) {
+                      return a.key < b.key;
+                  });
+    });
+
+    // Merge the sorted runs of the threads.
+    for (std::vector<BalanceSnapshot::CardBalance>& part : cards) {
+        std::size_t middle = snapshot.cards.size();
+        snapshot.cards.insert(snapshot.cards.end(), part.begin(), part.end());
+        std::inplace_merge(snapshot.cards.begin(), snapshot.cards.begin() + middle, snapshot.cards.end(),
+                           [](const BalanceSnapshot::CardBalance& a, const BalanceSnapshot::CardBalance& b) {
+                               return a.key < b.key;
+                           });
+        std::vector<BalanceSnapshot::CardBalance>().swap(part);
+    }
+    for (std::vector<BalanceSnapshot::LinkedBalance>& part : linked) {
+        snapshot.linked.insert(snapshot.linked.end(), part.begin(), part.end());
+    }
+    std::sort(snapshot.linked.begin(), snapshot.linked.end(),
+              [](const BalanceSnapshot::LinkedBalance& a, const BalanceSnapshot::LinkedBalance& b) {
+                  return a.account_id < b.account_id;
+              });
+
+    // Optional logging
+    ATM_LOG_INFO("Balance snapshot taken. Epoch: " << static_cast<unsigned long long>(epoch)
+                 << ", Accounts: " << snapshot.size()
+                 << ", Total: " << static_cast<long long>(snapshot.total_balance()));
+    return snapshot;
+}
+
+// Creates the limit counters; ATMs check them from then on.
+TransactionLimits& BankSystem::enable_limits(const LimitsConfig& config) {
+    if (limits) {
+        throw std::logic_error("Limits are already enabled.");
+    }
+    limits.reset(new TransactionLimits(config));
+    return *limits;
+}
+
+// Retrieves the limits, or null if none are enforced.
+TransactionLimits* BankSystem::get_limits() const {
+    return limits.get();
+}
+
+// Creates the deduplication cache; ATMs consult it for requests with a transaction ID.
+TransactionDedupCache& BankSystem::enable_deduplication(const DedupConfig& config) {
+    if (dedup_cache) {
+        throw std::logic_error("Deduplication is already enabled.");
+    }
+    dedup_cache.reset(new TransactionDedupCache(config));
+    return *dedup_cache;
+}
+
+// Retrieves the deduplication cache, or null if transaction IDs are not tracked.
+TransactionDedupCache* BankSystem::get_dedup_cache() const {
+    return dedup_cache.get();
+}
+
+// Throws if any shard holds an account.
+void BankSystem::require_no_accounts(const char* message) const {
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        if (shard->table.size() != 0) {
+            throw std::logic_error(message);
+        }
+    }
+}
+
+// Gives a new account its own history before the account is shared.
+void BankSystem::attach_ledger(Account& account) {
+    if (ledger) {
+        account.ledger = &ledger->create_account_ledger();
+    }
+}
+
+// Points a new account at the snapshot epoch and stamps the epoch it was added in.
+void BankSystem::attach_snapshot_epoch(Account& account) {
+    if (balance_snapshots) {
+        account.snapshot_epoch = &snapshot_epoch;
+        account.opened_epoch = snapshot_epoch.load();
+    }
+}
+
+// Retrieves the PIN verification pool.
+PinVerifier& BankSystem::get_pin_verifier() const {
+    return *verifier;
+}
+
+// Checkpointer thread body: snapshot once per interval until the bank is destroyed.
+void BankSystem::run_checkpointer() {
+    std::unique_lock<std::mutex> lock(checkpointer_mutex);
+    while (!checkpointer_wake.wait_for(lock, journal_config.snapshot_interval,
+                                       [this]() { return checkpointer_stopping; })) {
+        lock.unlock();
+        try {
+            checkpoint();
+        } catch (const std::exception& e) {
+            ATM_LOG_ERROR("Periodic checkpoint failed: " << e.what());
+        }
+        lock.lock();
+    }
 }
 
 /*
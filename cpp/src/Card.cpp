@@ -3,16 +3,50 @@
 #include <cctype>
 #include <algorithm>
 
+// Packs a 16-digit card number into its numeric value.
+bool pack_card_number(const std::string& card_number, std::uint64_t& key) {
+    if (card_number.length() != 16) {
+        return false;
+    }
+    std::uint64_t value = 0;
+    for (char c : card_number) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + static_cast<std::uint64_t>(c - '0');
+    }
+    key = value;
+    return true;
+}
+
+// Formats a packed card key back into its 16-digit string.
+std::string unpack_card_number(std::uint64_t key) {
+    std::string card_number(16, '0');
+    for (int i = 15; i >= 0; --i) {
+        card_number[i] = static_cast<char>('0' + key % 10);
+        key /= 10;
+    }
+    return card_number;
+}
+
 // Constructor that initializes the card with a given card number.
 Card::Card(const std::string& card_number) {
     // Check if the card number is empty, not 16 characters, or contains non-digit characters
-    if (card_number.empty() || card_number.length() != 16 || 
-        !std::all_of(card_number.begin(), card_number.end(), ::isdigit)) {
+    if (!pack_card_number(card_number, card_key)) {
         throw std::invalid_argument("Invalid card number: must be a 16-digit numeric string.");
     }
 
-    // Set the card number if valid
-    this->card_number = card_number;
+    // Reject mistyped or forged numbers whose check digit does not match
+    if (!is_valid_card_number(card_number)) {
+        throw std::invalid_argument("Invalid card number: Luhn checksum failed.");
+    }
+}
+
+// Rebuilds a card from its packed key.
+Card Card::from_key(std::uint64_t key) {
+    Card card;
+    card.card_key = key;
+    return card;
 }
 
 // Validates the card number using the Luhn algorithm.
@@ -36,12 +70,12 @@ bool Card::is_valid_card_number(const std::string& card_number) const {
 
 // Retrieves the card number.
 std::string Card::get_card_number() const {
-    return card_number;
+    return unpack_card_number(card_key);
 }
 
 // Retrieves the masked version of the card number (e.g., "****-****-****-1234").
 std::string Card::get_masked_card_number() const {
-    return "****-****-****-" + card_number.substr(12, 4);
+    return "****-****-****-" + get_card_number().substr(12, 4);
 }
 
 /*
@@ -0,0 +1,197 @@
+#include "CardValidation.h"
+#include <stdexcept>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ATM_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Runs the scalar check over a range of cards.
+void validate_scalar(const char* numbers, std::size_t begin, std::size_t end, std::size_t stride,
+                     std::uint64_t* bitmap) {
+    for (std::size_t i = begin; i < end; ++i) {
+        if (is_valid_pan16(numbers + i * stride)) {
+            bitmap[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+}
+
+#ifdef ATM_HAVE_X86
+
+// Returns true if the 16 bytes at card are digits that pass the Luhn checksum.
+// Positions 0, 2, ..., 14 (every second digit counting from the check digit)
+// are doubled, and doubled values above 9 have 9 subtracted.
+inline bool luhn_sse2(const char* card) {
+    const __m128i zero_char = _mm_set1_epi8('0');
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i four = _mm_set1_epi8(4);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i doubled_lanes = _mm_set_epi8(0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1);
+
+    __m128i digits = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(card)), zero_char);
+    __m128i invalid = _mm_or_si128(_mm_cmpgt_epi8(digits, nine), _mm_cmplt_epi8(digits, zero));
+    if (_mm_movemask_epi8(invalid) != 0) {
+        return false;
+    }
+
+    __m128i doubled = _mm_sub_epi8(_mm_add_epi8(digits, digits), _mm_and_si128(_mm_cmpgt_epi8(digits, four), nine));
+    __m128i weighted = _mm_or_si128(_mm_and_si128(doubled_lanes, doubled), _mm_andnot_si128(doubled_lanes, digits));
+    __m128i sums = _mm_sad_epu8(weighted, zero);
+    unsigned total = static_cast<unsigned>(_mm_cvtsi128_si32(sums)) +
+                     static_cast<unsigned>(_mm_extract_epi16(sums, 4));
+    return total % 10 == 0;
+}
+
+void validate_sse2(const char* numbers, std::size_t count, std::size_t stride, std::uint64_t* bitmap) {
+    for (std::size_t i = 0; i < count; ++i) {
+        if (luhn_sse2(numbers + i * stride)) {
+            bitmap[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+}
+
+// Same arithmetic as luhn_sse2, two cards per 256-bit register.
+__attribute__((target("avx2")))
+void validate_avx2(const char* numbers, std::size_t count, std::size_t stride, std::uint64_t* bitmap) {
+    const __m256i zero_char = _mm256_set1_epi8('0');
+    const __m256i nine = _mm256_set1_epi8(9);
+    const __m256i four = _mm256_set1_epi8(4);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i doubled_lanes = _mm256_set_epi8(
+        0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1,
+        0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1);
+
+    std::size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m256i raw = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(numbers + i * stride))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(numbers + (i + 1) * stride)), 1);
+        __m256i digits = _mm256_sub_epi8(raw, zero_char);
+        __m256i invalid = _mm256_or_si256(_mm256_cmpgt_epi8(digits, nine), _mm256_cmpgt_epi8(zero, digits));
+        unsigned invalid_mask = static_cast<unsigned>(_mm256_movemask_epi8(invalid));
+
+        __m256i doubled = _mm256_sub_epi8(_mm256_add_epi8(digits, digits),
+                                          _mm256_and_si256(_mm256_cmpgt_epi8(digits, four), nine));
+        __m256i weighted = _mm256_blendv_epi8(digits, doubled, doubled_lanes);
+        __m256i sums = _mm256_sad_epu8(weighted, zero);
+
+        unsigned first = static_cast<unsigned>(_mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1));
+        unsigned second = static_cast<unsigned>(_mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3));
+        if ((invalid_mask & 0xFFFFu) == 0 && first % 10 == 0) {
+            bitmap[i / 64] |= 1ULL << (i % 64);
+        }
+        if ((invalid_mask >> 16) == 0 && second % 10 == 0) {
+            bitmap[(i + 1) / 64] |= 1ULL << ((i + 1) % 64);
+        }
+    }
+    validate_scalar(numbers, i, count, stride, bitmap);
+}
+
+#endif // ATM_HAVE_X86
+
+} // namespace
+
+// Returns the kernel that LuhnKernel::Auto resolves to on this CPU.
+LuhnKernel best_luhn_kernel() {
+#ifdef ATM_HAVE_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return LuhnKernel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return LuhnKernel::SSE2;
+    }
+#endif
+    return LuhnKernel::Scalar;
+}
+
+// Returns a printable name for a kernel.
+const char* luhn_kernel_name(LuhnKernel kernel) {
+    switch (kernel) {
+        case LuhnKernel::Scalar: return "scalar";
+        case LuhnKernel::SSE2: return "sse2";
+        case LuhnKernel::AVX2: return "avx2";
+        default: return "auto";
+    }
+}
+
+// Returns true if the kernel can run on this CPU.
+bool luhn_kernel_supported(LuhnKernel kernel) {
+    switch (kernel) {
+        case LuhnKernel::Auto:
+        case LuhnKernel::Scalar:
+            return true;
+#ifdef ATM_HAVE_X86
+        case LuhnKernel::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case LuhnKernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+// Checks that 16 characters are all digits and pass the Luhn checksum.
+bool is_valid_pan16(const char* digits) {
+    int sum = 0;
+    for (int i = 0; i < 16; ++i) {
+        int digit = digits[i] - '0';
+        if (digit < 0 || digit > 9) {
+            return false;
+        }
+        if (i % 2 == 0) {  // Every second digit from the right of a 16-digit number.
+            digit *= 2;
+            if (digit > 9) digit -= 9;
+        }
+        sum += digit;
+    }
+    return sum % 10 == 0;
+}
+
+// Validates count card numbers of exactly 16 characters each.
+void validate_card_numbers(const char* numbers, std::size_t count, std::size_t stride,
+                           std::uint64_t* bitmap, LuhnKernel kernel) {
+    if (stride < 16) {
+        throw std::invalid_argument("Card stride must be at least 16 bytes.");
+    }
+    if (!luhn_kernel_supported(kernel)) {
+        throw std::invalid_argument(std::string("Luhn kernel not supported on this CPU: ") + luhn_kernel_name(kernel));
+    }
+    if (kernel == LuhnKernel::Auto) {
+        kernel = best_luhn_kernel();
+    }
+    std::memset(bitmap, 0, ((count + 63) / 64) * sizeof(std::uint64_t));
+
+    switch (kernel) {
+#ifdef ATM_HAVE_X86
+        case LuhnKernel::AVX2:
+            validate_avx2(numbers, count, stride, bitmap);
+            break;
+        case LuhnKernel::SSE2:
+            validate_sse2(numbers, count, stride, bitmap);
+            break;
+#endif
+        default:
+            validate_scalar(numbers, 0, count, stride, bitmap);
+            break;
+    }
+}
+
+// Validates card numbers of any length; anything not exactly 16 digits is invalid.
+std::vector<std::uint64_t> validate_card_numbers(const std::vector<std::string>& numbers, LuhnKernel kernel) {
+    // Pack into fixed 16-byte records; wrong-length entries become a known-invalid record.
+    std::vector<char> packed(numbers.size() * 16, 'x');
+    for (std::size_t i = 0; i < numbers.size(); ++i) {
+        if (numbers[i].size() == 16) {
+            std::memcpy(&packed[i * 16], numbers[i].data(), 16);
+        }
+    }
+    std::vector<std::uint64_t> bitmap((numbers.size() + 63) / 64);
+    if (!numbers.empty()) {
+        validate_card_numbers(packed.data(), numbers.size(), 16, bitmap.data(), kernel);
+    }
+    return bitmap;
+}
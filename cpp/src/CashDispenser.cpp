@@ -0,0 +1,246 @@
+#include "CashDispenser.h"
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+
+namespace {
+
+const int MAX_NOTE_COST = 1000;
+const long long NOTES_PER_COST = 4096; // Above the most notes a plan can hold (8 cassettes of 255).
+
+int gcd(int a, int b) {
+    while (b != 0) {
+        int rest = a % b;
+        a = b;
+        b = rest;
+    }
+    return a;
+}
+
+// Checks the cassettes and limits, and returns the greatest common divisor of the denominations.
+int validate(const std::vector<Cassette>& cassettes, int max_notes) {
+    if (cassettes.empty() || cassettes.size() > MAX_CASSETTES) {
+        throw std::invalid_argument("An ATM holds 1 to 8 cassettes.");
+    }
+    if (max_notes <= 0 || max_notes > 255) {
+        throw std::invalid_argument("Notes per withdrawal must be between 1 and 255.");
+    }
+    int unit = 0;
+    for (const Cassette& cassette : cassettes) {
+        if (cassette.denomination <= 0 || cassette.count < 0 || cassette.cost <= 0 || cassette.cost > MAX_NOTE_COST) {
+            throw std::invalid_argument("Cassettes need a positive denomination, a count of zero or more "
+                                        "and a cost from 1 to 1000.");
+        }
+        unit = gcd(cassette.denomination, unit);
+    }
+    return unit;
+}
+
+// Returns the largest amount, in units, that max_notes notes can make up.
+int max_units_for(const std::vector<Cassette>& cassettes, int max_notes, int unit) {
+    int largest = 0;
+    for (const Cassette& cassette : cassettes) {
+        largest = std::max(largest, cassette.denomination);
+    }
+    return static_cast<int>(std::min<long long>(static_cast<long long>(largest / unit) * max_notes, INT_MAX / 2));
+}
+
+// Fills caps with each count capped at max_notes.
+void cap_counts(const std::vector<Cassette>& cassettes, int max_notes, std::uint8_t* caps) {
+    for (std::size_t i = 0; i < MAX_CASSETTES; ++i) {
+        caps[i] = i < cassettes.size() ? static_cast<std::uint8_t>(std::min(cassettes[i].count, max_notes)) : 0;
+    }
+}
+
+} // namespace
+
+// Constructor that loads the given cassettes.
+CashDispenser::CashDispenser(const std::vector<Cassette>& cassettes, int max_notes)
+    : cassettes(cassettes), max_notes(max_notes), unit(validate(cassettes, max_notes)),
+      max_units(max_units_for(cassettes, max_notes, unit)) {
+    counters.reservations = 0;
+    counters.rejections = 0;
+    counters.table_builds = 0;
+    counters.cache_hits = 0;
+    counters.direct_solves = 0;
+    std::uint8_t caps[MAX_CASSETTES];
+    cap_counts(cassettes, max_notes, caps);
+    std::copy(caps, caps + MAX_CASSETTES, untabled_caps);
+    untabled_work = 0;
+    tables.push_back(build_table(cassettes, caps, unit, max_units, max_notes));
+    ++counters.table_builds;
+}
+
+// Looks the plan up in the table for the current inventory and takes its notes out.
+Result<DispensePlan> CashDispenser::try_reserve(int amount) {
+    if (amount <= 0) {
+        return TxError::InvalidAmount;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (amount % unit != 0 || amount / unit > max_units) {
+        ++counters.rejections;
+        return TxError::CannotDispense;
+    }
+    DispensePlan plan = plan_for(amount / unit);
+    if (plan.total_notes < 0) {
+        ++counters.rejections;
+        return TxError::CannotDispense;
+    }
+    for (std::size_t i = 0; i < cassettes.size(); ++i) {
+        cassettes[i].count -= plan.notes[i]; // Never goes negative: plans respect the capped counts.
+    }
+    ++counters.reservations;
+    return plan;
+}
+
+// Returns reserved notes to their cassettes.
+void CashDispenser::release(const DispensePlan& plan) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::size_t i = 0; i < cassettes.size(); ++i) {
+        cassettes[i].count += plan.notes[i];
+    }
+}
+
+// Adds notes to a cassette.
+void CashDispenser::refill(std::size_t cassette, int count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (cassette >= cassettes.size() || count < 0) {
+        throw std::invalid_argument("Unknown cassette or negative note count.");
+    }
+    cassettes[cassette].count += count;
+}
+
+// Retrieves the cassettes with their current counts.
+std::vector<Cassette> CashDispenser::inventory() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cassettes;
+}
+
+// Retrieves the total value of the notes available.
+long long CashDispenser::cash_available() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    long long total = 0;
+    for (const Cassette& cassette : cassettes) {
+        total += static_cast<long long>(cassette.denomination) * cassette.count;
+    }
+    return total;
+}
+
+// Retrieves the counters.
+DispenserStats CashDispenser::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+// Solves one amount with a table that only reaches that amount.
+Result<DispensePlan> CashDispenser::solve(const std::vector<Cassette>& cassettes, int amount, int max_notes) {
+    int unit = validate(cassettes, max_notes);
+    if (amount <= 0) {
+        return TxError::InvalidAmount;
+    }
+    if (amount % unit != 0 || amount / unit > max_units_for(cassettes, max_notes, unit)) {
+        return TxError::CannotDispense;
+    }
+    std::uint8_t caps[MAX_CASSETTES];
+    cap_counts(cassettes, max_notes, caps);
+    Table table = build_table(cassettes, caps, unit, amount / unit, max_notes);
+    const DispensePlan& plan = table.plans[amount / unit];
+    if (plan.total_notes < 0) {
+        return TxError::CannotDispense;
+    }
+    return plan;
+}
+
+// Uses the table for the current capped counts, moving it to the front of
+// the cache. A state without a table is solved for this amount alone until
+// the amounts solved that way reach the size of a table.
+DispensePlan CashDispenser::plan_for(int units) {
+    std::uint8_t caps[MAX_CASSETTES];
+    cap_counts(cassettes, max_notes, caps);
+    for (std::size_t i = 0; i < tables.size(); ++i) {
+        if (std::equal(caps, caps + MAX_CASSETTES, tables[i].caps)) {
+            if (i != 0) {
+                std::rotate(tables.begin(), tables.begin() + i, tables.begin() + i + 1);
+                ++counters.cache_hits;
+            }
+            return tables.front().plans[units];
+        }
+    }
+    if (!std::equal(caps, caps + MAX_CASSETTES, untabled_caps)) {
+        std::copy(caps, caps + MAX_CASSETTES, untabled_caps);
+        untabled_work = 0;
+    }
+    untabled_work += units + 1; // A solve costs about as much per amount below it as a table does.
+    if (untabled_work <= max_units) {
+        ++counters.direct_solves;
+        return build_table(cassettes, caps, unit, units, max_notes).plans[units];
+    }
+
+    if (tables.size() == CACHED_TABLES) {
+        tables.pop_back();
+    }
+    tables.insert(tables.begin(), build_table(cassettes, caps, unit, max_units, max_notes));
+    ++counters.table_builds;
+    return tables.front().plans[units];
+}
+
+// Bounded knapsack over the cassettes in ascending denomination order,
+// minimizing (cost, notes); on ties the larger denomination takes more notes.
+CashDispenser::Table CashDispenser::build_table(const std::vector<Cassette>& cassettes, const std::uint8_t* caps,
+                                                int unit, int max_units, int max_notes) {
+    std::vector<std::size_t> order(cassettes.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&cassettes](std::size_t a, std::size_t b) {
+        return cassettes[a].denomination < cassettes[b].denomination;
+    });
+
+    const std::size_t amounts = static_cast<std::size_t>(max_units) + 1;
+    const long long impossible = LLONG_MAX;
+    // Cost and note count are packed into one key so a single comparison orders them.
+    std::vector<long long> best(amounts, impossible);
+    std::vector<long long> next(amounts);
+    std::vector<std::uint8_t> choice(order.size() * amounts, 0);
+    best[0] = 0;
+    for (std::size_t stage = 0; stage < order.size(); ++stage) {
+        const Cassette& cassette = cassettes[order[stage]];
+        const std::size_t step = static_cast<std::size_t>(cassette.denomination / unit);
+        const long long note_key = static_cast<long long>(cassette.cost) * NOTES_PER_COST + 1;
+        std::uint8_t* chosen = &choice[stage * amounts];
+        for (std::size_t amount = 0; amount < amounts; ++amount) {
+            long long winner = impossible;
+            std::uint8_t taken = 0;
+            for (std::size_t k = 0; k <= caps[order[stage]] && k * step <= amount; ++k) {
+                long long before = best[amount - k * step];
+                if (before != impossible && before + static_cast<long long>(k) * note_key <= winner) {
+                    winner = before + static_cast<long long>(k) * note_key;
+                    taken = static_cast<std::uint8_t>(k);
+                }
+            }
+            next[amount] = winner;
+            chosen[amount] = taken;
+        }
+        best.swap(next);
+    }
+
+    Table table;
+    std::copy(caps, caps + MAX_CASSETTES, table.caps);
+    table.plans.resize(amounts);
+    for (std::size_t amount = 0; amount < amounts; ++amount) {
+        DispensePlan& plan = table.plans[amount];
+        std::fill(plan.notes, plan.notes + MAX_CASSETTES, 0);
+        if (best[amount] == impossible || best[amount] % NOTES_PER_COST > max_notes) {
+            plan.total_notes = -1;
+            continue;
+        }
+        plan.total_notes = static_cast<int>(best[amount] % NOTES_PER_COST);
+        std::size_t remaining = amount;
+        for (std::size_t stage = order.size(); stage-- > 0;) {
+            std::uint8_t taken = choice[stage * amounts + remaining];
+            plan.notes[order[stage]] = taken;
+            remaining -= taken * static_cast<std::size_t>(cassettes[order[stage]].denomination / unit);
+        }
+    }
+    return table;
+}
@@ -0,0 +1,285 @@
+#include "CompactAccountStore.h"
+#include <stdexcept>
+#include "Card.h"
+#include "FlatAccountTable.h"
+
+namespace {
+
+// Grow the index once it would be more than 70% full, like FlatAccountTable.
+const std::size_t MAX_LOAD_NUMERATOR = 7;
+const std::size_t MAX_LOAD_DENOMINATOR = 10;
+const std::size_t MIN_INDEX_SLOTS = 16;
+
+std::size_t index_slots_for(std::size_t accounts) {
+    std::size_t slots = MIN_INDEX_SLOTS;
+    while (accounts * MAX_LOAD_DENOMINATOR > slots * MAX_LOAD_NUMERATOR) {
+        slots *= 2;
+    }
+    return slots;
+}
+
+} // namespace
+
+// Constructor creates the chunk directory and an index sized for the expected accounts.
+CompactAccountStore::CompactAccountStore(std::size_t expected_accounts)
+    : chunks(new std::atomic<Chunk*>[MAX_CHUNKS]), count(0), index(nullptr) {
+    for (std::size_t i = 0; i < MAX_CHUNKS; ++i) {
+        chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+    std::size_t slots = index_slots_for(expected_accounts);
+    std::unique_ptr<Index> initial(new Index());
+    initial->mask = slots - 1;
+    initial->slots.reset(new std::atomic<std::uint32_t>[slots]);
+    for (std::size_t i = 0; i < slots; ++i) {
+        initial->slots[i].store(0, std::memory_order_relaxed);
+    }
+    index.store(initial.get(), std::memory_order_release);
+    index_generations.push_back(std::move(initial));
+}
+
+// Returns every chunk to the pool's owner (the heap).
+CompactAccountStore::~CompactAccountStore() {
+    for (std::size_t i = 0; i < MAX_CHUNKS; ++i) {
+        delete chunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+// Adds a plain account.
+AccountHandle CompactAccountStore::add(const std::string& account_id, int initial_balance) {
+    std::uint64_t key;
+    if (!pack_card_number(account_id, key)) {
+        throw std::invalid_argument("Account ID must be a 16-digit card number: " + account_id);
+    }
+    if (initial_balance < 0) {
+        throw std::invalid_argument("Initial balance cannot be negative.");
+    }
+    return append(key, initial_balance, 0, nullptr);
+}
+
+// Adds an account whose behavior is defined by an Account subclass.
+AccountHandle CompactAccountStore::add_custom(Account& account) {
+    std::uint64_t key;
+    if (!pack_card_number(account.get_account_id(), key)) {
+        throw std::invalid_argument("Account ID must be a 16-digit card number: " + account.get_account_id());
+    }
+    return append(key, 0, ACCOUNT_CUSTOM, &account);
+}
+
+// Appends an account under add_mutex and publishes it in the index.
+AccountHandle CompactAccountStore::append(std::uint64_t key, int balance, std::uint8_t flags, Account* account) {
+    std::lock_guard<std::mutex> lock(add_mutex);
+    if (find(key) != INVALID_ACCOUNT_HANDLE) {
+        throw std::invalid_argument("Account with this ID already exists: " + unpack_card_number(key));
+    }
+    std::size_t handle = count.load(std::memory_order_relaxed);
+    if (handle >= MAX_CHUNKS * CHUNK_SIZE) {
+        throw std::length_error("Compact account store is full.");
+    }
+    std::size_t chunk_index = handle >> CHUNK_BITS;
+    Chunk* chunk = chunks[chunk_index].load(std::memory_order_relaxed);
+    if (chunk == nullptr) {
+        chunk = new Chunk;
+        chunks[chunk_index].store(chunk, std::memory_order_release);
+    }
+    std::size_t slot = handle & (CHUNK_SIZE - 1);
+    chunk->keys[slot] = key;
+    chunk->balances[slot].store(balance, std::memory_order_relaxed);
+    chunk->flags[slot].store(flags, std::memory_order_relaxed);
+    if (account != nullptr) {
+        std::lock_guard<std::mutex> custom_lock(custom_mutex);
+        custom[static_cast<AccountHandle>(handle)] = account;
+    }
+    count.store(handle + 1, std::memory_order_release);
+    index_insert(key, static_cast<AccountHandle>(handle));
+    return static_cast<AccountHandle>(handle);
+}
+
+// Inserts a handle into the current index, growing it first if needed.
+void CompactAccountStore::index_insert(std::uint64_t key, AccountHandle handle) {
+    Index* current = index.load(std::memory_order_relaxed);
+    std::size_t accounts = count.load(std::memory_order_relaxed);
+    if (accounts * MAX_LOAD_DENOMINATOR > (current->mask + 1) * MAX_LOAD_NUMERATOR) {
+        // Build a larger index from scratch and publish it; readers still probing
+        // the old one keep a valid (if slightly stale) view.
+        std::size_t slots = (current->mask + 1) * 2;
+        std::unique_ptr<Index> grown(new Index());
+        grown->mask = slots - 1;
+        grown->slots.reset(new std::atomic<std::uint32_t>[slots]);
+        for (std::size_t i = 0; i < slots; ++i) {
+            grown->slots[i].store(0, std::memory_order_relaxed);
+        }
+        for (std::size_t i = 0; i <= current->mask; ++i) {
+            std::uint32_t entry = current->slots[i].load(std::memory_order_relaxed);
+            if (entry == 0) {
+                continue;
+            }
+            std::size_t slot_index;
+            const Chunk& chunk = locate(entry - 1, slot_index);
+            std::size_t probe = FlatAccountTable::hash(chunk.keys[slot_index]) & grown->mask;
+            while (grown->slots[probe].load(std::memory_order_relaxed) != 0) {
+                probe = (probe + 1) & grown->mask;
+            }
+            grown->slots[probe].store(entry, std::memory_order_relaxed);
+        }
+        current = grown.get();
+        index.store(current, std::memory_order_release);
+        index_generations.push_back(std::move(grown));
+    }
+    std::size_t probe = FlatAccountTable::hash(key) & current->mask;
+    while (current->slots[probe].load(std::memory_order_relaxed) != 0) {
+        probe = (probe + 1) & current->mask;
+    }
+    current->slots[probe].store(handle + 1, std::memory_order_release);
+}
+
+// Finds an account by card number.
+AccountHandle CompactAccountStore::find(const std::string& account_id) const {
+    std::uint64_t key;
+    return pack_card_number(account_id, key) ? find(key) : INVALID_ACCOUNT_HANDLE;
+}
+
+// Finds an account by packed card key with a lock-free linear probe.
+AccountHandle CompactAccountStore::find(std::uint64_t card_key) const {
+    const Index* current = index.load(std::memory_order_acquire);
+    for (std::size_t probe = FlatAccountTable::hash(card_key) & current->mask;;
+         probe = (probe + 1) & current->mask) {
+        std::uint32_t entry = current->slots[probe].load(std::memory_order_acquire);
+        if (entry == 0) {
+            return INVALID_ACCOUNT_HANDLE;
+        }
+        AccountHandle handle = entry - 1;
+        const Chunk& chunk = *chunks[handle >> CHUNK_BITS].load(std::memory_order_acquire);
+        if (chunk.keys[handle & (CHUNK_SIZE - 1)] == card_key) {
+            return handle;
+        }
+    }
+}
+
+// Returns the chunk and slot of a handle, or throws if the handle is unknown.
+CompactAccountStore::Chunk& CompactAccountStore::locate(AccountHandle handle, std::size_t& slot) const {
+    if (handle >= count.load(std::memory_order_acquire)) {
+        throw std::invalid_argument("Unknown account handle.");
+    }
+    slot = handle & (CHUNK_SIZE - 1);
+    return *chunks[handle >> CHUNK_BITS].load(std::memory_order_acquire);
+}
+
+// Returns the Account object behind a custom handle.
+Account& CompactAccountStore::custom_account(AccountHandle handle) const {
+    std::lock_guard<std::mutex> lock(custom_mutex);
+    return *custom.find(handle)->second;
+}
+
+// Slow path for custom accounts: check the frozen flag, then call the virtual method.
+int CompactAccountStore::custom_update(AccountHandle handle, int amount, bool withdrawal) {
+    Account& account = custom_account(handle);
+    {
+        std::size_t slot;
+        Chunk& chunk = locate(handle, slot);
+        std::lock_guard<std::mutex> lock(stripes[handle % LOCK_STRIPES].mutex);
+        if (chunk.flags[slot].load(std::memory_order_relaxed) & ACCOUNT_FROZEN) {
+            throw std::runtime_error("Account is frozen.");
+        }
+    }
+    return withdrawal ? account.withdraw(amount) : account.deposit(amount);
+}
+
+// Deposits into an account; plain accounts never touch a vtable.
+int CompactAccountStore::deposit(AccountHandle handle, int amount) {
+    if (amount <= 0) {
+        throw std::invalid_argument("Deposit amount must be positive.");
+    }
+    std::size_t slot;
+    Chunk& chunk = locate(handle, slot);
+    if (chunk.flags[slot].load(std::memory_order_acquire) & ACCOUNT_CUSTOM) {
+        return custom_update(handle, amount, false);
+    }
+    std::lock_guard<std::mutex> lock(stripes[handle % LOCK_STRIPES].mutex);
+    if (chunk.flags[slot].load(std::memory_order_relaxed) & ACCOUNT_FROZEN) {
+        throw std::runtime_error("Account is frozen.");
+    }
+    std::int32_t balance = chunk.balances[slot].load(std::memory_order_relaxed) + amount;
+    chunk.balances[slot].store(balance, std::memory_order_relaxed);
+    return balance;
+}
+
+// Withdraws from an account; the balance check and update happen under the stripe lock.
+int CompactAccountStore::withdraw(AccountHandle handle, int amount) {
+    if (amount <= 0) {
+        throw std::invalid_argument("Withdrawal amount must be positive.");
+    }
+    std::size_t slot;
+    Chunk& chunk = locate(handle, slot);
+    if (chunk.flags[slot].load(std::memory_order_acquire) & ACCOUNT_CUSTOM) {
+        return custom_update(handle, amount, true);
+    }
+    std::lock_guard<std::mutex> lock(stripes[handle % LOCK_STRIPES].mutex);
+    if (chunk.flags[slot].load(std::memory_order_relaxed) & ACCOUNT_FROZEN) {
+        throw std::runtime_error("Account is frozen.");
+    }
+    std::int32_t balance = chunk.balances[slot].load(std::memory_order_relaxed);
+    if (amount > balance) {
+        throw std::invalid_argument("Insufficient balance.");
+    }
+    balance -= amount;
+    chunk.balances[slot].store(balance, std::memory_order_relaxed);
+    return balance;
+}
+
+// Retrieves the balance of an account without blocking.
+int CompactAccountStore::get_balance(AccountHandle handle) const {
+    std::size_t slot;
+    const Chunk& chunk = locate(handle, slot);
+    if (chunk.flags[slot].load(std::memory_order_acquire) & ACCOUNT_CUSTOM) {
+        return custom_account(handle).get_balance();
+    }
+    return chunk.balances[slot].load(std::memory_order_relaxed);
+}
+
+// Retrieves the account ID (card number) of an account.
+std::string CompactAccountStore::get_account_id(AccountHandle handle) const {
+    return unpack_card_number(get_key(handle));
+}
+
+// Retrieves the packed card key of an account.
+std::uint64_t CompactAccountStore::get_key(AccountHandle handle) const {
+    std::size_t slot;
+    return locate(handle, slot).keys[slot];
+}
+
+// Freezes or unfreezes an account.
+void CompactAccountStore::set_frozen(AccountHandle handle, bool frozen) {
+    std::size_t slot;
+    Chunk& chunk = locate(handle, slot);
+    std::lock_guard<std::mutex> lock(stripes[handle % LOCK_STRIPES].mutex);
+    if (frozen) {
+        chunk.flags[slot].fetch_or(ACCOUNT_FROZEN, std::memory_order_acq_rel);
+    } else {
+        chunk.flags[slot].fetch_and(static_cast<std::uint8_t>(~ACCOUNT_FROZEN), std::memory_order_acq_rel);
+    }
+}
+
+// Retrieves the flag bits of an account.
+std::uint8_t CompactAccountStore::get_flags(AccountHandle handle) const {
+    std::size_t slot;
+    return locate(handle, slot).flags[slot].load(std::memory_order_acquire);
+}
+
+// Sums every balance.
+std::int64_t CompactAccountStore::total_balance() const {
+    std::int64_t total = 0;
+    for_each([&total](AccountHandle, std::uint64_t, int balance) { total += balance; });
+    return total;
+}
+
+// Retrieves the bytes held by chunks and the index.
+std::size_t CompactAccountStore::memory_usage() const {
+    std::size_t bytes = MAX_CHUNKS * sizeof(std::atomic<Chunk*>);
+    std::size_t chunk_count = (size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    bytes += chunk_count * sizeof(Chunk);
+    std::lock_guard<std::mutex> lock(add_mutex);
+    for (const std::unique_ptr<Index>& generation : index_generations) {
+        bytes += (generation->mask + 1) * sizeof(std::atomic<std::uint32_t>);
+    }
+    return bytes;
+}
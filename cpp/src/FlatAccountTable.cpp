@@ -0,0 +1,117 @@
+#include "FlatAccountTable.h"
+
+namespace {
+
+// Resize once the table would be more than 70% full; linear probing degrades beyond that.
+const std::size_t MAX_LOAD_NUMERATOR = 7;
+const std::size_t MAX_LOAD_DENOMINATOR = 10;
+const std::size_t MIN_SLOTS = 16;
+
+const std::uint64_t PIN_VALUE_MASK = (1ULL << 56) - 1;
+
+} // namespace
+
+// Packs a PIN of 4 to 12 decimal digits into 64 bits.
+bool pack_pin(const std::string& pin, std::uint64_t& packed) {
+    if (pin.size() < 4 || pin.size() > 12) {
+        return false;
+    }
+    std::uint64_t value = 0;
+    for (char c : pin) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + static_cast<std::uint64_t>(c - '0');
+    }
+    packed = (static_cast<std::uint64_t>(pin.size()) << 56) | value;
+    return true;
+}
+
+// Formats a packed PIN back into its digit string.
+std::string unpack_pin(std::uint64_t packed) {
+    std::size_t length = static_cast<std::size_t>(packed >> 56);
+    std::uint64_t value = packed & PIN_VALUE_MASK;
+    std::string pin(length, '0');
+    for (std::size_t i = length; i > 0; --i) {
+        pin[i - 1] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    return pin;
+}
+
+// Constructor that creates an empty table with room for the given number of entries.
+FlatAccountTable::FlatAccountTable(std::size_t expected_entries) : count(0) {
+    reserve(expected_entries);
+}
+
+// Finds the entry for a key with a single linear probe sequence.
+AccountEntry* FlatAccountTable::find(std::uint64_t key) {
+    return const_cast<AccountEntry*>(static_cast<const FlatAccountTable*>(this)->find(key));
+}
+
+const AccountEntry* FlatAccountTable::find(std::uint64_t key) const {
+    if (slots.empty()) {
+        return nullptr;
+    }
+    std::size_t mask = slots.size() - 1;
+    for (std::size_t i = hash(key) & mask;; i = (i + 1) & mask) {
+        const AccountEntry& slot = slots[i];
+        if (slot.account == nullptr) {
+            return nullptr;
+        }
+        if (slot.key == key) {
+            return &slot;
+        }
+    }
+}
+
+// Inserts a new entry unless the key already exists.
+bool FlatAccountTable::insert(std::uint64_t key, PinCredential* credential, Account* account) {
+    if ((count + 1) * MAX_LOAD_DENOMINATOR > slots.size() * MAX_LOAD_NUMERATOR) {
+        rehash(slots.empty() ? MIN_SLOTS : slots.size() * 2);
+    }
+    std::size_t mask = slots.size() - 1;
+    for (std::size_t i = hash(key) & mask;; i = (i + 1) & mask) {
+        AccountEntry& slot = slots[i];
+        if (slot.account == nullptr) {
+            slot.key = key;
+            slot.credential = credential;
+            slot.account = account;
+            ++count;
+            return true;
+        }
+        if (slot.key == key) {
+            return false;
+        }
+    }
+}
+
+// Grows the table so that the given number of entries fit without rehashing.
+void FlatAccountTable::reserve(std::size_t expected_entries) {
+    std::size_t needed = MIN_SLOTS;
+    while (expected_entries * MAX_LOAD_DENOMINATOR > needed * MAX_LOAD_NUMERATOR) {
+        needed *= 2;
+    }
+    if (needed > slots.size() && (expected_entries > 0 || !slots.empty())) {
+        rehash(needed);
+    }
+}
+
+// Rebuilds the table with the given number of slots.
+void FlatAccountTable::rehash(std::size_t slot_count) {
+    std::vector<AccountEntry> old;
+    old.swap(slots);
+    AccountEntry empty = {0, nullptr, nullptr};
+    slots.assign(slot_count, empty);
+    std::size_t mask = slot_count - 1;
+    for (const AccountEntry& entry : old) {
+        if (entry.account == nullptr) {
+            continue;
+        }
+        std::size_t i = hash(entry.key) & mask;
+        while (slots[i].account != nullptr) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = entry;
+    }
+}
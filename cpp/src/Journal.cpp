@@ -0,0 +1,574 @@
+#include "Journal.h"
+#include "Logger.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <cctype>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace {
+
+// Record layout: size, crc, lsn, type, id length, pin length, reserved, amount, balance, id, pin.
+const std::size_t RECORD_HEADER_SIZE = 4 + 4 + 8 + 1 + 1 + 1 + 1 + 4 + 4;
+const std::size_t MAX_FIELD_LENGTH = 255;
+
+const char SNAPSHOT_MAGIC[8] = {'A', 'T', 'M', 'S', 'N', 'A', 'P', '1'};
+
+// Standard CRC-32 (IEEE 802.3), used to detect torn or corrupt records.
+std::uint32_t crc32(const char* data, std::size_t size, std::uint32_t crc = 0) {
+    static std::uint32_t table[256];
+    static bool initialized = false;
+    if (!initialized) {
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        initialized = true;
+    }
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Builds the CRC table before any thread can race on it.
+struct Crc32Init {
+    Crc32Init() { crc32(nullptr, 0); }
+} crc32_init;
+
+template <typename T>
+void put(std::vector<char>& out, const T& value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+T get(const char* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+// Writes the whole buffer, retrying on short writes and EINTR.
+bool write_all(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+// Reads a whole file into memory. Returns false if it cannot be opened.
+bool read_file(const std::string& path, std::vector<char>& out) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    out.clear();
+    char chunk[1 << 16];
+    for (;;) {
+        ssize_t count = ::read(fd, chunk, sizeof(chunk));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
+        }
+        out.insert(out.end(), chunk, chunk + count);
+    }
+    ::close(fd);
+    return true;
+}
+
+// Makes directory entries (new or renamed files) durable.
+void sync_directory(const std::string& directory) {
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+// Lists LSNs encoded in file names of the form <prefix><20 digits><suffix>, ascending.
+std::vector<std::uint64_t> list_numbered_files(const std::string& directory, const std::string& prefix,
+                                               const std::string& suffix) {
+    std::vector<std::uint64_t> numbers;
+    DIR* dir = ::opendir(directory.c_str());
+    if (dir == nullptr) {
+        return numbers;
+    }
+    while (struct dirent* entry = ::readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() != prefix.size() + 20 + suffix.size() ||
+            name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+        std::string digits = name.substr(prefix.size(), 20);
+        if (std::all_of(digits.begin(), digits.end(), ::isdigit)) {
+            numbers.push_back(std::strtoull(digits.c_str(), nullptr, 10));
+        }
+    }
+    ::closedir(dir);
+    std::sort(numbers.begin(), numbers.end());
+    return numbers;
+}
+
+std::string numbered_path(const std::string& directory, const char* prefix, std::uint64_t number,
+                          const char* suffix) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%020llu%s", prefix, static_cast<unsigned long long>(number), suffix);
+    return directory + "/" + name;
+}
+
+std::string snapshot_path(const std::string& directory, std::uint64_t lsn) {
+    return numbered_path(directory, "snapshot.", lsn, ".snap");
+}
+
+} // namespace
+
+// Returns the path of the journal segment that starts at the given LSN.
+std::string journal_segment_path(const std::string& directory, std::uint64_t first_lsn) {
+    return numbered_path(directory, "journal.", first_lsn, ".log");
+}
+
+// Lists the first LSN of every journal segment in a directory, ascending.
+std::vector<std::uint64_t> list_journal_segments(const std::string& directory) {
+    return list_numbered_files(directory, "journal.", ".log");
+}
+
+// Opens the journal directory and starts a new segment after last_lsn.
+Journal::Journal(const JournalConfig& config, std::uint64_t last_lsn)
+    : config(config), fd(-1), next_lsn(last_lsn + 1), flushed_lsn(last_lsn), rotated_lsn(0),
+      rotate_requested(false), failed(false), stopping(false) {
+    if (config.directory.empty()) {
+        throw std::invalid_argument("Journal directory must not be empty.");
+    }
+    ::mkdir(config.directory.c_str(), 0755);
+    segments = list_journal_segments(config.directory);
+    counters.records = counters.batches = counters.bytes = 0;
+    open_segment(next_lsn);
+    if (segments.empty() || segments.back() != next_lsn) {
+        segments.push_back(next_lsn);
+    }
+    flusher = std::thread(&Journal::run, this);
+}
+
+// Commits everything still buffered and stops the flusher thread.
+Journal::~Journal() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    pending.notify_one();
+    flusher.join();
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+// Opens a new segment starting at the given LSN and makes it the write target.
+void Journal::open_segment(std::uint64_t first_lsn) {
+    std::string path = journal_segment_path(config.directory, first_lsn);
+    // A leftover file with this name can only hold a torn record, so start it empty.
+    int new_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (new_fd < 0) {
+        throw std::runtime_error("Unable to open journal segment: " + path);
+    }
+    sync_directory(config.directory);
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = new_fd;
+}
+
+// Buffers one record and returns its LSN, or throws if the journal has failed.
+std::uint64_t Journal::append(JournalRecordType type, const std::string& account_id,
+                              std::int32_t amount, std::int32_t balance, const std::string& pin) {
+    std::uint64_t lsn = try_append(type, account_id, amount, balance, pin);
+    if (lsn == 0) {
+        throw std::runtime_error("Journal write failed; mutation refused.");
+    }
+    return lsn;
+}
+
+// Buffers one record and returns its LSN, or 0 without buffering it if the
+// journal has failed, since the flusher will never write it.
+std::uint64_t Journal::try_append(JournalRecordType type, const std::string& account_id,
+                                  std::int32_t amount, std::int32_t balance, const std::string& pin) {
+    if (account_id.size() > MAX_FIELD_LENGTH || pin.size() > MAX_FIELD_LENGTH) {
+        throw std::invalid_argument("Journal field too long.");
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    if (failed) {
+        return 0;
+    }
+    bool was_empty = batch.empty();
+    std::uint64_t lsn = put_record(type, account_id, amount, balance, pin);
+    notify_flusher(lock, was_empty);
+    return lsn;
+}
+
+// Buffers both records of a transfer under one lock so they share a batch.
+std::uint64_t Journal::try_append_transfer(const std::string& from_id, const std::string& to_id,
+                                           std::int32_t amount, std::int32_t from_balance,
+                                           std::int32_t to_balance) {
+    if (from_id.size() > MAX_FIELD_LENGTH || to_id.size() > MAX_FIELD_LENGTH) {
+        throw std::invalid_argument("Journal field too long.");
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    if (failed) {
+        return 0;
+    }
+    bool was_empty = batch.empty();
+    put_record(JournalRecordType::TransferOut, from_id, amount, from_balance, "");
+    std::uint64_t lsn = put_record(JournalRecordType::TransferIn, to_id, amount, to_balance, "");
+    notify_flusher(lock, was_empty);
+    return lsn;
+}
+
+// Serializes one record, with its CRC, at the end of the batch.
+std::uint64_t Journal::put_record(JournalRecordType type, const std::string& account_id,
+                                  std::int32_t amount, std::int32_t balance, const std::string& pin) {
+    std::uint32_t size = static_cast<std::uint32_t>(RECORD_HEADER_SIZE + account_id.size() + pin.size());
+    std::uint64_t lsn = next_lsn++;
+    if (batch.empty()) {
+        batch_started = std::chrono::steady_clock::now();
+    }
+
+    std::size_t start = batch.size();
+    put(batch, size);
+    put(batch, std::uint32_t(0)); // CRC placeholder.
+    put(batch, lsn);
+    put(batch, static_cast<std::uint8_t>(type));
+    put(batch, static_cast<std::uint8_t>(account_id.size()));
+    put(batch, static_cast<std::uint8_t>(pin.size()));
+    put(batch, std::uint8_t(0));
+    put(batch, amount);
+    put(batch, balance);
+    batch.insert(batch.end(), account_id.begin(), account_id.end());
+    batch.insert(batch.end(), pin.begin(), pin.end());
+    std::uint32_t crc = crc32(&batch[start + 8], size - 8);
+    std::memcpy(&batch[start + 4], &crc, sizeof(crc));
+    return lsn;
+}
+
+// Wakes the flusher for a new or full batch.
+void Journal::notify_flusher(std::unique_lock<std::mutex>& lock, bool was_empty) {
+    if (was_empty || batch.size() >= config.max_batch_bytes) {
+        lock.unlock();
+        pending.notify_one();
+    }
+}
+
+// Blocks until the record with the given LSN has been fsynced.
+void Journal::wait_durable(std::uint64_t lsn) {
+    if (!try_wait_durable(lsn)) {
+        throw std::runtime_error("Journal write failed; mutation is not durable.");
+    }
+}
+
+// Blocks until the record is on disk or the journal has failed.
+bool Journal::try_wait_durable(std::uint64_t lsn) {
+    std::unique_lock<std::mutex> lock(mutex);
+    committed.wait(lock, [this, lsn]() { return flushed_lsn >= lsn || failed; });
+    return flushed_lsn >= lsn;
+}
+
+// Retrieves the LSN of the last appended record.
+std::uint64_t Journal::last_lsn() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return next_lsn - 1;
+}
+
+// Retrieves the LSN of the last record known to be on disk.
+std::uint64_t Journal::durable_lsn() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return flushed_lsn;
+}
+
+// Retrieves grouping counters.
+JournalStats Journal::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+// Commits the current batch and starts a new segment file.
+std::uint64_t Journal::rotate() {
+    std::unique_lock<std::mutex> lock(mutex);
+    rotate_requested = true;
+    pending.notify_one();
+    rotated.wait(lock, [this]() { return !rotate_requested || failed; });
+    if (rotate_requested) {
+        throw std::runtime_error("Journal rotation failed.");
+    }
+    return rotated_lsn;
+}
+
+// Deletes segments whose records all have an LSN of at most the given one.
+void Journal::prune_through(std::uint64_t lsn) {
+    std::lock_guard<std::mutex> lock(mutex);
+    // A segment ends right before the next one starts; the newest segment is always kept.
+    while (segments.size() > 1 && segments[1] - 1 <= lsn) {
+        ::unlink(journal_segment_path(config.directory, segments.front()).c_str());
+        segments.erase(segments.begin());
+    }
+}
+
+// Writes and syncs one batch.
+bool Journal::write_batch(const std::vector<char>& data) {
+    if (!write_all(fd, data.data(), data.size())) {
+        return false;
+    }
+    return !config.sync || ::fdatasync(fd) == 0;
+}
+
+// Flusher thread body: wait for a batch, let it fill for up to one commit window, commit it.
+void Journal::run() {
+    std::vector<char> writing;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        pending.wait(lock, [this]() { return !batch.empty() || rotate_requested || stopping; });
+        if (batch.empty() && stopping) {
+            break;
+        }
+
+        // Group commit: give concurrent writers until the window closes to join this batch.
+        if (!batch.empty() && !stopping && !rotate_requested) {
+            std::chrono::steady_clock::time_point deadline = batch_started + config.commit_window;
+            pending.wait_until(lock, deadline, [this]() {
+                return batch.size() >= config.max_batch_bytes || rotate_requested || stopping;
+            });
+        }
+
+        writing.swap(batch);
+        batch.clear();
+        std::uint64_t end_lsn = next_lsn - 1;
+        std::uint64_t records = end_lsn - flushed_lsn;
+        bool rotate = rotate_requested;
+        lock.unlock();
+
+        bool ok = writing.empty() || write_batch(writing);
+        if (ok && rotate) {
+            try {
+                open_segment(end_lsn + 1);
+            } catch (const std::exception& e) {
+                ATM_LOG_ERROR("Journal rotation failed: " << e.what());
+                ok = false;
+            }
+        }
+        if (!ok) {
+            ATM_LOG_ERROR("Journal write failed in " << config.directory);
+        }
+
+        lock.lock();
+        if (ok) {
+            flushed_lsn = end_lsn;
+            if (!writing.empty()) {
+                counters.records += records;
+                counters.batches += 1;
+                counters.bytes += writing.size();
+            }
+            if (rotate) {
+                if (segments.back() != end_lsn + 1) {
+                    segments.push_back(end_lsn + 1);
+                }
+                rotated_lsn = end_lsn + 1;
+                rotate_requested = false;
+            }
+        } else {
+            failed = true;
+        }
+        committed.notify_all();
+        rotated.notify_all();
+        if (failed) {
+            // Nothing appended after a failure can become durable; stop accepting work.
+            while (!stopping) {
+                pending.wait(lock);
+            }
+            break;
+        }
+    }
+}
+
+// Decodes one record from a buffer.
+std::size_t Journal::decode(const char* data, std::size_t size, JournalEntry& entry) {
+    if (size < RECORD_HEADER_SIZE) {
+        return 0;
+    }
+    std::uint32_t record_size = get<std::uint32_t>(data);
+    if (record_size < RECORD_HEADER_SIZE || record_size > size) {
+        return 0;
+    }
+    if (get<std::uint32_t>(data + 4) != crc32(data + 8, record_size - 8)) {
+        return 0;
+    }
+    std::size_t id_length = static_cast<unsigned char>(data[17]);
+    std::size_t pin_length = static_cast<unsigned char>(data[18]);
+    if (RECORD_HEADER_SIZE + id_length + pin_length != record_size) {
+        return 0;
+    }
+    entry.lsn = get<std::uint64_t>(data + 8);
+    entry.type = static_cast<JournalRecordType>(data[16]);
+    entry.amount = get<std::int32_t>(data + 20);
+    entry.balance = get<std::int32_t>(data + 24);
+    entry.account_id.assign(data + RECORD_HEADER_SIZE, id_length);
+    entry.pin.assign(data + RECORD_HEADER_SIZE + id_length, pin_length);
+    return record_size;
+}
+
+// Calls visit for every intact record after after_lsn, in LSN order.
+std::uint64_t Journal::replay(const std::string& directory, std::uint64_t after_lsn,
+                              const std::function<void(const JournalEntry&)>& visit) {
+    std::uint64_t last = after_lsn;
+    std::vector<char> data;
+    JournalEntry entry;
+    for (std::uint64_t first_lsn : list_journal_segments(directory)) {
+        if (!read_file(journal_segment_path(directory, first_lsn), data)) {
+            continue;
+        }
+        std::size_t offset = 0;
+        while (offset < data.size()) {
+            std::size_t size = decode(data.data() + offset, data.size() - offset, entry);
+            if (size == 0) {
+                // A torn tail from a crash: nothing after it in this segment was acknowledged.
+                // Every restart begins a fresh segment, so later segments are still valid.
+                break;
+            }
+            offset += size;
+            if (entry.lsn > last) {
+                visit(entry);
+                last = entry.lsn;
+            }
+        }
+    }
+    return last;
+}
+
+// Starts a snapshot that covers every journal record up to lsn.
+SnapshotWriter::SnapshotWriter(const std::string& directory, std::uint64_t lsn)
+    : directory(directory), temp_path(snapshot_path(directory, lsn) + ".tmp"),
+      final_path(snapshot_path(directory, lsn)), count(0), fd(-1) {
+    ::mkdir(directory.c_str(), 0755);
+    fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to create snapshot: " + temp_path);
+    }
+    buffer.insert(buffer.end(), SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + sizeof(SNAPSHOT_MAGIC));
+    put(buffer, lsn);
+}
+
+// Removes the temporary file if commit() was never called.
+SnapshotWriter::~SnapshotWriter() {
+    if (fd >= 0) {
+        ::close(fd);
+        ::unlink(temp_path.c_str());
+    }
+}
+
+// Adds one account to the snapshot.
+void SnapshotWriter::add(const std::string& account_id, const std::string& pin, std::int32_t balance) {
+    if (account_id.size() > MAX_FIELD_LENGTH || pin.size() > MAX_FIELD_LENGTH) {
+        throw std::invalid_argument("Snapshot field too long.");
+    }
+    put(buffer, static_cast<std::uint8_t>(account_id.size()));
+    put(buffer, static_cast<std::uint8_t>(pin.size()));
+    put(buffer, balance);
+    buffer.insert(buffer.end(), account_id.begin(), account_id.end());
+    buffer.insert(buffer.end(), pin.begin(), pin.end());
+    ++count;
+}
+
+// Writes the buffered bytes to the temporary file.
+void SnapshotWriter::write_buffer() {
+    if (!write_all(fd, buffer.data(), buffer.size())) {
+        throw std::runtime_error("Unable to write snapshot: " + temp_path);
+    }
+}
+
+// Syncs the file and publishes it as the latest snapshot.
+void SnapshotWriter::commit() {
+    put(buffer, count);
+    std::uint32_t crc = crc32(buffer.data(), buffer.size());
+    put(buffer, crc);
+    write_buffer();
+    if (::fsync(fd) != 0) {
+        throw std::runtime_error("Unable to sync snapshot: " + temp_path);
+    }
+    ::close(fd);
+    fd = -1;
+    if (::rename(temp_path.c_str(), final_path.c_str()) != 0) {
+        ::unlink(temp_path.c_str());
+        throw std::runtime_error("Unable to publish snapshot: " + final_path);
+    }
+    sync_directory(directory);
+}
+
+// Loads the newest intact snapshot in a directory.
+std::uint64_t load_latest_snapshot(
+    const std::string& directory,
+    const std::function<void(const std::string&, const std::string&, std::int32_t)>& visit) {
+    std::vector<std::uint64_t> lsns = list_numbered_files(directory, "snapshot.", ".snap");
+    std::vector<char> data;
+    for (auto it = lsns.rbegin(); it != lsns.rend(); ++it) {
+        if (!read_file(snapshot_path(directory, *it), data)) {
+            continue;
+        }
+        const std::size_t header = sizeof(SNAPSHOT_MAGIC) + 8;
+        const std::size_t footer = 8 + 4;
+        if (data.size() < header + footer ||
+            std::memcmp(data.data(), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+            get<std::uint32_t>(data.data() + data.size() - 4) != crc32(data.data(), data.size() - 4)) {
+            ATM_LOG_WARN("Skipping corrupt snapshot with LSN " << static_cast<unsigned long long>(*it));
+            continue;
+        }
+
+        std::uint64_t lsn = get<std::uint64_t>(data.data() + sizeof(SNAPSHOT_MAGIC));
+        std::size_t offset = header;
+        std::size_t end = data.size() - footer;
+        std::string account_id, pin;
+        while (offset + 6 <= end) {
+            std::size_t id_length = static_cast<unsigned char>(data[offset]);
+            std::size_t pin_length = static_cast<unsigned char>(data[offset + 1]);
+            std::int32_t balance = get<std::int32_t>(data.data() + offset + 2);
+            offset += 6;
+            account_id.assign(data.data() + offset, id_length);
+            pin.assign(data.data() + offset + id_length, pin_length);
+            offset += id_length + pin_length;
+            visit(account_id, pin, balance);
+        }
+        return lsn;
+    }
+    return 0;
+}
+
+// Deletes every snapshot older than the one covering the given LSN.
+void prune_snapshots(const std::string& directory, std::uint64_t keep_lsn) {
+    for (std::uint64_t lsn : list_numbered_files(directory, "snapshot.", ".snap")) {
+        if (lsn < keep_lsn) {
+            ::unlink(snapshot_path(directory, lsn).c_str());
+        }
+    }
+}
+
+// Computes the CRC-32 used by journal records and snapshots.
+std::uint32_t journal_crc32(const char* data, std::size_t size) {
+    return crc32(data, size);
+}
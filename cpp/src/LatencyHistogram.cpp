@@ -0,0 +1,75 @@
+#include "LatencyHistogram.h"
+#include <cstring>
+
+// Constructor that creates an empty histogram.
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+// Adds every value recorded in another histogram.
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    total += other.total;
+    sum += other.sum;
+    if (other.max_value > max_value) {
+        max_value = other.max_value;
+    }
+}
+
+// Forgets every recorded value.
+void LatencyHistogram::reset() {
+    std::memset(buckets, 0, sizeof(buckets));
+    total = 0;
+    sum = 0;
+    max_value = 0;
+}
+
+// Retrieves the largest value that falls into a bucket.
+std::uint64_t LatencyHistogram::bucket_upper_bound(std::size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    std::size_t shift = bucket / SUB_BUCKETS - 1;
+    std::uint64_t sub = bucket % SUB_BUCKETS + SUB_BUCKETS; // Restore the implicit top bit.
+    return ((sub + 1) << shift) - 1;
+}
+
+// Retrieves an upper bound of the q-quantile.
+std::uint64_t LatencyHistogram::percentile(double q) const {
+    if (total == 0) {
+        return 0;
+    }
+    std::uint64_t rank = static_cast<std::uint64_t>(q * (total - 1)) + 1;
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            std::uint64_t bound = bucket_upper_bound(i);
+            return bound < max_value ? bound : max_value;
+        }
+    }
+    return max_value;
+}
+
+// Constructor that creates an empty histogram.
+AtomicLatencyHistogram::AtomicLatencyHistogram() : sum(0), max_value(0) {
+    for (std::atomic<std::uint64_t>& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Adds the values recorded so far to a plain histogram.
+void AtomicLatencyHistogram::add_to(LatencyHistogram& histogram) const {
+    for (std::size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i) {
+        std::uint64_t count = buckets[i].load(std::memory_order_relaxed);
+        histogram.buckets[i] += count;
+        histogram.total += count;
+    }
+    histogram.sum += sum.load(std::memory_order_relaxed);
+    std::uint64_t largest = max_value.load(std::memory_order_relaxed);
+    if (largest > histogram.max_value) {
+        histogram.max_value = largest;
+    }
+}
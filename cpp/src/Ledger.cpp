@@ -0,0 +1,168 @@
+#include "Ledger.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+thread_local std::uint32_t current_atm_id = 0;
+
+} // namespace
+
+// Constructor for an empty history whose chunks come from ledger.
+AccountLedger::AccountLedger(Ledger& ledger) : ledger(ledger), head(nullptr), last_timestamp(0) {}
+
+// Appends into the newest chunk, or starts a new one when it is full.
+void AccountLedger::append(const LedgerEntry& entry) {
+    LedgerEntry stored = entry;
+    stored.timestamp_us = std::max(stored.timestamp_us, last_timestamp); // The wall clock may step back.
+    last_timestamp = stored.timestamp_us;
+
+    LedgerChunk* newest = head.load(std::memory_order_relaxed);
+    std::uint32_t count = newest != nullptr ? newest->count.load(std::memory_order_relaxed)
+                                            : static_cast<std::uint32_t>(LEDGER_CHUNK_ENTRIES);
+    if (count < LEDGER_CHUNK_ENTRIES) {
+        newest->entries[count] = stored;
+        newest->count.store(count + 1, std::memory_order_release);
+        return;
+    }
+
+    LedgerChunk* chunk = ledger.acquire_chunk();
+    chunk->entries[0] = stored;
+    chunk->count.store(1, std::memory_order_relaxed);
+    chunk->prev = newest;
+    if (newest != nullptr) {
+        // Skew-binary jump pointers: jumps of 1, 1, 3, 1, 1, 3, 7, ... chunks
+        // let find_chunk() reach any older chunk in O(log chunks) steps.
+        const LedgerChunk* jump = newest->jump != nullptr ? newest->jump : newest;
+        const LedgerChunk* jump_of_jump = jump->jump != nullptr ? jump->jump : jump;
+        chunk->index = newest->index + 1;
+        chunk->jump = newest->index - jump->index == jump->index - jump_of_jump->index ? jump_of_jump : newest;
+    }
+    head.store(chunk, std::memory_order_release);
+}
+
+// Retrieves the number of entries.
+std::uint64_t AccountLedger::size() const {
+    const LedgerChunk* newest = head.load(std::memory_order_acquire);
+    if (newest == nullptr) {
+        return 0;
+    }
+    return newest->index * LEDGER_CHUNK_ENTRIES + newest->count.load(std::memory_order_acquire);
+}
+
+// Walks back from the newest chunk, then restores chronological order.
+std::vector<LedgerEntry> AccountLedger::last(std::size_t count) const {
+    std::vector<LedgerEntry> result;
+    const LedgerChunk* chunk = head.load(std::memory_order_acquire);
+    if (chunk != nullptr) {
+        std::uint64_t available = chunk->index * LEDGER_CHUNK_ENTRIES + chunk->count.load(std::memory_order_acquire);
+        result.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(count, available)));
+    }
+    for (; chunk != nullptr && result.size() < count; chunk = chunk->prev) {
+        for (std::uint32_t i = chunk->count.load(std::memory_order_acquire); i > 0 && result.size() < count; --i) {
+            result.push_back(chunk->entries[i - 1]);
+        }
+    }
+    std::reverse(result.begin(), result.end());
+    return result;
+}
+
+// Jumps to the newest chunk that can hold to_us, then walks back until from_us.
+std::vector<LedgerEntry> AccountLedger::between(std::int64_t from_us, std::int64_t to_us) const {
+    std::vector<LedgerEntry> result;
+    if (from_us > to_us) {
+        return result;
+    }
+    for (const LedgerChunk* chunk = find_chunk(head.load(std::memory_order_acquire), to_us); chunk != nullptr;
+         chunk = chunk->prev) {
+        for (std::uint32_t i = chunk->count.load(std::memory_order_acquire); i > 0; --i) {
+            const LedgerEntry& entry = chunk->entries[i - 1];
+            if (entry.timestamp_us < from_us) {
+                std::reverse(result.begin(), result.end());
+                return result; // Everything older is earlier still.
+            }
+            if (entry.timestamp_us <= to_us) {
+                result.push_back(entry);
+            }
+        }
+    }
+    std::reverse(result.begin(), result.end());
+    return result;
+}
+
+// Follows a jump pointer whenever the chunk it lands on still starts after
+// time_us, so no candidate is skipped, and steps back one chunk otherwise.
+const LedgerChunk* AccountLedger::find_chunk(const LedgerChunk* newest, std::int64_t time_us) {
+    const LedgerChunk* chunk = newest;
+    while (chunk != nullptr && chunk->entries[0].timestamp_us > time_us) {
+        const LedgerChunk* jump = chunk->jump;
+        chunk = jump != nullptr && jump->entries[0].timestamp_us > time_us ? jump : chunk->prev;
+    }
+    return chunk;
+}
+
+// Constructor that reserves room for reserve_entries entries in total.
+Ledger::Ledger(std::size_t reserve_entries) : next_chunk(0) {
+    reserve(reserve_entries);
+}
+
+// Creates an empty account history.
+AccountLedger& Ledger::create_account_ledger() {
+    std::lock_guard<std::mutex> lock(mutex);
+    accounts.emplace_back(*this);
+    return accounts.back();
+}
+
+// Allocates enough chunks for the given number of further entries.
+void Ledger::reserve(std::size_t entries) {
+    std::lock_guard<std::mutex> lock(mutex);
+    reserve_chunks((entries + LEDGER_CHUNK_ENTRIES - 1) / LEDGER_CHUNK_ENTRIES);
+}
+
+// Retrieves the memory use.
+LedgerStats Ledger::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    LedgerStats stats;
+    stats.accounts = accounts.size();
+    stats.chunks_used = next_chunk;
+    stats.chunks_reserved = slabs.size() * SLAB_CHUNKS - next_chunk;
+    stats.bytes = slabs.size() * SLAB_CHUNKS * sizeof(LedgerChunk);
+    return stats;
+}
+
+// Hands out the next unused chunk, allocating a slab if none is left.
+LedgerChunk* Ledger::acquire_chunk() {
+    std::lock_guard<std::mutex> lock(mutex);
+    reserve_chunks(1);
+    LedgerChunk* chunk = &slabs[next_chunk / SLAB_CHUNKS][next_chunk % SLAB_CHUNKS];
+    ++next_chunk;
+    return chunk;
+}
+
+// Allocates slabs until the given number of chunks are unused.
+void Ledger::reserve_chunks(std::size_t chunks) {
+    while (slabs.size() * SLAB_CHUNKS - next_chunk < chunks) {
+        slabs.emplace_back(new LedgerChunk[SLAB_CHUNKS]);
+    }
+}
+
+// Returns the current wall-clock time in microseconds since the Unix epoch.
+std::int64_t ledger_clock_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Makes atm_id current on this thread until the scope ends.
+LedgerAtmScope::LedgerAtmScope(std::uint32_t atm_id) : previous(current_atm_id) {
+    current_atm_id = atm_id;
+}
+
+// Restores the ATM ID of the enclosing scope.
+LedgerAtmScope::~LedgerAtmScope() {
+    current_atm_id = previous;
+}
+
+// Retrieves the ATM ID of the innermost scope on this thread.
+std::uint32_t LedgerAtmScope::current() {
+    return current_atm_id;
+}
@@ -0,0 +1,300 @@
+#include "Limits.h"
+#include "FlatAccountTable.h"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace {
+
+// No slot of the set may be evicted.
+const std::size_t NO_VICTIM = static_cast<std::size_t>(-1);
+
+} // namespace
+
+// Returns the current time in milliseconds on the steady clock.
+std::int64_t limits_clock_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Constructor that sizes the sets and bucket arrays up front; nothing is allocated afterwards.
+SlidingWindowCounters::SlidingWindowCounters(std::chrono::milliseconds window, std::size_t buckets,
+                                             std::size_t capacity)
+    : bucket_ms(0), buckets(buckets), set_mask(0), locks(new std::mutex[LOCK_STRIPES]), evictions(0),
+      refusals(0) {
+    if (window.count() <= 0 || buckets == 0 || capacity == 0) {
+        throw std::invalid_argument("Window, buckets and capacity must be positive.");
+    }
+    bucket_ms = window.count() / static_cast<std::int64_t>(buckets);
+    if (bucket_ms == 0) {
+        throw std::invalid_argument("Window must be at least one millisecond per bucket.");
+    }
+    std::size_t sets = 1;
+    while (sets * WAYS < capacity) {
+        sets *= 2;
+    }
+    set_mask = sets - 1;
+    Slot empty = {0, 0, 0, false};
+    slots.assign(sets * WAYS, empty);
+    counts.assign(sets * WAYS * buckets, 0);
+}
+
+// Retrieves a key's total, or 0 if the key is not tracked.
+std::int64_t SlidingWindowCounters::total(std::uint64_t key, std::int64_t now_ms) {
+    std::size_t first = set_for(key);
+    std::lock_guard<std::mutex> lock(lock_for(first));
+    Slot* slot = find(key, now_ms / bucket_ms, false);
+    return slot == nullptr ? 0 : slot->total;
+}
+
+// Adds to the newest bucket, or for a negative amount removes from the newest buckets backwards.
+std::int64_t SlidingWindowCounters::add(std::uint64_t key, std::int64_t amount, std::int64_t now_ms) {
+    std::size_t first = set_for(key);
+    std::lock_guard<std::mutex> lock(lock_for(first));
+    Slot* slot = find(key, now_ms / bucket_ms, amount > 0);
+    if (slot == nullptr) {
+        return 0;
+    }
+    std::int64_t* base = &counts[static_cast<std::size_t>(slot - &slots[0]) * buckets];
+    if (amount >= 0) {
+        base[static_cast<std::size_t>(slot->head % static_cast<std::int64_t>(buckets))] += amount;
+        slot->total += amount;
+        return slot->total;
+    }
+    std::int64_t remaining = -amount;
+    for (std::size_t back = 0; back < buckets && remaining > 0; ++back) {
+        std::int64_t& bucket = base[static_cast<std::size_t>((slot->head - static_cast<std::int64_t>(back)) %
+                                                             static_cast<std::int64_t>(buckets))];
+        std::int64_t taken = std::min(bucket, remaining);
+        bucket -= taken;
+        slot->total -= taken;
+        remaining -= taken;
+    }
+    return slot->total;
+}
+
+// Adds under the set's lock only if the total stays within the limit. Keys
+// at the limit are kept, so a flood of new keys cannot evict one to reset it.
+bool SlidingWindowCounters::try_add(std::uint64_t key, std::int64_t amount, std::int64_t limit,
+                                    std::int64_t now_ms) {
+    if (amount > limit) {
+        return false;
+    }
+    std::size_t first = set_for(key);
+    std::lock_guard<std::mutex> lock(lock_for(first));
+    Slot* slot = find(key, now_ms / bucket_ms, true, limit);
+    if (slot == nullptr) {
+        refusals.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (slot->total + amount > limit) {
+        return false;
+    }
+    counts[static_cast<std::size_t>(slot - &slots[0]) * buckets +
+           static_cast<std::size_t>(slot->head % static_cast<std::int64_t>(buckets))] += amount;
+    slot->total += amount;
+    return true;
+}
+
+// Frees the key's slot; its buckets are cleared when the slot is reused.
+void SlidingWindowCounters::reset(std::uint64_t key) {
+    std::size_t first = set_for(key);
+    std::lock_guard<std::mutex> lock(lock_for(first));
+    for (std::size_t i = first; i < first + WAYS; ++i) {
+        if (slots[i].used && slots[i].key == key) {
+            slots[i].used = false;
+            return;
+        }
+    }
+}
+
+// Counts keys whose newest bucket is still inside the window and whose total is not zero.
+WindowCounterStats SlidingWindowCounters::stats(std::int64_t now_ms) const {
+    const std::int64_t now_bucket = now_ms / bucket_ms;
+    WindowCounterStats result = {slots.size(), 0, evictions.load(std::memory_order_relaxed),
+                                 refusals.load(std::memory_order_relaxed)};
+    for (std::size_t first = 0; first < slots.size(); first += WAYS) {
+        std::lock_guard<std::mutex> lock(lock_for(first));
+        for (std::size_t i = first; i < first + WAYS; ++i) {
+            const Slot& slot = slots[i];
+            if (slot.used && slot.total > 0 && now_bucket - slot.head < static_cast<std::int64_t>(buckets)) {
+                ++result.active;
+            }
+        }
+    }
+    return result;
+}
+
+// Looks the key up among its set's slots. A new key takes a free slot, then
+// an idle one, then evicts the slot updated least recently among those below keep_from.
+SlidingWindowCounters::Slot* SlidingWindowCounters::find(std::uint64_t key, std::int64_t now_bucket, bool create,
+                                                         std::int64_t keep_from) {
+    const std::size_t first = set_for(key);
+    for (std::size_t i = first; i < first + WAYS; ++i) {
+        if (slots[i].used && slots[i].key == key) {
+            advance(slots[i], now_bucket);
+            return &slots[i];
+        }
+    }
+    if (!create) {
+        return nullptr;
+    }
+
+    std::size_t victim = NO_VICTIM;
+    bool found = false;
+    for (std::size_t i = first; i < first + WAYS; ++i) {
+        if (slots[i].used) {
+            advance(slots[i], now_bucket);
+        }
+        if (!slots[i].used || slots[i].total == 0) {
+            victim = i;
+            found = true;
+            break;
+        }
+        if (slots[i].total < keep_from && (victim == NO_VICTIM || slots[i].head < slots[victim].head)) {
+            victim = i;
+        }
+    }
+    if (victim == NO_VICTIM) {
+        return nullptr;
+    }
+    if (!found) {
+        evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+    Slot& slot = slots[victim];
+    std::fill(counts.begin() + static_cast<std::ptrdiff_t>(victim * buckets),
+              counts.begin() + static_cast<std::ptrdiff_t>((victim + 1) * buckets), 0);
+    slot.key = key;
+    slot.head = now_bucket;
+    slot.total = 0;
+    slot.used = true;
+    return &slot;
+}
+
+// Zeroes the buckets between the slot's head and now_bucket and subtracts
+// them from the total. Clock readings older than the head count as the head.
+void SlidingWindowCounters::advance(Slot& slot, std::int64_t now_bucket) {
+    if (now_bucket <= slot.head) {
+        return;
+    }
+    std::int64_t* base = &counts[static_cast<std::size_t>(&slot - &slots[0]) * buckets];
+    const std::int64_t width = static_cast<std::int64_t>(buckets);
+    if (now_bucket - slot.head >= width) {
+        std::fill(base, base + buckets, 0);
+        slot.total = 0;
+    } else {
+        for (std::int64_t b = slot.head + 1; b <= now_bucket; ++b) {
+            std::int64_t& bucket = base[static_cast<std::size_t>(b % width)];
+            slot.total -= bucket;
+            bucket = 0;
+        }
+    }
+    slot.head = now_bucket;
+}
+
+// Returns the index of the first slot of a key's set.
+std::size_t SlidingWindowCounters::set_for(std::uint64_t key) const {
+    return static_cast<std::size_t>(FlatAccountTable::hash(key) & set_mask) * WAYS;
+}
+
+// Returns the lock stripe guarding the set that starts at slot first.
+std::mutex& SlidingWindowCounters::lock_for(std::size_t first) const {
+    return locks[(first / WAYS) % LOCK_STRIPES];
+}
+
+namespace {
+
+// Checks the thresholds before any table is built.
+const LimitsConfig& validate(const LimitsConfig& config) {
+    if (config.max_pin_failures < 0 || config.max_daily_withdrawal < 0 || config.max_atm_transactions < 0) {
+        throw std::invalid_argument("Limits cannot be negative.");
+    }
+    return config;
+}
+
+} // namespace
+
+// Constructor that builds one counter table per limit.
+TransactionLimits::TransactionLimits(const LimitsConfig& config)
+    : config(validate(config)),
+      pin_failures(config.pin_failure_window, WINDOW_BUCKETS, config.capacity),
+      withdrawals(config.withdrawal_window, WINDOW_BUCKETS, config.capacity),
+      atm_transactions(config.atm_rate_window, WINDOW_BUCKETS, config.capacity) {}
+
+// Counts the attempt against the card's failures if it is not already locked.
+Result<void> TransactionLimits::try_pin_attempt(std::uint64_t card_key, std::int64_t now_ms) {
+    if (config.max_pin_failures == 0) {
+        return Result<void>();
+    }
+    if (!pin_failures.try_add(card_key, 1, config.max_pin_failures, now_ms)) {
+        return TxError::CardLocked;
+    }
+    return Result<void>();
+}
+
+// Clears a card's failures after a correct PIN.
+void TransactionLimits::pin_accepted(std::uint64_t card_key) {
+    if (config.max_pin_failures != 0) {
+        pin_failures.reset(card_key);
+    }
+}
+
+// Retrieves the wrong PINs counted for a card within the window.
+std::int64_t TransactionLimits::pin_failures_for(std::uint64_t card_key, std::int64_t now_ms) {
+    return pin_failures.total(card_key, now_ms);
+}
+
+// Returns the key a linked account's withdrawals are limited under.
+std::uint64_t linked_account_limit_key(const std::string& account_id) {
+    return static_cast<std::uint64_t>(std::hash<std::string>()(account_id)) | (1ULL << 63);
+}
+
+// Counts the withdrawal if the account stays within its rolling limit.
+Result<void> TransactionLimits::try_reserve_withdrawal(std::uint64_t account_key, int amount, std::int64_t now_ms) {
+    if (amount <= 0) {
+        return TxError::InvalidAmount;
+    }
+    if (config.max_daily_withdrawal == 0) {
+        return Result<void>();
+    }
+    if (!withdrawals.try_add(account_key, amount, config.max_daily_withdrawal, now_ms)) {
+        return TxError::DailyLimitExceeded;
+    }
+    return Result<void>();
+}
+
+// Takes back a reserved withdrawal.
+void TransactionLimits::release_withdrawal(std::uint64_t account_key, int amount, std::int64_t now_ms) {
+    if (config.max_daily_withdrawal != 0 && amount > 0) {
+        withdrawals.add(account_key, -static_cast<std::int64_t>(amount), now_ms);
+    }
+}
+
+// Retrieves what the account has withdrawn within the rolling window.
+std::int64_t TransactionLimits::withdrawn(std::uint64_t account_key, std::int64_t now_ms) {
+    return withdrawals.total(account_key, now_ms);
+}
+
+// Counts the transaction if the ATM is within its rate.
+Result<void> TransactionLimits::try_atm_transaction(std::uint32_t atm_id, std::int64_t now_ms) {
+    if (config.max_atm_transactions == 0) {
+        return Result<void>();
+    }
+    if (!atm_transactions.try_add(atm_id, 1, config.max_atm_transactions, now_ms)) {
+        return TxError::RateLimited;
+    }
+    return Result<void>();
+}
+
+// Retrieves the counters of each table.
+WindowCounterStats TransactionLimits::pin_stats(std::int64_t now_ms) const {
+    return pin_failures.stats(now_ms);
+}
+
+WindowCounterStats TransactionLimits::withdrawal_stats(std::int64_t now_ms) const {
+    return withdrawals.stats(now_ms);
+}
+
+WindowCounterStats TransactionLimits::atm_stats(std::int64_t now_ms) const {
+    return atm_transactions.stats(now_ms);
+}
@@ -0,0 +1,274 @@
+#include "Logger.h"
+#include <iostream>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+
+std::atomic<int> Logger::min_level(static_cast<int>(LogLevel::Info));
+
+namespace {
+
+// Number of ring slots the writer moves per batch before writing them out.
+const std::size_t BATCH_SIZE = Logger::RING_CAPACITY / 4;
+
+// Longest the writer sleeps when it believes the ring is empty.
+const std::chrono::milliseconds IDLE_WAIT(50);
+
+std::int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Appends "[YYYY-MM-DD HH:MM:SS] " for the given wall-clock time.
+void append_timestamp(std::string& out, std::int64_t time_us) {
+    std::time_t seconds = static_cast<std::time_t>(time_us / 1000000);
+    std::tm local_tm;
+    localtime_r(&seconds, &local_tm);
+    char buffer[32];
+    std::size_t length = std::strftime(buffer, sizeof(buffer), "[%Y-%m-%d %H:%M:%S] ", &local_tm);
+    out.append(buffer, length);
+}
+
+} // namespace
+
+// Returns the label printed for a level (e.g. "INFO").
+const char* log_level_name(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Info: return "INFO";
+        case LogLevel::Warn: return "WARN";
+        case LogLevel::Error: return "ERROR";
+        default: return "OFF";
+    }
+}
+
+// Parses a label such as "INFO" or "WARN". Unknown labels map to Info.
+LogLevel parse_log_level(const std::string& name) {
+    if (name == "DEBUG") return LogLevel::Debug;
+    if (name == "WARN" || name == "WARNING") return LogLevel::Warn;
+    if (name == "ERROR") return LogLevel::Error;
+    if (name == "OFF") return LogLevel::Off;
+    return LogLevel::Info;
+}
+
+// Formats a floating-point value with two decimals.
+LogLine& LogLine::operator<<(double value) {
+    char text[32];
+    int count = std::snprintf(text, sizeof(text), "%.2f", value);
+    if (count > 0) {
+        append(text, static_cast<std::size_t>(count) < sizeof(text) ? count : sizeof(text) - 1);
+    }
+    return *this;
+}
+
+// Retrieves the process-wide logger, starting its writer thread on first use.
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+// Sets the minimum level that is written.
+void Logger::set_level(LogLevel level) {
+    min_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+// Retrieves the minimum level that is written.
+LogLevel Logger::level() {
+    return static_cast<LogLevel>(min_level.load(std::memory_order_relaxed));
+}
+
+// Constructor prepares the ring and starts the writer thread.
+Logger::Logger()
+    : slots(new Slot[RING_CAPACITY]), enqueue_pos(0), dequeue_pos(0), written_pos(0),
+      dropped(0), dropped_reported(0), console_enabled(true), writer_idle(false), stopping(false) {
+    for (std::size_t i = 0; i < RING_CAPACITY; ++i) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    writer = std::thread(&Logger::run, this);
+}
+
+// Drains the remaining messages and stops the writer thread.
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+}
+
+// Queues a message for the writer thread (bounded MPMC ring, producers never block).
+bool Logger::submit(LogLevel level, const char* text, std::size_t length, int file_sink, bool with_timestamp) {
+    std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &slots[pos & (RING_CAPACITY - 1)];
+        std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Ring is full: drop rather than block the transaction path.
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    if (length > LogLine::CAPACITY) {
+        length = LogLine::CAPACITY;
+    }
+    slot->level = level;
+    slot->file_sink = static_cast<std::int16_t>(file_sink);
+    slot->with_timestamp = with_timestamp;
+    slot->length = static_cast<std::uint16_t>(length);
+    slot->time_us = with_timestamp ? now_us() : 0;
+    std::memcpy(slot->text, text, length);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    if (writer_idle.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        wake.notify_one();
+    }
+    return true;
+}
+
+// Returns the ID of an append-mode file sink, opening it on first use.
+int Logger::open_file_sink(const std::string& path) {
+    std::lock_guard<std::mutex> lock(sink_mutex);
+    for (std::size_t i = 0; i < file_sinks.size(); ++i) {
+        if (file_sinks[i].first == path) {
+            return static_cast<int>(i);
+        }
+    }
+    if (file_sinks.size() >= MAX_FILE_SINKS) {
+        return -1;
+    }
+    std::unique_ptr<std::ofstream> file(new std::ofstream(path, std::ios::app));
+    if (!file->is_open()) {
+        return -1;
+    }
+    file_sinks.emplace_back(path, std::move(file));
+    return static_cast<int>(file_sinks.size() - 1);
+}
+
+// Enables or disables writing to std::cout.
+void Logger::set_console_enabled(bool enabled) {
+    console_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+// Blocks until every message queued before the call has been written.
+void Logger::flush() {
+    std::size_t target = enqueue_pos.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    wake.notify_one();
+    progress.wait(lock, [this, target]() {
+        return written_pos.load(std::memory_order_acquire) >= target;
+    });
+}
+
+// Retrieves the number of messages dropped because the ring was full.
+std::uint64_t Logger::dropped_count() const {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+// Retrieves the number of messages written by the background thread.
+std::uint64_t Logger::written_count() const {
+    return written_pos.load(std::memory_order_relaxed);
+}
+
+// Moves up to one batch from the ring into the output buffers.
+std::size_t Logger::drain(std::string& console, std::vector<std::string>& files) {
+    std::size_t count = 0;
+    while (count < BATCH_SIZE) {
+        Slot& slot = slots[dequeue_pos & (RING_CAPACITY - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) {
+            break;
+        }
+
+        std::size_t start = console.size();
+        if (slot.with_timestamp) {
+            append_timestamp(console, slot.time_us);
+            console += '[';
+            console += log_level_name(slot.level);
+            console += "]: ";
+        } else {
+            console += '[';
+            console += log_level_name(slot.level);
+            console += "] ";
+        }
+        console.append(slot.text, slot.length);
+        console += '\n';
+
+        if (slot.file_sink >= 0) {
+            if (files.size() <= static_cast<std::size_t>(slot.file_sink)) {
+                files.resize(slot.file_sink + 1);
+            }
+            files[slot.file_sink].append(console, start, std::string::npos);
+        }
+
+        slot.sequence.store(dequeue_pos + RING_CAPACITY, std::memory_order_release);
+        ++dequeue_pos;
+        ++count;
+    }
+
+    std::uint64_t dropped_now = dropped.load(std::memory_order_relaxed);
+    if (dropped_now != dropped_reported) {
+        LogLine notice;
+        notice << "[WARN] Logger dropped " << (dropped_now - dropped_reported)
+               << " messages (ring full).\n";
+        console.append(notice.data(), notice.size());
+        dropped_reported = dropped_now;
+    }
+    return count;
+}
+
+// Writer thread body: drain, write one batch, repeat; sleep when the ring is empty.
+void Logger::run() {
+    std::string console;
+    std::vector<std::string> files;
+    for (;;) {
+        console.clear();
+        for (std::string& file : files) {
+            file.clear();
+        }
+
+        std::size_t count = drain(console, files);
+        if (!console.empty() && console_enabled.load(std::memory_order_relaxed)) {
+            std::cout.write(console.data(), static_cast<std::streamsize>(console.size()));
+            std::cout.flush();
+        }
+        if (!files.empty()) {
+            std::lock_guard<std::mutex> lock(sink_mutex);
+            for (std::size_t i = 0; i < files.size() && i < file_sinks.size(); ++i) {
+                if (!files[i].empty()) {
+                    file_sinks[i].second->write(files[i].data(), static_cast<std::streamsize>(files[i].size()));
+                    file_sinks[i].second->flush();
+                }
+            }
+        }
+
+        if (count > 0) {
+            written_pos.store(dequeue_pos, std::memory_order_release);
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            progress.notify_all();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        if (stopping) {
+            break;
+        }
+        writer_idle.store(true, std::memory_order_release);
+        // Re-check after publishing the idle flag so a racing producer is not missed.
+        Slot& next = slots[dequeue_pos & (RING_CAPACITY - 1)];
+        if (next.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) {
+            wake.wait_for(lock, IDLE_WAIT);
+        }
+        writer_idle.store(false, std::memory_order_relaxed);
+        progress.notify_all();
+    }
+}
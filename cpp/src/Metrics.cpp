@@ -0,0 +1,252 @@
+#include "Metrics.h"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include "Logger.h"
+
+namespace {
+
+const char* const OP_NAMES[METRIC_OP_COUNT] = {
+    "atm_insert_card", "atm_eject_card", "atm_enter_pin", "atm_select_account", "atm_view_balance",
+    "atm_deposit", "atm_withdraw", "atm_mini_statement", "atm_transfer", "bank_add_account", "bank_validate_pin",
+    "bank_authenticate", "bank_get_account"
+};
+
+const char* const ERROR_NAMES[METRIC_ERROR_COUNT] = {
+    "invalid_argument", "length_error", "logic_error", "runtime_error", "other"
+};
+
+// Upper bounds (in seconds) of the exported histogram buckets.
+const double EXPORT_BOUNDS[] = {
+    250e-9, 500e-9, 1e-6, 2.5e-6, 5e-6, 10e-6, 25e-6, 50e-6, 100e-6, 250e-6, 500e-6,
+    1e-3, 2.5e-3, 5e-3, 10e-3, 25e-3, 50e-3, 100e-3, 250e-3, 500e-3, 1.0, 2.5, 5.0, 10.0
+};
+
+// Classifies the exception currently being handled.
+MetricError classify_current_exception() {
+    try {
+        throw;
+    } catch (const std::invalid_argument&) {
+        return MetricError::InvalidArgument;
+    } catch (const std::length_error&) {
+        return MetricError::LengthError;
+    } catch (const std::logic_error&) {
+        return MetricError::LogicError;
+    } catch (const std::runtime_error&) {
+        return MetricError::RuntimeError;
+    } catch (...) {
+        return MetricError::Other;
+    }
+}
+
+} // namespace
+
+// Hands the thread's block back for reuse when the thread exits.
+struct MetricsThreadSlot {
+    Metrics::ThreadBlock* block;
+
+    MetricsThreadSlot() : block(nullptr) {}
+
+    ~MetricsThreadSlot() {
+        if (block != nullptr) {
+            Metrics::instance().release_block(block);
+        }
+    }
+};
+
+namespace {
+
+thread_local MetricsThreadSlot thread_slot;
+
+} // namespace
+
+// Returns the label an operation is exported under.
+const char* metric_op_name(MetricOp op) {
+    return OP_NAMES[static_cast<std::size_t>(op)];
+}
+
+// Returns the label an exception type is exported under.
+const char* metric_error_name(MetricError error) {
+    return ERROR_NAMES[static_cast<std::size_t>(error)];
+}
+
+// Constructor that zeroes every counter.
+Metrics::ThreadBlock::ThreadBlock() {
+    for (std::size_t op = 0; op < METRIC_OP_COUNT; ++op) {
+        calls[op].store(0, std::memory_order_relaxed);
+        for (std::size_t error = 0; error < METRIC_ERROR_COUNT; ++error) {
+            errors[op][error].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+// Retrieves the process-wide metrics. Never destroyed, so threads exiting
+// after main() returns can still hand their blocks back.
+Metrics& Metrics::instance() {
+    static Metrics* metrics = new Metrics();
+    return *metrics;
+}
+
+// Returns the calling thread's block, taking one on first use.
+Metrics::ThreadBlock& Metrics::local() {
+    if (thread_slot.block == nullptr) {
+        thread_slot.block = instance().acquire_block();
+    }
+    return *thread_slot.block;
+}
+
+// Hands a block to a new thread, reusing one from an exited thread if possible.
+Metrics::ThreadBlock* Metrics::acquire_block() {
+    std::lock_guard<std::mutex> lock(blocks_mutex);
+    if (!free_blocks.empty()) {
+        ThreadBlock* block = free_blocks.back();
+        free_blocks.pop_back();
+        return block;
+    }
+    blocks.emplace_back(new ThreadBlock());
+    return blocks.back().get();
+}
+
+// Takes a block back from an exiting thread; its counts stay in the totals.
+void Metrics::release_block(ThreadBlock* block) {
+    std::lock_guard<std::mutex> lock(blocks_mutex);
+    free_blocks.push_back(block);
+}
+
+// Records one completed call and its duration on the calling thread.
+void Metrics::record(MetricOp op, std::uint64_t elapsed_ns) {
+    ThreadBlock& block = local();
+    std::size_t index = static_cast<std::size_t>(op);
+    std::atomic<std::uint64_t>& calls = block.calls[index];
+    calls.store(calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    block.latency[index].record(elapsed_ns);
+}
+
+// Counts a failed call under the type of the exception being handled.
+void Metrics::record_current_exception(MetricOp op) {
+    record_error(op, classify_current_exception());
+}
+
+// Counts a failed call under the given exception type.
+void Metrics::record_error(MetricOp op, MetricError error) {
+    std::atomic<std::uint64_t>& count = local().errors[static_cast<std::size_t>(op)][static_cast<std::size_t>(error)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// Sums every thread's counters and histograms.
+MetricsSnapshot Metrics::snapshot() const {
+    MetricsSnapshot snapshot;
+    snapshot.operations.resize(METRIC_OP_COUNT);
+    for (OperationMetrics& operation : snapshot.operations) {
+        operation.calls = 0;
+        for (std::uint64_t& errors : operation.errors) {
+            errors = 0;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(blocks_mutex); // Keeps the list stable; recording does not take it.
+    for (const std::unique_ptr<ThreadBlock>& block : blocks) {
+        for (std::size_t op = 0; op < METRIC_OP_COUNT; ++op) {
+            OperationMetrics& operation = snapshot.operations[op];
+            operation.calls += block->calls[op].load(std::memory_order_relaxed);
+            for (std::size_t error = 0; error < METRIC_ERROR_COUNT; ++error) {
+                operation.errors[error] += block->errors[op][error].load(std::memory_order_relaxed);
+            }
+            block->latency[op].add_to(operation.latency);
+        }
+    }
+    return snapshot;
+}
+
+// Writes a snapshot in Prometheus text exposition format.
+void Metrics::write_prometheus(const MetricsSnapshot& snapshot, std::ostream& out) {
+    out << "# HELP atm_operation_calls_total Completed calls per operation, failed ones included.\n"
+        << "# TYPE atm_operation_calls_total counter\n";
+    for (std::size_t op = 0; op < METRIC_OP_COUNT; ++op) {
+        out << "atm_operation_calls_total{op=\"" << OP_NAMES[op] << "\"} " << snapshot.operations[op].calls << '\n';
+    }
+
+    out << "# HELP atm_operation_errors_total Failed calls per operation by exception type.\n"
+        << "# TYPE atm_operation_errors_total counter\n";
+    for (std::size_t op = 0; op < METRIC_OP_COUNT; ++op) {
+        for (std::size_t error = 0; error < METRIC_ERROR_COUNT; ++error) {
+            out << "atm_operation_errors_total{op=\"" << OP_NAMES[op] << "\",exception=\"" << ERROR_NAMES[error]
+                << "\"} " << snapshot.operations[op].errors[error] << '\n';
+        }
+    }
+
+    // Exported buckets are coarser than the recorded ones: each counts the
+    // recorded buckets that lie entirely below its bound.
+    out << "# HELP atm_operation_duration_seconds Wall time per call.\n"
+        << "# TYPE atm_operation_duration_seconds histogram\n";
+    for (std::size_t op = 0; op < METRIC_OP_COUNT; ++op) {
+        const LatencyHistogram& latency = snapshot.operations[op].latency;
+        std::size_t bucket = 0;
+        std::uint64_t cumulative = 0;
+        for (double bound : EXPORT_BOUNDS) {
+            std::uint64_t bound_ns = static_cast<std::uint64_t>(bound * 1e9 + 0.5);
+            while (bucket < LatencyHistogram::BUCKET_COUNT && LatencyHistogram::bucket_upper_bound(bucket) <= bound_ns) {
+                cumulative += latency.bucket_count(bucket++);
+            }
+            out << "atm_operation_duration_seconds_bucket{op=\"" << OP_NAMES[op] << "\",le=\"" << bound << "\"} "
+                << cumulative << '\n';
+        }
+        out << "atm_operation_duration_seconds_bucket{op=\"" << OP_NAMES[op] << "\",le=\"+Inf\"} " << latency.count()
+            << '\n'
+            << "atm_operation_duration_seconds_sum{op=\"" << OP_NAMES[op] << "\"} " << latency.mean() * latency.count() / 1e9
+            << '\n'
+            << "atm_operation_duration_seconds_count{op=\"" << OP_NAMES[op] << "\"} " << latency.count() << '\n';
+    }
+}
+
+// Starts the writer thread.
+MetricsExporter::MetricsExporter(const std::string& path, std::chrono::milliseconds interval)
+    : path(path), interval(interval), stopping(false) {
+    if (interval.count() <= 0) {
+        throw std::invalid_argument("Metrics export interval must be positive.");
+    }
+    writer = std::thread(&MetricsExporter::run, this);
+}
+
+// Stops the writer thread after one final write.
+MetricsExporter::~MetricsExporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    writer.join();
+}
+
+// Writes the file now, replacing the previous one atomically.
+void MetricsExporter::write_now() {
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path.c_str(), std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Cannot open metrics file: " + temp_path);
+        }
+        Metrics::write_prometheus(Metrics::instance().snapshot(), out);
+        if (!out) {
+            throw std::runtime_error("Cannot write metrics file: " + temp_path);
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Cannot replace metrics file: " + path);
+    }
+}
+
+// Writer thread body: write once per interval until stopped, then once more.
+void MetricsExporter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        wake.wait_for(lock, interval, [this]() { return stopping; });
+        lock.unlock();
+        try {
+            write_now();
+        } catch (const std::exception& e) {
+            ATM_LOG_WARN("Metrics export failed: " << e.what()); // Retried next interval.
+        }
+        lock.lock();
+    }
+}
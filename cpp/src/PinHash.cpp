@@ -0,0 +1,312 @@
+#include "PinHash.h"
+#include <cstring>
+#include <random>
+
+namespace {
+
+const std::uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+const std::size_t BLOCK_SIZE = 64;
+const char* const CREDENTIAL_PREFIX = "pbkdf2-sha256$";
+
+inline std::uint32_t rotr(std::uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+inline std::uint32_t load_be32(const std::uint8_t* p) {
+    return (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16) |
+           (static_cast<std::uint32_t>(p[2]) << 8) | p[3];
+}
+
+inline void store_be32(std::uint8_t* p, std::uint32_t v) {
+    p[0] = static_cast<std::uint8_t>(v >> 24);
+    p[1] = static_cast<std::uint8_t>(v >> 16);
+    p[2] = static_cast<std::uint8_t>(v >> 8);
+    p[3] = static_cast<std::uint8_t>(v);
+}
+
+// Incremental SHA-256 (FIPS 180-4).
+struct Sha256 {
+    std::uint32_t state[8];
+    std::uint8_t buffer[BLOCK_SIZE];
+    std::uint64_t length;   // Bytes absorbed so far.
+    std::size_t buffered;
+
+    Sha256() : length(0), buffered(0) {
+        static const std::uint32_t INITIAL[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                                 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        std::memcpy(state, INITIAL, sizeof(state));
+    }
+
+    void compress(const std::uint8_t* block) {
+        std::uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = load_be32(block + 4 * i);
+        }
+        for (int i = 16; i < 64; ++i) {
+            std::uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            std::uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        std::uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            std::uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            std::uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+
+    void update(const void* data, std::size_t size) {
+        if (size == 0) {
+            return;
+        }
+        const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+        length += size;
+        if (buffered != 0) {
+            std::size_t take = BLOCK_SIZE - buffered < size ? BLOCK_SIZE - buffered : size;
+            std::memcpy(buffer + buffered, bytes, take);
+            buffered += take;
+            bytes += take;
+            size -= take;
+            if (buffered < BLOCK_SIZE) {
+                return;
+            }
+            compress(buffer);
+            buffered = 0;
+        }
+        for (; size >= BLOCK_SIZE; bytes += BLOCK_SIZE, size -= BLOCK_SIZE) {
+            compress(bytes);
+        }
+        std::memcpy(buffer, bytes, size);
+        buffered = size;
+    }
+
+    void finish(std::uint8_t digest[SHA256_DIGEST_SIZE]) {
+        std::uint64_t bits = length * 8;
+        std::uint8_t padding[BLOCK_SIZE + 8] = {0x80};
+        std::size_t pad = (buffered < 56 ? 56 : 120) - buffered;
+        std::uint8_t encoded_length[8];
+        for (int i = 0; i < 8; ++i) {
+            encoded_length[i] = static_cast<std::uint8_t>(bits >> (56 - 8 * i));
+        }
+        update(padding, pad);
+        update(encoded_length, 8);
+        for (int i = 0; i < 8; ++i) {
+            store_be32(digest + 4 * i, state[i]);
+        }
+    }
+};
+
+// HMAC-SHA256 keyed once; the inner and outer pad states are reused for every message.
+struct HmacSha256 {
+    Sha256 inner;
+    Sha256 outer;
+
+    HmacSha256(const void* key, std::size_t key_size) {
+        std::uint8_t block[BLOCK_SIZE] = {0};
+        if (key_size > BLOCK_SIZE) {
+            sha256(key, key_size, block);
+        } else {
+            std::memcpy(block, key, key_size);
+        }
+        std::uint8_t pad[BLOCK_SIZE];
+        for (std::size_t i = 0; i < BLOCK_SIZE; ++i) {
+            pad[i] = block[i] ^ 0x36;
+        }
+        inner.update(pad, BLOCK_SIZE);
+        for (std::size_t i = 0; i < BLOCK_SIZE; ++i) {
+            pad[i] = block[i] ^ 0x5c;
+        }
+        outer.update(pad, BLOCK_SIZE);
+    }
+
+    // Computes HMAC(key, first || second).
+    void mac(const void* first, std::size_t first_size, const void* second, std::size_t second_size,
+             std::uint8_t out[SHA256_DIGEST_SIZE]) const {
+        Sha256 state = inner;
+        state.update(first, first_size);
+        state.update(second, second_size);
+        std::uint8_t inner_digest[SHA256_DIGEST_SIZE];
+        state.finish(inner_digest);
+        state = outer;
+        state.update(inner_digest, SHA256_DIGEST_SIZE);
+        state.finish(out);
+    }
+
+    // Runs rounds more PBKDF2 iterations: u = HMAC(key, u), accumulating u into t.
+    // Every message is one 32-byte digest after a 64-byte pad block, so the
+    // padded final blocks are fixed and each HMAC costs two compressions.
+    void iterate(std::uint8_t u[SHA256_DIGEST_SIZE], std::uint8_t t[SHA256_DIGEST_SIZE], std::uint32_t rounds) const {
+        std::uint8_t block[BLOCK_SIZE] = {0};
+        block[SHA256_DIGEST_SIZE] = 0x80;
+        block[BLOCK_SIZE - 2] = 0x03; // (64 + 32) * 8 = 768 bits.
+        std::memcpy(block, u, SHA256_DIGEST_SIZE);
+        for (std::uint32_t round = 0; round < rounds; ++round) {
+            Sha256 state = inner;
+            state.compress(block);
+            for (int i = 0; i < 8; ++i) {
+                store_be32(block + 4 * i, state.state[i]);
+            }
+            std::memcpy(state.state, outer.state, sizeof(state.state));
+            state.compress(block);
+            for (int i = 0; i < 8; ++i) {
+                store_be32(block + 4 * i, state.state[i]);
+            }
+            for (std::size_t j = 0; j < SHA256_DIGEST_SIZE; ++j) {
+                t[j] ^= block[j];
+            }
+        }
+        std::memcpy(u, block, SHA256_DIGEST_SIZE);
+    }
+};
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+void append_hex(std::string& out, const std::uint8_t* bytes, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+        out += HEX_DIGITS[bytes[i] >> 4];
+        out += HEX_DIGITS[bytes[i] & 0xF];
+    }
+}
+
+bool parse_hex(const std::string& text, std::uint8_t* bytes, std::size_t size) {
+    if (text.size() != size * 2) {
+        return false;
+    }
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        int value = c >= '0' && c <= '9' ? c - '0' : (c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1);
+        if (value < 0) {
+            return false;
+        }
+        bytes[i / 2] = static_cast<std::uint8_t>(i % 2 == 0 ? value << 4 : bytes[i / 2] | value);
+    }
+    return true;
+}
+
+} // namespace
+
+// Computes the SHA-256 digest of a byte string.
+void sha256(const void* data, std::size_t size, std::uint8_t digest[SHA256_DIGEST_SIZE]) {
+    Sha256 state;
+    state.update(data, size);
+    state.finish(digest);
+}
+
+// Derives size bytes from a password and salt with PBKDF2-HMAC-SHA256.
+void pbkdf2_hmac_sha256(const void* password, std::size_t password_size, const void* salt, std::size_t salt_size,
+                        std::uint32_t iterations, std::uint8_t* out, std::size_t size) {
+    HmacSha256 hmac(password, password_size);
+    for (std::uint32_t block = 1; size > 0; ++block) {
+        std::uint8_t index[4];
+        store_be32(index, block);
+        std::uint8_t u[SHA256_DIGEST_SIZE];
+        std::uint8_t t[SHA256_DIGEST_SIZE];
+        hmac.mac(salt, salt_size, index, sizeof(index), u);
+        std::memcpy(t, u, SHA256_DIGEST_SIZE);
+        if (iterations > 1) {
+            hmac.iterate(u, t, iterations - 1);
+        }
+        std::size_t take = size < SHA256_DIGEST_SIZE ? size : SHA256_DIGEST_SIZE;
+        std::memcpy(out, t, take);
+        out += take;
+        size -= take;
+    }
+}
+
+// Hashes a PIN with a fresh random salt at the given cost.
+PinCredential hash_pin(const std::string& pin, std::uint32_t iterations) {
+    PinCredential credential;
+    credential.iterations = iterations == 0 ? 1 : iterations;
+    // Salts need to be unique, not secret: seed one generator per thread from
+    // the OS instead of reading the OS source (microseconds) for every PIN.
+    thread_local std::mt19937 random = []() {
+        std::random_device device;
+        std::seed_seq seed{device(), device(), device(), device(), device(), device(), device(), device()};
+        return std::mt19937(seed);
+    }();
+    for (std::size_t i = 0; i < PIN_SALT_SIZE; i += 4) {
+        store_be32(credential.salt + i, static_cast<std::uint32_t>(random()));
+    }
+    pbkdf2_hmac_sha256(pin.data(), pin.size(), credential.salt, PIN_SALT_SIZE, credential.iterations,
+                       credential.hash, SHA256_DIGEST_SIZE);
+    return credential;
+}
+
+// Returns a credential that no PIN matches.
+PinCredential empty_pin_credential() {
+    PinCredential credential;
+    std::memset(&credential, 0, sizeof(credential));
+    return credential;
+}
+
+// Checks a PIN against a credential in time independent of where the keys differ.
+bool verify_pin(const PinCredential& credential, const std::string& pin) {
+    if (credential.iterations == 0) {
+        return false;
+    }
+    std::uint8_t derived[SHA256_DIGEST_SIZE];
+    pbkdf2_hmac_sha256(pin.data(), pin.size(), credential.salt, PIN_SALT_SIZE, credential.iterations,
+                       derived, SHA256_DIGEST_SIZE);
+    unsigned difference = 0;
+    for (std::size_t i = 0; i < SHA256_DIGEST_SIZE; ++i) {
+        difference |= derived[i] ^ credential.hash[i];
+    }
+    return difference == 0;
+}
+
+// Formats a credential for journals and snapshots.
+std::string encode_pin_credential(const PinCredential& credential) {
+    std::string text = CREDENTIAL_PREFIX;
+    text += std::to_string(static_cast<unsigned long>(credential.iterations));
+    text += '$';
+    append_hex(text, credential.salt, PIN_SALT_SIZE);
+    text += '$';
+    append_hex(text, credential.hash, SHA256_DIGEST_SIZE);
+    return text;
+}
+
+// Parses a string produced by encode_pin_credential.
+bool decode_pin_credential(const std::string& text, PinCredential& credential) {
+    std::size_t prefix = std::strlen(CREDENTIAL_PREFIX);
+    if (text.compare(0, prefix, CREDENTIAL_PREFIX) != 0) {
+        return false;
+    }
+    std::size_t salt_start = text.find('$', prefix);
+    std::size_t hash_start = salt_start == std::string::npos ? std::string::npos : text.find('$', salt_start + 1);
+    if (hash_start == std::string::npos || salt_start == prefix || salt_start - prefix > 10) {
+        return false;
+    }
+    std::uint64_t iterations = 0;
+    for (std::size_t i = prefix; i < salt_start; ++i) {
+        if (text[i] < '0' || text[i] > '9') {
+            return false;
+        }
+        iterations = iterations * 10 + static_cast<std::uint64_t>(text[i] - '0');
+    }
+    if (iterations == 0 || iterations > 0xFFFFFFFFu) {
+        return false;
+    }
+    credential.iterations = static_cast<std::uint32_t>(iterations);
+    return parse_hex(text.substr(salt_start + 1, hash_start - salt_start - 1), credential.salt, PIN_SALT_SIZE) &&
+           parse_hex(text.substr(hash_start + 1), credential.hash, SHA256_DIGEST_SIZE);
+}
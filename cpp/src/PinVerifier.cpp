@@ -0,0 +1,146 @@
+#include "PinVerifier.h"
+#include <chrono>
+#include <stdexcept>
+
+namespace {
+
+std::uint64_t now_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace
+
+// Starts the worker threads.
+PinVerifier::PinVerifier(const PinHashConfig& config)
+    : thread_count(config.verifier_threads), max_batch(config.max_batch), queue_head(0), stopping(false), stats_start_ns(now_ns()), verified(0), batches(0), busy_ns(0) {
+    if (config.verifier_threads == 0 || config.max_batch == 0) {
+        throw std::invalid_argument("PIN verifier needs at least one thread and a positive batch size.");
+    }
+    for (std::size_t i = 0; i < config.verifier_threads; ++i) {
+        workers.emplace_back(&PinVerifier::run, this);
+    }
+}
+
+// Finishes every queued check and stops the workers.
+PinVerifier::~PinVerifier() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// Queues a check; done(matched) is called on a worker thread.
+void PinVerifier::submit(const PinCredential& credential, const std::string& pin, std::function<void(bool)> done) {
+    Job job;
+    job.credential = credential;
+    job.pin = pin;
+    job.done = std::move(done);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job.enqueued_ns = now_ns();
+        queue.push_back(std::move(job));
+    }
+    wake.notify_one();
+}
+
+// Queues a check and waits for its result.
+bool PinVerifier::verify(const PinCredential& credential, const std::string& pin) {
+    // The worker notifies while holding the lock, so this frame outlives its last use.
+    struct Waiter {
+        std::mutex mutex;
+        std::condition_variable signal;
+        bool done;
+        bool matched;
+    } waiter;
+    waiter.done = false;
+    waiter.matched = false;
+    // Captures one pointer, which std::function stores without allocating.
+    Waiter* state = &waiter;
+    submit(credential, pin, [state](bool value) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->matched = value;
+        state->done = true;
+        state->signal.notify_one();
+    });
+    std::unique_lock<std::mutex> lock(waiter.mutex);
+    waiter.signal.wait(lock, [&waiter]() { return waiter.done; });
+    return waiter.matched;
+}
+
+// Retrieves throughput and queue-wait statistics.
+PinVerifierStats PinVerifier::stats() const {
+    PinVerifierStats stats;
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.verified = verified.load(std::memory_order_relaxed);
+    stats.batches = batches.load(std::memory_order_relaxed);
+    stats.queue_depth = queue.size() - queue_head;
+    stats.seconds = (now_ns() - stats_start_ns) / 1e9;
+    stats.verifications_per_sec = stats.seconds > 0 ? stats.verified / stats.seconds : 0;
+    double capacity_ns = stats.seconds * 1e9 * thread_count;
+    stats.worker_utilization = capacity_ns > 0 ? busy_ns.load(std::memory_order_relaxed) / capacity_ns : 0;
+    stats.queue_wait_mean_ns = queue_wait.mean();
+    stats.queue_wait_p50_ns = queue_wait.percentile(0.50);
+    stats.queue_wait_p99_ns = queue_wait.percentile(0.99);
+    stats.queue_wait_max_ns = queue_wait.max();
+    return stats;
+}
+
+// Starts a new statistics interval.
+void PinVerifier::reset_stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue_wait.reset();
+    stats_start_ns = now_ns();
+    verified.store(0, std::memory_order_relaxed);
+    batches.store(0, std::memory_order_relaxed);
+    busy_ns.store(0, std::memory_order_relaxed);
+}
+
+// Worker thread body: take a batch, check it outside the lock, report results.
+void PinVerifier::run() {
+    std::vector<Job> batch;
+    batch.reserve(max_batch);
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this]() { return queue_head != queue.size() || stopping; });
+        if (queue_head == queue.size()) {
+            return; // Stopping and drained.
+        }
+        // Take a fair share of the queue so idle workers are not left waiting behind one batch.
+        std::size_t share = (queue.size() - queue_head + thread_count - 1) / thread_count;
+        std::size_t take = share < max_batch ? share : max_batch;
+        std::uint64_t dequeued_ns = now_ns();
+        while (batch.size() < take) {
+            queue_wait.record(dequeued_ns - queue[queue_head].enqueued_ns);
+            batch.push_back(std::move(queue[queue_head]));
+            ++queue_head;
+        }
+        if (queue_head == queue.size()) {
+            queue.clear(); // Keeps the capacity for the next checks.
+            queue_head = 0;
+        } else {
+            if (queue_head >= queue.size() / 2) {
+                // Taken checks fill half the storage: drop them so it does not grow under sustained load.
+                queue.erase(queue.begin(), queue.begin() + static_cast<std::ptrdiff_t>(queue_head));
+                queue_head = 0;
+            }
+            wake.notify_one();
+        }
+        lock.unlock();
+
+        batches.fetch_add(1, std::memory_order_relaxed);
+        for (Job& job : batch) {
+            bool matched = verify_pin(job.credential, job.pin);
+            verified.fetch_add(1, std::memory_order_relaxed); // Counted before the caller can observe it.
+            job.done(matched);
+        }
+        busy_ns.fetch_add(now_ns() - dequeued_ns, std::memory_order_relaxed);
+        batch.clear();
+
+        lock.lock();
+    }
+}
@@ -0,0 +1,162 @@
+#include "Posting.h"
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ATM_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Posting arithmetic for one balance. The product is exact in a double and the
+// quotient is at least 1/10000 from the next whole number, so truncating the
+// correctly rounded division gives the exact floor, as the vector kernels do.
+inline int delta_for(int balance, const PostingRules& rules) {
+    int interest = static_cast<int>(static_cast<double>(balance) * rules.interest_bp / 10000.0);
+    int fee = balance < rules.fee_waiver_balance ? (rules.fee < balance ? rules.fee : balance) : 0;
+    return interest - fee;
+}
+
+// Runs the scalar arithmetic over a range of balances.
+void postings_scalar(const int* balances, int* deltas, std::size_t begin, std::size_t end,
+                     const PostingRules& rules) {
+    for (std::size_t i = begin; i < end; ++i) {
+        deltas[i] = delta_for(balances[i], rules);
+    }
+}
+
+#ifdef ATM_HAVE_X86
+
+// Four balances per vector, converted to doubles two at a time for the
+// interest. SSE2 has no 32-bit minimum, so the fee cap is a compare and select.
+void postings_sse2(const int* balances, int* deltas, std::size_t count, const PostingRules& rules) {
+    const __m128d rate = _mm_set1_pd(rules.interest_bp);
+    const __m128d scale = _mm_set1_pd(10000.0);
+    const __m128i fee = _mm_set1_epi32(rules.fee);
+    const __m128i waiver = _mm_set1_epi32(rules.fee_waiver_balance);
+
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i balance = _mm_loadu_si128(reinterpret_cast<const __m128i*>(balances + i));
+        __m128d low = _mm_div_pd(_mm_mul_pd(_mm_cvtepi32_pd(balance), rate), scale);
+        __m128d high = _mm_div_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(balance, 0x4E)), rate), scale);
+        __m128i interest = _mm_unpacklo_epi64(_mm_cvttpd_epi32(low), _mm_cvttpd_epi32(high));
+
+        __m128i fee_above_balance = _mm_cmpgt_epi32(fee, balance);
+        __m128i capped_fee = _mm_or_si128(_mm_and_si128(fee_above_balance, balance),
+                                          _mm_andnot_si128(fee_above_balance, fee));
+        __m128i charged = _mm_and_si128(_mm_cmpgt_epi32(waiver, balance), capped_fee);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(deltas + i), _mm_sub_epi32(interest, charged));
+    }
+    postings_scalar(balances, deltas, i, count, rules);
+}
+
+// Same arithmetic as postings_sse2, eight balances per 256-bit register.
+__attribute__((target("avx2")))
+void postings_avx2(const int* balances, int* deltas, std::size_t count, const PostingRules& rules) {
+    const __m256d rate = _mm256_set1_pd(rules.interest_bp);
+    const __m256d scale = _mm256_set1_pd(10000.0);
+    const __m256i fee = _mm256_set1_epi32(rules.fee);
+    const __m256i waiver = _mm256_set1_epi32(rules.fee_waiver_balance);
+
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i balance = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(balances + i));
+        __m256d low = _mm256_div_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(balance)), rate), scale);
+        __m256d high = _mm256_div_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(balance, 1)), rate),
+                                     scale);
+        __m256i interest = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(low)),
+                                                   _mm256_cvttpd_epi32(high), 1);
+
+        __m256i charged = _mm256_and_si256(_mm256_cmpgt_epi32(waiver, balance), _mm256_min_epi32(fee, balance));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(deltas + i), _mm256_sub_epi32(interest, charged));
+    }
+    postings_scalar(balances, deltas, i, count, rules);
+}
+
+#endif // ATM_HAVE_X86
+
+} // namespace
+
+// Returns the kernel that PostingKernel::Auto resolves to on this CPU.
+PostingKernel best_posting_kernel() {
+#ifdef ATM_HAVE_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return PostingKernel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return PostingKernel::SSE2;
+    }
+#endif
+    return PostingKernel::Scalar;
+}
+
+// Returns a printable name for a kernel.
+const char* posting_kernel_name(PostingKernel kernel) {
+    switch (kernel) {
+        case PostingKernel::Scalar: return "scalar";
+        case PostingKernel::SSE2: return "sse2";
+        case PostingKernel::AVX2: return "avx2";
+        default: return "auto";
+    }
+}
+
+// Returns true if the kernel can run on this CPU.
+bool posting_kernel_supported(PostingKernel kernel) {
+    switch (kernel) {
+        case PostingKernel::Auto:
+        case PostingKernel::Scalar:
+            return true;
+#ifdef ATM_HAVE_X86
+        case PostingKernel::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case PostingKernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+// Throws unless the rules are in range.
+void check_posting_rules(const PostingRules& rules) {
+    if (rules.interest_bp < 0 || rules.interest_bp >= 10000) {
+        throw std::invalid_argument("Interest must be 0 to 9999 basis points.");
+    }
+    if (rules.fee < 0 || rules.fee_waiver_balance < 0) {
+        throw std::invalid_argument("Fee and fee waiver balance cannot be negative.");
+    }
+}
+
+// Returns the net change the rules make to one balance.
+int posting_delta(int balance, const PostingRules& rules) {
+    return delta_for(balance, rules);
+}
+
+// Computes the net change for every balance with the requested kernel.
+void compute_postings(const int* balances, int* deltas, std::size_t count, const PostingRules& rules,
+                      PostingKernel kernel) {
+    check_posting_rules(rules);
+    if (!posting_kernel_supported(kernel)) {
+        throw std::invalid_argument(std::string("Posting kernel not supported on this CPU: ") +
+                                    posting_kernel_name(kernel));
+    }
+    if (kernel == PostingKernel::Auto) {
+        kernel = best_posting_kernel();
+    }
+
+    switch (kernel) {
+#ifdef ATM_HAVE_X86
+        case PostingKernel::AVX2:
+            postings_avx2(balances, deltas, count, rules);
+            break;
+        case PostingKernel::SSE2:
+            postings_sse2(balances, deltas, count, rules);
+            break;
+#endif
+        default:
+            postings_scalar(balances, deltas, 0, count, rules);
+            break;
+    }
+}
@@ -0,0 +1,193 @@
+#include "RemoteATMController.h"
+#include <stdexcept>
+#include "Logger.h"
+#include "Metrics.h"
+
+// Constructor that sends requests through the given backend.
+RemoteATMController::RemoteATMController(BankBackend& backend, std::uint32_t atm_id)
+    : backend(backend), atm_id(atm_id), card(Card::from_key(0)), card_inserted(false), session(0) {}
+
+// Retrieves the ID of the ATM.
+std::uint32_t RemoteATMController::get_atm_id() const {
+    return atm_id;
+}
+
+// Loads the cassettes, replacing any loaded before.
+void RemoteATMController::load_cash(const std::vector<Cassette>& cassettes, int max_notes) {
+    dispenser.reset(new CashDispenser(cassettes, max_notes));
+}
+
+// Retrieves the cash inventory, or null if no cash is loaded.
+CashDispenser* RemoteATMController::get_cash_dispenser() const {
+    return dispenser.get();
+}
+
+// Simulates inserting a card into the ATM.
+void RemoteATMController::insert_card(const Card& inserted) {
+    MetricsTimer timer(MetricOp::AtmInsertCard);
+    try {
+        if (card_inserted) {
+            throw std::runtime_error("A card is already inserted.");
+        }
+        card = inserted;
+        card_inserted = true;
+        session = 0;
+
+        // Optional logging
+        ATM_LOG_INFO("Card inserted: " << card.get_card_number());
+    } catch (...) {
+        timer.fail();
+        throw;
+    }
+}
+
+// Simulates ejecting the currently inserted card.
+void RemoteATMController::eject_card() {
+    MetricsTimer timer(MetricOp::AtmEjectCard);
+    try {
+        if (!card_inserted) {
+            throw std::runtime_error("No card to eject.");
+        }
+
+        // Optional logging
+        ATM_LOG_INFO("Card ejected: " << card.get_card_number());
+
+        if (session != 0) {
+            backend.call(BackendRequest::end_session(card.get_key(), session)); // An expired session needs no closing.
+        }
+        card_inserted = false;
+        session = 0;
+    } catch (...) {
+        timer.fail();
+        throw;
+    }
+}
+
+// Checks the PIN and opens a bank session in one round trip.
+Result<void> RemoteATMController::try_enter_pin(const std::string& pin) {
+    MetricsTimer timer(MetricOp::AtmEnterPin);
+    try {
+        if (!card_inserted) {
+            return timer.fail(TxError::NoCard);
+        }
+        BackendReply reply = backend.call(BackendRequest::authenticate(card.get_key(), pin));
+        if (reply.error != TxError::None) {
+            return timer.fail(reply.error);
+        }
+        session = reply.session;
+
+        // Optional logging
+        ATM_LOG_INFO("PIN validated for card: " << card.get_card_number());
+        return Result<void>();
+    } catch (...) {
+        timer.fail();
+        throw;
+    }
+}
+
+// Validates the PIN for the inserted card.
+void RemoteATMController::enter_pin(const std::string& pin) {
+    try_enter_pin(pin).value();
+}
+
+// Asks the bank for the balance without throwing on a routine failure.
+Result<int> RemoteATMController::try_view_balance() {
+    MetricsTimer timer(MetricOp::AtmViewBalance);
+    try {
+        if (session == 0) {
+            return timer.fail(TxError::NoAccountSelected);
+        }
+        BackendReply reply = backend.call(BackendRequest::balance(card.get_key(), session));
+        if (reply.error != TxError::None) {
+            return timer.fail(reply.error);
+        }
+        return reply.balance;
+    } catch (...) {
+        timer.fail();
+        throw;
+    }
+}
+
+// Retrieves the balance of the card's account.
+int RemoteATMController::view_balance() {
+    return try_view_balance().value();
+}
+
+// Sends a deposit without throwing on a routine failure.
+Result<int> RemoteATMController::try_deposit(int amount) {
+    MetricsTimer timer(MetricOp::AtmDeposit);
+    try {
+        if (session == 0) {
+            return timer.fail(TxError::NoAccountSelected);
+        }
+        if (amount <= 0) {
+            return timer.fail(TxError::InvalidAmount);
+        }
+        BackendReply reply = backend.call(BackendRequest::deposit(card.get_key(), session, amount));
+        if (reply.error != TxError::None) {
+            return timer.fail(reply.error);
+        }
+
+        // Optional logging
+        ATM_LOG_INFO("Deposit made. Amount: " << amount << ", New Balance: " << reply.balance);
+
+        return reply.balance;
+    } catch (...) {
+        timer.fail();
+        throw;
+    }
+}
+
+// Deposits a specified amount into the card's account.
+int RemoteATMController::deposit(int amount) {
+    return try_deposit(amount).value();
+}
+
+// Reserves the notes, sends the withdrawal and gives the notes back unless the bank debited the account.
+Result<int> RemoteATMController::try_withdraw(int amount) {
+    MetricsTimer timer(MetricOp::AtmWithdraw);
+    try {
+        if (session == 0) {
+            return timer.fail(TxError::NoAccountSelected);
+        }
+        if (amount <= 0) {
+            return timer.fail(TxError::InvalidAmount);
+        }
+        DispensePlan plan = DispensePlan();
+        if (dispenser != nullptr) {
+            Result<DispensePlan> reserved = dispenser->try_reserve(amount);
+            if (!reserved) {
+                return timer.fail(reserved.error());
+            }
+            plan = reserved.value();
+        }
+        BackendReply reply;
+        try {
+            reply = backend.call(BackendRequest::withdraw(card.get_key(), session, amount));
+        } catch (...) {
+            if (dispenser != nullptr) {
+                dispenser->release(plan);
+            }
+            throw;
+        }
+        if (reply.error != TxError::None) {
+            if (dispenser != nullptr && reply.error != TxError::NotDurable) { // NotDurable was debited.
+                dispenser->release(plan);
+            }
+            return timer.fail(reply.error);
+        }
+
+        // Optional logging
+        ATM_LOG_INFO("Withdrawal made. Amount: " << amount << ", New Balance: " << reply.balance);
+
+        return reply.balance;
+    } catch (...) {
+        timer.fail();
+        throw;
+    }
+}
+
+// Withdraws a specified amount from the card's account.
+int RemoteATMController::withdraw(int amount) {
+    return try_withdraw(amount).value();
+}
@@ -0,0 +1,155 @@
+#include "RemoteBankBackend.h"
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "BackendProtocol.h"
+
+namespace {
+
+// Reply for a request that never reached the backend or never came back.
+BackendReply unavailable(std::uint64_t card_key) {
+    BackendReply reply;
+    reply.error = TxError::BackendUnavailable;
+    reply.card_key = card_key;
+    reply.balance = 0;
+    return reply;
+}
+
+} // namespace
+
+// Connects every connection and starts its reader thread.
+RemoteBankBackend::RemoteBankBackend(const RemoteBackendConfig& config) : config(config), next_connection(0) {
+    if (config.connections == 0 || config.max_in_flight == 0) {
+        throw std::invalid_argument("Connections and requests in flight must be positive.");
+    }
+    try {
+        for (std::size_t i = 0; i < config.connections; ++i) {
+            connections.emplace_back(new Connection());
+            Connection& connection = *connections.back();
+            connection.fd = connect_unix(config.socket_path);
+            connection.reader = std::thread(&RemoteBankBackend::read_replies, this, std::ref(connection));
+        }
+    } catch (...) {
+        for (std::unique_ptr<Connection>& connection : connections) {
+            if (connection->fd >= 0) {
+                ::shutdown(connection->fd, SHUT_RDWR);
+            }
+            if (connection->reader.joinable()) {
+                connection->reader.join();
+            }
+            if (connection->fd >= 0) {
+                ::close(connection->fd);
+            }
+        }
+        throw;
+    }
+}
+
+// Shuts the sockets down; each reader fails what is still pending and exits.
+RemoteBankBackend::~RemoteBankBackend() {
+    for (std::unique_ptr<Connection>& connection : connections) {
+        ::shutdown(connection->fd, SHUT_RDWR);
+    }
+    for (std::unique_ptr<Connection>& connection : connections) {
+        connection->reader.join();
+        ::close(connection->fd);
+    }
+}
+
+// Registers the request, then writes it without waiting for earlier replies.
+void RemoteBankBackend::submit(const BackendRequest& request, BackendCallback done) {
+    char frame[BACKEND_REQUEST_SIZE];
+    Connection& connection =
+        *connections[next_connection.fetch_add(1, std::memory_order_relaxed) % connections.size()];
+    std::uint64_t id;
+    {
+        std::unique_lock<std::mutex> lock(connection.pending_mutex);
+        connection.window.wait(lock, [this, &connection]() {
+            return connection.closed || connection.pending.size() < config.max_in_flight;
+        });
+        if (connection.closed) {
+            lock.unlock();
+            done(unavailable(request.card_key));
+            return;
+        }
+        id = connection.next_id++;
+        encode_backend_request(id, request, frame); // Throws for a malformed request before it is registered.
+        PendingRequest& pending = connection.pending[id];
+        pending.done = std::move(done);
+        pending.card_key = request.card_key;
+    }
+
+    bool sent;
+    {
+        std::lock_guard<std::mutex> lock(connection.write_mutex);
+        sent = send_all(connection.fd, frame, sizeof(frame));
+    }
+    if (!sent) {
+        ::shutdown(connection.fd, SHUT_RDWR); // The reader fails this and every other pending request.
+    }
+}
+
+// Retrieves the number of requests awaiting a reply.
+std::size_t RemoteBankBackend::in_flight() const {
+    std::size_t total = 0;
+    for (const std::unique_ptr<Connection>& connection : connections) {
+        std::lock_guard<std::mutex> lock(connection->pending_mutex);
+        total += connection->pending.size();
+    }
+    return total;
+}
+
+// Reads replies in large chunks and completes their requests.
+void RemoteBankBackend::read_replies(Connection& connection) {
+    char buffer[BACKEND_REPLY_SIZE * 256];
+    std::size_t filled = 0;
+    for (;;) {
+        ssize_t count = ::recv(connection.fd, buffer + filled, sizeof(buffer) - filled, 0);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
+        }
+        filled += static_cast<std::size_t>(count);
+
+        std::size_t offset = 0;
+        for (; filled - offset >= BACKEND_REPLY_SIZE; offset += BACKEND_REPLY_SIZE) {
+            std::uint64_t id;
+            BackendReply reply;
+            decode_backend_reply(buffer + offset, id, reply);
+            BackendCallback done;
+            {
+                std::lock_guard<std::mutex> lock(connection.pending_mutex);
+                auto it = connection.pending.find(id);
+                if (it == connection.pending.end()) {
+                    continue; // Not ours; the server is confused, but the stream is still aligned.
+                }
+                done = std::move(it->second.done);
+                connection.pending.erase(it);
+            }
+            connection.window.notify_one();
+            done(reply);
+        }
+        std::memmove(buffer, buffer + offset, filled - offset);
+        filled -= offset;
+    }
+    fail_pending(connection);
+}
+
+// Marks a connection broken and fails everything still pending on it.
+void RemoteBankBackend::fail_pending(Connection& connection) {
+    std::unordered_map<std::uint64_t, PendingRequest> orphans;
+    {
+        std::lock_guard<std::mutex> lock(connection.pending_mutex);
+        connection.closed = true;
+        orphans.swap(connection.pending);
+    }
+    connection.window.notify_all();
+    for (auto& orphan : orphans) {
+        orphan.second.done(unavailable(orphan.second.card_key));
+    }
+}
@@ -0,0 +1,61 @@
+#include "Result.h"
+#include <stdexcept>
+
+// Returns the message used for an error.
+const char* tx_error_message(TxError error) {
+    switch (error) {
+    case TxError::None:
+        return "No error.";
+    case TxError::InvalidAmount:
+        return "Amount must be positive.";
+    case TxError::InsufficientFunds:
+        return "Insufficient balance.";
+    case TxError::WrongPin:
+        return "Invalid PIN.";
+    case TxError::UnknownAccount:
+        return "Account does not exist.";
+    case TxError::NoCard:
+        return "No card inserted.";
+    case TxError::NoAccountSelected:
+        return "Account not selected.";
+    case TxError::BackendUnavailable:
+        return "Bank backend unavailable.";
+    case TxError::CannotDispense:
+        return "The ATM cannot dispense this amount.";
+    case TxError::CardLocked:
+        return "Card locked after too many wrong PINs.";
+    case TxError::DailyLimitExceeded:
+        return "Daily withdrawal limit exceeded.";
+    case TxError::RateLimited:
+        return "Too many transactions at this ATM; try again later.";
+    case TxError::TransactionIdReused:
+        return "Transaction ID was already used for a different request.";
+    case TxError::SameAccount:
+        return "Cannot transfer between an account and itself.";
+    case TxError::SessionExpired:
+        return "The session has expired.";
+    case TxError::TooManySessions:
+        return "Too many open sessions.";
+    case TxError::NotDurable:
+        return "Transaction applied but not saved; the journal failed.";
+    }
+    return "Unknown error.";
+}
+
+// Returns true if the throwing API reports the error as std::runtime_error.
+bool tx_error_is_runtime(TxError error) {
+    return error == TxError::NoCard || error == TxError::NoAccountSelected || error == TxError::BackendUnavailable ||
+           error == TxError::CardLocked || error == TxError::RateLimited || error == TxError::SessionExpired ||
+           error == TxError::TooManySessions || error == TxError::NotDurable;
+}
+
+// Throws the exception the throwing API uses for an error.
+void throw_tx_error(TxError error) {
+    if (error == TxError::None) {
+        throw std::logic_error("throw_tx_error called without an error.");
+    }
+    if (tx_error_is_runtime(error)) {
+        throw std::runtime_error(tx_error_message(error));
+    }
+    throw std::invalid_argument(tx_error_message(error));
+}
@@ -0,0 +1,307 @@
+#include "SessionManager.h"
+#include <stdexcept>
+#include "Logger.h"
+
+namespace {
+
+// Builds the handle of a slot's current session.
+SessionHandle make_handle(std::uint32_t index, std::uint32_t generation) {
+    return static_cast<SessionHandle>(generation) << 32 | index;
+}
+
+} // namespace
+
+const std::uint32_t SessionManager::NO_SLOT;
+
+// Allocates every slot, chains them all on the free list and sizes the wheel.
+SessionManager::SessionManager(BankSystem& bank, const SessionConfig& config)
+    : bank(bank), config(config), started(std::chrono::steady_clock::now()), timeout_ticks(0),
+      slot_count(config.capacity), wheel_tick(0), free_head(0), open_count(0), opened(0), closed(0), expired(0),
+      rejected(0) {
+    if (config.capacity == 0 || config.capacity >= NO_SLOT) {
+        throw std::invalid_argument("Session capacity must be 1 to 2^32 - 2.");
+    }
+    if (config.tick.count() <= 0 || config.tick >= config.idle_timeout) {
+        throw std::invalid_argument("Session tick must be positive and shorter than the idle timeout.");
+    }
+    timeout_ticks = static_cast<std::uint32_t>((config.idle_timeout.count() + config.tick.count() - 1) /
+                                               config.tick.count());
+
+    slots.reset(new Slot[slot_count]);
+    for (std::size_t i = 0; i + 1 < slot_count; ++i) {
+        slots[i].next = static_cast<std::uint32_t>(i + 1);
+    }
+
+    // A session is filed at most timeout_ticks + 1 ticks ahead, so it never
+    // wraps around onto a bucket that comes due before it does.
+    std::size_t buckets = 1;
+    while (buckets < static_cast<std::size_t>(timeout_ticks) + 2) {
+        buckets *= 2;
+    }
+    wheel.assign(buckets, NO_SLOT);
+}
+
+// Returns the current tick.
+std::uint32_t SessionManager::now_tick() const {
+    return static_cast<std::uint32_t>((std::chrono::steady_clock::now() - started) / config.tick);
+}
+
+// Takes a free slot, inserts the card and files the session on the wheel.
+Result<SessionHandle> SessionManager::try_open_session(const Card& card) {
+    const std::uint32_t now = now_tick();
+    std::lock_guard<std::mutex> wheel_lock(wheel_mutex);
+    advance(now);
+    if (free_head == NO_SLOT) {
+        ++rejected;
+        return TxError::TooManySessions;
+    }
+    const std::uint32_t index = free_head;
+    Slot& slot = slots[index];
+    free_head = slot.next;
+    {
+        std::lock_guard<std::mutex> slot_lock(slot.mutex);
+        ATMController atm(bank, config.atm_id);
+        atm.resume(slot.session);
+        atm.insert_card(card);
+        slot.state = SlotState::Open;
+        slot.last_used.store(now, std::memory_order_relaxed);
+    }
+    file(index, now + timeout_ticks + 1);
+    ++open_count;
+    ++opened;
+    return make_handle(index, slot.generation);
+}
+
+// Opens a session for an inserted card.
+SessionHandle SessionManager::open_session(const Card& card) {
+    return try_open_session(card).value();
+}
+
+// Ends the session under its own lock first, so that no request runs on it
+// anymore, then frees the slot under the wheel lock; the wheel leaves
+// Closing slots to their closer.
+bool SessionManager::close_session(SessionHandle handle) {
+    const std::uint32_t index = static_cast<std::uint32_t>(handle);
+    if (index >= slot_count) {
+        return false;
+    }
+    Slot& slot = slots[index];
+    bool was_idle;
+    {
+        std::lock_guard<std::mutex> slot_lock(slot.mutex);
+        if (slot.generation != static_cast<std::uint32_t>(handle >> 32) || slot.state != SlotState::Open) {
+            return false;
+        }
+        was_idle = now_tick() - slot.last_used.load(std::memory_order_relaxed) > timeout_ticks;
+        ATMController atm(bank, config.atm_id);
+        atm.resume(slot.session);
+        atm.eject_card();
+        slot.state = SlotState::Closing;
+    }
+
+    std::lock_guard<std::mutex> wheel_lock(wheel_mutex);
+    unlink(index);
+    {
+        std::lock_guard<std::mutex> slot_lock(slot.mutex);
+        release(index);
+    }
+    --open_count;
+    if (was_idle) {
+        ++expired;
+    } else {
+        ++closed;
+    }
+    return !was_idle;
+}
+
+// Runs a request on a controller resumed on the session, recording the request's tick.
+template <typename T, typename Request>
+Result<T> SessionManager::run(SessionHandle handle, Request request) {
+    const std::uint32_t index = static_cast<std::uint32_t>(handle);
+    if (index >= slot_count) {
+        return TxError::SessionExpired;
+    }
+    Slot& slot = slots[index];
+    std::lock_guard<std::mutex> slot_lock(slot.mutex);
+    if (slot.generation != static_cast<std::uint32_t>(handle >> 32) || slot.state != SlotState::Open) {
+        return TxError::SessionExpired;
+    }
+    // Idle past the timeout but not yet reached by the wheel: expired all the same.
+    const std::uint32_t now = now_tick();
+    if (now - slot.last_used.load(std::memory_order_relaxed) > timeout_ticks) {
+        return TxError::SessionExpired;
+    }
+    slot.last_used.store(now, std::memory_order_relaxed);
+    ATMController atm(bank, config.atm_id);
+    atm.resume(slot.session);
+    return request(atm, slot.session);
+}
+
+// Validates the PIN for the session's card without throwing on a wrong PIN.
+Result<void> SessionManager::try_enter_pin(SessionHandle session, const std::string& pin) {
+    return run<void>(session, [&pin](ATMController& atm, ATMSession&) { return atm.try_enter_pin(pin); });
+}
+
+// Validates the PIN for the session's card.
+void SessionManager::enter_pin(SessionHandle session, const std::string& pin) {
+    try_enter_pin(session, pin).value();
+}
+
+// Selects another account of the session's card without throwing on a routine failure.
+Result<void> SessionManager::try_select_account(SessionHandle session, const std::string& account_id) {
+    return run<void>(session,
+                     [&account_id](ATMController& atm, ATMSession&) { return atm.try_select_account(account_id); });
+}
+
+// Selects another account of the session's card.
+void SessionManager::select_account(SessionHandle session, const std::string& account_id) {
+    try_select_account(session, account_id).value();
+}
+
+// Retrieves the selected account's balance without throwing if none is selected.
+Result<int> SessionManager::try_view_balance(SessionHandle session) {
+    return run<int>(session, [](ATMController& atm, ATMSession& state) -> Result<int> {
+        if (state.current_account == nullptr) {
+            return TxError::NoAccountSelected;
+        }
+        return atm.view_balance();
+    });
+}
+
+// Retrieves the selected account's balance.
+int SessionManager::view_balance(SessionHandle session) {
+    return try_view_balance(session).value();
+}
+
+// Deposits into the selected account without throwing on a routine failure.
+Result<int> SessionManager::try_deposit(SessionHandle session, int amount) {
+    return run<int>(session, [amount](ATMController& atm, ATMSession&) { return atm.try_deposit(amount); });
+}
+
+// Deposits into the selected account.
+int SessionManager::deposit(SessionHandle session, int amount) {
+    return try_deposit(session, amount).value();
+}
+
+// Withdraws from the selected account without throwing on a routine failure.
+Result<int> SessionManager::try_withdraw(SessionHandle session, int amount) {
+    return run<int>(session, [amount](ATMController& atm, ATMSession&) { return atm.try_withdraw(amount); });
+}
+
+// Withdraws from the selected account.
+int SessionManager::withdraw(SessionHandle session, int amount) {
+    return try_withdraw(session, amount).value();
+}
+
+// Transfers to another account of the card without throwing on a routine failure.
+Result<int> SessionManager::try_transfer(SessionHandle session, const std::string& to_account_id, int amount) {
+    return run<int>(session, [&to_account_id, amount](ATMController& atm, ATMSession&) {
+        return atm.try_transfer(to_account_id, amount);
+    });
+}
+
+// Transfers to another account of the card.
+int SessionManager::transfer(SessionHandle session, const std::string& to_account_id, int amount) {
+    return try_transfer(session, to_account_id, amount).value();
+}
+
+// Advances the wheel to now.
+std::size_t SessionManager::expire_idle() {
+    const std::uint32_t now = now_tick();
+    std::lock_guard<std::mutex> wheel_lock(wheel_mutex);
+    std::size_t count = advance(now);
+
+    // Optional logging
+    if (count != 0) {
+        ATM_LOG_INFO("Expired " << count << " idle sessions; " << open_count << " open.");
+    }
+    return count;
+}
+
+// Retrieves the counters.
+SessionStats SessionManager::stats() const {
+    std::lock_guard<std::mutex> wheel_lock(wheel_mutex);
+    SessionStats result;
+    result.open = open_count;
+    result.opened = opened;
+    result.closed = closed;
+    result.expired = expired;
+    result.rejected = rejected;
+    return result;
+}
+
+// Files a slot in the bucket of tick due.
+void SessionManager::file(std::uint32_t index, std::uint32_t due) {
+    Slot& slot = slots[index];
+    const std::uint32_t bucket = due & static_cast<std::uint32_t>(wheel.size() - 1);
+    slot.bucket = bucket;
+    slot.prev = NO_SLOT;
+    slot.next = wheel[bucket];
+    if (slot.next != NO_SLOT) {
+        slots[slot.next].prev = index;
+    }
+    wheel[bucket] = index;
+}
+
+// Takes a slot off its bucket.
+void SessionManager::unlink(std::uint32_t index) {
+    Slot& slot = slots[index];
+    if (slot.prev != NO_SLOT) {
+        slots[slot.prev].next = slot.next;
+    } else {
+        wheel[slot.bucket] = slot.next;
+    }
+    if (slot.next != NO_SLOT) {
+        slots[slot.next].prev = slot.prev;
+    }
+}
+
+// Puts a slot on the free list; its session has already been ended.
+void SessionManager::release(std::uint32_t index) {
+    Slot& slot = slots[index];
+    if (++slot.generation == 0) {
+        slot.generation = 1; // Keeps every handle distinct from INVALID_SESSION_HANDLE.
+    }
+    slot.state = SlotState::Free;
+    slot.session = ATMSession();
+    slot.prev = NO_SLOT;
+    slot.next = free_head;
+    free_head = index;
+}
+
+// Handles each bucket due up to now: sessions used since they were filed
+// are filed again by their latest request, and the others expire. A slot
+// busy with a request, or being closed, is looked at again next tick.
+std::size_t SessionManager::advance(std::uint32_t now) {
+    const std::uint32_t mask = static_cast<std::uint32_t>(wheel.size() - 1);
+    if (now - wheel_tick > mask) {
+        wheel_tick = now - mask - 1; // Fell more than a revolution behind: every bucket is due once.
+    }
+    std::size_t count = 0;
+    while (wheel_tick != now) {
+        ++wheel_tick;
+        std::uint32_t index = wheel[wheel_tick & mask];
+        wheel[wheel_tick & mask] = NO_SLOT;
+        while (index != NO_SLOT) {
+            Slot& slot = slots[index];
+            const std::uint32_t next = slot.next;
+            std::unique_lock<std::mutex> slot_lock(slot.mutex, std::try_to_lock);
+            const std::uint32_t last_used = slot.last_used.load(std::memory_order_relaxed);
+            if (!slot_lock.owns_lock() || slot.state != SlotState::Open) {
+                file(index, now + 1);
+            } else if (now - last_used <= timeout_ticks) {
+                file(index, last_used + timeout_ticks + 1);
+            } else {
+                ATMController atm(bank, config.atm_id);
+                atm.resume(slot.session);
+                atm.eject_card();
+                release(index);
+                --open_count;
+                ++expired;
+                ++count;
+            }
+            index = next;
+        }
+    }
+    return count;
+}
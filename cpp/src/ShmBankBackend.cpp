@@ -0,0 +1,188 @@
+#include "ShmBankBackend.h"
+#include <stdexcept>
+#include <unistd.h>
+#include "BackendProtocol.h"
+#include "Logger.h"
+
+namespace {
+
+const int SPIN_ROUNDS = 64;    // Empty looks at the reply ring before the reader sleeps.
+const int IDLE_SLEEP_MS = 100; // Longest sleep, so that a server that died is noticed.
+const std::uint64_t SLOT_MASK = 0xFF; // Low byte of a request ID: its pending slot.
+
+// Reply for a request that never reached the server or never came back.
+BackendReply unavailable(std::uint64_t card_key) {
+    BackendReply reply;
+    reply.error = TxError::BackendUnavailable;
+    reply.card_key = card_key;
+    reply.balance = 0;
+    return reply;
+}
+
+} // namespace
+
+// Opens the region, claims the first free channel and starts the reader.
+ShmBankBackend::ShmBankBackend(const std::string& name, std::size_t max_in_flight)
+    : region(open_shm_region(name)), channel(nullptr), pending(max_in_flight), next_sequence(1), closed(false),
+      stopping(false) {
+    if (max_in_flight == 0 || max_in_flight > SHM_RING_SLOTS) {
+        unmap_shm_region(region);
+        throw std::invalid_argument("Requests in flight must be 1 to 256 for a shared memory backend.");
+    }
+    if (region->closed.load() != 0) {
+        unmap_shm_region(region);
+        throw std::runtime_error("Shared memory bank server has shut down: " + name);
+    }
+    for (ShmChannel& candidate : region->channels) {
+        std::uint32_t expected = static_cast<std::uint32_t>(ShmChannelState::Free);
+        if (candidate.state.compare_exchange_strong(expected, static_cast<std::uint32_t>(ShmChannelState::Claimed))) {
+            candidate.owner.store(static_cast<std::uint32_t>(::getpid()));
+            channel = &candidate;
+            break;
+        }
+    }
+    if (channel == nullptr) {
+        unmap_shm_region(region);
+        throw std::runtime_error("Every shared memory channel is in use: " + name);
+    }
+    for (std::size_t slot = max_in_flight; slot > 0; --slot) {
+        free_slots.push_back(slot - 1);
+    }
+    reader = std::thread(&ShmBankBackend::read_replies, this);
+}
+
+// Stops the reader, which fails what is pending, then hands the channel to the server for reset.
+ShmBankBackend::~ShmBankBackend() {
+    stopping.store(true);
+    shm_futex_wake(channel->reply_doorbell);
+    reader.join();
+    channel->state.store(static_cast<std::uint32_t>(ShmChannelState::Releasing));
+    shm_futex_wake(region->doorbell);
+    unmap_shm_region(region);
+}
+
+// Registers the request, then encodes it in place in the request ring.
+void ShmBankBackend::submit(const BackendRequest& request, BackendCallback done) {
+    if (request.pin.size() > BACKEND_MAX_PIN_LENGTH) {
+        // Checked up front so that encoding into the ring cannot fail once the request is registered.
+        throw std::invalid_argument("PIN is too long for a backend request.");
+    }
+    std::uint64_t id;
+    {
+        std::unique_lock<std::mutex> lock(pending_mutex);
+        window.wait(lock, [this]() { return closed || !free_slots.empty(); });
+        if (closed) {
+            lock.unlock();
+            done(unavailable(request.card_key));
+            return;
+        }
+        std::size_t slot = free_slots.back();
+        free_slots.pop_back();
+        id = next_sequence++ << 8 | slot;
+        PendingRequest& entry = pending[slot];
+        entry.done = std::move(done);
+        entry.id = id;
+        entry.card_key = request.card_key;
+    }
+
+    {
+        // The window keeps fewer requests outstanding than the ring has slots, so there is always room.
+        std::lock_guard<std::mutex> lock(write_mutex);
+        std::uint64_t tail = channel->requests.tail.load(std::memory_order_relaxed);
+        encode_backend_request(id, request, channel->requests.frame(tail));
+        channel->requests.tail.store(tail + 1);
+    }
+    if (region->server_waiting.load() != 0) {
+        shm_futex_wake(region->doorbell);
+    }
+}
+
+// Retrieves the number of requests awaiting a reply.
+std::size_t ShmBankBackend::in_flight() const {
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    return pending.size() - free_slots.size();
+}
+
+// Drains the reply ring whenever it has frames; when it stays empty, says
+// it is going to sleep, looks once more and sleeps on the channel's doorbell.
+void ShmBankBackend::read_replies() {
+    int idle = 0;
+    for (;;) {
+        std::uint64_t head = channel->replies.head.load(std::memory_order_relaxed);
+        const std::uint64_t tail = channel->replies.tail.load(std::memory_order_acquire);
+        if (head != tail) {
+            for (; head != tail; ++head) {
+                std::uint64_t id;
+                BackendReply reply;
+                decode_backend_reply(channel->replies.frame(head), id, reply);
+                channel->replies.head.store(head + 1, std::memory_order_release);
+                BackendCallback done;
+                {
+                    std::lock_guard<std::mutex> lock(pending_mutex);
+                    std::size_t slot = static_cast<std::size_t>(id & SLOT_MASK);
+                    if (slot >= pending.size() || pending[slot].id != id || !pending[slot].done) {
+                        continue; // Not ours; the server is confused, but the ring is still aligned.
+                    }
+                    done = std::move(pending[slot].done);
+                    pending[slot].done = nullptr;
+                    free_slots.push_back(slot);
+                }
+                window.notify_one();
+                done(reply);
+            }
+            idle = 0;
+            continue;
+        }
+        if (stopping.load() || region->closed.load() != 0) {
+            break;
+        }
+        if (++idle < SPIN_ROUNDS) {
+            std::this_thread::yield();
+            continue;
+        }
+        idle = 0;
+        std::uint32_t seen = channel->reply_doorbell.load();
+        channel->client_waiting.store(1);
+        if (channel->replies.tail.load() == head && !stopping.load()) {
+            shm_futex_wait(channel->reply_doorbell, seen, IDLE_SLEEP_MS);
+        }
+        channel->client_waiting.store(0);
+        if (channel->reply_doorbell.load() == seen && !shm_process_alive(region->server_pid.load())) {
+            ATM_LOG_WARN("Shared memory bank server process exited.");
+            break;
+        }
+    }
+    fail_pending();
+}
+
+// Marks the backend closed and fails everything still pending.
+void ShmBankBackend::fail_pending() {
+    std::vector<PendingRequest> orphans;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        closed = true;
+        for (PendingRequest& entry : pending) {
+            if (entry.done) {
+                orphans.push_back(entry);
+                entry.done = nullptr;
+            }
+        }
+    }
+    window.notify_all();
+    for (PendingRequest& orphan : orphans) {
+        orphan.done(unavailable(orphan.card_key));
+    }
+}
+
+// Prefers shared memory and falls back to the socket.
+std::unique_ptr<BankBackend> connect_bank_daemon(const std::string& region_name,
+                                                 const RemoteBackendConfig& socket_config) {
+    try {
+        std::unique_ptr<BankBackend> backend(new ShmBankBackend(region_name, socket_config.max_in_flight));
+        ATM_LOG_INFO("Connected to the bank daemon over shared memory: " << region_name);
+        return backend;
+    } catch (const std::exception& e) {
+        ATM_LOG_WARN("Shared memory unavailable (" << e.what() << "); using socket " << socket_config.socket_path);
+    }
+    return std::unique_ptr<BankBackend>(new RemoteBankBackend(socket_config));
+}
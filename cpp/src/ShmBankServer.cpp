@@ -0,0 +1,181 @@
+#include "ShmBankServer.h"
+#include "Logger.h"
+
+namespace {
+
+const int SPIN_ROUNDS = 64;      // Idle passes over the channels before the poller sleeps.
+const int IDLE_SLEEP_MS = 100;   // Longest sleep, so that abandoned channels are noticed.
+
+// Reply for a frame that could not be decoded.
+BackendReply malformed_reply() {
+    BackendReply reply;
+    reply.error = TxError::BackendUnavailable;
+    reply.card_key = 0;
+    reply.balance = 0;
+    return reply;
+}
+
+} // namespace
+
+// Creates the region and starts the poller.
+ShmBankServer::ShmBankServer(BankSystem& bank, const std::string& name)
+    : backend(bank), name(name), region(create_shm_region(name)), async_pending(0), stopping(false),
+      served(0), batches(0) {
+    poller = std::thread(&ShmBankServer::run, this);
+    ATM_LOG_INFO("Shared memory bank server started. Region: " << name);
+}
+
+// Stops the poller, waits for PIN checks in progress, then closes the region.
+ShmBankServer::~ShmBankServer() {
+    stopping.store(true);
+    shm_futex_wake(region->doorbell);
+    poller.join();
+    {
+        std::unique_lock<std::mutex> lock(async_mutex);
+        async_done.wait(lock, [this]() { return async_pending == 0; });
+    }
+    region->closed.store(1);
+    for (ShmChannel& channel : region->channels) {
+        shm_futex_wake(channel.reply_doorbell);
+    }
+    remove_shm_region(name);
+    unmap_shm_region(region);
+}
+
+// Scans the channels until a pass finds nothing, spins a little, then
+// sleeps on the doorbell. server_waiting is set before the last look at
+// the rings, so a client that publishes after that look sees it and wakes us.
+void ShmBankServer::run() {
+    int idle = 0;
+    while (!stopping.load()) {
+        std::size_t handled = 0;
+        for (std::size_t i = 0; i < SHM_MAX_CHANNELS; ++i) {
+            handled += serve_channel(i);
+        }
+        if (handled != 0 || ++idle < SPIN_ROUNDS) {
+            if (handled == 0) {
+                std::this_thread::yield();
+            } else {
+                idle = 0;
+            }
+            continue;
+        }
+        idle = 0;
+        std::uint32_t seen = region->doorbell.load();
+        region->server_waiting.store(1);
+        bool pending = false;
+        for (ShmChannel& channel : region->channels) {
+            if (channel.state.load() != static_cast<std::uint32_t>(ShmChannelState::Free) &&
+                channel.requests.head.load(std::memory_order_relaxed) != channel.requests.tail.load()) {
+                pending = true;
+                break;
+            }
+        }
+        if (!pending && !stopping.load()) {
+            shm_futex_wait(region->doorbell, seen, IDLE_SLEEP_MS);
+        }
+        region->server_waiting.store(0);
+        if (region->doorbell.load() == seen) {
+            reclaim_abandoned(); // Woken by the timeout rather than a client.
+        }
+    }
+}
+
+// Executes one channel's queued requests in place and publishes their replies.
+std::size_t ShmBankServer::serve_channel(std::size_t index) {
+    ShmChannel& channel = region->channels[index];
+    std::uint32_t state = channel.state.load(std::memory_order_acquire);
+    if (state == static_cast<std::uint32_t>(ShmChannelState::Releasing)) {
+        reset_channel(index);
+        return 0;
+    }
+    if (state != static_cast<std::uint32_t>(ShmChannelState::Claimed)) {
+        return 0;
+    }
+    const std::uint64_t first = channel.requests.head.load(std::memory_order_relaxed);
+    const std::uint64_t tail = channel.requests.tail.load(std::memory_order_acquire);
+    if (first == tail) {
+        return 0;
+    }
+
+    const std::uint32_t generation = channel.generation.load(std::memory_order_relaxed);
+    BackendRequest request; // Reused, so the PIN string keeps its buffer.
+    for (std::uint64_t head = first; head != tail; ++head) {
+        std::uint64_t id;
+        if (!decode_backend_request(channel.requests.frame(head), id, request)) {
+            ATM_LOG_WARN("Shared memory bank server rejected a malformed request.");
+            put_reply(index, generation, id, malformed_reply());
+        } else if (request.op == BackendOp::Authenticate) {
+            {
+                std::lock_guard<std::mutex> lock(async_mutex);
+                ++async_pending;
+            }
+            backend.submit(request, [this, index, generation, id](const BackendReply& reply) {
+                put_reply(index, generation, id, reply);
+                notify_client(region->channels[index]);
+                std::lock_guard<std::mutex> lock(async_mutex);
+                if (--async_pending == 0) {
+                    async_done.notify_all();
+                }
+            });
+        } else {
+            put_reply(index, generation, id, backend.execute(request));
+        }
+    }
+    channel.requests.head.store(tail, std::memory_order_release);
+    notify_client(channel);
+
+    const std::size_t count = static_cast<std::size_t>(tail - first);
+    served.fetch_add(count, std::memory_order_relaxed);
+    batches.fetch_add(1, std::memory_order_relaxed);
+    return count;
+}
+
+// Encodes the reply into the next slot and publishes it.
+void ShmBankServer::put_reply(std::size_t index, std::uint32_t generation, std::uint64_t id,
+                              const BackendReply& reply) {
+    ShmChannel& channel = region->channels[index];
+    std::lock_guard<std::mutex> lock(reply_mutexes[index]);
+    if (channel.generation.load(std::memory_order_relaxed) != generation) {
+        return; // The client is gone and the channel was reset.
+    }
+    const std::uint64_t tail = channel.replies.tail.load(std::memory_order_relaxed);
+    if (tail - channel.replies.head.load(std::memory_order_acquire) >= SHM_RING_SLOTS) {
+        ATM_LOG_WARN("Shared memory bank server dropped a reply for a client over its window.");
+        return;
+    }
+    encode_backend_reply(id, reply, channel.replies.frame(tail));
+    channel.replies.tail.store(tail + 1);
+}
+
+// Wakes the client only if it has said it is going to sleep.
+void ShmBankServer::notify_client(ShmChannel& channel) {
+    if (channel.client_waiting.load() != 0) {
+        shm_futex_wake(channel.reply_doorbell);
+    }
+}
+
+// Drops whatever the former client left queued; replies still being
+// computed for it see the new generation and are discarded.
+void ShmBankServer::reset_channel(std::size_t index) {
+    ShmChannel& channel = region->channels[index];
+    std::lock_guard<std::mutex> lock(reply_mutexes[index]);
+    channel.generation.fetch_add(1);
+    channel.requests.head.store(channel.requests.tail.load());
+    channel.replies.head.store(channel.replies.tail.load());
+    channel.client_waiting.store(0);
+    channel.owner.store(0);
+    channel.state.store(static_cast<std::uint32_t>(ShmChannelState::Free), std::memory_order_release);
+}
+
+// Checks the owner of every claimed channel.
+void ShmBankServer::reclaim_abandoned() {
+    for (ShmChannel& channel : region->channels) {
+        std::uint32_t owner = channel.owner.load();
+        std::uint32_t claimed = static_cast<std::uint32_t>(ShmChannelState::Claimed);
+        if (owner != 0 && channel.state.load() == claimed && !shm_process_alive(owner)) {
+            channel.state.compare_exchange_strong(claimed, static_cast<std::uint32_t>(ShmChannelState::Releasing));
+            ATM_LOG_WARN("Shared memory bank server reclaimed the channel of exited process " << owner);
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#include "ShmTransport.h"
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+const std::uint64_t SHM_REGION_MAGIC = 0x314D4853424D5441ULL; // "ATMBSHM1"
+const std::uint32_t SHM_REGION_VERSION = 2; // 2: frames carry a session token.
+
+// Throws unless name is a valid POSIX shared memory name.
+void check_name(const std::string& name) {
+    if (name.size() < 2 || name[0] != '/' || name.find('/', 1) != std::string::npos || name.size() > NAME_MAX) {
+        throw std::invalid_argument("Shared memory name must be a slash followed by a file name: " + name);
+    }
+}
+
+// Maps a region file descriptor and closes it.
+ShmRegion* map_region(int fd, const std::string& name) {
+    void* address = ::mmap(nullptr, sizeof(ShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int error = errno;
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("Unable to map shared memory " + name + ": " + std::strerror(error));
+    }
+    return static_cast<ShmRegion*>(address);
+}
+
+} // namespace
+
+// Creates, sizes and initializes a region; the magic is written last.
+ShmRegion* create_shm_region(const std::string& name) {
+    check_name(name);
+    ::shm_unlink(name.c_str()); // A region left by a server that crashed would make O_EXCL fail.
+    int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to create shared memory " + name + ": " + std::strerror(errno));
+    }
+    if (::ftruncate(fd, sizeof(ShmRegion)) != 0) {
+        int error = errno;
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        throw std::runtime_error("Unable to size shared memory " + name + ": " + std::strerror(error));
+    }
+    ShmRegion* region = map_region(fd, name);
+
+    // The new pages are zero, so every position, state and futex word starts at 0.
+    region = new (region) ShmRegion;
+    region->version = SHM_REGION_VERSION;
+    region->channel_count = SHM_MAX_CHANNELS;
+    region->server_pid.store(static_cast<std::uint32_t>(::getpid()));
+    region->magic.store(SHM_REGION_MAGIC, std::memory_order_release);
+    return region;
+}
+
+// Maps an existing region and checks that it is initialized and compatible.
+ShmRegion* open_shm_region(const std::string& name) {
+    check_name(name);
+    int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to open shared memory " + name + ": " + std::strerror(errno));
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0 || static_cast<std::size_t>(status.st_size) != sizeof(ShmRegion)) {
+        ::close(fd);
+        throw std::runtime_error("Shared memory " + name + " does not hold a bank region of this version.");
+    }
+    ShmRegion* region = map_region(fd, name);
+    if (region->magic.load(std::memory_order_acquire) != SHM_REGION_MAGIC || region->version != SHM_REGION_VERSION) {
+        unmap_shm_region(region);
+        throw std::runtime_error("Shared memory " + name + " does not hold a bank region of this version.");
+    }
+    return region;
+}
+
+// Unmaps a region.
+void unmap_shm_region(ShmRegion* region) {
+    ::munmap(region, sizeof(ShmRegion));
+}
+
+// Removes a region's name.
+void remove_shm_region(const std::string& name) {
+    ::shm_unlink(name.c_str());
+}
+
+// Process-shared futex wait: the word lives in memory mapped by several processes.
+void shm_futex_wait(std::atomic<std::uint32_t>& word, std::uint32_t expected, int timeout_ms) {
+    struct timespec timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000L;
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+// Bumps the word first, so a sleeper that read the old value does not go to sleep.
+void shm_futex_wake(std::atomic<std::uint32_t>& word) {
+    word.fetch_add(1);
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+// Signal 0 checks for existence without sending anything.
+bool shm_process_alive(std::uint32_t pid) {
+    return ::kill(static_cast<pid_t>(pid), 0) == 0 || errno != ESRCH;
+}
@@ -0,0 +1,166 @@
+#include "TransactionDedup.h"
+#include "FlatAccountTable.h"
+#include <stdexcept>
+
+// Returns the current time in milliseconds on the steady clock.
+std::int64_t dedup_clock_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Constructor that allocates every slot up front.
+TransactionDedupCache::TransactionDedupCache(const DedupConfig& config)
+    : config(config), set_mask(0), stripes(new Stripe[LOCK_STRIPES]), started(0), replays(0), conflicts(0),
+      waits(0), expirations(0), evictions(0) {
+    if (config.ttl.count() <= 0 || config.capacity == 0) {
+        throw std::invalid_argument("Deduplication TTL and capacity must be positive.");
+    }
+    std::size_t sets = 1;
+    while (sets * WAYS < config.capacity) {
+        sets *= 2;
+    }
+    set_mask = sets - 1;
+    Slot empty = {0, 0, 0, 0, 0, 0, LedgerEntryType::Deposit, SlotState::Empty};
+    slots.assign(sets * WAYS, empty);
+}
+
+// Finds the ID in its set, waiting while it runs elsewhere; claims a slot for a new ID.
+DedupStatus TransactionDedupCache::begin(const DedupRequest& request, int& balance, std::int64_t now_ms) {
+    const std::size_t first = set_for(request.atm_id, request.transaction_id);
+    Stripe& stripe = stripe_for(first);
+    std::unique_lock<std::mutex> lock(stripe.mutex);
+    for (;;) {
+        Slot* slot = find(first, request);
+        if (slot != nullptr && slot->state == SlotState::Running) {
+            waits.fetch_add(1, std::memory_order_relaxed);
+            stripe.finished.wait(lock);
+            continue;
+        }
+        if (slot != nullptr && slot->expires_ms > now_ms) {
+            if (slot->type != request.type || slot->account_key != request.account_key ||
+                slot->amount != request.amount) {
+                conflicts.fetch_add(1, std::memory_order_relaxed);
+                return DedupStatus::Conflict;
+            }
+            replays.fetch_add(1, std::memory_order_relaxed);
+            balance = slot->balance;
+            return DedupStatus::Replayed;
+        }
+
+        // Claim the request's own expired slot, else an empty or expired one,
+        // else evict the completed request that expires soonest.
+        Slot* victim = slot;
+        for (std::size_t i = first; i < first + WAYS && victim == nullptr; ++i) {
+            if (slots[i].state == SlotState::Empty ||
+                (slots[i].state == SlotState::Done && slots[i].expires_ms <= now_ms)) {
+                victim = &slots[i];
+            }
+        }
+        if (victim != nullptr && victim->state == SlotState::Done) {
+            expirations.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (victim == nullptr) {
+            for (std::size_t i = first; i < first + WAYS; ++i) {
+                if (slots[i].state == SlotState::Done &&
+                    (victim == nullptr || slots[i].expires_ms < victim->expires_ms)) {
+                    victim = &slots[i];
+                }
+            }
+            if (victim == nullptr) {
+                // Every slot of the set holds a running request; one will finish shortly.
+                waits.fetch_add(1, std::memory_order_relaxed);
+                stripe.finished.wait(lock);
+                continue;
+            }
+            evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+        victim->transaction_id = request.transaction_id;
+        victim->account_key = request.account_key;
+        victim->expires_ms = 0;
+        victim->atm_id = request.atm_id;
+        victim->amount = request.amount;
+        victim->balance = 0;
+        victim->type = request.type;
+        victim->state = SlotState::Running;
+        started.fetch_add(1, std::memory_order_relaxed);
+        return DedupStatus::New;
+    }
+}
+
+// Marks the running request done and wakes any retry waiting for it.
+void TransactionDedupCache::complete(const DedupRequest& request, int balance, std::int64_t now_ms) {
+    const std::size_t first = set_for(request.atm_id, request.transaction_id);
+    Stripe& stripe = stripe_for(first);
+    {
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        Slot* slot = find(first, request);
+        if (slot == nullptr || slot->state != SlotState::Running) {
+            throw std::logic_error("complete() called for a request that is not running.");
+        }
+        slot->balance = balance;
+        slot->expires_ms = now_ms + config.ttl.count();
+        slot->state = SlotState::Done;
+    }
+    stripe.finished.notify_all();
+}
+
+// Frees the running request's slot and wakes any retry waiting for it.
+void TransactionDedupCache::abandon(const DedupRequest& request) {
+    const std::size_t first = set_for(request.atm_id, request.transaction_id);
+    Stripe& stripe = stripe_for(first);
+    {
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        Slot* slot = find(first, request);
+        if (slot != nullptr && slot->state == SlotState::Running) {
+            slot->state = SlotState::Empty;
+        }
+    }
+    stripe.finished.notify_all();
+}
+
+// Counts running requests and completed ones that have not expired.
+DedupStats TransactionDedupCache::stats(std::int64_t now_ms) const {
+    DedupStats result;
+    result.capacity = slots.size();
+    result.entries = 0;
+    for (std::size_t first = 0; first < slots.size(); first += WAYS) {
+        std::lock_guard<std::mutex> lock(stripe_for(first).mutex);
+        for (std::size_t i = first; i < first + WAYS; ++i) {
+            if (slots[i].state == SlotState::Running ||
+                (slots[i].state == SlotState::Done && slots[i].expires_ms > now_ms)) {
+                ++result.entries;
+            }
+        }
+    }
+    result.started = started.load(std::memory_order_relaxed);
+    result.replays = replays.load(std::memory_order_relaxed);
+    result.conflicts = conflicts.load(std::memory_order_relaxed);
+    result.waits = waits.load(std::memory_order_relaxed);
+    result.expirations = expirations.load(std::memory_order_relaxed);
+    result.evictions = evictions.load(std::memory_order_relaxed);
+    return result;
+}
+
+// Mixes the ATM ID into the transaction ID so equal IDs from different ATMs spread out.
+std::size_t TransactionDedupCache::set_for(std::uint32_t atm_id, std::uint64_t transaction_id) const {
+    std::uint64_t mixed = transaction_id ^ static_cast<std::uint64_t>(atm_id) * 0x9e3779b97f4a7c15ULL;
+    std::uint64_t hash = FlatAccountTable::hash(mixed);
+    return static_cast<std::size_t>(hash & set_mask) * WAYS;
+}
+
+// Returns the lock stripe guarding the set that starts at slot first.
+TransactionDedupCache::Stripe& TransactionDedupCache::stripe_for(std::size_t first) const {
+    return stripes[(first / WAYS) % LOCK_STRIPES];
+}
+
+// Returns the slot holding the request's ID in the set starting at first, or null.
+TransactionDedupCache::Slot* TransactionDedupCache::find(std::size_t first, const DedupRequest& request) {
+    for (std::size_t i = first; i < first + WAYS; ++i) {
+        Slot& slot = slots[i];
+        if (slot.state != SlotState::Empty && slot.transaction_id == request.transaction_id &&
+            slot.atm_id == request.atm_id) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
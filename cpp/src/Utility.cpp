@@ -1,36 +1,29 @@
 #include "Utility.h"
-#include <iostream>
-#include <fstream>
-#include <chrono>
-#include <iomanip>
-#include <sstream>
+#include "Logger.h"
 
 // Logs a message with an optional log level, optionally writes to a log file.
+// The message is handed to the asynchronous Logger, which adds the
+// [YYYY-MM-DD HH:MM:SS] timestamp and keeps the log file open between calls.
 void logMessage(const std::string& message, const std::string& level, const std::string& logFile) {
-    // Get the current time
-    auto now = std::chrono::system_clock::now();
-    auto time_t_now = std::chrono::system_clock::to_time_t(now);
-    std::tm local_tm = *std::localtime(&time_t_now);
-
-    // Format the time as [YYYY-MM-DD HH:MM:SS]
-    std::ostringstream timeStream;
-    timeStream << "[" << std::put_time(&local_tm, "%Y-%m-%d %H:%M:%S") << "]";
-
-    // Construct the log message
-    std::ostringstream logStream;
-    logStream << timeStream.str() << " [" << level << "]: " << message;
-
-    // Print to console
-    std::cout << logStream.str() << std::endl;
+    LogLevel log_level = parse_log_level(level);
+    if (!Logger::enabled(log_level)) {
+        return;
+    }
 
-    // Optionally write to a log file
+    // Resolve the file sink once per thread and path instead of reopening the file.
+    static thread_local std::string cached_path;
+    static thread_local int cached_sink = -1;
+    int file_sink = -1;
     if (!logFile.empty()) {
-        std::ofstream file(logFile, std::ios::app); // Append mode
-        if (file.is_open()) {
-            file << logStream.str() << std::endl;
-            file.close();
-        } else {
-            std::cerr << "[ERROR]: Unable to open log file: " << logFile << std::endl;
+        if (logFile != cached_path) {
+            cached_sink = Logger::instance().open_file_sink(logFile);
+            cached_path = logFile;
+            if (cached_sink < 0) {
+                ATM_LOG_ERROR("Unable to open log file: " << logFile);
+            }
         }
+        file_sink = cached_sink;
     }
+
+    Logger::instance().submit(log_level, message.data(), message.size(), file_sink, true);
 }
@@ -1,6 +1,71 @@
 #include <iostream>
 #include <cassert>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <condition_variable>
+#include <mutex>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "../include/ATMController.h"
+#include "../include/Logger.h"
+#include "../include/Utility.h"
+#include "../include/Journal.h"
+#include "../include/FlatAccountTable.h"
+#include "../include/CardValidation.h"
+#include "../include/LatencyHistogram.h"
+#include "../include/PinHash.h"
+#include "../include/CompactAccountStore.h"
+#include "../include/Metrics.h"
+#include "../include/BankServer.h"
+#include "../include/RemoteBankBackend.h"
+#include "../include/Ledger.h"
+#include "../include/CashDispenser.h"
+#include "../include/Limits.h"
+#include "../include/TransactionDedup.h"
+#include "../include/Posting.h"
+#include "../include/BalanceSnapshot.h"
+#include "../include/ShmBankServer.h"
+#include "../include/ShmBankBackend.h"
+#include "../include/SessionManager.h"
+#include "../include/RemoteATMController.h"
+#include "../tools/SyntheticCards.h"
+
+// Temporary directory under /tmp, removed with its contents when the test that made it ends.
+class TempDir {
+public:
+    // Creates /tmp/<prefix>_XXXXXX; throws if it cannot be created.
+    explicit TempDir(const std::string& prefix) {
+        std::string pattern = "/tmp/" + prefix + "_XXXXXX";
+        std::vector<char> buffer(pattern.begin(), pattern.end());
+        buffer.push_back('\0');
+        if (mkdtemp(buffer.data()) == nullptr) {
+            throw std::runtime_error("Cannot create " + pattern + ": " + std::strerror(errno));
+        }
+        directory = buffer.data();
+    }
+
+    ~TempDir() { std::system(("rm -rf " + directory).c_str()); }
+
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    const std::string& path() const { return directory; }
+
+private:
+    std::string directory;
+};
 
 // Test inserting a card and handling duplicate insertion
 void test_insert_card() {
@@ -193,6 +258,2246 @@ void test_full_flow() {
     std::cout << "[PASS] test_full_flow passed." << std::endl;
 }
 
+// Test that concurrent sessions on shared accounts never lose a balance update
+void test_concurrent_updates() {
+    std::cout << "[TEST] test_concurrent_updates started." << std::endl;
+
+    PinHashConfig cheap_pins; // PIN hashing cost is not under test here.
+    cheap_pins.iterations = 10;
+    BankSystem bank(4, cheap_pins);
+    const std::vector<std::string> card_numbers = {
+        "4539578763621486", "4556737586899855", "4916338506082832", "4024007198964305"
+    };
+    for (const std::string& number : card_numbers) {
+        bank.add_account(number, "1234", 1000);
+    }
+
+    const int thread_count = 8;
+    const int iterations = 250;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&bank, &card_numbers, t]() {
+            for (int i = 0; i < iterations; ++i) {
+                Card card(card_numbers[(t + i) % card_numbers.size()]);
+                assert(bank.validate_pin(card, "1234"));
+                Account& account = bank.get_account(card);
+                account.deposit(3);
+                account.withdraw(1);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    // Every thread spreads its iterations evenly over the accounts, netting +2 per iteration.
+    int total = 0;
+    for (const std::string& number : card_numbers) {
+        total += bank.get_account(Card(number)).get_balance();
+    }
+    int expected = static_cast<int>(card_numbers.size()) * 1000 + thread_count * iterations * 2;
+    assert(total == expected && "Concurrent updates must not be lost.");
+
+    std::cout << "[PASS] test_concurrent_updates passed." << std::endl;
+}
+
+// Test lock-free balance updates on a single hot account
+void test_lock_free_balances() {
+    std::cout << "[TEST] test_lock_free_balances started." << std::endl;
+
+    PinHashConfig cheap_pins;
+    cheap_pins.iterations = 10;
+    BankSystem bank(1, cheap_pins, BalanceMode::LockFree);
+    bank.add_account("4539578763621486", "1234", 1000);
+    Account& hot = bank.get_account(Card("4539578763621486"));
+    assert(hot.get_balance_mode() == BalanceMode::LockFree);
+
+    // Racing withdrawals drain the account exactly once and never below zero,
+    // while a reader polls the balance without blocking.
+    const int thread_count = 8;
+    std::atomic<int> succeeded(0);
+    std::atomic<bool> done(false);
+    std::thread reader([&hot, &done]() {
+        int last = hot.get_balance();
+        while (!done.load()) {
+            int current = hot.get_balance();
+            assert(current >= 0 && current <= last && "Balance must only fall while draining.");
+            last = current;
+        }
+    });
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&hot, &succeeded]() {
+            for (int i = 0; i < 500; ++i) {
+                try {
+                    hot.withdraw(1);
+                    ++succeeded;
+                } catch (const std::invalid_argument&) {
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    done = true;
+    reader.join();
+    assert(succeeded.load() == 1000 && hot.get_balance() == 0);
+
+    // Mixed deposits and withdrawals lose no update.
+    threads.clear();
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&hot]() {
+            for (int i = 0; i < 1000; ++i) {
+                hot.deposit(3);
+                hot.withdraw(1);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    assert(hot.get_balance() == thread_count * 1000 * 2);
+
+    // A standalone account defaults to the locked mode with the same results.
+    Account locked("4556737586899855", 10);
+    assert(locked.get_balance_mode() == BalanceMode::Locked);
+    assert(locked.withdraw(4) == 6 && locked.deposit(1) == 7);
+    bool threw = false;
+    try {
+        locked.withdraw(8);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw && locked.get_balance() == 7);
+
+    std::cout << "[PASS] test_lock_free_balances passed." << std::endl;
+}
+
+// Test level filtering, file output and the drop policy of the asynchronous logger
+void test_logger() {
+    std::cout << "[TEST] test_logger started." << std::endl;
+
+    Logger& logger = Logger::instance();
+    logger.flush();
+
+    // A disabled level must not even evaluate its arguments.
+    int evaluations = 0;
+    Logger::set_level(LogLevel::Warn);
+    ATM_LOG_INFO("skipped " << ++evaluations);
+    assert(evaluations == 0 && "Disabled log statements must not be evaluated.");
+    Logger::set_level(LogLevel::Info);
+
+    // logMessage writes timestamped lines to its file sink.
+    const std::string log_file = "test_logger.log";
+    std::remove(log_file.c_str());
+    logMessage("first line", "INFO", log_file);
+    logMessage("second line", "ERROR", log_file);
+    logger.flush();
+    std::ifstream file(log_file);
+    std::string line;
+    int lines = 0;
+    while (std::getline(file, line)) {
+        assert(line.find(lines == 0 ? "[INFO]: first line" : "[ERROR]: second line") != std::string::npos);
+        ++lines;
+    }
+    assert(lines == 2 && "Both messages should reach the log file.");
+    std::remove(log_file.c_str());
+
+    // Flooding the ring drops messages instead of blocking, and every message is accounted for.
+    logger.set_console_enabled(false);
+    std::uint64_t written_before = logger.written_count();
+    std::uint64_t dropped_before = logger.dropped_count();
+    const int flood = static_cast<int>(Logger::RING_CAPACITY) * 4;
+    for (int i = 0; i < flood; ++i) {
+        ATM_LOG_INFO("flood " << i);
+    }
+    logger.flush();
+    logger.set_console_enabled(true);
+    std::uint64_t accounted = (logger.written_count() - written_before) + (logger.dropped_count() - dropped_before);
+    assert(accounted == static_cast<std::uint64_t>(flood) && "Messages must be either written or dropped.");
+
+    std::cout << "[PASS] test_logger passed." << std::endl;
+}
+
+// Test that a journaled bank recovers from its snapshot plus the journal tail
+void test_journal_recovery() {
+    std::cout << "[TEST] test_journal_recovery started." << std::endl;
+
+    TempDir temp_dir("atm_journal");
+    const std::string& directory = temp_dir.path();
+    JournalConfig config(directory);
+    config.commit_window = std::chrono::microseconds(200);
+
+    {
+        BankSystem bank;
+        bank.open_journal(config);
+        bank.add_account("4539578763621486", "1234", 100);
+        bank.add_account("4556737586899855", "4321", 500);
+        bank.get_account(Card("4539578763621486")).deposit(50);
+        bank.checkpoint();                                      // Snapshot covers 150 / 500.
+        bank.get_account(Card("4539578763621486")).withdraw(30);
+        bank.get_account(Card("4556737586899855")).deposit(25); // Only in the journal tail.
+        assert(bank.get_journal()->durable_lsn() == bank.get_journal()->last_lsn());
+        assert(list_journal_segments(directory).size() == 1 && "Checkpoint should prune covered segments.");
+    }
+
+    // A torn record at the end of the journal (crash mid-write) must be ignored.
+    std::vector<std::uint64_t> segments = list_journal_segments(directory);
+    FILE* tail = std::fopen(journal_segment_path(directory, segments.back()).c_str(), "ab");
+    std::fputs("torn", tail);
+    std::fclose(tail);
+
+    {
+        BankSystem bank;
+        bank.open_journal(config);
+        assert(bank.get_account(Card("4539578763621486")).get_balance() == 120);
+        assert(bank.get_account(Card("4556737586899855")).get_balance() == 525);
+        assert(bank.validate_pin(Card("4556737586899855"), "4321"));
+        bank.get_account(Card("4556737586899855")).deposit(5);  // Lands in a segment after the torn one.
+    }
+
+    {
+        BankSystem bank;
+        bank.open_journal(config);
+        assert(bank.get_account(Card("4556737586899855")).get_balance() == 530);
+    }
+
+    // Checkpoints taken during concurrent deposits lose none of them: every
+    // deposit is either in the snapshot or in a segment kept after it.
+    int expected_first = 0;
+    int expected_second = 0;
+    {
+        Logger::set_level(LogLevel::Error);
+        BankSystem bank;
+        bank.open_journal(config);
+        Account& first = bank.get_account(Card("4539578763621486"));
+        Account& second = bank.get_account(Card("4556737586899855"));
+        std::atomic<bool> depositing(true);
+        std::vector<std::thread> depositors;
+        for (int t = 0; t < 4; ++t) {
+            depositors.emplace_back([&first, &second, t]() {
+                for (int i = 0; i < 300; ++i) {
+                    (t % 2 == 0 ? first : second).deposit(1);
+                    if (i % 50 == 0) {
+                        first.transfer(second, 1);
+                    }
+                }
+            });
+        }
+        std::thread checkpointer([&bank, &depositing]() {
+            while (depositing.load()) {
+                bank.checkpoint();
+            }
+        });
+        for (std::thread& depositor : depositors) {
+            depositor.join();
+        }
+        depositing.store(false);
+        checkpointer.join();
+        expected_first = first.get_balance();
+        expected_second = second.get_balance();
+        assert(expected_first + expected_second == 120 + 530 + 4 * 300);
+        Logger::set_level(LogLevel::Info);
+    }
+    {
+        BankSystem bank;
+        bank.open_journal(config);
+        assert(bank.get_account(Card("4539578763621486")).get_balance() == expected_first);
+        assert(bank.get_account(Card("4556737586899855")).get_balance() == expected_second);
+    }
+
+    // Once the journal cannot write, updates are refused before they change
+    // anything; the one that found out stands, since it was already applied,
+    // and reports that it is not durable.
+    // The segment after the next rotation is made to point at /dev/full.
+    {
+        Logger::set_level(LogLevel::Off);
+        BankSystem bank;
+        bank.open_journal(config);
+        Account& account = bank.get_account(Card("4556737586899855"));
+        Account& other = bank.get_account(Card("4539578763621486"));
+        account.deposit(10); // Rotating starts the next segment after the last record.
+        std::string full_segment = journal_segment_path(directory, bank.get_journal()->last_lsn() + 1);
+        assert(symlink("/dev/full", full_segment.c_str()) == 0);
+        bank.checkpoint();
+        const int applied = expected_second + 10 + 10;
+        assert(account.try_deposit(10).error() == TxError::NotDurable && account.get_balance() == applied);
+        assert(account.try_deposit(10).error() == TxError::BackendUnavailable);
+        assert(account.try_withdraw(10).error() == TxError::BackendUnavailable);
+        assert(account.try_transfer(other, 10).error() == TxError::BackendUnavailable);
+        assert(account.get_balance() == applied && other.get_balance() == expected_first);
+        bool threw = false;
+        try {
+            bank.add_account("4929804463622139", "1234", 10);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw && bank.try_get_account(Card("4929804463622139")).error() == TxError::UnknownAccount);
+        Logger::set_level(LogLevel::Info);
+    }
+
+    std::cout << "[PASS] test_journal_recovery passed." << std::endl;
+}
+
+// Test packed card keys, packed PINs and the flat account table
+void test_flat_account_table() {
+    std::cout << "[TEST] test_flat_account_table started." << std::endl;
+
+    std::uint64_t key = 0;
+    assert(pack_card_number("0000000000001234", key) && key == 1234);
+    assert(unpack_card_number(key) == "0000000000001234");
+    assert(!pack_card_number("12345", key) && !pack_card_number("453957876362148x", key));
+    assert(make_card_number(12345).compare(0, 15, "400000000012345") == 0);
+    assert(Card(make_card_number(0)).get_key() != Card(make_card_number(1)).get_key()); // Valid, so no throw.
+
+    std::uint64_t short_pin = 0, long_pin = 0;
+    assert(pack_pin("0123", short_pin) && pack_pin("00123", long_pin) && short_pin != long_pin);
+    assert(unpack_pin(long_pin) == "00123");
+    assert(!pack_pin("123", short_pin) && !pack_pin("12a4", short_pin));
+
+    // Grow well past the initial capacity and check every key still resolves.
+    std::deque<Account> accounts;
+    std::vector<PinCredential> credentials(10000);
+    FlatAccountTable table;
+    for (std::uint64_t i = 0; i < 10000; ++i) {
+        accounts.emplace_back(unpack_card_number(i * 7919), 0);
+        assert(table.insert(i * 7919, &credentials[i], &accounts.back()));
+    }
+    assert(!table.insert(7919, &credentials[0], &accounts.front()) && "Duplicate keys must be rejected.");
+    assert(table.size() == 10000 && table.capacity() * 7 >= table.size() * 10);
+    for (std::uint64_t i = 0; i < 10000; ++i) {
+        const AccountEntry* entry = table.find(i * 7919);
+        assert(entry != nullptr && entry->credential == &credentials[i] && entry->account == &accounts[i]);
+    }
+    assert(table.find(1) == nullptr);
+
+    // authenticate resolves the account in one lookup and rejects bad PINs.
+    BankSystem bank;
+    bank.add_account("4539578763621486", "1234", 100);
+    assert(bank.authenticate(Card("4539578763621486"), "1234") == &bank.get_account(Card("4539578763621486")));
+    assert(bank.authenticate(Card("4539578763621486"), "9999") == nullptr);
+    assert(bank.authenticate(Card("4556737586899855"), "1234") == nullptr);
+    try {
+        bank.add_account("not-a-card", "1234", 0);
+        assert(false && "Non-card account IDs should throw an exception.");
+    } catch (const std::invalid_argument& e) {
+        std::cout << "[INFO] Expected exception: " << e.what() << std::endl;
+    }
+
+    std::cout << "[PASS] test_flat_account_table passed." << std::endl;
+}
+
+// Test that every Luhn kernel agrees and that Card enforces the checksum
+void test_card_validation() {
+    std::cout << "[TEST] test_card_validation started." << std::endl;
+
+    std::vector<std::string> numbers = {
+        "4539578763621486",  // valid
+        "4539578763621487",  // wrong check digit
+        "4556737586899855",  // valid
+        "455673758689985",   // too short
+        "45567375868998a5",  // not a digit
+        "0000000000000000",  // valid (checksum 0)
+        "4916338506082832",  // valid
+        "4024007198964305",  // valid
+    };
+    // Append many generated numbers so the vector kernels see full blocks and a tail.
+    for (int i = 0; i < 203; ++i) {
+        std::string number = unpack_card_number(4000000000000000ULL + 7777777ULL * i);
+        numbers.push_back(number);
+    }
+
+    std::vector<std::uint64_t> expected((numbers.size() + 63) / 64);
+    for (std::size_t i = 0; i < numbers.size(); ++i) {
+        if (numbers[i].size() == 16 && is_valid_pan16(numbers[i].data())) {
+            expected[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+    assert(card_bit(expected, 0) && !card_bit(expected, 1) && card_bit(expected, 2));
+    assert(!card_bit(expected, 3) && !card_bit(expected, 4) && card_bit(expected, 5));
+
+    const LuhnKernel kernels[] = {LuhnKernel::Scalar, LuhnKernel::SSE2, LuhnKernel::AVX2, LuhnKernel::Auto};
+    for (LuhnKernel kernel : kernels) {
+        if (!luhn_kernel_supported(kernel)) {
+            std::cout << "[INFO] Skipping unsupported kernel: " << luhn_kernel_name(kernel) << std::endl;
+            continue;
+        }
+        assert(validate_card_numbers(numbers, kernel) == expected && "Kernels must agree with the scalar check.");
+    }
+
+    try {
+        Card card("4539578763621487");
+        assert(false && "A card failing the Luhn checksum should throw an exception.");
+    } catch (const std::invalid_argument& e) {
+        std::cout << "[INFO] Expected exception: " << e.what() << std::endl;
+    }
+
+    std::cout << "[PASS] test_card_validation passed." << std::endl;
+}
+
+// Test histogram percentiles and shard lock statistics used by the load generator
+void test_latency_histogram() {
+    std::cout << "[TEST] test_latency_histogram started." << std::endl;
+
+    LatencyHistogram histogram;
+    assert(histogram.count() == 0 && histogram.percentile(0.99) == 0);
+    for (std::uint64_t value = 1; value <= 100000; ++value) {
+        histogram.record(value);
+    }
+    assert(histogram.count() == 100000 && histogram.max() == 100000);
+    // Buckets are within 1/16 of their values, so each estimate is at most that much high.
+    std::uint64_t p50 = histogram.percentile(0.50);
+    std::uint64_t p99 = histogram.percentile(0.99);
+    assert(p50 >= 50000 && p50 <= 50000 + 50000 / 16);
+    assert(p99 >= 99000 && p99 <= 100000);
+    assert(histogram.percentile(1.0) == 100000);
+    for (std::size_t bucket = 1; bucket < LatencyHistogram::BUCKET_COUNT; ++bucket) {
+        std::uint64_t bound = LatencyHistogram::bucket_upper_bound(bucket);
+        assert(LatencyHistogram::bucket_for(bound) == bucket);
+        assert(LatencyHistogram::bucket_for(LatencyHistogram::bucket_upper_bound(bucket - 1) + 1) == bucket);
+    }
+
+    LatencyHistogram other;
+    other.record(5000000);
+    histogram.merge(other);
+    assert(histogram.count() == 100001 && histogram.max() == 5000000);
+    histogram.reset();
+    assert(histogram.count() == 0);
+
+    BankSystem bank(4);
+    bank.add_account("4539578763621486", "1234", 100);
+    bank.get_account(Card("4539578763621486"));
+    std::vector<BankSystem::ShardStats> stats = bank.shard_stats();
+    std::size_t accounts = 0;
+    std::uint64_t acquisitions = 0;
+    for (const BankSystem::ShardStats& shard : stats) {
+        accounts += shard.accounts;
+        acquisitions += shard.acquisitions;
+        assert(shard.contended <= shard.acquisitions);
+    }
+    assert(stats.size() == 4 && accounts == 1 && acquisitions == 2);
+
+    std::cout << "[PASS] test_latency_histogram passed." << std::endl;
+}
+
+// Test salted PIN hashes, their persistence and the verification pool
+void test_pin_hashing() {
+    std::cout << "[TEST] test_pin_hashing started." << std::endl;
+
+    // Known-answer tests: FIPS 180-2 and RFC 7914.
+    std::uint8_t digest[SHA256_DIGEST_SIZE];
+    sha256("abc", 3, digest);
+    assert(digest[0] == 0xba && digest[1] == 0x78 && digest[31] == 0xad);
+    pbkdf2_hmac_sha256("password", 8, "salt", 4, 4096, digest, sizeof(digest));
+    assert(digest[0] == 0xc5 && digest[1] == 0xe4 && digest[31] == 0x4a);
+
+    PinCredential first = hash_pin("1234", 50);
+    PinCredential second = hash_pin("1234", 50);
+    assert(first.iterations == 50 && std::memcmp(first.salt, second.salt, PIN_SALT_SIZE) != 0);
+    assert(std::memcmp(first.hash, second.hash, SHA256_DIGEST_SIZE) != 0 && "Salts must make equal PINs differ.");
+    assert(verify_pin(first, "1234") && !verify_pin(first, "1235") && !verify_pin(first, "01234"));
+    assert(!verify_pin(empty_pin_credential(), "1234"));
+
+    PinCredential decoded;
+    std::string encoded = encode_pin_credential(first);
+    assert(encoded.find("pbkdf2-sha256$50$") == 0);
+    assert(decode_pin_credential(encoded, decoded) && verify_pin(decoded, "1234"));
+    assert(!decode_pin_credential("1234", decoded) && !decode_pin_credential(encoded.substr(0, 40), decoded));
+
+    // The bank verifies on its pool, synchronously and asynchronously, and counts the checks.
+    PinHashConfig config;
+    config.iterations = 100;
+    config.verifier_threads = 2;
+    BankSystem bank(4, config);
+    bank.add_account("4539578763621486", "1234", 100);
+    Card card("4539578763621486");
+    bank.get_pin_verifier().reset_stats();
+    assert(bank.validate_pin(card, "1234") && !bank.validate_pin(card, "4321"));
+    assert(bank.authenticate(Card("4556737586899855"), "1234") == nullptr);
+
+    std::mutex done_mutex;
+    std::condition_variable done_signal;
+    int completed = 0;
+    int matched = 0;
+    for (int i = 0; i < 20; ++i) {
+        bank.authenticate_async(card, i % 2 == 0 ? "1234" : "9999", [&](Account* account) {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            matched += account != nullptr ? 1 : 0;
+            ++completed;
+            done_signal.notify_one();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done_signal.wait(lock, [&completed]() { return completed == 20; });
+    }
+    assert(matched == 10);
+    PinVerifierStats stats = bank.get_pin_verifier().stats();
+    assert(stats.verified == 23 && stats.batches >= 1 && stats.batches <= 23 && stats.queue_depth == 0);
+    assert(stats.queue_wait_max_ns >= stats.queue_wait_p50_ns);
+
+    // Journals and snapshots hold only the hash.
+    TempDir temp_dir("atm_journal");
+    const std::string& directory = temp_dir.path();
+    JournalConfig journal_config(directory);
+    journal_config.sync = false;
+    {
+        BankSystem durable(4, config);
+        durable.open_journal(journal_config);
+        durable.add_account("4539578763621486", "135791", 100);
+        durable.checkpoint();
+        durable.add_account("4556737586899855", "246802", 100);
+    }
+    std::string contents;
+    for (std::uint64_t segment : list_journal_segments(directory)) {
+        std::ifstream in(journal_segment_path(directory, segment).c_str(), std::ios::binary);
+        contents.append(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    assert(contents.find("246802") == std::string::npos && contents.find("pbkdf2-sha256$100$") != std::string::npos);
+    {
+        BankSystem durable(4, config);
+        durable.open_journal(journal_config);
+        assert(durable.validate_pin(Card("4539578763621486"), "135791"));
+        assert(durable.validate_pin(Card("4556737586899855"), "246802"));
+        assert(!durable.validate_pin(Card("4556737586899855"), "135791"));
+    }
+
+    std::cout << "[PASS] test_pin_hashing passed." << std::endl;
+}
+
+// Account subclass used to check that custom accounts keep their own behavior in the compact store
+class FeeAccount : public Account {
+public:
+    explicit FeeAccount(const std::string& account_id, int balance) : Account(account_id, balance) {}
+
+    Result<int> try_withdraw(int amount) override {
+        return Account::try_withdraw(amount + 1); // One unit fee per withdrawal.
+    }
+};
+
+// Test the struct-of-arrays account store, its handles and the custom-account slow path
+void test_compact_account_store() {
+    std::cout << "[TEST] test_compact_account_store started." << std::endl;
+
+    // Cross several pooled chunks and index generations; handles must stay put.
+    CompactAccountStore store;
+    const std::size_t count = CompactAccountStore::CHUNK_SIZE * 2 + 100;
+    std::vector<std::string> ids;
+    for (std::size_t i = 0; i < count; ++i) {
+        ids.push_back(unpack_card_number(4000000000000000ULL + i * 7));
+        assert(store.add(ids.back(), static_cast<int>(i % 100)) == i);
+    }
+    assert(store.size() == count);
+    for (std::size_t i = 0; i < count; ++i) {
+        assert(store.find(ids[i]) == i && store.get_account_id(static_cast<AccountHandle>(i)) == ids[i]);
+    }
+    assert(store.find("4000000000000001") == INVALID_ACCOUNT_HANDLE);
+    try {
+        store.add(ids[5], 0);
+        assert(false && "Duplicate account IDs should throw an exception.");
+    } catch (const std::invalid_argument& e) {
+        std::cout << "[INFO] Expected exception: " << e.what() << std::endl;
+    }
+
+    std::int64_t expected_total = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        expected_total += static_cast<int>(i % 100);
+    }
+    assert(store.total_balance() == expected_total);
+    assert(store.memory_usage() / count < sizeof(Account) / 2 && "Compact accounts should be far smaller than Account.");
+
+    AccountHandle handle = store.find(ids[42]);
+    assert(store.deposit(handle, 58) == 100 && store.withdraw(handle, 30) == 70);
+    try {
+        store.withdraw(handle, 71);
+        assert(false && "Overdrawing should throw an exception.");
+    } catch (const std::invalid_argument& e) {
+        std::cout << "[INFO] Expected exception: " << e.what() << std::endl;
+    }
+    store.set_frozen(handle, true);
+    try {
+        store.deposit(handle, 1);
+        assert(false && "Frozen accounts should refuse deposits.");
+    } catch (const std::runtime_error& e) {
+        std::cout << "[INFO] Expected exception: " << e.what() << std::endl;
+    }
+    store.set_frozen(handle, false);
+    assert(store.get_flags(handle) == 0 && store.get_balance(handle) == 70);
+
+    // Custom accounts go through their virtual methods.
+    FeeAccount fee_account("4539578763621486", 100);
+    AccountHandle custom = store.add_custom(fee_account);
+    assert(store.get_flags(custom) == ACCOUNT_CUSTOM && store.withdraw(custom, 10) == 89);
+    assert(store.get_balance(custom) == 89 && fee_account.get_balance() == 89);
+
+    // Concurrent updates on a few hot handles are not lost.
+    const int thread_count = 8;
+    const int iterations = 2000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&store, t]() {
+            for (int i = 0; i < iterations; ++i) {
+                AccountHandle target = static_cast<AccountHandle>((t + i) % 4);
+                store.deposit(target, 3);
+                store.withdraw(target, 1);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    int hot_total = 0;
+    for (AccountHandle h = 0; h < 4; ++h) {
+        hot_total += store.get_balance(h);
+    }
+    assert(hot_total == 0 + 1 + 2 + 3 + thread_count * iterations * 2);
+
+    std::cout << "[PASS] test_compact_account_store passed." << std::endl;
+}
+
+// Test operation counters, error breakdown, latency histograms and the Prometheus exporter
+void test_metrics() {
+    std::cout << "[TEST] test_metrics started." << std::endl;
+
+    // Metrics are process-wide, so compare against what earlier tests recorded.
+    MetricsSnapshot before = Metrics::instance().snapshot();
+
+    PinHashConfig cheap_pins;
+    cheap_pins.iterations = 10;
+    BankSystem bank(4, cheap_pins);
+    bank.add_account("4539578763621486", "1234", 100);
+    ATMController atm(bank);
+    Card card("4539578763621486");
+    atm.insert_card(card);
+    try {
+        atm.enter_pin("0000");
+        assert(false && "Entering incorrect PIN should throw an exception.");
+    } catch (const std::invalid_argument&) {
+    }
+    try {
+        atm.insert_card(card);
+        assert(false && "Inserting a second card should throw an exception.");
+    } catch (const std::runtime_error&) {
+    }
+    atm.enter_pin("1234");
+
+    // Calls made on a thread that has exited still count.
+    std::thread worker([&atm]() {
+        atm.withdraw(30);
+        try {
+            atm.withdraw(1000);
+        } catch (const std::invalid_argument&) {
+        }
+    });
+    worker.join();
+    atm.eject_card();
+
+    MetricsSnapshot after = Metrics::instance().snapshot();
+#ifndef ATM_METRICS_DISABLED
+    const std::size_t invalid = static_cast<std::size_t>(MetricError::InvalidArgument);
+    const std::size_t runtime = static_cast<std::size_t>(MetricError::RuntimeError);
+    assert(after[MetricOp::AtmEnterPin].calls - before[MetricOp::AtmEnterPin].calls == 2);
+    assert(after[MetricOp::AtmEnterPin].errors[invalid] - before[MetricOp::AtmEnterPin].errors[invalid] == 1);
+    assert(after[MetricOp::AtmInsertCard].errors[runtime] - before[MetricOp::AtmInsertCard].errors[runtime] == 1);
+    assert(after[MetricOp::AtmWithdraw].calls - before[MetricOp::AtmWithdraw].calls == 2);
+    assert(after[MetricOp::AtmWithdraw].errors[invalid] - before[MetricOp::AtmWithdraw].errors[invalid] == 1);
+    assert(after[MetricOp::BankAuthenticate].calls - before[MetricOp::BankAuthenticate].calls == 2);
+    assert(after[MetricOp::BankAddAccount].calls > before[MetricOp::BankAddAccount].calls);
+    assert(after[MetricOp::AtmWithdraw].latency.count() == after[MetricOp::AtmWithdraw].calls);
+    assert(after[MetricOp::AtmEnterPin].latency.max() > 0);
+#endif
+
+    // The exporter writes every operation in Prometheus text format.
+    const std::string metrics_file = "test_metrics.prom";
+    std::remove(metrics_file.c_str());
+    {
+        MetricsExporter exporter(metrics_file, std::chrono::milliseconds(10));
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    }
+    std::ifstream in(metrics_file.c_str());
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    assert(text.find("# TYPE atm_operation_duration_seconds histogram") != std::string::npos);
+    assert(text.find("atm_operation_errors_total{op=\"atm_enter_pin\",exception=\"invalid_argument\"}") !=
+           std::string::npos);
+    assert(text.find("atm_operation_duration_seconds_count{op=\"bank_get_account\"}") != std::string::npos);
+    std::remove(metrics_file.c_str());
+
+    std::cout << "[PASS] test_metrics passed." << std::endl;
+}
+
+// Test the non-throwing result API and its throwing wrappers
+void test_result_api() {
+    std::cout << "[TEST] test_result_api started." << std::endl;
+
+    PinHashConfig cheap_pins;
+    cheap_pins.iterations = 10;
+    BankSystem bank(4, cheap_pins);
+    bank.add_account("4539578763621486", "1234", 100);
+    Card card("4539578763621486");
+    Card unknown("4556737586899855");
+
+    assert(bank.try_validate_pin(card, "1234").ok());
+    assert(bank.try_validate_pin(card, "0000").error() == TxError::WrongPin);
+    assert(bank.try_validate_pin(unknown, "1234").error() == TxError::WrongPin);
+    assert(bank.try_get_account(unknown).error() == TxError::UnknownAccount);
+    Result<Account*> found = bank.try_get_account(card);
+    assert(found && found.value() == &bank.get_account(card));
+
+    ATMController atm(bank);
+    assert(atm.try_enter_pin("1234").error() == TxError::NoCard);
+    assert(atm.try_withdraw(10).error() == TxError::NoAccountSelected);
+    atm.insert_card(card);
+    assert(atm.try_enter_pin("0000").error() == TxError::WrongPin);
+    assert(atm.try_enter_pin("1234").ok());
+    assert(atm.try_withdraw(0).error() == TxError::InvalidAmount);
+    assert(atm.try_withdraw(500).error() == TxError::InsufficientFunds);
+    assert(atm.view_balance() == 100 && "A failed withdrawal must not change the balance.");
+    Result<int> balance = atm.try_withdraw(40);
+    assert(balance.ok() && balance.value() == 60);
+    assert(atm.try_deposit(-5).error() == TxError::InvalidAmount);
+    assert(atm.try_deposit(15).value() == 75);
+
+    // The throwing methods raise the exception type documented for each error.
+    bool threw = false;
+    try {
+        atm.withdraw(1000);
+    } catch (const std::invalid_argument& e) {
+        threw = std::string(e.what()) == tx_error_message(TxError::InsufficientFunds);
+    }
+    assert(threw);
+    atm.eject_card();
+    threw = false;
+    try {
+        atm.enter_pin("1234");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    threw = false;
+    try {
+        Result<int>(TxError::NoAccountSelected).value();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "[PASS] test_result_api passed." << std::endl;
+}
+
+// Counts this process's open file descriptors.
+std::size_t count_open_fds() {
+    std::size_t count = 0;
+    DIR* directory = opendir("/proc/self/fd");
+    assert(directory != nullptr);
+    while (readdir(directory) != nullptr) {
+        ++count;
+    }
+    closedir(directory);
+    return count;
+}
+
+// Test the in-process and remote bank backends and request pipelining
+void test_bank_backend() {
+    std::cout << "[TEST] test_bank_backend started." << std::endl;
+
+    PinHashConfig cheap_pins;
+    cheap_pins.iterations = 10;
+    BankSystem bank(4, cheap_pins);
+    bank.add_account("4539578763621486", "1234", 100);
+    const std::uint64_t key = Card("4539578763621486").get_key();
+    const std::uint64_t unknown = Card("4556737586899855").get_key();
+
+    LocalBankBackend local(bank);
+    BackendReply reply = local.call(BackendRequest::authenticate(key, "1234"));
+    assert(reply.error == TxError::None && reply.card_key == key && reply.balance == 100 && reply.session != 0);
+    const std::uint64_t local_session = reply.session;
+    assert(local.call(BackendRequest::authenticate(key, "0000")).error == TxError::WrongPin);
+    assert(local.call(BackendRequest::authenticate(12345, "1234")).error == TxError::WrongPin);
+    assert(local.call(BackendRequest::balance(key, local_session)).balance == 100);
+
+    // Account operations need the session of a successful Authenticate for the same card.
+    assert(local.call(BackendRequest::balance(key, 0)).error == TxError::SessionExpired);
+    assert(local.call(BackendRequest::deposit(key, local_session ^ 1, 5)).error == TxError::SessionExpired);
+    assert(local.call(BackendRequest::balance(unknown, local_session)).error == TxError::SessionExpired);
+    assert(local.call(BackendRequest::validate_pin(key, "1234")).session == 0);
+    assert(local.get_sessions().size() == 1);
+    assert(local.call(BackendRequest::end_session(key, local_session)).error == TxError::None);
+    assert(local.call(BackendRequest::balance(key, local_session)).error == TxError::SessionExpired);
+    assert(local.call(BackendRequest::end_session(key, local_session)).error == TxError::SessionExpired);
+    assert(bank.get_account(Card("4539578763621486")).get_balance() == 100);
+
+    // Sessions expire when idle, and a full table refuses new ones until one does.
+    BackendSessions sessions(std::chrono::milliseconds(20), 2);
+    const std::uint64_t first = sessions.open(key);
+    assert(first != 0 && sessions.open(key) != 0 && sessions.open(key) == 0);
+    assert(sessions.check(first, key) && !sessions.check(first, unknown));
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    assert(!sessions.check(first, key));
+    assert(sessions.open(key) != 0 && sessions.open(key) != 0 && sessions.size() == 2);
+
+    const std::string socket_path = "test_backend.sock";
+    BankServerConfig server_config;
+    server_config.latency = std::chrono::milliseconds(2);
+    std::unique_ptr<BankServer> server(new BankServer(bank, socket_path, server_config));
+    RemoteBankBackend remote{RemoteBackendConfig(socket_path)};
+
+    reply = remote.call(BackendRequest::authenticate(key, "1234"));
+    assert(reply.error == TxError::None && reply.balance == 100 && reply.session != 0);
+    const std::uint64_t session = reply.session;
+    assert(remote.call(BackendRequest::authenticate(key, "4321")).error == TxError::WrongPin);
+    assert(remote.call(BackendRequest::authenticate(unknown, "1234")).error == TxError::WrongPin);
+    assert(remote.call(BackendRequest::validate_pin(key, "1234")).error == TxError::None);
+    assert(remote.call(BackendRequest::get_account(unknown, session)).error == TxError::SessionExpired);
+    assert(remote.call(BackendRequest::deposit(key, session, 50)).balance == 150);
+    assert(remote.call(BackendRequest::withdraw(key, session, 30)).balance == 120);
+    assert(remote.call(BackendRequest::withdraw(key, session, 500)).error == TxError::InsufficientFunds);
+    assert(remote.call(BackendRequest::deposit(key, session, -5)).error == TxError::InvalidAmount);
+    assert(bank.get_account(Card("4539578763621486")).get_balance() == 120);
+
+    // Pipelined requests overlap their latency instead of queueing behind each other.
+    const int requests = 40;
+    std::mutex done_mutex;
+    std::condition_variable done_signal;
+    int completed = 0;
+    int succeeded = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < requests; ++i) {
+        remote.submit(BackendRequest::deposit(key, session, 1), [&](const BackendReply& result) {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            succeeded += result.error == TxError::None ? 1 : 0;
+            ++completed;
+            done_signal.notify_one();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done_signal.wait(lock, [&completed]() { return completed == requests; });
+    }
+    std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+    assert(succeeded == requests && remote.in_flight() == 0);
+    assert(elapsed < server_config.latency * requests / 2 && "Pipelined requests must not wait for each other.");
+    assert(bank.get_account(Card("4539578763621486")).get_balance() == 120 + requests);
+    assert(server->requests_served() == 9 + requests);
+
+    // Clients that leave give back their socket and reader thread.
+    const std::size_t open_fds = count_open_fds();
+    for (int i = 0; i < 20; ++i) {
+        RemoteBankBackend transient{RemoteBackendConfig(socket_path)};
+        assert(transient.call(BackendRequest::balance(key, session)).error == TxError::None);
+    }
+    for (int wait = 0; wait < 1000 && (server->client_count() != 1 || count_open_fds() != open_fds); ++wait) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(server->client_count() == 1 && count_open_fds() == open_fds);
+
+    // Once the server is gone, requests fail instead of hanging.
+    server.reset();
+    assert(remote.call(BackendRequest::balance(key, session)).error == TxError::BackendUnavailable);
+    assert(remote.call(BackendRequest::balance(key, session)).error == TxError::BackendUnavailable);
+    bool threw = false;
+    try {
+        RemoteBankBackend unreachable{RemoteBackendConfig(socket_path)};
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "[PASS] test_bank_backend passed." << std::endl;
+}
+
+// Test the per-account transaction ledger and its queries
+void test_ledger() {
+    std::cout << "[TEST] test_ledger started." << std::endl;
+
+    // Time-range queries agree with a linear scan across many chunks.
+    Ledger ledger(1000);
+    AccountLedger& history = ledger.create_account_ledger();
+    assert(history.size() == 0 && history.last(5).empty() && history.between(0, 1000000).empty());
+    const int entries = 10000;
+    for (int i = 0; i < entries; ++i) {
+        LedgerEntry entry = {static_cast<std::int64_t>(i / 3) * 10, 7, LedgerEntryType::Deposit, i, i};
+        history.append(entry);
+    }
+    assert(history.size() == entries);
+    std::vector<LedgerEntry> newest = history.last(5);
+    assert(newest.size() == 5 && newest.front().amount == entries - 5 && newest.back().amount == entries - 1);
+    assert(history.last(0).empty() && history.last(entries * 2).size() == entries);
+    assert(history.last(entries).front().amount == 0);
+    std::uint32_t seed = 12345;
+    for (int round = 0; round < 500; ++round) {
+        seed = seed * 1103515245u + 12345u;
+        std::int64_t from = static_cast<std::int64_t>(seed % 34000) - 500;
+        seed = seed * 1103515245u + 12345u;
+        std::int64_t to = from + static_cast<std::int64_t>(seed % 2000);
+        std::vector<LedgerEntry> found = history.between(from, to);
+        std::int64_t first = (std::max<std::int64_t>(from, 0) + 9) / 10 * 3;
+        std::int64_t last = std::min<std::int64_t>(to < 0 ? -1 : to / 10 * 3 + 2, entries - 1);
+        std::size_t expected = last >= first ? static_cast<std::size_t>(last - first + 1) : 0;
+        assert(found.size() == expected);
+        assert(found.empty() || (found.front().amount == first && found.back().amount == last));
+    }
+    assert(history.between(100, 50).empty());
+
+    // A clock that steps back cannot unsort the history.
+    LedgerEntry early = {5, 7, LedgerEntryType::Withdrawal, 1, 0};
+    history.append(early);
+    assert(history.last(1).front().timestamp_us == (entries - 1) / 3 * 10);
+    LedgerStats stats = ledger.stats();
+    assert(stats.accounts == 1 && stats.chunks_used == (entries + 1 + LEDGER_CHUNK_ENTRIES - 1) / LEDGER_CHUNK_ENTRIES);
+    assert(stats.bytes == (stats.chunks_used + stats.chunks_reserved) * sizeof(LedgerChunk));
+
+    // Banks record each completed transaction with its ATM and resulting balance.
+    PinHashConfig cheap_pins;
+    cheap_pins.iterations = 10;
+    BankSystem bank(4, cheap_pins, BalanceMode::LockFree);
+    bank.open_ledger(100);
+    bank.add_account("4539578763621486", "1234", 100);
+    Card card("4539578763621486");
+    std::int64_t start = ledger_clock_us();
+    ATMController atm(bank, 42);
+    atm.insert_card(card);
+    atm.enter_pin("1234");
+    atm.deposit(50);
+    assert(!atm.try_withdraw(1000) && "A declined withdrawal must not be recorded.");
+    atm.withdraw(30);
+    std::vector<LedgerEntry> statement = atm.mini_statement(5);
+    assert(statement.size() == 2 && statement[0].type == LedgerEntryType::Deposit && statement[0].balance == 150);
+    assert(statement[1].type == LedgerEntryType::Withdrawal && statement[1].amount == 30 && statement[1].balance == 120);
+    assert(statement[0].atm_id == 42 && statement[1].atm_id == 42 && statement[0].timestamp_us >= start);
+    assert(bank.get_account(card).get_ledger()->between(start, ledger_clock_us()).size() == 2);
+    bank.get_account(card).deposit(5); // Not made at an ATM.
+    assert(atm.mini_statement(1).front().atm_id == 0);
+
+    // Concurrent updates on a lock-free bank are still recorded in balance order.
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&bank, &card, t]() {
+            ATMController teller(bank, 100 + t);
+            teller.insert_card(card);
+            teller.enter_pin("1234");
+            for (int i = 0; i < 500; ++i) {
+                teller.deposit(2);
+                teller.withdraw(1);
+            }
+        });
+    }
+    std::vector<LedgerEntry> seen = atm.mini_statement(10); // Read while the tellers write.
+    assert(seen.size() >= 3 && seen.size() <= 10);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    std::vector<LedgerEntry> all = bank.get_account(card).get_ledger()->last(10000);
+    assert(all.size() == 3 + 4 * 1000);
+    for (std::size_t i = 1; i < all.size(); ++i) {
+        int delta = all[i].type == LedgerEntryType::Deposit ? all[i].amount : -all[i].amount;
+        assert(all[i].balance == all[i - 1].balance + delta && all[i].timestamp_us >= all[i - 1].timestamp_us);
+    }
+    assert(all.back().balance == bank.get_account(card).get_balance());
+
+    bool threw = false;
+    try {
+        bank.open_ledger();
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    assert(threw);
+    BankSystem plain(4, cheap_pins);
+    plain.add_account("4539578763621486", "1234", 100);
+    threw = false;
+    try {
+        plain.open_ledger();
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    assert(threw && plain.get_account(card).get_ledger() == nullptr);
+
+    std::cout << "[PASS] test_ledger passed." << std::endl;
+}
+
+// Test the cash dispensing solver, its table cache and the ATM's note reservation
+void test_cash_dispenser() {
+    std::cout << "[TEST] test_cash_dispenser started." << std::endl;
+
+    CashDispenser dispenser({Cassette(100, 50), Cassette(50, 50), Cassette(20, 50), Cassette(10, 50)});
+    assert(dispenser.cash_available() == 9000);
+    Result<DispensePlan> plan = dispenser.try_reserve(180);
+    assert(plan && plan.value().total_notes == 4);
+    assert(plan.value().notes[0] == 1 && plan.value().notes[1] == 1 && plan.value().notes[2] == 1 &&
+           plan.value().notes[3] == 1);
+    assert(dispenser.inventory()[0].count == 49 && dispenser.cash_available() == 8820);
+    dispenser.release(plan.value());
+    assert(dispenser.cash_available() == 9000);
+    assert(dispenser.try_reserve(0).error() == TxError::InvalidAmount);
+    assert(dispenser.try_reserve(15).error() == TxError::CannotDispense);
+    assert(dispenser.try_reserve(4010).error() == TxError::CannotDispense && "More than 40 notes.");
+    assert(dispenser.try_reserve(4000).value().notes[0] == 40);
+
+    // Limits and preferences: no 20 + 10 split of a missing note, and costly cassettes are spared.
+    assert(CashDispenser::solve({Cassette(50, 1), Cassette(20, 5)}, 100).value().notes[1] == 5);
+    assert(CashDispenser::solve({Cassette(50, 9), Cassette(20, 2)}, 30).error() == TxError::CannotDispense);
+    assert(CashDispenser::solve({Cassette(50, 9, 5), Cassette(20, 9)}, 100).value().notes[1] == 5);
+    assert(CashDispenser::solve({Cassette(50, 9), Cassette(20, 9)}, 100).value().notes[0] == 2);
+
+    // The table matches a brute-force search over every reachable inventory state.
+    std::uint32_t seed = 777;
+    for (int round = 0; round < 200; ++round) {
+        std::vector<Cassette> cassettes;
+        for (int denomination : {50, 20, 10}) {
+            seed = seed * 1103515245u + 12345u;
+            cassettes.push_back(Cassette(denomination, static_cast<int>(seed >> 16) % 6));
+        }
+        CashDispenser small(cassettes, 8);
+        for (int amount = 10; amount <= 420; amount += 10) {
+            int fewest = -1;
+            for (int a = 0; a <= cassettes[0].count; ++a) {
+                for (int b = 0; b <= cassettes[1].count; ++b) {
+                    for (int c = 0; c <= cassettes[2].count; ++c) {
+                        if (a * 50 + b * 20 + c * 10 == amount && a + b + c <= 8 && (fewest < 0 || a + b + c < fewest)) {
+                            fewest = a + b + c;
+                        }
+                    }
+                }
+            }
+            Result<DispensePlan> found = small.try_reserve(amount);
+            assert(fewest < 0 ? found.error() == TxError::CannotDispense : found.value().total_notes == fewest);
+            if (found) {
+                const DispensePlan& notes = found.value();
+                assert(notes.notes[0] * 50 + notes.notes[1] * 20 + notes.notes[2] * 10 == amount);
+                small.release(notes);
+            }
+        }
+    }
+
+    // Low cassettes are solved per amount until a state has seen enough
+    // lookups to earn a table; a state that comes back reuses its table.
+    CashDispenser low({Cassette(50, 2), Cassette(20, 100)});
+    DispenserStats before = low.stats();
+    assert(low.try_reserve(50).value().notes[0] == 1);
+    for (int i = 0; i < 100; ++i) {
+        Result<DispensePlan> repeated = low.try_reserve(70);
+        assert(repeated && repeated.value().notes[0] == 1 && repeated.value().notes[1] == 1);
+        low.release(repeated.value());
+    }
+    assert(low.try_reserve(50).value().notes[0] == 1);
+    assert(low.try_reserve(50).error() == TxError::CannotDispense && low.try_reserve(100).value().notes[1] == 5);
+    low.refill(0, 2);
+    assert(low.try_reserve(50).value().notes[0] == 1);
+    DispenserStats after = low.stats();
+    assert(after.table_builds - before.table_builds == 1 && after.direct_solves > 0 && after.direct_solves < 100);
+    assert(after.cache_hits >= 1 && after.reservations == 104 && after.rejections == 1);
+
+    // The ATM reserves notes and debits the account together.
+    PinHashConfig cheap_pins;
+    cheap_pins.iterations = 10;
+    BankSystem bank(4, cheap_pins);
+    bank.add_account("4539578763621486", "1234", 500);
+    Card card("4539578763621486");
+    ATMController atm(bank, 7);
+    atm.load_cash({Cassette(50, 4), Cassette(20, 10)});
+    atm.insert_card(card);
+    atm.enter_pin("1234");
+    assert(atm.withdraw(140) == 360 && atm.get_cash_dispenser()->cash_available() == 260);
+    assert(atm.try_withdraw(30).error() == TxError::CannotDispense && atm.view_balance() == 360);
+    assert(atm.try_withdraw(380).error() == TxError::CannotDispense); // Only 260 left in the machine.
+    bank.get_account(card).withdraw(300);
+    assert(atm.try_withdraw(100).error() == TxError::InsufficientFunds);
+    assert(atm.get_cash_dispenser()->cash_available() == 260 && "A declined debit must return the notes.");
+    bool threw = false;
+    try {
+        atm.withdraw(10);
+    } catch (const std::invalid_argument& e) {
+        threw = std::string(e.what()) == tx_error_message(TxError::CannotDispense);
+    }
+    assert(threw);
+    threw = false;
+    try {
+        atm.load_cash({Cassette(0, 4)});
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw && atm.get_cash_dispenser()->cash_available() == 260);
+
+    std::cout << "[PASS] test_cash_dispenser passed." << std::endl;
+}
+
+// Test the sliding-window counters and the PIN, withdrawal and ATM rate limits built on them
+void test_limits() {
+    std::cout << "[TEST] test_limits started." << std::endl;
+
+    // A 10-second window in 1-second buckets slides one bucket at a time.
+    SlidingWindowCounters counters(std::chrono::seconds(10), 10, 16);
+    assert(counters.add(1, 5, 0) == 5 && counters.add(1, 3, 4500) == 8);
+    assert(counters.total(1, 9999) == 8 && counters.total(1, 10000) == 3 && counters.total(1, 14999) == 0);
+    assert(counters.try_add(2, 4, 5, 0) && !counters.try_add(2, 2, 5, 0) && counters.try_add(2, 1, 5, 3000));
+    assert(counters.add(2, -3, 3000) == 2 && counters.add(2, -10, 3000) == 0 && counters.total(2, 3000) == 0);
+    counters.add(3, 1, 20000);
+    counters.reset(3);
+    assert(counters.total(3, 20000) == 0 && counters.total(99, 20000) == 0);
+
+    // Memory stays at the capacity: extra keys evict the least recently updated
+    // ones, and keys whose window has passed are reused without evicting.
+    SlidingWindowCounters bounded(std::chrono::seconds(10), 10, 16);
+    for (std::uint64_t key = 0; key < 1000; ++key) {
+        bounded.add(key, 1, static_cast<std::int64_t>(key));
+    }
+    WindowCounterStats full = bounded.stats(1000);
+    assert(full.capacity == 16 && full.active == 16 && full.evictions == 1000 - 16);
+    assert(bounded.total(999, 1000) == 1 && bounded.total(0, 1000) == 0);
+    for (std::uint64_t key = 5000; key < 5004; ++key) {
+        bounded.add(key, 1, 30000);
+    }
+    WindowCounterStats later = bounded.stats(30000);
+    assert(later.active == 4 && later.evictions == full.evictions);
+
+    // The check and the update are one step, so a limit holds under contention.
+    SlidingWindowCounters shared(std::chrono::seconds(10), 10, 64);
+    std::atomic<int> admitted(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&shared, &admitted]() {
+            for (int i = 0; i < 2000; ++i) {
+                if (shared.try_add(42, 1, 1000, 500)) {
+                    ++admitted;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    assert(admitted.load() == 1000 && shared.total(42, 500) == 1000);
+
+    // Each limit on its own, with synthetic times.
+    LimitsConfig config;
+    config.max_pin_failures = 3;
+    config.max_daily_withdrawal = 1000;
+    config.max_atm_transactions = 2;
+    config.capacity = 64;
+    TransactionLimits limits(config);
+    const std::int64_t day = 24 * 3600 * 1000LL;
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        assert(limits.try_pin_attempt(7, 0));
+    }
+    assert(limits.try_pin_attempt(7, 1000).error() == TxError::CardLocked && limits.pin_failures_for(7, 1000) == 3);
+    assert(limits.try_pin_attempt(7, day + 3600 * 1000LL) && "Failures age out of the window.");
+    limits.pin_accepted(7);
+    assert(limits.pin_failures_for(7, day + 3600 * 1000LL) == 0);
+
+    assert(limits.try_reserve_withdrawal(8, 600, 0) && limits.try_reserve_withdrawal(8, 400, 0));
+    assert(limits.try_reserve_withdrawal(8, 1, 0).error() == TxError::DailyLimitExceeded);
+    limits.release_withdrawal(8, 400, 3600 * 1000LL);
+    assert(limits.withdrawn(8, 3600 * 1000LL) == 600 && limits.try_reserve_withdrawal(8, 400, 3600 * 1000LL));
+    assert(limits.try_reserve_withdrawal(8, 0, 0).error() == TxError::InvalidAmount);
+    assert(limits.withdrawn(8, day + 1) == 400 && "The 600 withdrawn at time 0 has rolled off.");
+
+    assert(limits.try_atm_transaction(1, 0) && limits.try_atm_transaction(1, 10));
+    assert(limits.try_atm_transaction(1, 20).error() == TxError::RateLimited && limits.try_atm_transaction(2, 20));
+    assert(limits.try_atm_transaction(1, 60 * 1000));
+
+    // Wrong PINs on other cards of the same set cannot evict a locked card.
+    // 16 slots make two sets of 8, picked by the low bit of the key's hash.
+    LimitsConfig small_config;
+    small_config.max_pin_failures = 3;
+    small_config.capacity = 16;
+    TransactionLimits small(small_config);
+    const std::uint64_t locked_key = 7;
+    std::vector<std::uint64_t> same_set;
+    for (std::uint64_t key = 100; same_set.size() < 9; ++key) {
+        if ((FlatAccountTable::hash(key) & 1) == (FlatAccountTable::hash(locked_key) & 1)) {
+            same_set.push_back(key);
+        }
+    }
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        assert(small.try_pin_attempt(locked_key, 0));
+    }
+    for (std::size_t i = 0; i < 8; ++i) {
+        assert(small.try_pin_attempt(same_set[i], 1000));
+    }
+    assert(small.pin_stats(1000).evictions == 1 && "The eighth card evicted the first, not the locked one.");
+    assert(small.try_pin_attempt(locked_key, 2000).error() == TxError::CardLocked);
+    assert(small.pin_failures_for(locked_key, 2000) == 3);
+    for (std::size_t i = 1; i < 8; ++i) {
+        small.try_pin_attempt(same_set[i], 3000);
+        small.try_pin_attempt(same_set[i], 3000);
+    }
+    assert(small.try_pin_attempt(same_set[8], 4000).error() == TxError::CardLocked &&
+           "A set full of locked cards refuses a new one instead of evicting.");
+    assert(small.pin_stats(4000).refusals == 1 && small.pin_failures_for(locked_key, 4000) == 3);
+
+    config.max_daily_withdrawal = -1;
+    bool threw = false;
+    try {
+        TransactionLimits invalid(config);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // The ATM locks a card after wrong PINs and holds withdrawals to the daily limit.
+    PinHashConfig cheap_pins;
+    cheap_pins.iterations = 10;
+    BankSystem bank(4, cheap_pins);
+    bank.add_account("4539578763621486", "1234", 1000);
+    bank.add_account("4556737586899855", "5678", 1000);
+    bank.add_linked_account("4556737586899855", "4556737586899855-SAV", 500);
+    LimitsConfig atm_config;
+    atm_config.max_pin_failures = 2;
+    atm_config.max_daily_withdrawal = 300;
+    atm_config.capacity = 64;
+    bank.enable_limits(atm_config);
+    threw = false;
+    try {
+        bank.enable_limits();
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    ATMController atm(bank, 3);
+    Card locked_card("4539578763621486");
+    atm.insert_card(locked_card);
+    assert(atm.try_enter_pin("0000").error() == TxError::WrongPin);
+    assert(atm.try_enter_pin("0000").error() == TxError::WrongPin);
+    threw = false;
+    try {
+        atm.enter_pin("1234");
+    } catch (const std::runtime_error& e) {
+        threw = std::string(e.what()) == tx_error_message(TxError::CardLocked);
+    }
+    assert(threw && "The right PIN does not unlock the card.");
+    atm.eject_card();
+
+    Card card("4556737586899855");
+    atm.insert_card(card);
+    assert(atm.try_enter_pin("0000").error() == TxError::WrongPin);
+    atm.enter_pin("5678");
+    assert(bank.get_limits()->pin_failures_for(card.get_key()) == 0 && "A right PIN clears the failures.");
+    atm.load_cash({Cassette(50, 10)});
+    assert(atm.withdraw(200) == 800);
+    assert(atm.try_withdraw(30).error() == TxError::CannotDispense);
+    assert(bank.get_limits()->withdrawn(card.get_key()) == 200 && "A declined withdrawal returns its allowance.");
+    assert(atm.try_withdraw(150).error() == TxError::DailyLimitExceeded && atm.view_balance() == 800);
+    assert(atm.get_cash_dispenser()->cash_available() == 300);
+    assert(atm.withdraw(100) == 700);
+
+    // Each account of a card has its own limit.
+    atm.select_account("4556737586899855-SAV");
+    assert(atm.withdraw(100) == 400);
+    assert(bank.get_limits()->withdrawn(linked_account_limit_key("4556737586899855-SAV")) == 100);
+    assert(bank.get_limits()->withdrawn(card.get_key()) == 300);
+    atm.select_account();
+    assert(atm.try_withdraw(50).error() == TxError::DailyLimitExceeded);
+
+    std::cout << "[PASS] test_limits passed." << std::endl;
+}
+
+// Test the deduplication cache and ATM requests retried with the same transaction ID
+void test_transaction_dedup() {
+    std::cout << "[TEST] test_transaction_dedup started." << std::endl;
+
+    DedupConfig config;
+    config.ttl = std::chrono::seconds(10);
+    config.capacity = 16;
+    TransactionDedupCache cache(config);
+    DedupRequest request = {1, 100, LedgerEntryType::Withdrawal, 42, 50};
+    int balance = -1;
+    assert(cache.begin(request, balance, 0) == DedupStatus::New);
+    cache.complete(request, 950, 0);
+    assert(cache.begin(request, balance, 9999) == DedupStatus::Replayed && balance == 950);
+    DedupRequest different = request;
+    different.amount = 60;
+    assert(cache.begin(different, balance, 5000) == DedupStatus::Conflict);
+    DedupRequest other_atm = request;
+    other_atm.atm_id = 2;
+    assert(cache.begin(other_atm, balance, 5000) == DedupStatus::New && "IDs are scoped by ATM.");
+    cache.abandon(other_atm);
+    assert(cache.begin(other_atm, balance, 5000) == DedupStatus::New && "An abandoned ID runs again.");
+    cache.complete(other_atm, 1, 5000);
+    assert(cache.begin(request, balance, 10000) == DedupStatus::New && "Completed IDs expire after the TTL.");
+    cache.complete(request, 900, 10000);
+
+    // Memory stays at the capacity; completed requests are evicted first by expiry.
+    DedupStats before = cache.stats(10000);
+    assert(before.capacity == 16 && before.entries == 2 && before.replays == 1 && before.conflicts == 1);
+    for (std::uint64_t id = 1000; id < 1100; ++id) {
+        DedupRequest filler = {3, id, LedgerEntryType::Deposit, 7, 1};
+        assert(cache.begin(filler, balance, 10000) == DedupStatus::New);
+        cache.complete(filler, 1, 10000 + static_cast<std::int64_t>(id));
+    }
+    DedupStats full = cache.stats(10000);
+    assert(full.entries == 16 && full.evictions >= 100 - 16 && full.started == before.started + 100);
+    assert(cache.stats(100000).entries == 0);
+
+    // A retry that arrives while the first attempt runs waits for its result.
+    DedupRequest slow = {4, 1, LedgerEntryType::Deposit, 9, 5};
+    assert(cache.begin(slow, balance, 20000) == DedupStatus::New);
+    std::atomic<int> waited_balance(-1);
+    std::thread retry([&cache, &slow, &waited_balance]() {
+        int replayed = -1;
+        if (cache.begin(slow, replayed, 20000) == DedupStatus::Replayed) {
+            waited_balance = replayed;
+        }
+    });
+    while (cache.stats(20000).waits == full.waits) {
+        std::this_thread::yield();
+    }
+    cache.complete(slow, 77, 20000);
+    retry.join();
+    assert(waited_balance.load() == 77);
+
+    // Concurrent retries of one withdrawal debit the account once.
+    PinHashConfig cheap_pins;
+    cheap_pins.iterations = 10;
+    BankSystem bank(4, cheap_pins);
+    bank.add_account("4539578763621486", "1234", 1000);
+    Card card("4539578763621486");
+    ATMController plain(bank);
+    plain.insert_card(card);
+    plain.enter_pin("1234");
+    bool threw = false;
+    try {
+        plain.withdraw(10, 1);
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    assert(threw && "Transaction IDs need the deduplication cache.");
+
+    bank.enable_deduplication();
+    std::vector<std::thread> threads;
+    std::atomic<int> agreed(0);
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&bank, &agreed]() {
+            Card session_card("4539578763621486");
+            ATMController atm(bank, 5);
+            atm.insert_card(session_card);
+            atm.enter_pin("1234");
+            for (std::uint64_t id = 1; id <= 50; ++id) {
+                Result<int> result = atm.try_withdraw(10, id);
+                if (result && result.value() == 1000 - 10 * static_cast<int>(id)) {
+                    ++agreed;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    assert(bank.get_account(card).get_balance() == 500 && agreed.load() == 200);
+    DedupStats shared = bank.get_dedup_cache()->stats();
+    assert(shared.started == 50 && shared.replays == 150);
+
+    // A failed attempt is forgotten; reusing an ID for another request is an error.
+    ATMController atm(bank, 6);
+    atm.insert_card(card);
+    atm.enter_pin("1234");
+    assert(atm.try_withdraw(5000, 1).error() == TxError::InsufficientFunds);
+    assert(atm.try_withdraw(100, 1).value() == 400 && atm.try_withdraw(100, 1).value() == 400);
+    assert(atm.try_deposit(100, 1).error() == TxError::TransactionIdReused);
+    assert(atm.deposit(100, 2) == 500 && atm.deposit(100, 2) == 500 && atm.view_balance() == 500);
+    threw = false;
+    try {
+        atm.withdraw(50, 2);
+    } catch (const std::invalid_argument& e) {
+        threw = std::string(e.what()) == tx_error_message(TxError::TransactionIdReused);
+    }
+    assert(threw && atm.view_balance() == 500);
+
+    // A withdrawal applied before the journal failed is not undone: it
+    // reports NotDurable and its notes and allowance stay taken. Later
+    // withdrawals, its retry included, are refused before the debit and give
+    // everything back.
+    TempDir temp_dir("atm_dedup");
+    const std::string& directory = temp_dir.path();
+    {
+        Logger::set_level(LogLevel::Off);
+        BankSystem durable(4, cheap_pins);
+        durable.open_journal(JournalConfig(directory));
+        LimitsConfig limits_config;
+        limits_config.capacity = 64;
+        durable.enable_limits(limits_config);
+        durable.enable_deduplication();
+        durable.add_account("4539578763621486", "1234", 1000);
+        ATMController teller(durable, 7);
+        teller.insert_card(card);
+        teller.enter_pin("1234");
+        teller.load_cash({Cassette(50, 20)});
+        assert(teller.withdraw(100, 10) == 900);
+        std::string full_segment = journal_segment_path(directory, durable.get_journal()->last_lsn() + 1);
+        assert(symlink("/dev/full", full_segment.c_str()) == 0);
+        durable.checkpoint();
+        assert(teller.try_withdraw(100, 11).error() == TxError::NotDurable);
+        assert(teller.try_withdraw(100, 11).error() == TxError::BackendUnavailable);
+        assert(teller.try_withdraw(100, 12).error() == TxError::BackendUnavailable);
+        assert(teller.try_withdraw(100, 12).error() == TxError::BackendUnavailable);
+        assert(teller.view_balance() == 800 && teller.get_cash_dispenser()->cash_available() == 800);
+        assert(durable.get_limits()->withdrawn(card.get_key()) == 200);
+        Logger::set_level(LogLevel::Info);
+    }
+
+    std::cout << "[PASS] test_transaction_dedup passed." << std::endl;
+}
+
+// Test bulk account provisioning: parallel passes, duplicates, invalid records and durability
+void test_bulk_load() {
+    std::cout << "[TEST] test_bulk_load started." << std::endl;
+
+    PinHashConfig cheap_pins;
+    cheap_pins.iterations = 10;
+    std::uint64_t pin_1234 = 0;
+    pack_pin("1234", pin_1234);
+    PinCredential precomputed = hash_pin("9876", 10);
+
+    // 20000 accounts: even ones with a plain PIN, odd ones with a precomputed hash.
+    std::vector<BankSystem::NewAccount> accounts;
+    for (std::uint64_t i = 0; i < 20000; ++i) {
+        BankSystem::NewAccount account;
+        pack_card_number(make_card_number(i), account.key);
+        account.packed_pin = pin_1234;
+        account.credential = i % 2 == 0 ? empty_pin_credential() : precomputed; // Iterations 0: hash packed_pin.
+        account.balance = static_cast<int>(i);
+        accounts.push_back(account);
+    }
+    BankSystem::NewAccount bad = accounts[3];
+    bad.balance = -1;                      // Index 20000: negative balance.
+    accounts.push_back(bad);
+    bad = accounts[4];
+    bad.packed_pin = 123;                  // Index 20001: not a packed PIN.
+    accounts.push_back(bad);
+    bad = accounts[5];
+    bad.key = 10000000000000000ULL;        // Index 20002: more than 16 digits.
+    accounts.push_back(bad);
+    accounts.push_back(accounts[7]);       // Index 20003: repeats index 7.
+    accounts.back().balance = 999;
+    bad = accounts[6];
+    bad.key ^= 1;                          // Index 20004: fails the Luhn checksum.
+    accounts.push_back(bad);
+
+    BankSystem bank(8, cheap_pins);
+    bank.add_account(make_card_number(9), "5555", 1); // Loaded before: index 9 is a duplicate.
+    BankSystem::BulkLoadResult result = bank.add_accounts(accounts, 4);
+    assert(result.added == 19999 && result.duplicates == 2 && result.invalid == 4);
+    const std::size_t expected[] = {9, 20000, 20001, 20002, 20003, 20004};
+    assert(result.rejected == std::vector<std::size_t>(expected, expected + 6));
+
+    std::size_t stored = 0;
+    for (const BankSystem::ShardStats& shard : bank.shard_stats()) {
+        stored += shard.accounts;
+    }
+    assert(stored == 20000);
+    assert(bank.get_account(Card(make_card_number(7))).get_balance() == 7);
+    assert(bank.get_account(Card(make_card_number(9))).get_balance() == 1);
+    assert(bank.validate_pin(Card(make_card_number(10)), "1234"));
+    assert(bank.validate_pin(Card(make_card_number(11)), "9876"));
+    assert(!bank.validate_pin(Card(make_card_number(11)), "1234"));
+
+    // Loading the same file again adds nothing.
+    result = bank.add_accounts(accounts);
+    assert(result.added == 0 && result.duplicates == 20001 && result.invalid == 4);
+
+    // A journaled bank records every bulk opening and recovers it.
+    TempDir temp_dir("atm_bulk");
+    const std::string& directory = temp_dir.path();
+    JournalConfig config(directory);
+    config.commit_window = std::chrono::microseconds(200);
+    {
+        BankSystem durable(4, cheap_pins);
+        durable.open_journal(config);
+        accounts.resize(100);
+        assert(durable.add_accounts(accounts).added == 100);
+        assert(durable.get_journal()->durable_lsn() == durable.get_journal()->last_lsn());
+    }
+    {
+        BankSystem recovered(4, cheap_pins);
+        recovered.open_journal(config);
+        assert(recovered.get_account(Card(make_card_number(99))).get_balance() == 99);
+        assert(recovered.validate_pin(Card(make_card_number(98)), "1234"));
+        assert(recovered.validate_pin(Card(make_card_number(99)), "9876"));
+    }
+
+    std::cout << "[PASS] test_bulk_load passed." << std::endl;
+}
+
+// Test linked accounts, account selection and atomic transfers, including under contention and recovery
+void test_linked_accounts_and_transfers() {
+    std::cout << "[TEST] test_linked_accounts_and_transfers started." << std::endl;
+
+    BankSystem bank;
+    bank.open_ledger();
+    bank.add_account("4539578763621486", "1234", 1000);
+    bank.add_account("4556737586899855", "4321", 50);
+    bank.add_linked_account("4539578763621486", "4539578763621486-SAV", 200);
+    bank.add_linked_account("4539578763621486", "4539578763621486-USD");
+    try {
+        bank.add_linked_account("4556737586899855", "4539578763621486-SAV"); // IDs are unique across cards.
+        assert(false && "Expected a duplicate ID to be rejected.");
+    } catch (const std::invalid_argument&) {
+    }
+    try {
+        bank.add_linked_account("4556737586899855", "4539578763621486"); // Would collide with a card account.
+        assert(false && "Expected a card number as ID to be rejected.");
+    } catch (const std::invalid_argument&) {
+    }
+    try {
+        bank.add_linked_account("4916338506082832", "ORPHAN"); // The card has no account.
+        assert(false && "Expected an unknown card to be rejected.");
+    } catch (const std::invalid_argument&) {
+    }
+    std::vector<Account*> accounts = bank.get_accounts(Card("4539578763621486"));
+    assert(accounts.size() == 3 && accounts[0] == &bank.get_account(Card("4539578763621486")));
+    assert(accounts[1]->get_account_id() == "4539578763621486-SAV" && accounts[1]->get_balance() == 200);
+    assert(bank.get_accounts(Card("4556737586899855")).size() == 1);
+    assert(bank.get_accounts(Card("4916338506082832")).empty());
+
+    // Selection at the ATM is limited to the card's own accounts.
+    Card card("4539578763621486");
+    ATMController atm(bank, 7);
+    atm.insert_card(card);
+    assert(atm.try_select_account("4539578763621486-SAV").error() == TxError::NoAccountSelected);
+    atm.enter_pin("1234");
+    std::vector<std::string> ids = atm.list_accounts();
+    assert(ids.size() == 3 && ids[0] == "4539578763621486" && ids[2] == "4539578763621486-USD");
+    atm.select_account("4539578763621486-SAV");
+    assert(atm.view_balance() == 200);
+    assert(atm.try_select_account("4556737586899855").error() == TxError::UnknownAccount);
+    assert(atm.view_balance() == 200 && "A failed selection keeps the current account.");
+
+    // Transfers move money between the card's accounts in one step.
+    assert(atm.transfer("4539578763621486", 150) == 50);
+    atm.select_account();
+    assert(atm.view_balance() == 1150);
+    assert(atm.try_transfer("4539578763621486-SAV", 2000).error() == TxError::InsufficientFunds);
+    assert(atm.try_transfer("4539578763621486", 10).error() == TxError::SameAccount);
+    assert(atm.try_transfer("4539578763621486-SAV", 0).error() == TxError::InvalidAmount);
+    assert(atm.try_transfer("4556737586899855", 10).error() == TxError::UnknownAccount);
+    assert(atm.transfer("4539578763621486-USD", 100) == 1050);
+    assert(accounts[1]->get_balance() == 50 && accounts[2]->get_balance() == 100);
+    std::vector<LedgerEntry> statement = atm.mini_statement(1);
+    assert(statement.size() == 1 && statement[0].type == LedgerEntryType::TransferOut &&
+           statement[0].amount == 100 && statement[0].balance == 1050 && statement[0].atm_id == 7);
+    statement = accounts[2]->get_ledger()->last(1);
+    assert(statement.size() == 1 && statement[0].type == LedgerEntryType::TransferIn && statement[0].balance == 100);
+    atm.eject_card();
+
+    // Opposing transfers on both balance modes: no deadlock, and no money created or lost.
+    Logger::set_level(LogLevel::Error); // Every transfer logs at Info level.
+    for (BalanceMode mode : {BalanceMode::Locked, BalanceMode::LockFree}) {
+        BankSystem contended(4, PinHashConfig(), mode);
+        contended.add_account("4539578763621486", "1234", 1000);
+        contended.add_linked_account("4539578763621486", "SAVINGS", 1000);
+        Account& checking = contended.get_account(Card("4539578763621486"));
+        Account& savings = *contended.get_accounts(Card("4539578763621486"))[1];
+        std::vector<std::thread> threads;
+        std::atomic<int> moved(0);
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t]() {
+                Account& from = t % 2 == 0 ? checking : savings;
+                Account& to = t % 2 == 0 ? savings : checking;
+                for (int i = 0; i < 5000; ++i) {
+                    if (from.try_transfer(to, 1 + i % 7)) {
+                        moved.fetch_add(1);
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        assert(moved.load() > 0);
+        assert(checking.get_balance() + savings.get_balance() == 2000);
+        assert(checking.get_balance() >= 0 && savings.get_balance() >= 0);
+    }
+    Logger::set_level(LogLevel::Info);
+
+    // Linked accounts and transfers survive a restart, from the snapshot and the journal tail.
+    TempDir temp_dir("atm_transfer");
+    const std::string& directory = temp_dir.path();
+    JournalConfig config(directory);
+    config.commit_window = std::chrono::microseconds(200);
+    std::uint64_t last_lsn;
+    {
+        BankSystem durable;
+        durable.open_journal(config);
+        durable.add_account("4539578763621486", "1234", 500);
+        durable.add_linked_account("4539578763621486", "SAVINGS", 100);
+        Account& checking = durable.get_account(Card("4539578763621486"));
+        Account& savings = *durable.get_accounts(Card("4539578763621486"))[1];
+        checking.transfer(savings, 50);
+        durable.checkpoint();                    // Snapshot covers 450 / 150.
+        durable.add_linked_account("4539578763621486", "HOLIDAY", 0);
+        savings.transfer(checking, 20);          // Only in the journal tail.
+        savings.deposit(5);
+        last_lsn = durable.get_journal()->last_lsn();
+    }
+    {
+        // A transfer torn after its TransferOut record is dropped as a whole.
+        Journal tail(config, last_lsn);
+        tail.wait_durable(tail.append(JournalRecordType::TransferOut, "SAVINGS", 100, 35));
+    }
+    {
+        BankSystem recovered;
+        recovered.open_journal(config);
+        std::vector<Account*> restored = recovered.get_accounts(Card("4539578763621486"));
+        assert(restored.size() == 3);
+        assert(restored[0]->get_balance() == 470);
+        assert(restored[1]->get_account_id() == "SAVINGS" && restored[1]->get_balance() == 135);
+        assert(restored[2]->get_account_id() == "HOLIDAY" && restored[2]->get_balance() == 0);
+        assert(restored[1]->transfer(*restored[2], 35) == 100); // Restored accounts are journaled again.
+    }
+    {
+        BankSystem recovered;
+        recovered.open_journal(config);
+        assert(recovered.get_accounts(Card("4539578763621486"))[2]->get_balance() == 35);
+    }
+
+    std::cout << "[PASS] test_linked_accounts_and_transfers passed." << std::endl;
+}
+
+// Test the posting kernels and batch posting, alone and next to live traffic
+void test_batch_posting() {
+    std::cout << "[TEST] test_batch_posting started." << std::endl;
+
+    // Every kernel agrees with the scalar arithmetic, including the tails.
+    PostingRules rules;
+    rules.interest_bp = 125;  // 1.25%.
+    rules.fee = 300;
+    rules.fee_waiver_balance = 100000;
+    std::vector<int> balances;
+    for (int i = 0; i < 1003; ++i) {
+        balances.push_back(i % 5 == 0 ? i : static_cast<int>(FlatAccountTable::hash(i) % 2147483647u));
+    }
+    balances.push_back(2147483647);
+    balances.push_back(99999);
+    balances.push_back(100000);
+    for (PostingKernel kernel : {PostingKernel::Scalar, PostingKernel::SSE2, PostingKernel::AVX2}) {
+        if (!posting_kernel_supported(kernel)) {
+            continue;
+        }
+        std::vector<int> deltas(balances.size());
+        compute_postings(balances.data(), deltas.data(), balances.size(), rules, kernel);
+        for (std::size_t i = 0; i < balances.size(); ++i) {
+            assert(deltas[i] == posting_delta(balances[i], rules));
+        }
+    }
+    assert(posting_delta(10000, rules) == 125 - 300);
+    assert(posting_delta(200, rules) == 2 - 200 && "The fee is capped at the balance.");
+    assert(posting_delta(100000, rules) == 1250 && "Large balances pay no fee.");
+    assert(posting_delta(0, rules) == 0);
+    PostingRules bad;
+    bad.interest_bp = 10000;
+    try {
+        check_posting_rules(bad);
+        assert(false && "Expected a rate of 100% to be rejected.");
+    } catch (const std::invalid_argument&) {
+    }
+
+    // Posting updates card and linked accounts, records and rejects.
+    for (BalanceMode mode : {BalanceMode::Locked, BalanceMode::LockFree}) {
+        BankSystem bank(4, PinHashConfig(), mode);
+        bank.add_account("4539578763621486", "1234", 10000);
+        bank.add_account("4556737586899855", "4321", 200000);
+        bank.add_linked_account("4539578763621486", "SAVINGS", 50000);
+        std::vector<BankSystem::PostingAdjustment> adjustments;
+        BankSystem::PostingAdjustment refund = {"SAVINGS", 500};
+        adjustments.push_back(refund);
+        BankSystem::PostingAdjustment correction = {"4556737586899855", -250000}; // Would overdraw.
+        adjustments.push_back(correction);
+        BankSystem::PostingResult result = bank.post_batch(rules, adjustments, 2);
+        assert(result.accounts == 3 && result.posted == 2 && result.rejected == 1);
+        assert(bank.get_account(Card("4539578763621486")).get_balance() == 10000 + 125 - 300);
+        assert(bank.get_accounts(Card("4539578763621486"))[1]->get_balance() == 50000 + 625 - 300 + 500);
+        assert(bank.get_account(Card("4556737586899855")).get_balance() == 200000);
+        assert(result.credited == 825 && result.debited == 175);
+
+        BankSystem::PostingAdjustment unknown = {"NOSUCH", 1};
+        adjustments.assign(1, unknown);
+        try {
+            bank.post_batch(rules, adjustments);
+            assert(false && "Expected an unknown account to be rejected.");
+        } catch (const std::invalid_argument&) {
+        }
+        assert(bank.get_account(Card("4539578763621486")).get_balance() == 9825 && "Nothing was posted.");
+    }
+
+    // Live traffic keeps running and sees each account before or after its whole posting.
+    PostingRules fee_only;
+    fee_only.fee = 7;
+    fee_only.fee_waiver_balance = 2000000;
+    BankSystem bank(8);
+    bank.open_ledger();
+    const int account_count = 64;
+    std::vector<Account*> accounts;
+    for (int i = 0; i < account_count; ++i) {
+        std::string card_number = make_card_number(static_cast<std::uint64_t>(i));
+        bank.add_account(card_number, "1234", 1000);
+        accounts.push_back(&bank.get_account(Card(card_number)));
+    }
+    Logger::set_level(LogLevel::Error); // Every deposit and withdrawal logs at Info level.
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> traffic;
+    for (int t = 0; t < 3; ++t) {
+        traffic.emplace_back([&, t]() {
+            for (std::size_t i = 0; !stop.load(); ++i) {
+                Account& account = *accounts[(i * 7 + static_cast<std::size_t>(t)) % account_count];
+                account.deposit(10);
+                account.withdraw(10);
+            }
+        });
+    }
+    for (int round = 0; round < 5; ++round) {
+        BankSystem::PostingResult result = bank.post_batch(fee_only, std::vector<BankSystem::PostingAdjustment>(), 2);
+        assert(result.accounts == static_cast<std::size_t>(account_count) && result.rejected == 0);
+    }
+    stop.store(true);
+    for (std::thread& thread : traffic) {
+        thread.join();
+    }
+    Logger::set_level(LogLevel::Info);
+    for (Account* account : accounts) {
+        assert(account->get_balance() == 1000 - 5 * 7);
+        std::vector<LedgerEntry> entries = account->get_ledger()->last(1000000);
+        int postings = 0;
+        for (const LedgerEntry& entry : entries) {
+            if (entry.type == LedgerEntryType::Posting) {
+                assert(entry.amount == -7);
+                ++postings;
+            }
+        }
+        assert(postings == 5);
+    }
+
+    // Postings are journaled and recovered.
+    TempDir temp_dir("atm_posting");
+    const std::string& directory = temp_dir.path();
+    JournalConfig config(directory);
+    config.commit_window = std::chrono::microseconds(200);
+    {
+        BankSystem durable;
+        durable.open_journal(config);
+        durable.add_account("4539578763621486", "1234", 10000);
+        durable.post_batch(rules);
+        assert(durable.get_journal()->durable_lsn() == durable.get_journal()->last_lsn());
+    }
+    {
+        BankSystem recovered;
+        recovered.open_journal(config);
+        assert(recovered.get_account(Card("4539578763621486")).get_balance() == 9825);
+    }
+
+    std::cout << "[PASS] test_batch_posting passed." << std::endl;
+}
+
+// Test point-in-time balance snapshots taken while transfers run
+void test_balance_snapshots() {
+    std::cout << "[TEST] test_balance_snapshots started." << std::endl;
+
+    BankSystem plain;
+    try {
+        plain.snapshot_balances();
+        assert(false && "Expected snapshots to require enabling.");
+    } catch (const std::logic_error&) {
+    }
+    plain.add_account("4539578763621486", "1234", 100);
+    try {
+        plain.enable_balance_snapshots();
+        assert(false && "Expected enabling after an account was added to be rejected.");
+    } catch (const std::logic_error&) {
+    }
+
+    // Later updates and accounts stay out of an earlier snapshot.
+    BankSystem bank(4, PinHashConfig(), BalanceMode::LockFree);
+    bank.enable_balance_snapshots();
+    bank.add_account("4539578763621486", "1234", 1000);
+    bank.add_linked_account("4539578763621486", "SAVINGS", 500);
+    BalanceSnapshot first = bank.snapshot_balances();
+    bank.get_account(Card("4539578763621486")).deposit(250);
+    bank.get_accounts(Card("4539578763621486"))[1]->transfer(bank.get_account(Card("4539578763621486")), 100);
+    bank.add_account("4556737586899855", "4321", 70);
+    assert(first.epoch() == 1 && first.size() == 2 && first.total_balance() == 1500);
+    assert(first.find("4539578763621486").value() == 1000);
+    assert(first.find("SAVINGS").value() == 500);
+    assert(first.find("4556737586899855").error() == TxError::UnknownAccount);
+    BalanceSnapshot second = bank.snapshot_balances(2);
+    assert(second.epoch() == 2 && second.size() == 3 && second.total_balance() == 1820);
+    assert(second.find("4539578763621486").value() == 1350);
+    assert(second.card_balances().front().key < second.card_balances().back().key);
+    assert(second.linked_balances()[0].card_key == second.card_balances().front().key);
+    assert(bank.get_balance_mode() == BalanceMode::LockFree);
+
+    // Every snapshot taken during concurrent transfers holds exactly the money put in.
+    BankSystem busy(8);
+    busy.enable_balance_snapshots();
+    const int account_count = 32;
+    std::vector<Account*> accounts;
+    for (int i = 0; i < account_count; ++i) {
+        std::string card_number = make_card_number(static_cast<std::uint64_t>(i));
+        busy.add_account(card_number, "1234", 1000);
+        accounts.push_back(&busy.get_account(Card(card_number)));
+    }
+    Logger::set_level(LogLevel::Error); // Every transfer logs at Info level.
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> traffic;
+    for (int t = 0; t < 3; ++t) {
+        traffic.emplace_back([&, t]() {
+            for (std::size_t i = 0; !stop.load(); ++i) {
+                std::uint64_t h = FlatAccountTable::hash(static_cast<std::uint64_t>(t) << 32 | i);
+                std::size_t from = h % account_count;
+                std::size_t to = (from + 1 + (h >> 8) % (account_count - 1)) % account_count;
+                accounts[from]->try_transfer(*accounts[to], static_cast<int>(h >> 16) % 300 + 1);
+            }
+        });
+    }
+    for (int round = 0; round < 20; ++round) {
+        BalanceSnapshot snapshot = busy.snapshot_balances(2);
+        assert(snapshot.size() == static_cast<std::size_t>(account_count));
+        assert(snapshot.total_balance() == account_count * 1000);
+    }
+    stop.store(true);
+    for (std::thread& thread : traffic) {
+        thread.join();
+    }
+    Logger::set_level(LogLevel::Info);
+
+    // The exported file reads back unchanged, and corruption is detected.
+    TempDir temp_dir("atm_balances");
+    const std::string& directory = temp_dir.path();
+    const std::string path = directory + "/balances.bin";
+    second.write(path);
+    BalanceSnapshot loaded = BalanceSnapshot::read(path);
+    assert(loaded.epoch() == second.epoch() && loaded.taken_at_us() == second.taken_at_us());
+    assert(loaded.size() == 3 && loaded.total_balance() == 1820);
+    assert(loaded.find("SAVINGS").value() == 400);
+    {
+        std::fstream file(path.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(40);
+        file.put('\x7f');
+    }
+    try {
+        BalanceSnapshot::read(path);
+        assert(false && "Expected a corrupt file to be rejected.");
+    } catch (const std::runtime_error&) {
+    }
+
+    std::cout << "[PASS] test_balance_snapshots passed." << std::endl;
+}
+
+// Test the shared memory transport, its batching and the socket fallback
+void test_shm_transport() {
+    std::cout << "[TEST] test_shm_transport started." << std::endl;
+
+    PinHashConfig cheap_pins;
+    cheap_pins.iterations = 10;
+    BankSystem bank(4, cheap_pins);
+    bank.add_account("4539578763621486", "1234", 100);
+    const std::uint64_t key = Card("4539578763621486").get_key();
+    const std::uint64_t unknown = Card("4556737586899855").get_key();
+
+    const std::string region_name = "/atm_test_shm";
+    std::unique_ptr<ShmBankServer> server(new ShmBankServer(bank, region_name));
+    std::unique_ptr<ShmBankBackend> client(new ShmBankBackend(region_name));
+
+    BackendReply reply = client->call(BackendRequest::authenticate(key, "1234"));
+    assert(reply.error == TxError::None && reply.card_key == key && reply.balance == 100 && reply.session != 0);
+    const std::uint64_t session = reply.session;
+    assert(client->call(BackendRequest::authenticate(key, "4321")).error == TxError::WrongPin);
+    assert(client->call(BackendRequest::get_account(unknown, session)).error == TxError::SessionExpired);
+    assert(client->call(BackendRequest::deposit(key, session, 50)).balance == 150);
+    assert(client->call(BackendRequest::withdraw(key, session, 30)).balance == 120);
+    assert(client->call(BackendRequest::withdraw(key, session, 500)).error == TxError::InsufficientFunds);
+    try {
+        client->submit(BackendRequest::authenticate(key, "1234567890123"), [](const BackendReply&) {});
+        assert(false && "Expected an overlong PIN to be rejected.");
+    } catch (const std::invalid_argument&) {
+    }
+
+    // Sessions on several threads share the channel; requests queued together are served as one batch.
+    Logger::set_level(LogLevel::Error);
+    const int threads = 4;
+    const int per_thread = 500;
+    std::atomic<int> succeeded(0);
+    std::vector<std::thread> sessions;
+    for (int t = 0; t < threads; ++t) {
+        sessions.emplace_back([&]() {
+            std::mutex done_mutex;
+            std::condition_variable done_signal;
+            int completed = 0;
+            for (int i = 0; i < per_thread; ++i) {
+                client->submit(BackendRequest::deposit(key, session, 1), [&](const BackendReply& result) {
+                    succeeded.fetch_add(result.error == TxError::None ? 1 : 0);
+                    std::lock_guard<std::mutex> lock(done_mutex);
+                    ++completed;
+                    done_signal.notify_one();
+                });
+            }
+            std::unique_lock<std::mutex> lock(done_mutex);
+            done_signal.wait(lock, [&]() { return completed == per_thread; });
+        });
+    }
+    for (std::thread& session : sessions) {
+        session.join();
+    }
+    Logger::set_level(LogLevel::Info);
+    assert(succeeded.load() == threads * per_thread && client->in_flight() == 0);
+    assert(bank.get_account(Card("4539578763621486")).get_balance() == 120 + threads * per_thread);
+    assert(server->requests_served() == 6 + threads * per_thread);
+    assert(server->batches_served() < server->requests_served());
+
+    // Every channel can be claimed once; a released channel is reset and can be claimed again.
+    std::vector<std::unique_ptr<ShmBankBackend>> others;
+    for (std::size_t i = 1; i < SHM_MAX_CHANNELS; ++i) {
+        others.emplace_back(new ShmBankBackend(region_name, 1));
+    }
+    try {
+        ShmBankBackend extra(region_name, 1);
+        assert(false && "Expected every channel to be in use.");
+    } catch (const std::runtime_error&) {
+    }
+    others.pop_back();
+    std::unique_ptr<ShmBankBackend> reused;
+    for (int attempt = 0; attempt < 100 && !reused; ++attempt) {
+        try {
+            reused.reset(new ShmBankBackend(region_name, 1));
+        } catch (const std::runtime_error&) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    assert(reused && reused->call(BackendRequest::balance(key, session)).balance == 120 + threads * per_thread);
+    others.clear();
+    reused.reset();
+
+    // Once the server is gone, requests fail instead of hanging, and new clients are refused.
+    server.reset();
+    assert(client->call(BackendRequest::balance(key, session)).error == TxError::BackendUnavailable);
+    assert(client->call(BackendRequest::balance(key, session)).error == TxError::BackendUnavailable);
+    client.reset();
+    try {
+        ShmBankBackend missing(region_name);
+        assert(false && "Expected a removed region to be refused.");
+    } catch (const std::runtime_error&) {
+    }
+
+    // Without the region, connecting to the daemon falls back to its socket.
+    const std::string socket_path = "test_shm_fallback.sock";
+    std::unique_ptr<BankServer> socket_server(new BankServer(bank, socket_path, BankServerConfig()));
+    std::unique_ptr<BankBackend> fallback = connect_bank_daemon(region_name, RemoteBackendConfig(socket_path));
+    assert(dynamic_cast<RemoteBankBackend*>(fallback.get()) != nullptr);
+    const std::uint64_t fallback_session = fallback->call(BackendRequest::authenticate(key, "1234")).session;
+    assert(fallback->call(BackendRequest::deposit(key, fallback_session, 1)).balance == 121 + threads * per_thread);
+    fallback.reset();
+    socket_server.reset();
+
+    std::cout << "[PASS] test_shm_transport passed." << std::endl;
+}
+
+// Test full ATM sessions from a terminal that reaches the bank through a backend
+void test_remote_atm_controller() {
+    std::cout << "[TEST] test_remote_atm_controller started." << std::endl;
+
+    PinHashConfig cheap_pins;
+    cheap_pins.iterations = 10;
+    BankSystem bank(4, cheap_pins);
+    bank.add_account("4539578763621486", "1234", 1000);
+    bank.add_account("4556737586899855", "5678", 0);
+    bank.enable_limits();
+    Card card("4539578763621486");
+
+    const std::string region_name = "/atm_test_remote_atm";
+    const std::string socket_path = "test_remote_atm.sock";
+    std::unique_ptr<ShmBankServer> shm_server(new ShmBankServer(bank, region_name));
+    std::unique_ptr<BankServer> socket_server(new BankServer(bank, socket_path, BankServerConfig()));
+    RemoteBackendConfig socket_config(socket_path);
+    std::unique_ptr<BankBackend> shm = connect_bank_daemon(region_name, socket_config);
+    assert(dynamic_cast<ShmBankBackend*>(shm.get()) != nullptr);
+    RemoteBankBackend socket(socket_config);
+    LocalBankBackend local(bank);
+    BankBackend* backends[] = {shm.get(), &socket, &local};
+
+    int balance = 1000;
+    for (BankBackend* backend : backends) {
+        RemoteATMController atm(*backend, 9);
+        assert(atm.get_atm_id() == 9);
+        assert(atm.try_enter_pin("1234").error() == TxError::NoCard);
+        atm.insert_card(card);
+        assert(atm.try_view_balance().error() == TxError::NoAccountSelected);
+        assert(atm.try_enter_pin("4321").error() == TxError::WrongPin);
+        atm.enter_pin("1234");
+        assert(atm.view_balance() == balance);
+        assert(atm.deposit(100) == balance + 100);
+        assert(atm.withdraw(50) == balance + 50);
+        assert(atm.try_withdraw(1000000).error() == TxError::InsufficientFunds);
+        assert(atm.try_deposit(0).error() == TxError::InvalidAmount);
+        balance += 50;
+
+        // Notes are reserved in the terminal and given back if the bank declines.
+        atm.load_cash({Cassette(100, 20)});
+        assert(atm.try_withdraw(30).error() == TxError::CannotDispense);
+        assert(atm.try_withdraw(2000).error() == TxError::InsufficientFunds);
+        assert(atm.get_cash_dispenser()->cash_available() == 2000);
+        assert(atm.withdraw(100) == balance - 100 && atm.get_cash_dispenser()->cash_available() == 1900);
+        balance -= 100;
+        atm.eject_card();
+        assert(atm.try_deposit(10).error() == TxError::NoAccountSelected);
+    }
+    assert(bank.get_account(card).get_balance() == balance);
+    assert(shm_server->requests_served() > 0 && socket_server->requests_served() > 0);
+    assert(local.get_sessions().size() == 0 && "Ejecting the card closes its session.");
+
+    // Wrong PINs count against the bank's lockout whichever transport they arrive by.
+    Card guessed("4556737586899855");
+    for (BankBackend* backend : backends) {
+        RemoteATMController atm(*backend, 9);
+        atm.insert_card(guessed);
+        assert(atm.try_enter_pin("0000").error() == TxError::WrongPin);
+    }
+    RemoteATMController locked(socket, 9);
+    locked.insert_card(guessed);
+    assert(locked.try_enter_pin("5678").error() == TxError::CardLocked);
+    assert(locked.try_view_balance().error() == TxError::NoAccountSelected);
+
+    // A terminal whose bank has gone away reports it instead of hanging.
+    RemoteATMController orphan(*shm, 9);
+    orphan.insert_card(card);
+    orphan.enter_pin("1234");
+    shm_server.reset();
+    Logger::set_level(LogLevel::Off);
+    assert(orphan.try_view_balance().error() == TxError::BackendUnavailable);
+    bool threw = false;
+    try {
+        orphan.withdraw(10);
+    } catch (const std::runtime_error& e) {
+        threw = std::string(e.what()) == tx_error_message(TxError::BackendUnavailable);
+    }
+    Logger::set_level(LogLevel::Info);
+    assert(threw);
+
+    shm.reset();
+    std::cout << "[PASS] test_remote_atm_controller passed." << std::endl;
+}
+
+// Test resumable controller sessions and the pooled session manager with idle expiry
+void test_session_manager() {
+    std::cout << "[TEST] test_session_manager started." << std::endl;
+
+    PinHashConfig cheap_pins;
+    cheap_pins.iterations = 10;
+    BankSystem bank(4, cheap_pins);
+    bank.add_account("4539578763621486", "1234", 100);
+    bank.add_account("4556737586899855", "5678", 500);
+    bank.add_linked_account("4539578763621486", "4539578763621486-SAV", 50);
+    Card first("4539578763621486");
+    Card second("4556737586899855");
+
+    // One controller serves two customers in turn, each resuming where it left off.
+    ATMController atm(bank);
+    ATMSession alice;
+    ATMSession bob;
+    atm.resume(alice);
+    atm.insert_card(first);
+    atm.resume(bob);
+    atm.insert_card(second);
+    atm.enter_pin("5678");
+    atm.resume(alice);
+    assert(atm.try_deposit(10).error() == TxError::NoAccountSelected);
+    atm.enter_pin("1234");
+    assert(atm.deposit(10) == 110 && alice.current_account == &bank.get_account(first));
+    atm.resume(bob);
+    assert(atm.withdraw(100) == 400);
+    atm.suspend();
+    assert(atm.try_enter_pin("1234").error() == TxError::NoCard);
+
+    try {
+        SessionConfig bad;
+        bad.tick = bad.idle_timeout;
+        SessionManager rejected(bank, bad);
+        assert(false && "Expected a tick as long as the timeout to be rejected.");
+    } catch (const std::invalid_argument&) {
+    }
+
+    SessionConfig config;
+    config.capacity = 2;
+    config.idle_timeout = std::chrono::milliseconds(200);
+    config.tick = std::chrono::milliseconds(10);
+    SessionManager sessions(bank, config);
+    SessionHandle a = sessions.open_session(first);
+    SessionHandle b = sessions.open_session(second);
+    assert(a != INVALID_SESSION_HANDLE && b != INVALID_SESSION_HANDLE && a != b);
+    assert(sessions.try_open_session(first).error() == TxError::TooManySessions);
+    assert(sessions.try_view_balance(a).error() == TxError::NoAccountSelected);
+    assert(sessions.try_enter_pin(a, "0000").error() == TxError::WrongPin);
+    sessions.enter_pin(a, "1234");
+    sessions.enter_pin(b, "5678");
+    assert(sessions.deposit(a, 5) == 115);
+    assert(sessions.withdraw(b, 50) == 350);
+    assert(sessions.try_withdraw(a, 1000).error() == TxError::InsufficientFunds);
+    assert(sessions.transfer(a, "4539578763621486-SAV", 15) == 100);
+    sessions.select_account(a, "4539578763621486-SAV");
+    assert(sessions.view_balance(a) == 65 && sessions.view_balance(b) == 350);
+
+    // A closed session's handle is refused, even once its slot serves someone else.
+    assert(sessions.close_session(a));
+    assert(!sessions.close_session(a));
+    assert(sessions.try_deposit(a, 1).error() == TxError::SessionExpired);
+    SessionHandle c = sessions.open_session(first);
+    assert(static_cast<std::uint32_t>(c) == static_cast<std::uint32_t>(a) && c != a);
+    assert(sessions.try_view_balance(a).error() == TxError::SessionExpired);
+    assert(sessions.try_view_balance(INVALID_SESSION_HANDLE).error() == TxError::SessionExpired);
+    try {
+        sessions.view_balance(a);
+        assert(false && "Expected a closed session to be refused.");
+    } catch (const std::runtime_error&) {
+    }
+
+    // A session kept busy stays open; an idle one expires and its slot is reused.
+    sessions.enter_pin(c, "1234");
+    for (int i = 0; i < 15; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        assert(sessions.view_balance(c) == 100);
+        sessions.expire_idle();
+    }
+    assert(sessions.try_view_balance(b).error() == TxError::SessionExpired);
+    SessionStats stats = sessions.stats();
+    assert(stats.open == 1 && stats.opened == 3 && stats.closed == 1 && stats.expired == 1 && stats.rejected == 1);
+    SessionHandle d = sessions.open_session(second);
+    assert(static_cast<std::uint32_t>(d) == static_cast<std::uint32_t>(b));
+    assert(sessions.close_session(c) && sessions.close_session(d));
+
+    // Many sessions on several threads, interleaved per thread.
+    Logger::set_level(LogLevel::Error);
+    SessionConfig wide;
+    wide.capacity = 4096;
+    SessionManager pool(bank, wide);
+    const int threads = 4;
+    const int per_thread = 1000;
+    std::vector<std::thread> terminals;
+    for (int t = 0; t < threads; ++t) {
+        terminals.emplace_back([&, t]() {
+            std::vector<SessionHandle> mine;
+            for (int i = 0; i < per_thread; ++i) {
+                mine.push_back(pool.open_session(t % 2 == 0 ? first : second));
+            }
+            for (SessionHandle session : mine) {
+                pool.enter_pin(session, t % 2 == 0 ? "1234" : "5678");
+            }
+            for (SessionHandle session : mine) {
+                pool.deposit(session, 1);
+                assert(pool.close_session(session));
+            }
+        });
+    }
+    for (std::thread& terminal : terminals) {
+        terminal.join();
+    }
+    Logger::set_level(LogLevel::Info);
+    assert(pool.stats().open == 0 && pool.stats().closed == threads * per_thread);
+    assert(bank.get_account(first).get_balance() == 100 + 2 * per_thread);
+    assert(bank.get_account(second).get_balance() == 350 + 2 * per_thread);
+
+    std::cout << "[PASS] test_session_manager passed." << std::endl;
+}
+
+// Runs a tool from bin/, next to this test binary, and returns its standard
+// output; status receives its exit code.
+std::string run_tool(const std::string& arguments, int& status) {
+    char self[4096];
+    ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    assert(length > 0);
+    std::string command(self, static_cast<std::size_t>(length));
+    command = command.substr(0, command.rfind('/') + 1) + arguments + " 2>&1";
+    FILE* pipe = popen(command.c_str(), "r");
+    assert(pipe != nullptr);
+    std::string output;
+    char buffer[4096];
+    std::size_t count;
+    while ((count = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, count);
+    }
+    int raw = pclose(pipe);
+    status = WIFEXITED(raw) ? WEXITSTATUS(raw) : -1;
+    return output;
+}
+
+// Returns the text after prefix in output, up to the end of its line.
+std::string output_line(const std::string& output, const std::string& prefix) {
+    std::size_t start = output.find(prefix);
+    assert(start != std::string::npos);
+    start += prefix.size();
+    return output.substr(start, output.find('\n', start) - start);
+}
+
+// Test tools/atm_replay.cpp on CSV and journal input, malformed records and several threads
+void test_replay_tool() {
+    std::cout << "[TEST] test_replay_tool started." << std::endl;
+
+    TempDir temp_dir("atm_replay");
+    const std::string& directory = temp_dir.path();
+    const std::string first = make_card_number(1);
+    const std::string second = make_card_number(2);
+
+    // A CSV log with a withdrawal the balance does not cover, a card number
+    // failing the Luhn check, a negative opening and an unknown type.
+    const std::string csv = directory + "/day.csv";
+    {
+        std::ofstream out(csv);
+        out << "account_id,type,amount,balance\n"
+            << first << ",open,100\n"
+            << second << ",open,50\n"
+            << first << ",deposit,25,125\n"
+            << second << ",withdraw,20,30\n"
+            << first << ",withdraw,500\n"
+            << "1234567812345678,open,100\n"
+            << make_card_number(3) << ",open,-5\n"
+            << first << ",refund,1\n";
+    }
+    int status = -1;
+    std::string checksum;
+    for (int threads : {1, 4}) {
+        std::string output = run_tool("atm_replay --csv " + csv + " --threads " + std::to_string(threads), status);
+        assert(status == 0);
+        assert(output_line(output, "Applied ") == "4, rejected 1, balance mismatches 0, unknown accounts 0, "
+                                                  "duplicate opens 0, malformed 3, linked-account records skipped 0");
+        if (checksum.empty()) {
+            checksum = output_line(output, "Checksum ");
+        }
+        assert(output_line(output, "Checksum ") == checksum && "The thread count does not change the result.");
+    }
+
+    // A journal with a linked account: its opening and its half of the
+    // transfer are skipped, not reported as corruption.
+    const std::string journal_dir = directory + "/journal";
+    assert(mkdir(journal_dir.c_str(), 0700) == 0);
+    {
+        Logger::set_level(LogLevel::Error);
+        PinHashConfig cheap_pins;
+        cheap_pins.iterations = 10;
+        BankSystem bank(4, cheap_pins);
+        bank.open_journal(JournalConfig(journal_dir));
+        bank.add_account(first, "1234", 100);
+        bank.add_account(second, "1234", 50);
+        bank.add_linked_account(first, first + "-SAV", 10);
+        bank.get_account(Card(first)).deposit(5);
+        std::vector<Account*> accounts = bank.get_accounts(Card(first));
+        assert(accounts.size() == 2 && accounts[0]->transfer(*accounts[1], 20) == 85);
+        Logger::set_level(LogLevel::Info);
+    }
+    std::string output = run_tool("atm_replay --journal " + journal_dir + " --threads 3", status);
+    assert(status == 0);
+    assert(output_line(output, "Applied ") == "4, rejected 0, balance mismatches 0, unknown accounts 0, "
+                                              "duplicate opens 0, malformed 0, linked-account records skipped 2");
+
+    // A generated journal replays on several threads to its checksum.
+    const std::string generated_dir = directory + "/generated";
+    assert(mkdir(generated_dir.c_str(), 0700) == 0);
+    output = run_tool("atm_replay --generate-journal " + generated_dir + " --accounts 200 --records 5000", status);
+    assert(status == 0);
+    checksum = output_line(output, "checksum ");
+    output = run_tool("atm_replay --journal " + generated_dir + " --threads 4 --expect-checksum " + checksum, status);
+    assert(status == 0 && output.find("Checksum matches.") != std::string::npos);
+    output = run_tool("atm_replay --journal " + generated_dir + " --expect-checksum 1", status);
+    assert(status == 1);
+
+    std::cout << "[PASS] test_replay_tool passed." << std::endl;
+}
+
 int main() {
     try {
         test_insert_card();
@@ -202,7 +2507,32 @@ int main() {
         test_deposit();
         test_withdraw();
         test_full_flow();
+        test_concurrent_updates();
+        test_lock_free_balances();
+        test_logger();
+        test_journal_recovery();
+        test_flat_account_table();
+        test_card_validation();
+        test_latency_histogram();
+        test_pin_hashing();
+        test_compact_account_store();
+        test_metrics();
+        test_result_api();
+        test_bank_backend();
+        test_ledger();
+        test_cash_dispenser();
+        test_limits();
+        test_transaction_dedup();
+        test_bulk_load();
+        test_linked_accounts_and_transfers();
+        test_batch_posting();
+        test_balance_snapshots();
+        test_shm_transport();
+        test_remote_atm_controller();
+        test_session_manager();
+        test_replay_tool();
 
+        Logger::instance().flush();
         std::cout << "All tests passed successfully!" << std::endl;
     } catch (const std::exception& e) {
         std::cerr << "[FAILURE] A test failed: " << e.what() << std::endl;
@@ -0,0 +1,29 @@
+#ifndef SYNTHETICCARDS_H
+#define SYNTHETICCARDS_H
+
+#include <string>
+#include <cstdint>
+#include "../include/Card.h"
+
+// Synthetic card numbers for the tools, benchmarks and tests that provision
+// accounts in bulk. Not part of the library: a real bank's card numbers come
+// from its issuer.
+
+// Returns the valid (Luhn) 16-digit card number numbered index: "4", index
+// as 14 digits and the check digit. index must be below 10^14.
+inline std::string make_card_number(std::uint64_t index) {
+    std::uint64_t body = 400000000000000ULL + index; // 15 digits starting with 4.
+    int sum = 0;
+    std::uint64_t rest = body;
+    for (int position = 0; rest != 0; ++position, rest /= 10) {
+        int digit = static_cast<int>(rest % 10);
+        if (position % 2 == 0) {
+            digit *= 2;
+            if (digit > 9) digit -= 9;
+        }
+        sum += digit;
+    }
+    return unpack_card_number(body * 10 + static_cast<std::uint64_t>((10 - sum % 10) % 10));
+}
+
+#endif // SYNTHETICCARDS_H
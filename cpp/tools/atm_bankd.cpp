@@ -0,0 +1,170 @@
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include "../include/BankServer.h"
+#include "../include/BankSystem.h"
+#include "../include/FlatAccountTable.h"
+#include "../include/Logger.h"
+#include "../include/PinHash.h"
+#include "../include/ShmBankServer.h"
+#include "SyntheticCards.h"
+
+// Bank daemon: serves one BankSystem to ATM front-end processes, over a
+// shared memory region (ShmBankServer) for processes on the same host and
+// over a Unix domain socket (BankServer) for those that cannot map it, e.g.
+// from another container. Front ends connect with connect_bank_daemon,
+// which prefers the region and falls back to the socket.
+//
+// The bank is provisioned with --accounts synthetic accounts: card numbers
+// 4000000000000000 upward (Luhn-valid), PIN 1234, --balance each. The
+// daemon runs until SIGINT or SIGTERM, or for --duration seconds if given,
+// then prints the requests served on each transport and the mean number of
+// requests the shared memory server picked up per batch.
+//
+// Usage: atm_bankd [--shm NAME] [--socket PATH] [--accounts N] [--balance N]
+//                  [--shards N] [--pin-iterations N] [--workers N] [--duration SEC]
+
+namespace {
+
+const char* const PROVISIONED_PIN = "1234";
+
+struct Options {
+    std::string shm_name;
+    std::string socket_path;
+    std::size_t accounts;
+    int balance;
+    std::size_t shards;
+    std::uint32_t pin_iterations;
+    std::size_t workers;
+    double duration; // Seconds; 0 runs until a signal.
+
+    Options()
+        : shm_name("/atm_bank"), socket_path("atm_bank.sock"), accounts(100000), balance(1000),
+          shards(BankSystem::DEFAULT_SHARD_COUNT), pin_iterations(PinHashConfig().iterations), workers(2),
+          duration(0) {}
+};
+
+Options parse_options(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for " + arg);
+        }
+        std::string value = argv[++i];
+        if (arg == "--shm") {
+            options.shm_name = value;
+        } else if (arg == "--socket") {
+            options.socket_path = value;
+        } else if (arg == "--accounts") {
+            options.accounts = std::stoul(value);
+        } else if (arg == "--balance") {
+            options.balance = std::stoi(value);
+        } else if (arg == "--shards") {
+            options.shards = std::stoul(value);
+        } else if (arg == "--pin-iterations") {
+            options.pin_iterations = static_cast<std::uint32_t>(std::stoul(value));
+        } else if (arg == "--workers") {
+            options.workers = std::stoul(value);
+        } else if (arg == "--duration") {
+            options.duration = std::stod(value);
+        } else {
+            throw std::invalid_argument("Unknown option: " + arg);
+        }
+    }
+    if (options.shards == 0 || options.pin_iterations == 0 || options.workers == 0) {
+        throw std::invalid_argument("Shards, PIN iterations and workers must be positive.");
+    }
+    if (options.balance < 0 || options.duration < 0) {
+        throw std::invalid_argument("Balance and duration must not be negative.");
+    }
+    return options;
+}
+
+// Adds the synthetic accounts with one bulk load.
+void provision(BankSystem& bank, const Options& options) {
+    std::uint64_t packed_pin = 0;
+    pack_pin(PROVISIONED_PIN, packed_pin);
+    std::vector<BankSystem::NewAccount> accounts(options.accounts);
+    for (std::size_t i = 0; i < options.accounts; ++i) {
+        BankSystem::NewAccount& account = accounts[i];
+        pack_card_number(make_card_number(i), account.key);
+        account.packed_pin = packed_pin;
+        account.credential.iterations = 0;
+        account.balance = options.balance;
+    }
+    bank.add_accounts(accounts);
+}
+
+// Blocks until SIGINT or SIGTERM arrives, or until duration seconds have passed if positive.
+void wait_for_shutdown(const sigset_t& signals, double duration) {
+    if (duration <= 0) {
+        int received = 0;
+        sigwait(&signals, &received);
+        return;
+    }
+    struct timespec timeout;
+    timeout.tv_sec = static_cast<time_t>(duration);
+    timeout.tv_nsec = static_cast<long>((duration - static_cast<double>(timeout.tv_sec)) * 1e9);
+    sigtimedwait(&signals, nullptr, &timeout);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "atm_bankd: " << e.what() << std::endl;
+        return 2;
+    }
+    Logger::set_level(LogLevel::Warn);
+
+    // Blocked before any thread starts, so every thread inherits the mask and
+    // the signals are only ever taken by wait_for_shutdown.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    try {
+        PinHashConfig pins;
+        pins.iterations = options.pin_iterations;
+        BankSystem bank(options.shards, pins);
+        provision(bank, options);
+
+        BankServerConfig socket_config;
+        socket_config.workers = options.workers;
+        std::unique_ptr<BankServer> socket_server(new BankServer(bank, options.socket_path, socket_config));
+        std::unique_ptr<ShmBankServer> shm_server(new ShmBankServer(bank, options.shm_name));
+        std::cout << "atm_bankd: serving " << options.accounts << " accounts on shared memory " << options.shm_name
+                  << " and socket " << options.socket_path << std::endl;
+
+        wait_for_shutdown(signals, options.duration);
+
+        const std::uint64_t shm_requests = shm_server->requests_served();
+        const std::uint64_t shm_batches = shm_server->batches_served();
+        const std::uint64_t socket_requests = socket_server->requests_served();
+        shm_server.reset();
+        socket_server.reset();
+        std::cout << "Shared memory: " << shm_requests << " requests in " << shm_batches << " batches (mean "
+                  << std::fixed << std::setprecision(1)
+                  << (shm_batches == 0 ? 0.0 : static_cast<double>(shm_requests) / shm_batches) << " per batch)"
+                  << std::endl;
+        std::cout << "Socket: " << socket_requests << " requests" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "atm_bankd: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,536 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/ATMController.h"
+#include "../include/LatencyHistogram.h"
+#include "../include/Logger.h"
+#include "../include/Metrics.h"
+#include "SyntheticCards.h"
+
+// ATM fleet load generator: drives many ATMController sessions from a pool of
+// threads against one shared BankSystem with a configurable transaction mix and
+// Zipf-skewed account popularity, then reports throughput, latency histograms
+// and the shards and accounts where sessions contend.
+//
+// Usage: atm_loadgen [--accounts N] [--sessions N] [--threads N] [--duration SEC]
+//                    [--mix balance=40,deposit=20,withdraw=30,bad_pin=10]
+//                    [--zipf S] [--shards N] [--seed N] [--journal DIR]
+//                    [--pin-iterations N] [--verifier-threads N]
+//                    [--lock-free] [--histogram] [--json FILE] [--metrics FILE]
+
+namespace {
+
+enum TxType { TX_BALANCE, TX_DEPOSIT, TX_WITHDRAW, TX_BAD_PIN, TX_TYPE_COUNT };
+
+const char* const TX_NAMES[TX_TYPE_COUNT] = {"balance", "deposit", "withdraw", "bad_pin"};
+
+const char* const PIN = "1234";
+const char* const WRONG_PIN = "9999";
+const int INITIAL_BALANCE = 1000000;
+
+// Accounts this popular or more (by Zipf rank) are tracked individually for the hot-spot report.
+const std::size_t TRACKED_RANKS = 1024;
+
+struct Options {
+    std::size_t accounts;
+    std::size_t sessions;
+    std::size_t threads;
+    double duration;
+    unsigned mix[TX_TYPE_COUNT];
+    double zipf;
+    std::size_t shards;
+    unsigned seed;
+    std::string journal_dir;
+    PinHashConfig pins;
+    bool lock_free; // Accounts update balances with compare-and-swap instead of a lock.
+    bool histogram;
+    std::string json_path;
+    std::string metrics_path; // Receives operation metrics in Prometheus format once a second.
+
+    Options()
+        : accounts(100000), sessions(64), threads(std::max(1u, std::thread::hardware_concurrency())),
+          duration(5.0), zipf(0.99), shards(BankSystem::DEFAULT_SHARD_COUNT), seed(42), lock_free(false),
+          histogram(false) {
+        pins.iterations = 100; // Keeps provisioning quick; pass the production cost to size hosts.
+        mix[TX_BALANCE] = 40;
+        mix[TX_DEPOSIT] = 20;
+        mix[TX_WITHDRAW] = 30;
+        mix[TX_BAD_PIN] = 10;
+    }
+};
+
+// Per-account tally for the hot-spot report.
+struct AccountTally {
+    std::uint64_t transactions;
+    std::uint64_t total_ns;
+    std::uint64_t max_ns;
+};
+
+// Everything one worker thread measures; merged after the run.
+struct WorkerResult {
+    LatencyHistogram latency[TX_TYPE_COUNT];
+    std::uint64_t declined;   // Withdrawals refused for insufficient funds.
+    std::uint64_t errors;     // Unexpected exceptions.
+    std::vector<AccountTally> hot;
+
+    WorkerResult() : declined(0), errors(0), hot(TRACKED_RANKS, AccountTally()) {}
+};
+
+// Samples Zipf-distributed ranks (0 is the most popular) from a precomputed CDF.
+// Exponent 0 gives a uniform distribution.
+class ZipfSampler {
+public:
+    ZipfSampler(std::size_t count, double exponent) : cdf(count) {
+        double total = 0;
+        for (std::size_t rank = 0; rank < count; ++rank) {
+            total += 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+            cdf[rank] = total;
+        }
+        for (double& value : cdf) {
+            value /= total;
+        }
+    }
+
+    // Maps a uniform value in [0, 1) to a rank.
+    std::size_t sample(double uniform) const {
+        std::size_t rank = std::lower_bound(cdf.begin(), cdf.end(), uniform) - cdf.begin();
+        return rank < cdf.size() ? rank : cdf.size() - 1;
+    }
+
+    // Retrieves the fraction of samples that land on the given rank.
+    double probability(std::size_t rank) const {
+        return rank == 0 ? cdf[0] : cdf[rank] - cdf[rank - 1];
+    }
+
+private:
+    std::vector<double> cdf;
+};
+
+std::uint64_t now_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Parses "balance=40,deposit=20,..." into mix weights; omitted types get weight 0.
+void parse_mix(const std::string& text, unsigned* mix) {
+    std::fill(mix, mix + TX_TYPE_COUNT, 0u);
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        std::size_t equals = item.find('=');
+        if (equals == std::string::npos) {
+            throw std::invalid_argument("Mix entries must be name=weight: " + item);
+        }
+        std::string name = item.substr(0, equals);
+        int type = -1;
+        for (int i = 0; i < TX_TYPE_COUNT; ++i) {
+            if (name == TX_NAMES[i]) {
+                type = i;
+            }
+        }
+        if (type < 0) {
+            throw std::invalid_argument("Unknown transaction type in mix: " + name);
+        }
+        mix[type] = static_cast<unsigned>(std::stoul(item.substr(equals + 1)));
+    }
+}
+
+Options parse_options(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--histogram") {
+            options.histogram = true;
+            continue;
+        }
+        if (arg == "--lock-free") {
+            options.lock_free = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for " + arg);
+        }
+        std::string value = argv[++i];
+        if (arg == "--accounts") {
+            options.accounts = std::stoul(value);
+        } else if (arg == "--sessions") {
+            options.sessions = std::stoul(value);
+        } else if (arg == "--threads") {
+            options.threads = std::stoul(value);
+        } else if (arg == "--duration") {
+            options.duration = std::stod(value);
+        } else if (arg == "--mix") {
+            parse_mix(value, options.mix);
+        } else if (arg == "--zipf") {
+            options.zipf = std::stod(value);
+        } else if (arg == "--shards") {
+            options.shards = std::stoul(value);
+        } else if (arg == "--seed") {
+            options.seed = static_cast<unsigned>(std::stoul(value));
+        } else if (arg == "--pin-iterations") {
+            options.pins.iterations = static_cast<std::uint32_t>(std::stoul(value));
+        } else if (arg == "--verifier-threads") {
+            options.pins.verifier_threads = std::stoul(value);
+        } else if (arg == "--journal") {
+            options.journal_dir = value;
+        } else if (arg == "--json") {
+            options.json_path = value;
+        } else if (arg == "--metrics") {
+            options.metrics_path = value;
+        } else {
+            throw std::invalid_argument("Unknown option: " + arg);
+        }
+    }
+    unsigned weight = 0;
+    for (unsigned share : options.mix) {
+        weight += share;
+    }
+    if (options.accounts == 0 || options.sessions == 0 || options.threads == 0 || weight == 0 ||
+        options.duration <= 0 || options.zipf < 0 || options.pins.iterations == 0 ||
+        options.pins.verifier_threads == 0) {
+        throw std::invalid_argument("Accounts, sessions, threads, duration, mix weight, PIN iterations and "
+                                    "verifier threads must be positive.");
+    }
+    if (options.sessions < options.threads) {
+        options.threads = options.sessions; // A session is driven by exactly one thread.
+    }
+    return options;
+}
+
+// Runs one transaction end to end at a terminal: card in, PIN, operation, card out.
+// Returns false if a withdrawal was declined.
+bool run_transaction(ATMController& atm, Card& card, TxType type) {
+    atm.insert_card(card);
+    try {
+        if (type == TX_BAD_PIN) {
+            try {
+                atm.enter_pin(WRONG_PIN);
+            } catch (const std::invalid_argument&) {
+                // Expected: the terminal rejects the PIN and returns the card.
+            }
+            atm.eject_card();
+            return true;
+        }
+        atm.enter_pin(PIN);
+        atm.select_account();
+        bool accepted = true;
+        switch (type) {
+            case TX_BALANCE:
+                atm.view_balance();
+                break;
+            case TX_DEPOSIT:
+                atm.deposit(20);
+                break;
+            default:
+                try {
+                    atm.withdraw(20);
+                } catch (const std::invalid_argument&) {
+                    accepted = false;
+                }
+                break;
+        }
+        atm.eject_card();
+        return accepted;
+    } catch (...) {
+        atm.eject_card();
+        throw;
+    }
+}
+
+// Drives the sessions assigned to one thread until stop is set.
+void run_worker(const Options& options, std::size_t worker, std::vector<std::unique_ptr<ATMController>>& atms,
+                std::vector<Card>& cards, const std::vector<std::uint32_t>& rank_to_account,
+                const ZipfSampler& zipf, const std::atomic<bool>& go, const std::atomic<bool>& stop,
+                WorkerResult& result) {
+    std::mt19937_64 rng(options.seed * 7919u + worker);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    unsigned weight = 0;
+    for (unsigned share : options.mix) {
+        weight += share;
+    }
+    std::uniform_int_distribution<unsigned> pick_type(0, weight - 1);
+
+    // Sessions worker, worker + threads, worker + 2 * threads, ... belong to this thread.
+    std::vector<ATMController*> mine;
+    for (std::size_t s = worker; s < atms.size(); s += options.threads) {
+        mine.push_back(atms[s].get());
+    }
+
+    while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    for (std::size_t turn = 0; !stop.load(std::memory_order_relaxed); ++turn) {
+        ATMController& atm = *mine[turn % mine.size()];
+        std::size_t rank = zipf.sample(uniform(rng));
+        unsigned roll = pick_type(rng);
+        int type = 0;
+        while (roll >= options.mix[type]) {
+            roll -= options.mix[type];
+            ++type;
+        }
+
+        std::uint64_t start = now_ns();
+        try {
+            if (!run_transaction(atm, cards[rank_to_account[rank]], static_cast<TxType>(type))) {
+                ++result.declined;
+            }
+        } catch (const std::exception&) {
+            ++result.errors;
+        }
+        std::uint64_t elapsed = now_ns() - start;
+
+        result.latency[type].record(elapsed);
+        if (rank < TRACKED_RANKS) {
+            AccountTally& tally = result.hot[rank];
+            ++tally.transactions;
+            tally.total_ns += elapsed;
+            tally.max_ns = std::max(tally.max_ns, elapsed);
+        }
+    }
+}
+
+std::string micros(std::uint64_t ns) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(ns < 10000 ? 2 : 1) << ns / 1000.0;
+    return out.str();
+}
+
+void print_latency_row(const std::string& name, const LatencyHistogram& histogram, double seconds) {
+    std::cout << std::left << std::setw(10) << name << std::right << std::setw(12) << histogram.count()
+              << std::setw(12) << std::fixed << std::setprecision(0) << histogram.count() / seconds
+              << std::setw(10) << micros(static_cast<std::uint64_t>(histogram.mean()))
+              << std::setw(10) << micros(histogram.percentile(0.50))
+              << std::setw(10) << micros(histogram.percentile(0.90))
+              << std::setw(10) << micros(histogram.percentile(0.99))
+              << std::setw(10) << micros(histogram.percentile(0.999))
+              << std::setw(10) << micros(histogram.max()) << std::endl;
+}
+
+// Prints the distribution with one line per power-of-two latency band.
+void print_histogram(const LatencyHistogram& histogram) {
+    std::vector<std::uint64_t> bands(65, 0);
+    for (std::size_t bucket = 0; bucket < LatencyHistogram::BUCKET_COUNT; ++bucket) {
+        std::uint64_t count = histogram.bucket_count(bucket);
+        if (count != 0) {
+            std::uint64_t bound = LatencyHistogram::bucket_upper_bound(bucket);
+            bands[bound == 0 ? 0 : 64 - __builtin_clzll(bound)] += count;
+        }
+    }
+    std::uint64_t peak = *std::max_element(bands.begin(), bands.end());
+    std::size_t first = 0;
+    while (first < bands.size() && bands[first] == 0) ++first;
+    std::size_t last = bands.size();
+    while (last > first && bands[last - 1] == 0) --last;
+
+    std::cout << "\nLatency histogram (all transactions, us):" << std::endl;
+    for (std::size_t band = first; band < last; ++band) {
+        std::uint64_t upper = band == 0 ? 0 : (band >= 64 ? ~0ULL : (1ULL << band) - 1);
+        std::size_t bar = peak == 0 ? 0 : static_cast<std::size_t>(50.0 * bands[band] / peak);
+        std::cout << "  <= " << std::setw(10) << micros(upper) << " " << std::setw(10) << bands[band] << " "
+                  << std::string(bar, '#') << std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "atm_loadgen: " << e.what() << std::endl;
+        return 2;
+    }
+    // Per-transaction INFO lines and the WARN for every bad PIN would dominate the measurement.
+    Logger::set_level(LogLevel::Error);
+
+    BankSystem bank(options.shards, options.pins, options.lock_free ? BalanceMode::LockFree : BalanceMode::Locked);
+    if (!options.journal_dir.empty()) {
+        bank.open_journal(JournalConfig(options.journal_dir));
+    }
+    std::vector<Card> cards;
+    cards.reserve(options.accounts);
+    for (std::size_t i = 0; i < options.accounts; ++i) {
+        cards.emplace_back(make_card_number(i));
+    }
+    // Provision in parallel: every new PIN is hashed at the configured cost.
+    std::vector<std::thread> provisioners;
+    std::size_t provision_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t t = 0; t < provision_threads; ++t) {
+        provisioners.emplace_back([&, t]() {
+            for (std::size_t i = t; i < options.accounts; i += provision_threads) {
+                bank.add_account(cards[i].get_card_number(), PIN, INITIAL_BALANCE);
+            }
+        });
+    }
+    for (std::thread& provisioner : provisioners) {
+        provisioner.join();
+    }
+
+    // Shuffle which account gets which popularity rank so hot accounts spread over shards.
+    std::vector<std::uint32_t> rank_to_account(options.accounts);
+    for (std::size_t i = 0; i < rank_to_account.size(); ++i) {
+        rank_to_account[i] = static_cast<std::uint32_t>(i);
+    }
+    std::mt19937 shuffle_rng(options.seed);
+    std::shuffle(rank_to_account.begin(), rank_to_account.end(), shuffle_rng);
+    ZipfSampler zipf(options.accounts, options.zipf);
+
+    std::vector<std::unique_ptr<ATMController>> atms;
+    for (std::size_t s = 0; s < options.sessions; ++s) {
+        atms.emplace_back(new ATMController(bank));
+    }
+
+    std::vector<BankSystem::ShardStats> before = bank.shard_stats();
+    bank.get_pin_verifier().reset_stats();
+    std::vector<std::unique_ptr<WorkerResult>> results;
+    std::vector<std::thread> workers;
+    std::atomic<bool> go(false);
+    std::atomic<bool> stop(false);
+    for (std::size_t t = 0; t < options.threads; ++t) {
+        results.emplace_back(new WorkerResult());
+        workers.emplace_back(run_worker, std::cref(options), t, std::ref(atms), std::ref(cards),
+                             std::cref(rank_to_account), std::cref(zipf), std::cref(go), std::cref(stop),
+                             std::ref(*results.back()));
+    }
+    std::unique_ptr<MetricsExporter> exporter;
+    if (!options.metrics_path.empty()) {
+        exporter.reset(new MetricsExporter(options.metrics_path, std::chrono::milliseconds(1000)));
+    }
+    std::uint64_t start = now_ns();
+    go.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.duration));
+    stop.store(true);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    exporter.reset(); // Writes the final totals.
+    std::vector<BankSystem::ShardStats> after = bank.shard_stats();
+    PinVerifierStats pins = bank.get_pin_verifier().stats();
+
+    // Merge the per-thread measurements.
+    WorkerResult total;
+    for (const std::unique_ptr<WorkerResult>& result : results) {
+        for (int type = 0; type < TX_TYPE_COUNT; ++type) {
+            total.latency[type].merge(result->latency[type]);
+        }
+        total.declined += result->declined;
+        total.errors += result->errors;
+        for (std::size_t rank = 0; rank < TRACKED_RANKS; ++rank) {
+            total.hot[rank].transactions += result->hot[rank].transactions;
+            total.hot[rank].total_ns += result->hot[rank].total_ns;
+            total.hot[rank].max_ns = std::max(total.hot[rank].max_ns, result->hot[rank].max_ns);
+        }
+    }
+    LatencyHistogram all;
+    for (int type = 0; type < TX_TYPE_COUNT; ++type) {
+        all.merge(total.latency[type]);
+    }
+
+    std::cout << "ATM fleet: " << options.sessions << " sessions on " << options.threads << " threads, "
+              << options.accounts << " accounts (zipf " << options.zipf << "), " << options.shards << " shards"
+              << (options.journal_dir.empty() ? "" : ", journaled") << (options.lock_free ? ", lock-free" : "")
+              << ", " << std::fixed << std::setprecision(1) << seconds << " s" << std::endl;
+    std::cout << "Throughput: " << std::setprecision(0) << all.count() / seconds << " tx/s (" << all.count()
+              << " transactions, " << total.declined << " declined, " << total.errors << " errors)\n" << std::endl;
+
+    std::cout << std::left << std::setw(10) << "type" << std::right << std::setw(12) << "count" << std::setw(12)
+              << "tx/s" << std::setw(10) << "mean_us" << std::setw(10) << "p50_us" << std::setw(10) << "p90_us"
+              << std::setw(10) << "p99_us" << std::setw(10) << "p999_us" << std::setw(10) << "max_us" << std::endl;
+    for (int type = 0; type < TX_TYPE_COUNT; ++type) {
+        if (options.mix[type] != 0) {
+            print_latency_row(TX_NAMES[type], total.latency[type], seconds);
+        }
+    }
+    print_latency_row("all", all, seconds);
+    if (options.histogram) {
+        print_histogram(all);
+    }
+
+    std::cout << "\nPIN verification (" << options.pins.iterations << " iterations, " << options.pins.verifier_threads
+              << " verifier threads): " << std::setprecision(0) << pins.verifications_per_sec << " checks/s, "
+              << std::setprecision(1) << 100.0 * pins.worker_utilization << "% busy, queue wait p50 "
+              << micros(pins.queue_wait_p50_ns) << " us, p99 " << micros(pins.queue_wait_p99_ns) << " us, max "
+              << micros(pins.queue_wait_max_ns) << " us" << std::endl;
+
+    // Hot shards: where sessions queued on a shard lock during the run.
+    std::vector<std::size_t> shard_order(after.size());
+    for (std::size_t i = 0; i < shard_order.size(); ++i) {
+        shard_order[i] = i;
+    }
+    std::sort(shard_order.begin(), shard_order.end(), [&](std::size_t a, std::size_t b) {
+        return after[a].contended - before[a].contended > after[b].contended - before[b].contended;
+    });
+    std::cout << "\nHot shards (by contended lock acquisitions):" << std::endl;
+    std::cout << std::setw(8) << "shard" << std::setw(10) << "accounts" << std::setw(14) << "acquisitions"
+              << std::setw(12) << "contended" << std::setw(10) << "rate" << std::endl;
+    for (std::size_t i = 0; i < std::min<std::size_t>(5, shard_order.size()); ++i) {
+        std::size_t shard = shard_order[i];
+        std::uint64_t acquisitions = after[shard].acquisitions - before[shard].acquisitions;
+        std::uint64_t contended = after[shard].contended - before[shard].contended;
+        std::cout << std::setw(8) << shard << std::setw(10) << after[shard].accounts << std::setw(14) << acquisitions
+                  << std::setw(12) << contended << std::setw(9) << std::setprecision(2)
+                  << (acquisitions == 0 ? 0.0 : 100.0 * contended / acquisitions) << "%" << std::endl;
+    }
+
+    // Hot accounts: the tracked ranks with the most time spent in their transactions.
+    std::vector<std::size_t> rank_order;
+    for (std::size_t rank = 0; rank < std::min(TRACKED_RANKS, options.accounts); ++rank) {
+        if (total.hot[rank].transactions != 0) {
+            rank_order.push_back(rank);
+        }
+    }
+    std::sort(rank_order.begin(), rank_order.end(), [&](std::size_t a, std::size_t b) {
+        return total.hot[a].total_ns > total.hot[b].total_ns;
+    });
+    std::cout << "\nHot accounts (by total time in transactions):" << std::endl;
+    std::cout << std::setw(6) << "rank" << std::setw(22) << "account" << std::setw(10) << "share"
+              << std::setw(12) << "count" << std::setw(10) << "mean_us" << std::setw(10) << "max_us" << std::endl;
+    for (std::size_t i = 0; i < std::min<std::size_t>(10, rank_order.size()); ++i) {
+        std::size_t rank = rank_order[i];
+        const AccountTally& tally = total.hot[rank];
+        std::cout << std::setw(6) << rank << std::setw(22) << cards[rank_to_account[rank]].get_masked_card_number()
+                  << std::setw(9) << std::setprecision(2) << 100.0 * zipf.probability(rank) << "%"
+                  << std::setw(12) << tally.transactions << std::setw(10) << micros(tally.total_ns / tally.transactions)
+                  << std::setw(10) << micros(tally.max_ns) << std::endl;
+    }
+
+    if (!options.json_path.empty()) {
+        std::ofstream json(options.json_path.c_str(), std::ios::app);
+        json << std::fixed << std::setprecision(1) << "{\"tool\":\"atm_loadgen\",\"sessions\":" << options.sessions
+             << ",\"threads\":" << options.threads << ",\"accounts\":" << options.accounts
+             << ",\"zipf\":" << options.zipf << ",\"shards\":" << options.shards
+             << ",\"journaled\":" << (options.journal_dir.empty() ? "false" : "true")
+             << ",\"lock_free\":" << (options.lock_free ? "true" : "false")
+             << ",\"seconds\":" << seconds << ",\"tx_per_sec\":" << all.count() / seconds
+             << ",\"declined\":" << total.declined << ",\"errors\":" << total.errors
+             << ",\"pin_iterations\":" << options.pins.iterations
+             << ",\"pin_checks_per_sec\":" << pins.verifications_per_sec
+             << ",\"pin_queue_wait_p99_ns\":" << pins.queue_wait_p99_ns;
+        for (int type = 0; type < TX_TYPE_COUNT; ++type) {
+            const LatencyHistogram& histogram = total.latency[type];
+            json << ",\"" << TX_NAMES[type] << "\":{\"count\":" << histogram.count()
+                 << ",\"p50_ns\":" << histogram.percentile(0.50) << ",\"p99_ns\":" << histogram.percentile(0.99)
+                 << ",\"p999_ns\":" << histogram.percentile(0.999) << ",\"max_ns\":" << histogram.max() << "}";
+        }
+        json << "}\n";
+    }
+
+    Logger::instance().flush();
+    return total.errors == 0 ? 0 : 1;
+}
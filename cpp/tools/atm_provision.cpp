@@ -0,0 +1,545 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/BankSystem.h"
+#include "../include/CardValidation.h"
+#include "../include/Logger.h"
+#include "../include/PinHash.h"
+#include "SyntheticCards.h"
+
+// Bulk account provisioning: loads a nightly account file into a fresh
+// BankSystem with BankSystem::add_accounts.
+//
+// The input is either a CSV file of "card_number,pin,balance" lines, where
+// pin is 4 to 12 digits or a credential as written by encode_pin_credential,
+// or a binary file: the 8-byte magic "ATMPROV1", a little-endian 64-bit
+// record count, then fixed 72-byte records (see BinaryRecord). The file is
+// memory-mapped and cut into slices that are parsed on all threads; card
+// numbers are Luhn-checked in batches by validate_card_numbers, straight from
+// the mapping for binary files and from a packed copy for CSV. The slices
+// are then handed to add_accounts in file order, which hashes plain PINs,
+// presizes the shards, detects duplicates and builds the index in one pass.
+//
+// Plain PINs are hashed at --pin-iterations (the bank default unless given),
+// which dominates the load; production files should carry credentials.
+// --generate-csv and --generate-binary write synthetic files for drills.
+//
+// Usage: atm_provision (--csv FILE | --binary FILE) [--threads N] [--shards N]
+//                      [--pin-iterations N] [--strict]
+//        atm_provision (--generate-csv FILE | --generate-binary FILE)
+//                      [--accounts N] [--pin-iterations N] [--plain-pins]
+// --strict exits with status 1 if any record was malformed or rejected.
+
+namespace {
+
+const char BINARY_MAGIC[8] = {'A', 'T', 'M', 'P', 'R', 'O', 'V', '1'};
+const std::size_t BINARY_HEADER_SIZE = 16;
+const std::size_t VALIDATION_BATCH = 4096; // Card numbers Luhn-checked per call.
+const char* const GENERATED_PIN = "1234";
+
+// One account in a binary file; 72 bytes, all integers little-endian.
+struct BinaryRecord {
+    char card_number[16]; // ASCII digits, first so records can be Luhn-checked in place.
+    std::uint8_t balance[4];
+    std::uint8_t iterations[4];
+    std::uint8_t salt[PIN_SALT_SIZE];
+    std::uint8_t hash[SHA256_DIGEST_SIZE];
+};
+
+static_assert(sizeof(BinaryRecord) == 72, "Binary records must be packed.");
+
+// Accounts parsed from one slice of the input, in file order.
+struct Slice {
+    std::vector<BankSystem::NewAccount> accounts;
+    std::size_t malformed;     // Lines or records that could not be parsed.
+    std::size_t failed_checks; // Card numbers that failed the Luhn check.
+
+    Slice() : malformed(0), failed_checks(0) {}
+};
+
+struct Options {
+    std::string csv_path;
+    std::string binary_path;
+    std::string generate_csv;
+    std::string generate_binary;
+    std::size_t threads;
+    std::size_t shards;
+    std::uint32_t pin_iterations;
+    bool pin_iterations_set;
+    bool plain_pins;
+    bool strict;
+    std::size_t accounts;
+
+    Options()
+        : threads(std::max(1u, std::thread::hardware_concurrency())), shards(BankSystem::DEFAULT_SHARD_COUNT),
+          pin_iterations(PinHashConfig().iterations), pin_iterations_set(false), plain_pins(false), strict(false),
+          accounts(1000000) {}
+};
+
+// Read-only view of a whole file, memory-mapped when the file system allows
+// it and read into memory otherwise.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) : data(nullptr), length(0), mapped(false) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Unable to open " + path);
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Unable to stat " + path);
+        }
+        length = static_cast<std::size_t>(info.st_size);
+        if (length > 0) {
+            void* address = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                ::madvise(address, length, MADV_SEQUENTIAL);
+                data = static_cast<const char*>(address);
+                mapped = true;
+            } else {
+                copy.resize(length);
+                std::size_t done = 0;
+                while (done < length) {
+                    ssize_t got = ::read(fd, &copy[done], length - done);
+                    if (got <= 0) {
+                        ::close(fd);
+                        throw std::runtime_error("Unable to read " + path);
+                    }
+                    done += static_cast<std::size_t>(got);
+                }
+                data = copy.data();
+            }
+        }
+        ::close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (mapped) {
+            ::munmap(const_cast<char*>(data), length);
+        }
+    }
+
+    const char* begin() const { return data; }
+    const char* end() const { return data + length; }
+    std::size_t size() const { return length; }
+
+private:
+    const char* data;
+    std::size_t length;
+    bool mapped;
+    std::vector<char> copy;
+};
+
+std::uint64_t now_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Runs task(0) to task(count - 1) on up to threads threads, handing out indices in order.
+template <typename Task>
+void run_parallel(std::size_t count, std::size_t threads, Task task) {
+    std::atomic<std::size_t> next(0);
+    std::vector<std::thread> pool;
+    for (std::size_t t = 0; t < std::min(threads, count); ++t) {
+        pool.emplace_back([&]() {
+            for (std::size_t i = next++; i < count; i = next++) {
+                task(i);
+            }
+        });
+    }
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+}
+
+std::uint32_t load_le32(const std::uint8_t* bytes) {
+    return static_cast<std::uint32_t>(bytes[0]) | static_cast<std::uint32_t>(bytes[1]) << 8 |
+           static_cast<std::uint32_t>(bytes[2]) << 16 | static_cast<std::uint32_t>(bytes[3]) << 24;
+}
+
+void store_le32(std::uint8_t* bytes, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        bytes[i] = static_cast<std::uint8_t>(value >> (8 * i));
+    }
+}
+
+// Packs 16 ASCII digits known to be valid into a card key.
+std::uint64_t pack_digits(const char* digits) {
+    std::uint64_t key = 0;
+    for (int i = 0; i < 16; ++i) {
+        key = key * 10 + static_cast<std::uint64_t>(digits[i] - '0');
+    }
+    return key;
+}
+
+// Parses one CSV line (without its newline) into an account, except the card
+// number, which the caller validates and packs in a batch.
+bool parse_csv_line(const char* p, const char* end, BankSystem::NewAccount& account) {
+    if (end - p < 17 || p[16] != ',') {
+        return false;
+    }
+    p += 17;
+    const char* comma = static_cast<const char*>(std::memchr(p, ',', static_cast<std::size_t>(end - p)));
+    if (comma == nullptr) {
+        return false;
+    }
+    std::string pin(p, comma);
+    if (pack_pin(pin, account.packed_pin)) {
+        account.credential = empty_pin_credential(); // Hashed by the bank.
+    } else if (decode_pin_credential(pin, account.credential)) {
+        account.packed_pin = 0;
+    } else {
+        return false;
+    }
+    p = comma + 1;
+    long long balance = 0;
+    const char* digits = p;
+    while (p < end && *p >= '0' && *p <= '9' && p - digits < 10) {
+        balance = balance * 10 + (*p++ - '0');
+    }
+    if (p == digits || p != end || balance > INT32_MAX) {
+        return false;
+    }
+    account.balance = static_cast<int>(balance);
+    return true;
+}
+
+// Luhn-checks the card numbers gathered in cards (16 bytes each) and keeps
+// the matching pending accounts, with their keys, in slice order.
+void flush_batch(std::vector<char>& cards, std::vector<BankSystem::NewAccount>& pending, Slice& slice) {
+    std::vector<std::uint64_t> bitmap((pending.size() + 63) / 64);
+    validate_card_numbers(cards.data(), pending.size(), 16, bitmap.data());
+    for (std::size_t i = 0; i < pending.size(); ++i) {
+        if (card_bit(bitmap, i)) {
+            pending[i].key = pack_digits(&cards[i * 16]);
+            slice.accounts.push_back(pending[i]);
+        } else {
+            ++slice.failed_checks;
+        }
+    }
+    cards.clear();
+    pending.clear();
+}
+
+// Parses the CSV lines in [begin, end). Blank lines, '#' comments and header lines (starting with a letter) are skipped.
+void parse_csv(const char* begin, const char* end, Slice& slice) {
+    std::vector<char> cards;
+    std::vector<BankSystem::NewAccount> pending;
+    cards.reserve(VALIDATION_BATCH * 16);
+    pending.reserve(VALIDATION_BATCH);
+    const char* line = begin;
+    while (line < end) {
+        const char* newline = static_cast<const char*>(std::memchr(line, '\n', static_cast<std::size_t>(end - line)));
+        const char* line_end = newline == nullptr ? end : newline;
+        const char* content_end = line_end > line && line_end[-1] == '\r' ? line_end - 1 : line_end;
+        if (content_end > line && *line != '#' && !std::isalpha(static_cast<unsigned char>(*line))) {
+            BankSystem::NewAccount account;
+            if (parse_csv_line(line, content_end, account)) {
+                cards.insert(cards.end(), line, line + 16);
+                pending.push_back(account);
+                if (pending.size() == VALIDATION_BATCH) {
+                    flush_batch(cards, pending, slice);
+                }
+            } else {
+                ++slice.malformed;
+            }
+        }
+        line = line_end + 1;
+    }
+    flush_batch(cards, pending, slice);
+}
+
+// Parses binary records [first, last), Luhn-checking their card numbers in place.
+void parse_binary(const BinaryRecord* records, std::size_t first, std::size_t last, Slice& slice) {
+    std::vector<std::uint64_t> bitmap((VALIDATION_BATCH + 63) / 64);
+    slice.accounts.reserve(last - first);
+    for (std::size_t batch = first; batch < last; batch += VALIDATION_BATCH) {
+        std::size_t count = std::min(VALIDATION_BATCH, last - batch);
+        validate_card_numbers(records[batch].card_number, count, sizeof(BinaryRecord), bitmap.data());
+        for (std::size_t i = 0; i < count; ++i) {
+            const BinaryRecord& record = records[batch + i];
+            if (!card_bit(bitmap, i)) {
+                ++slice.failed_checks;
+                continue;
+            }
+            std::uint32_t balance = load_le32(record.balance);
+            std::uint32_t iterations = load_le32(record.iterations);
+            if (balance > INT32_MAX || iterations == 0) {
+                ++slice.malformed;
+                continue;
+            }
+            BankSystem::NewAccount account;
+            account.key = pack_digits(record.card_number);
+            account.packed_pin = 0;
+            account.credential.iterations = iterations;
+            std::memcpy(account.credential.salt, record.salt, PIN_SALT_SIZE);
+            std::memcpy(account.credential.hash, record.hash, SHA256_DIGEST_SIZE);
+            account.balance = static_cast<int>(balance);
+            slice.accounts.push_back(account);
+        }
+    }
+}
+
+// Splits a CSV file into slices that end at line boundaries.
+std::vector<std::pair<const char*, const char*>> split_lines(const MappedFile& file, std::size_t slices) {
+    std::vector<std::pair<const char*, const char*>> result;
+    const std::size_t target = std::max<std::size_t>(1 << 20, file.size() / slices + 1);
+    const char* start = file.begin();
+    while (start < file.end()) {
+        const char* cut = start + std::min<std::size_t>(target, static_cast<std::size_t>(file.end() - start));
+        if (cut < file.end()) {
+            const char* newline = static_cast<const char*>(
+                std::memchr(cut, '\n', static_cast<std::size_t>(file.end() - cut)));
+            cut = newline == nullptr ? file.end() : newline + 1;
+        }
+        result.push_back(std::make_pair(start, cut));
+        start = cut;
+    }
+    return result;
+}
+
+// Returns the generated credential of account index: a per-account salt and
+// the hash of GENERATED_PIN at the given cost.
+PinCredential generated_credential(std::uint64_t index, std::uint32_t iterations) {
+    PinCredential credential;
+    credential.iterations = iterations;
+    for (std::size_t i = 0; i < PIN_SALT_SIZE; ++i) {
+        credential.salt[i] = static_cast<std::uint8_t>(FlatAccountTable::hash(index * PIN_SALT_SIZE + i));
+    }
+    pbkdf2_hmac_sha256(GENERATED_PIN, std::strlen(GENERATED_PIN), credential.salt, PIN_SALT_SIZE, iterations,
+                       credential.hash, SHA256_DIGEST_SIZE);
+    return credential;
+}
+
+// Writes a synthetic account file; chunks are formatted in parallel and written in order.
+void generate(const Options& options) {
+    const bool binary = !options.generate_binary.empty();
+    const std::string& path = binary ? options.generate_binary : options.generate_csv;
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Unable to create " + path);
+    }
+    if (binary) {
+        std::uint8_t header[BINARY_HEADER_SIZE];
+        std::memcpy(header, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+        store_le32(header + 8, static_cast<std::uint32_t>(options.accounts));
+        store_le32(header + 12, static_cast<std::uint32_t>(static_cast<std::uint64_t>(options.accounts) >> 32));
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    } else {
+        out << "card_number,pin,balance\n";
+    }
+
+    const std::size_t chunk = 65536;
+    const std::size_t chunks = (options.accounts + chunk - 1) / chunk;
+    for (std::size_t round = 0; round < chunks; round += options.threads) {
+        std::size_t count = std::min(options.threads, chunks - round);
+        std::vector<std::string> texts(count);
+        run_parallel(count, options.threads, [&](std::size_t task) {
+            std::string& text = texts[task];
+            std::size_t first = (round + task) * chunk;
+            std::size_t last = std::min(options.accounts, first + chunk);
+            for (std::size_t i = first; i < last; ++i) {
+                std::string number = make_card_number(i);
+                int balance = static_cast<int>(i % 100000);
+                if (binary) {
+                    BinaryRecord record;
+                    PinCredential credential = generated_credential(i, options.pin_iterations);
+                    std::memcpy(record.card_number, number.data(), 16);
+                    store_le32(record.balance, static_cast<std::uint32_t>(balance));
+                    store_le32(record.iterations, credential.iterations);
+                    std::memcpy(record.salt, credential.salt, PIN_SALT_SIZE);
+                    std::memcpy(record.hash, credential.hash, SHA256_DIGEST_SIZE);
+                    text.append(reinterpret_cast<const char*>(&record), sizeof(record));
+                } else {
+                    text += number;
+                    text += ',';
+                    text += options.plain_pins ? std::string(GENERATED_PIN)
+                                               : encode_pin_credential(generated_credential(i, options.pin_iterations));
+                    text += ',';
+                    text += std::to_string(balance);
+                    text += '\n';
+                }
+            }
+        });
+        for (const std::string& text : texts) {
+            out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        }
+    }
+    if (!out.flush()) {
+        throw std::runtime_error("Unable to write " + path);
+    }
+}
+
+Options parse_options(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--plain-pins") {
+            options.plain_pins = true;
+            continue;
+        }
+        if (arg == "--strict") {
+            options.strict = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for " + arg);
+        }
+        std::string value = argv[++i];
+        if (arg == "--csv") {
+            options.csv_path = value;
+        } else if (arg == "--binary") {
+            options.binary_path = value;
+        } else if (arg == "--generate-csv") {
+            options.generate_csv = value;
+        } else if (arg == "--generate-binary") {
+            options.generate_binary = value;
+        } else if (arg == "--threads") {
+            options.threads = std::stoul(value);
+        } else if (arg == "--shards") {
+            options.shards = std::stoul(value);
+        } else if (arg == "--pin-iterations") {
+            options.pin_iterations = static_cast<std::uint32_t>(std::stoul(value));
+            options.pin_iterations_set = true;
+        } else if (arg == "--accounts") {
+            options.accounts = std::stoul(value);
+        } else {
+            throw std::invalid_argument("Unknown option: " + arg);
+        }
+    }
+    int inputs = !options.csv_path.empty() + !options.binary_path.empty() + !options.generate_csv.empty() +
+                 !options.generate_binary.empty();
+    if (inputs != 1) {
+        throw std::invalid_argument("Give exactly one of --csv, --binary, --generate-csv and --generate-binary.");
+    }
+    if (options.threads == 0 || options.shards == 0 || options.accounts == 0 || options.pin_iterations == 0) {
+        throw std::invalid_argument("Threads, shards, accounts and PIN iterations must be positive.");
+    }
+    if (!options.generate_binary.empty() && options.plain_pins) {
+        throw std::invalid_argument("Binary files carry credentials; --plain-pins applies to CSV only.");
+    }
+    if (!options.generate_csv.empty() || !options.generate_binary.empty()) {
+        if (!options.pin_iterations_set) {
+            options.pin_iterations = 1; // Keeps generation fast; real files use the bank's cost.
+        }
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "atm_provision: " << e.what() << std::endl;
+        return 2;
+    }
+    Logger::set_level(LogLevel::Error);
+
+    try {
+        if (!options.generate_csv.empty() || !options.generate_binary.empty()) {
+            std::uint64_t start = now_ns();
+            generate(options);
+            std::cout << "Generated " << options.accounts << " accounts with PIN " << GENERATED_PIN << " in "
+                      << std::fixed << std::setprecision(3) << (now_ns() - start) / 1e9 << " s" << std::endl;
+            return 0;
+        }
+
+        std::uint64_t start = now_ns();
+        const bool binary = !options.binary_path.empty();
+        MappedFile file(binary ? options.binary_path : options.csv_path);
+        std::vector<Slice> slices;
+        if (binary) {
+            if (file.size() < BINARY_HEADER_SIZE || std::memcmp(file.begin(), BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) {
+                throw std::runtime_error("Not a provisioning file: " + options.binary_path);
+            }
+            const std::uint8_t* header = reinterpret_cast<const std::uint8_t*>(file.begin());
+            std::uint64_t declared = load_le32(header + 8) | static_cast<std::uint64_t>(load_le32(header + 12)) << 32;
+            std::size_t present = (file.size() - BINARY_HEADER_SIZE) / sizeof(BinaryRecord);
+            if (declared != present || (file.size() - BINARY_HEADER_SIZE) % sizeof(BinaryRecord) != 0) {
+                throw std::runtime_error("Truncated provisioning file: header declares " + std::to_string(declared) +
+                                         " records, file holds " + std::to_string(present));
+            }
+            // Records hold only bytes, so they can be read in place at any alignment.
+            const BinaryRecord* records = reinterpret_cast<const BinaryRecord*>(file.begin() + BINARY_HEADER_SIZE);
+            const std::size_t per_slice = std::max<std::size_t>(65536, present / (options.threads * 8) + 1);
+            slices.resize((present + per_slice - 1) / per_slice);
+            run_parallel(slices.size(), options.threads, [&](std::size_t task) {
+                parse_binary(records, task * per_slice, std::min(present, (task + 1) * per_slice), slices[task]);
+            });
+        } else {
+            std::vector<std::pair<const char*, const char*>> ranges = split_lines(file, options.threads * 8);
+            slices.resize(ranges.size());
+            run_parallel(ranges.size(), options.threads, [&](std::size_t task) {
+                parse_csv(ranges[task].first, ranges[task].second, slices[task]);
+            });
+        }
+
+        // Concatenate in file order so the first record for a card wins.
+        std::size_t total = 0;
+        std::size_t malformed = 0;
+        std::size_t failed_checks = 0;
+        for (const Slice& slice : slices) {
+            total += slice.accounts.size();
+            malformed += slice.malformed;
+            failed_checks += slice.failed_checks;
+        }
+        std::vector<BankSystem::NewAccount> accounts;
+        accounts.reserve(total);
+        for (Slice& slice : slices) {
+            accounts.insert(accounts.end(), slice.accounts.begin(), slice.accounts.end());
+            std::vector<BankSystem::NewAccount>().swap(slice.accounts);
+        }
+        std::uint64_t parsed = now_ns();
+
+        PinHashConfig pins;
+        pins.iterations = options.pin_iterations;
+        BankSystem bank(options.shards, pins);
+        BankSystem::BulkLoadResult result = bank.add_accounts(accounts, options.threads);
+        std::uint64_t loaded = now_ns();
+
+        double parse_s = (parsed - start) / 1e9;
+        double load_s = (loaded - parsed) / 1e9;
+        double total_s = (loaded - start) / 1e9;
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "Provisioned " << result.added << " accounts from " << file.size() / (1024.0 * 1024.0)
+                  << " MiB on " << options.threads << " threads, " << options.shards << " shards" << std::endl;
+        std::cout << "Parse:  " << parse_s << " s, " << std::setprecision(0) << total / parse_s << " records/s, "
+                  << std::setprecision(1) << file.size() / (1024.0 * 1024.0) / parse_s << " MiB/s" << std::endl;
+        std::cout << "Load:   " << std::setprecision(3) << load_s << " s, " << std::setprecision(0)
+                  << total / load_s << " records/s" << std::endl;
+        std::cout << "Total:  " << std::setprecision(3) << total_s << " s, " << std::setprecision(0)
+                  << result.added / total_s << " accounts/s" << std::endl;
+        std::cout << "Duplicates " << result.duplicates << ", invalid " << result.invalid << ", failed Luhn "
+                  << failed_checks << ", malformed " << malformed << std::endl;
+
+        bool clean = result.rejected.empty() && failed_checks == 0 && malformed == 0;
+        return options.strict && !clean ? 1 : 0;
+    } catch (const std::exception& e) {
+        std::cerr << "atm_provision: " << e.what() << std::endl;
+        return 1;
+    }
+}
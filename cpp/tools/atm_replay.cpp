@@ -0,0 +1,673 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/BankSystem.h"
+#include "../include/CardValidation.h"
+#include "../include/Journal.h"
+#include "../include/Logger.h"
+#include "../include/PinHash.h"
+#include "SyntheticCards.h"
+
+// Transaction log replay: streams a recorded day of account openings,
+// deposits and withdrawals through a fresh BankSystem as fast as the cores
+// allow, for recovery drills and load tests.
+//
+// The input is either a journal directory written by BankSystem (its latest
+// snapshot plus the segments after it) or a CSV file of
+// "account_id,type,amount[,balance]" lines with type open, deposit or
+// withdraw (for open, amount is the opening balance). Files are memory-mapped
+// and parsed in parallel, one journal segment or CSV slice per task, and each
+// record is routed to a partition by account. Every partition then replays
+// on its own thread, so independent accounts run in parallel while each
+// account sees its records in log order. Records that carry the resulting
+// balance are checked against it. CSV lines whose card number fails the
+// Luhn check or that open an account with a negative balance count as
+// malformed. Linked accounts (IDs that are not card numbers) are skipped:
+// their records, and the linked half of a transfer, are counted but not
+// replayed, since opening one needs its card's account from another
+// partition.
+//
+// At the end the final balances are folded into an order-independent
+// checksum, which must equal --expect-checksum if given. --generate-csv and
+// --generate-journal write a synthetic log and print its checksum.
+//
+// Usage: atm_replay (--journal DIR | --csv FILE) [--threads N] [--shards N]
+//                   [--lock-free] [--expect-checksum HEX]
+//        atm_replay (--generate-csv FILE | --generate-journal DIR)
+//                   [--accounts N] [--records N] [--seed N]
+// Replayed accounts get the PIN 0000; PINs do not take part in replay.
+
+namespace {
+
+const char* const REPLAY_PIN = "0000";
+const int INITIAL_BALANCE = 1000;
+
+enum class ReplayOp : std::uint8_t { Open, Deposit, Withdraw };
+
+// One parsed record; 24 bytes.
+struct ReplayRecord {
+    std::uint64_t key;     // Packed card number.
+    std::int32_t amount;   // Opening balance for ReplayOp::Open.
+    std::int32_t balance;  // Expected balance afterwards, if has_balance.
+    ReplayOp op;
+    bool has_balance;
+};
+
+// Records parsed from one slice of the input, split by partition in log order.
+struct Batch {
+    std::vector<std::vector<ReplayRecord>> parts;
+    std::size_t bytes;
+    std::size_t malformed; // Lines or records that could not be parsed.
+    std::size_t skipped;   // Records of linked accounts, which are not replayed.
+
+    Batch() : bytes(0), malformed(0), skipped(0) {}
+};
+
+// Outcome of replaying one partition.
+struct PartitionResult {
+    std::uint64_t applied;
+    std::uint64_t rejected;   // Withdrawals the balance did not cover, invalid amounts or refused opens.
+    std::uint64_t mismatched; // Resulting balance differed from the one recorded.
+    std::uint64_t unknown;    // Records for accounts never opened.
+    std::uint64_t duplicate_opens;
+    std::uint64_t accounts;
+    std::uint64_t checksum;
+
+    PartitionResult()
+        : applied(0), rejected(0), mismatched(0), unknown(0), duplicate_opens(0), accounts(0), checksum(0) {}
+};
+
+struct Options {
+    std::string journal_dir;
+    std::string csv_path;
+    std::string generate_csv;
+    std::string generate_journal;
+    std::size_t threads;
+    std::size_t shards;
+    bool lock_free;
+    bool check;
+    std::uint64_t expected_checksum;
+    std::size_t accounts;
+    std::size_t records;
+    unsigned seed;
+
+    Options()
+        : threads(std::max(1u, std::thread::hardware_concurrency())), shards(BankSystem::DEFAULT_SHARD_COUNT),
+          lock_free(false), check(false), expected_checksum(0), accounts(100000), records(10000000), seed(42) {}
+};
+
+// Read-only view of a whole file, memory-mapped when the file system allows
+// it and read into memory otherwise.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) : data(nullptr), length(0), mapped(false) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Unable to open " + path);
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Unable to stat " + path);
+        }
+        length = static_cast<std::size_t>(info.st_size);
+        if (length > 0) {
+            void* address = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                ::madvise(address, length, MADV_SEQUENTIAL);
+                data = static_cast<const char*>(address);
+                mapped = true;
+            } else {
+                copy.resize(length);
+                std::size_t done = 0;
+                while (done < length) {
+                    ssize_t got = ::read(fd, &copy[done], length - done);
+                    if (got <= 0) {
+                        ::close(fd);
+                        throw std::runtime_error("Unable to read " + path);
+                    }
+                    done += static_cast<std::size_t>(got);
+                }
+                data = copy.data();
+            }
+        }
+        ::close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (mapped) {
+            ::munmap(const_cast<char*>(data), length);
+        }
+    }
+
+    const char* begin() const { return data; }
+    const char* end() const { return data + length; }
+    std::size_t size() const { return length; }
+
+private:
+    const char* data;
+    std::size_t length;
+    bool mapped;
+    std::vector<char> copy;
+};
+
+std::uint64_t now_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Returns one account's share of the checksum; shares are summed, so the
+// checksum does not depend on the order accounts are visited in.
+std::uint64_t checksum_term(std::uint64_t key, std::int32_t balance) {
+    return FlatAccountTable::hash(key ^ FlatAccountTable::hash(static_cast<std::uint32_t>(balance) + 1));
+}
+
+// Returns the partition that replays an account.
+std::size_t partition_of(std::uint64_t key, std::size_t partitions) {
+    return static_cast<std::size_t>(FlatAccountTable::hash(key) % partitions);
+}
+
+// Runs task(0) to task(count - 1) on up to threads threads, handing out indices in order.
+template <typename Task>
+void run_parallel(std::size_t count, std::size_t threads, Task task) {
+    std::atomic<std::size_t> next(0);
+    std::vector<std::thread> pool;
+    for (std::size_t t = 0; t < std::min(threads, count); ++t) {
+        pool.emplace_back([&]() {
+            for (std::size_t i = next++; i < count; i = next++) {
+                task(i);
+            }
+        });
+    }
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+}
+
+// Parses a signed decimal field ending at a comma or the end of the line.
+bool parse_number(const char*& p, const char* end, long long& value) {
+    bool negative = p < end && *p == '-';
+    if (negative) {
+        ++p;
+    }
+    const char* start = p;
+    value = 0;
+    while (p < end && *p >= '0' && *p <= '9' && p - start < 12) {
+        value = value * 10 + (*p++ - '0');
+    }
+    if (p == start || (p < end && *p != ',')) {
+        return false;
+    }
+    if (negative) {
+        value = -value;
+    }
+    return true;
+}
+
+// Parses one CSV line (without its newline) into a record.
+bool parse_csv_line(const char* p, const char* end, ReplayRecord& record) {
+    if (end - p < 17 || p[16] != ',') {
+        return false;
+    }
+    if (!is_valid_pan16(p) || !pack_card_number(std::string(p, 16), record.key)) {
+        return false;
+    }
+    p += 17;
+    const char* comma = static_cast<const char*>(std::memchr(p, ',', static_cast<std::size_t>(end - p)));
+    if (comma == nullptr) {
+        return false;
+    }
+    std::size_t type_length = static_cast<std::size_t>(comma - p);
+    if (type_length == 4 && std::memcmp(p, "open", 4) == 0) {
+        record.op = ReplayOp::Open;
+    } else if (type_length == 7 && std::memcmp(p, "deposit", 7) == 0) {
+        record.op = ReplayOp::Deposit;
+    } else if (type_length == 8 && std::memcmp(p, "withdraw", 8) == 0) {
+        record.op = ReplayOp::Withdraw;
+    } else {
+        return false;
+    }
+    p = comma + 1;
+    long long amount = 0;
+    if (!parse_number(p, end, amount) || amount < INT32_MIN || amount > INT32_MAX) {
+        return false;
+    }
+    if (record.op == ReplayOp::Open && amount < 0) {
+        return false;
+    }
+    record.amount = static_cast<std::int32_t>(amount);
+    record.has_balance = false;
+    record.balance = 0;
+    if (p < end) {
+        long long balance = 0;
+        ++p;
+        if (!parse_number(p, end, balance) || p != end || balance < INT32_MIN || balance > INT32_MAX) {
+            return false;
+        }
+        record.balance = static_cast<std::int32_t>(balance);
+        record.has_balance = true;
+    }
+    return true;
+}
+
+// Parses the CSV lines in [begin, end). Blank lines, '#' comments and header lines (starting with a letter) are skipped.
+void parse_csv(const char* begin, const char* end, Batch& batch) {
+    const std::size_t partitions = batch.parts.size();
+    batch.bytes = static_cast<std::size_t>(end - begin);
+    const char* line = begin;
+    while (line < end) {
+        const char* newline = static_cast<const char*>(std::memchr(line, '\n', static_cast<std::size_t>(end - line)));
+        const char* line_end = newline == nullptr ? end : newline;
+        const char* content_end = line_end > line && line_end[-1] == '\r' ? line_end - 1 : line_end;
+        if (content_end > line && *line != '#' && !std::isalpha(static_cast<unsigned char>(*line))) {
+            ReplayRecord record;
+            if (parse_csv_line(line, content_end, record)) {
+                batch.parts[partition_of(record.key, partitions)].push_back(record);
+            } else {
+                ++batch.malformed;
+            }
+        }
+        line = line_end + 1;
+    }
+}
+
+// Splits a CSV file into slices that end at line boundaries.
+std::vector<std::pair<const char*, const char*>> split_lines(const MappedFile& file, std::size_t slices) {
+    std::vector<std::pair<const char*, const char*>> result;
+    const std::size_t target = std::max<std::size_t>(1 << 20, file.size() / slices + 1);
+    const char* start = file.begin();
+    while (start < file.end()) {
+        const char* cut = start + std::min<std::size_t>(target, static_cast<std::size_t>(file.end() - start));
+        if (cut < file.end()) {
+            const char* newline = static_cast<const char*>(
+                std::memchr(cut, '\n', static_cast<std::size_t>(file.end() - cut)));
+            cut = newline == nullptr ? file.end() : newline + 1;
+        }
+        result.push_back(std::make_pair(start, cut));
+        start = cut;
+    }
+    return result;
+}
+
+// What replay does with a decoded journal record.
+enum class JournalUse { Replay, Skip, Malformed };
+
+// Converts a decoded journal record. Each half of a transfer, and each batch
+// posting, is applied as a withdrawal or a deposit. Records of linked
+// accounts, whose IDs are not card numbers, are skipped.
+JournalUse from_journal(const JournalEntry& entry, ReplayRecord& record) {
+    if (entry.type == JournalRecordType::AccountLinked || !pack_card_number(entry.account_id, record.key)) {
+        return JournalUse::Skip;
+    }
+    record.has_balance = true;
+    record.balance = entry.balance;
+    switch (entry.type) {
+    case JournalRecordType::AccountOpened:
+        record.op = ReplayOp::Open;
+        record.amount = entry.balance;
+        return JournalUse::Replay;
+    case JournalRecordType::Deposit:
+        record.op = ReplayOp::Deposit;
+        record.amount = entry.amount;
+        return JournalUse::Replay;
+    case JournalRecordType::Withdrawal:
+    case JournalRecordType::TransferOut:
+        record.op = ReplayOp::Withdraw;
+        record.amount = entry.amount;
+        return JournalUse::Replay;
+    case JournalRecordType::TransferIn:
+        record.op = ReplayOp::Deposit;
+        record.amount = entry.amount;
+        return JournalUse::Replay;
+    case JournalRecordType::Posting:
+        record.op = entry.amount < 0 ? ReplayOp::Withdraw : ReplayOp::Deposit;
+        record.amount = entry.amount < 0 ? -entry.amount : entry.amount;
+        return JournalUse::Replay;
+    case JournalRecordType::AccountLinked:
+        break;
+    }
+    return JournalUse::Malformed;
+}
+
+// Parses the records of one journal segment with an LSN above after_lsn.
+// Like recovery, stops at the first torn or corrupt record.
+void parse_segment(const MappedFile& segment, std::uint64_t after_lsn, Batch& batch) {
+    const std::size_t partitions = batch.parts.size();
+    batch.bytes = segment.size();
+    JournalEntry entry; // Reused so its strings keep their capacity.
+    std::size_t offset = 0;
+    while (offset < segment.size()) {
+        std::size_t size = Journal::decode(segment.begin() + offset, segment.size() - offset, entry);
+        if (size == 0) {
+            ++batch.malformed;
+            break;
+        }
+        offset += size;
+        if (entry.lsn <= after_lsn) {
+            continue;
+        }
+        ReplayRecord record;
+        switch (from_journal(entry, record)) {
+        case JournalUse::Replay:
+            batch.parts[partition_of(record.key, partitions)].push_back(record);
+            break;
+        case JournalUse::Skip:
+            ++batch.skipped;
+            break;
+        case JournalUse::Malformed:
+            ++batch.malformed;
+            break;
+        }
+    }
+}
+
+// Applies one partition's records from every batch, in batch order, then
+// sums the checksum of the accounts it owns. A record the bank refuses, e.g.
+// an opening it rejects, is counted as rejected rather than ending the run.
+void replay_partition(BankSystem& bank, const std::vector<Batch>& batches, std::size_t partition,
+                      PartitionResult& result) {
+    std::unordered_map<std::uint64_t, Account*> accounts;
+    for (const Batch& batch : batches) {
+        for (const ReplayRecord& record : batch.parts[partition]) {
+            if (record.op == ReplayOp::Open) {
+                if (accounts.count(record.key) != 0) {
+                    ++result.duplicate_opens;
+                    continue;
+                }
+                try {
+                    std::string account_id = unpack_card_number(record.key);
+                    bank.add_account(account_id, REPLAY_PIN, record.amount);
+                    accounts[record.key] = &bank.get_account(Card(account_id));
+                    ++result.applied;
+                } catch (const std::exception&) {
+                    ++result.rejected;
+                }
+                continue;
+            }
+            std::unordered_map<std::uint64_t, Account*>::const_iterator found = accounts.find(record.key);
+            if (found == accounts.end()) {
+                ++result.unknown;
+                continue;
+            }
+            Result<int> balance = record.op == ReplayOp::Deposit ? found->second->try_deposit(record.amount)
+                                                                 : found->second->try_withdraw(record.amount);
+            if (!balance) {
+                ++result.rejected;
+            } else {
+                ++result.applied;
+                if (record.has_balance && balance.value() != record.balance) {
+                    ++result.mismatched;
+                }
+            }
+        }
+    }
+    for (const std::pair<const std::uint64_t, Account*>& account : accounts) {
+        result.checksum += checksum_term(account.first, account.second->get_balance());
+    }
+    result.accounts = accounts.size();
+}
+
+// Writes a synthetic log: every account opens with INITIAL_BALANCE, then
+// random deposits and covered withdrawals. Returns its checksum.
+std::uint64_t generate(const Options& options) {
+    std::vector<std::string> ids(options.accounts);
+    std::vector<std::uint64_t> keys(options.accounts);
+    std::vector<std::int32_t> balances(options.accounts, INITIAL_BALANCE);
+    for (std::size_t i = 0; i < options.accounts; ++i) {
+        ids[i] = make_card_number(i);
+        pack_card_number(ids[i], keys[i]);
+    }
+
+    std::unique_ptr<std::ofstream> csv;
+    std::unique_ptr<Journal> journal;
+    std::string credential;
+    if (!options.generate_csv.empty()) {
+        csv.reset(new std::ofstream(options.generate_csv, std::ios::binary | std::ios::trunc));
+        if (!*csv) {
+            throw std::runtime_error("Unable to create " + options.generate_csv);
+        }
+    } else {
+        JournalConfig config(options.generate_journal);
+        config.sync = false;
+        journal.reset(new Journal(config, 0));
+        credential = encode_pin_credential(hash_pin(REPLAY_PIN, 1));
+    }
+
+    std::string line;
+    for (std::size_t i = 0; i < options.accounts; ++i) {
+        if (csv) {
+            line = ids[i] + ",open," + std::to_string(INITIAL_BALANCE) + "\n";
+            csv->write(line.data(), static_cast<std::streamsize>(line.size()));
+        } else {
+            journal->append(JournalRecordType::AccountOpened, ids[i], INITIAL_BALANCE, INITIAL_BALANCE, credential);
+        }
+    }
+    std::mt19937_64 rng(options.seed);
+    for (std::size_t r = 0; r < options.records; ++r) {
+        std::size_t account = static_cast<std::size_t>(rng() % options.accounts);
+        std::int32_t amount = static_cast<std::int32_t>(rng() % 200 + 1);
+        bool deposit = (rng() & 1) != 0 || balances[account] < amount;
+        balances[account] += deposit ? amount : -amount;
+        if (csv) {
+            line = ids[account] + (deposit ? ",deposit," : ",withdraw,") + std::to_string(amount) + "," +
+                   std::to_string(balances[account]) + "\n";
+            csv->write(line.data(), static_cast<std::streamsize>(line.size()));
+        } else {
+            journal->append(deposit ? JournalRecordType::Deposit : JournalRecordType::Withdrawal, ids[account],
+                            amount, balances[account]);
+        }
+    }
+    if (journal) {
+        journal->wait_durable(journal->last_lsn());
+    }
+
+    std::uint64_t checksum = 0;
+    for (std::size_t i = 0; i < options.accounts; ++i) {
+        checksum += checksum_term(keys[i], balances[i]);
+    }
+    return checksum;
+}
+
+Options parse_options(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--lock-free") {
+            options.lock_free = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for " + arg);
+        }
+        std::string value = argv[++i];
+        if (arg == "--journal") {
+            options.journal_dir = value;
+        } else if (arg == "--csv") {
+            options.csv_path = value;
+        } else if (arg == "--generate-csv") {
+            options.generate_csv = value;
+        } else if (arg == "--generate-journal") {
+            options.generate_journal = value;
+        } else if (arg == "--threads") {
+            options.threads = std::stoul(value);
+        } else if (arg == "--shards") {
+            options.shards = std::stoul(value);
+        } else if (arg == "--expect-checksum") {
+            options.expected_checksum = std::stoull(value, nullptr, 16);
+            options.check = true;
+        } else if (arg == "--accounts") {
+            options.accounts = std::stoul(value);
+        } else if (arg == "--records") {
+            options.records = std::stoul(value);
+        } else if (arg == "--seed") {
+            options.seed = static_cast<unsigned>(std::stoul(value));
+        } else {
+            throw std::invalid_argument("Unknown option: " + arg);
+        }
+    }
+    int inputs = !options.journal_dir.empty() + !options.csv_path.empty() + !options.generate_csv.empty() +
+                 !options.generate_journal.empty();
+    if (inputs != 1) {
+        throw std::invalid_argument("Give exactly one of --journal, --csv, --generate-csv and --generate-journal.");
+    }
+    if (options.threads == 0 || options.shards == 0 || options.accounts == 0) {
+        throw std::invalid_argument("Threads, shards and accounts must be positive.");
+    }
+    return options;
+}
+
+std::string hex(std::uint64_t value) {
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "atm_replay: " << e.what() << std::endl;
+        return 2;
+    }
+    Logger::set_level(LogLevel::Error); // Every replayed deposit and withdrawal would log at Info level.
+
+    try {
+        if (!options.generate_csv.empty() || !options.generate_journal.empty()) {
+            std::uint64_t checksum = generate(options);
+            std::cout << "Generated " << options.accounts << " accounts and " << options.records
+                      << " transactions; checksum " << hex(checksum) << std::endl;
+            return 0;
+        }
+
+        const std::size_t partitions = options.threads;
+        std::uint64_t start = now_ns();
+
+        // Parse: the snapshot first, then the journal segments or CSV slices, each into its own batch.
+        std::vector<std::unique_ptr<MappedFile>> files;
+        std::vector<std::pair<const char*, const char*>> slices;
+        std::vector<Batch> batches;
+        std::uint64_t after_lsn = 0;
+        if (!options.journal_dir.empty()) {
+            batches.emplace_back();
+            batches.back().parts.resize(partitions);
+            Batch& snapshot = batches.back();
+            after_lsn = load_latest_snapshot(options.journal_dir, [&](const std::string& account_id,
+                                                                      const std::string&, std::int32_t balance) {
+                ReplayRecord record = {0, balance, balance, ReplayOp::Open, true};
+                if (pack_card_number(account_id, record.key)) {
+                    snapshot.parts[partition_of(record.key, partitions)].push_back(record);
+                } else {
+                    ++snapshot.skipped; // A linked account.
+                }
+            });
+            for (std::uint64_t first_lsn : list_journal_segments(options.journal_dir)) {
+                files.emplace_back(new MappedFile(journal_segment_path(options.journal_dir, first_lsn)));
+            }
+        } else {
+            files.emplace_back(new MappedFile(options.csv_path));
+            slices = split_lines(*files.back(), options.threads * 8);
+        }
+        const std::size_t first_parsed = batches.size();
+        const std::size_t tasks = options.journal_dir.empty() ? slices.size() : files.size();
+        batches.resize(first_parsed + tasks);
+        run_parallel(tasks, options.threads, [&](std::size_t task) {
+            Batch& batch = batches[first_parsed + task];
+            batch.parts.resize(partitions);
+            if (options.journal_dir.empty()) {
+                parse_csv(slices[task].first, slices[task].second, batch);
+            } else {
+                parse_segment(*files[task], after_lsn, batch);
+            }
+        });
+        std::uint64_t parsed = now_ns();
+
+        // Replay: one thread per partition, every account in log order.
+        PinHashConfig pins;
+        pins.iterations = 1; // Every opened account hashes REPLAY_PIN; keep that off the measurement.
+        BankSystem bank(options.shards, pins, options.lock_free ? BalanceMode::LockFree : BalanceMode::Locked);
+        std::vector<PartitionResult> results(partitions);
+        run_parallel(partitions, options.threads, [&](std::size_t partition) {
+            replay_partition(bank, batches, partition, results[partition]);
+        });
+        std::uint64_t replayed = now_ns();
+
+        PartitionResult total;
+        std::size_t records = 0;
+        std::size_t bytes = 0;
+        std::size_t malformed = 0;
+        std::size_t skipped = 0;
+        for (const Batch& batch : batches) {
+            for (const std::vector<ReplayRecord>& part : batch.parts) {
+                records += part.size();
+            }
+            bytes += batch.bytes;
+            malformed += batch.malformed;
+            skipped += batch.skipped;
+        }
+        for (const PartitionResult& result : results) {
+            total.applied += result.applied;
+            total.rejected += result.rejected;
+            total.mismatched += result.mismatched;
+            total.unknown += result.unknown;
+            total.duplicate_opens += result.duplicate_opens;
+            total.accounts += result.accounts;
+            total.checksum += result.checksum;
+        }
+
+        double parse_s = (parsed - start) / 1e9;
+        double replay_s = (replayed - parsed) / 1e9;
+        double total_s = (replayed - start) / 1e9;
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "Replayed " << records << " records (" << bytes / (1024.0 * 1024.0) << " MiB) for "
+                  << total.accounts << " accounts on " << options.threads << " threads, " << options.shards
+                  << " shards" << (options.lock_free ? ", lock-free" : "") << std::endl;
+        std::cout << "Parse:  " << parse_s << " s, " << std::setprecision(0) << records / parse_s << " records/s, "
+                  << std::setprecision(1) << bytes / (1024.0 * 1024.0) / parse_s << " MiB/s" << std::endl;
+        std::cout << "Replay: " << std::setprecision(3) << replay_s << " s, " << std::setprecision(0)
+                  << records / replay_s << " records/s" << std::endl;
+        std::cout << "Total:  " << std::setprecision(3) << total_s << " s, " << std::setprecision(0)
+                  << records / total_s << " records/s" << std::endl;
+        std::cout << "Applied " << total.applied << ", rejected " << total.rejected << ", balance mismatches "
+                  << total.mismatched << ", unknown accounts " << total.unknown << ", duplicate opens "
+                  << total.duplicate_opens << ", malformed " << malformed << ", linked-account records skipped "
+                  << skipped << std::endl;
+        std::cout << "Checksum " << hex(total.checksum) << std::endl;
+
+        if (options.check && total.checksum != options.expected_checksum) {
+            std::cerr << "atm_replay: checksum mismatch, expected " << hex(options.expected_checksum) << std::endl;
+            return 1;
+        }
+        if (options.check) {
+            std::cout << "Checksum matches." << std::endl;
+        }
+        return total.mismatched == 0 ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "atm_replay: " << e.what() << std::endl;
+        return 1;
+    }
+}